@@ -0,0 +1,122 @@
+﻿#include "RAssetPack.h"
+#include "RCompression.h"
+#include "RHash.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace REngine {
+    void RAssetPack::Open(const std::string& path) {
+        Close();
+        m_mapping.Open(path);
+
+        const uint8_t* data = m_mapping.GetData();
+        const size_t size = m_mapping.GetSize();
+        PackHeader header{};
+        if (size < sizeof(header)) {
+            Close();
+            throw std::runtime_error("Truncated asset pack: " + path);
+        }
+        std::memcpy(&header, data, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION) {
+            Close();
+            throw std::runtime_error("Not an asset pack or unsupported version: " + path);
+        }
+
+        const uint64_t tocSize = static_cast<uint64_t>(header.entryCount) * sizeof(PackEntry);
+        if (header.tocOffset > size || tocSize > size - header.tocOffset || header.namesOffset > size) {
+            Close();
+            throw std::runtime_error("Corrupt asset pack TOC: " + path);
+        }
+
+        // Copied out, the TOC is small and payload offsets need not keep it aligned
+        m_entries.resize(header.entryCount);
+        std::memcpy(m_entries.data(), data + header.tocOffset, tocSize);
+        m_names = reinterpret_cast<const char*>(data + header.namesOffset);
+
+        const uint64_t namesSize = size - header.namesOffset;
+        for (const PackEntry& entry : m_entries) {
+            const bool badPayload = entry.offset > size || entry.storedSize > size - entry.offset;
+            const bool badName = static_cast<uint64_t>(entry.nameOffset) + entry.nameLength > namesSize;
+            const bool badCodec = entry.codec != PackCodec::None && entry.codec != PackCodec::LZ4;
+            const bool badSize = entry.codec == PackCodec::None && entry.storedSize != entry.size;
+            if (badPayload || badName || badCodec || badSize) {
+                Close();
+                throw std::runtime_error("Corrupt asset pack entry: " + path);
+            }
+        }
+        if (!std::is_sorted(m_entries.begin(), m_entries.end(), [](const PackEntry& a, const PackEntry& b) {
+            return a.nameHash < b.nameHash;
+        })) {
+            Close();
+            throw std::runtime_error("Asset pack TOC is not sorted: " + path);
+        }
+
+        m_path = path;
+    }
+
+    void RAssetPack::Close() {
+        m_mapping.Close();
+        m_path.clear();
+        m_entries.clear();
+        m_names = nullptr;
+    }
+
+    const PackEntry* RAssetPack::Find(const std::string& name) const {
+        const uint64_t hash = HashBytes(name.data(), name.size());
+        auto it = std::lower_bound(m_entries.begin(), m_entries.end(), hash, [](const PackEntry& entry, const uint64_t value) {
+            return entry.nameHash < value;
+        });
+
+        // Hashes can collide, the names decide
+        for (; it != m_entries.end() && it->nameHash == hash; ++it) {
+            if (it->nameLength == name.size() && std::memcmp(m_names + it->nameOffset, name.data(), name.size()) == 0) {
+                return &*it;
+            }
+        }
+        return nullptr;
+    }
+
+    const uint8_t* RAssetPack::GetPayload(const PackEntry& entry) const {
+        return m_mapping.GetData() + entry.offset;
+    }
+
+    const uint8_t* RAssetPack::GetView(const PackEntry& entry) const {
+        if (entry.codec != PackCodec::None) {
+            throw std::runtime_error("Compressed asset has no view: " + GetName(entry));
+        }
+        return GetPayload(entry);
+    }
+
+    void RAssetPack::ReadInto(const PackEntry& entry, void* dst) const {
+        switch (entry.codec) {
+            case PackCodec::None:
+                std::memcpy(dst, GetPayload(entry), entry.size);
+                break;
+            case PackCodec::LZ4:
+                if (!Lz4Decompress(GetPayload(entry), entry.storedSize, dst, entry.size)) {
+                    throw std::runtime_error("Corrupt LZ4 data in asset: " + GetName(entry));
+                }
+                break;
+        }
+    }
+
+    std::vector<uint8_t> RAssetPack::Read(const std::string& name) const {
+        const PackEntry& entry = Get(name);
+        std::vector<uint8_t> bytes(entry.size);
+        ReadInto(entry, bytes.data());
+        return bytes;
+    }
+
+    std::string RAssetPack::GetName(const PackEntry& entry) const {
+        return std::string(m_names + entry.nameOffset, entry.nameLength);
+    }
+
+    const PackEntry& RAssetPack::Get(const std::string& name) const {
+        const PackEntry* entry = Find(name);
+        if (!entry) {
+            throw std::runtime_error("Asset not found in pack " + m_path + ": " + name);
+        }
+        return *entry;
+    }
+}
@@ -0,0 +1,100 @@
+﻿#pragma once
+#include <RFileMapping.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace REngine {
+    enum class PackCodec : uint16_t {
+        None = 0,
+        LZ4 = 1     // LZ4 block, see RCompression.h
+    };
+
+    enum class PackEntryType : uint16_t {
+        Raw = 0,
+        Shader = 1,     // SPIR-V
+        Texture = 2     // KTX2, DDS or an image stb_image reads
+    };
+
+    // On-disk layout, little endian:
+    //   PackHeader
+    //   payloads, each at a multiple of the pack's alignment
+    //   PackEntry[entryCount], sorted by nameHash
+    //   names, not terminated
+    struct PackHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t alignment;
+        uint64_t tocOffset;
+        uint64_t namesOffset;
+    };
+
+    struct PackEntry {
+        uint64_t nameHash;      // HashBytes() of the name
+        uint64_t offset;        // Payload, from the start of the file
+        uint64_t storedSize;    // Payload bytes in the file
+        uint64_t size;          // Once decompressed
+        uint32_t nameOffset;    // From namesOffset
+        uint32_t nameLength;
+        PackCodec codec;
+        PackEntryType type;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(PackHeader) == 32, "PackHeader layout changed");
+    static_assert(sizeof(PackEntry) == 48, "PackEntry layout changed");
+
+    // Read-only archive of assets, memory mapped. Uncompressed payloads are used
+    // in place: GetView() points into the mapping, so their bytes go from the
+    // page cache straight to wherever they are copied to, e.g. staging memory.
+    // Written by rengine_pack. Lookups are a binary search over the TOC and
+    // safe from any thread.
+    class RAssetPack {
+    public:
+        static constexpr uint32_t MAGIC = 0x4B415052;  // "RPAK"
+        static constexpr uint32_t VERSION = 1;
+        static constexpr uint32_t DEFAULT_ALIGNMENT = 64;
+
+        RAssetPack() = default;
+        explicit RAssetPack(const std::string& path) { Open(path); }
+
+        // Disable copying
+        RAssetPack(const RAssetPack&) = delete;
+        RAssetPack& operator=(const RAssetPack&) = delete;
+
+        // Validates the header and TOC, payloads are only touched when read
+        void Open(const std::string& path);
+        void Close();
+
+        [[nodiscard]] bool IsOpen() const { return m_mapping.IsOpen(); }
+        [[nodiscard]] const std::string& GetPath() const { return m_path; }
+
+        // Names use forward slashes and are relative to the packed directory
+        [[nodiscard]] const PackEntry* Find(const std::string& name) const;
+        [[nodiscard]] bool Contains(const std::string& name) const { return Find(name) != nullptr; }
+
+        // Throws if the name is missing
+        [[nodiscard]] const PackEntry& Get(const std::string& name) const;
+
+        // Payload as stored, compressed or not. Valid while the pack is open.
+        [[nodiscard]] const uint8_t* GetPayload(const PackEntry& entry) const;
+
+        // Zero-copy access; throws for compressed entries
+        [[nodiscard]] const uint8_t* GetView(const PackEntry& entry) const;
+
+        // Decompresses if needed. dst holds entry.size bytes.
+        void ReadInto(const PackEntry& entry, void* dst) const;
+        [[nodiscard]] std::vector<uint8_t> Read(const std::string& name) const;
+
+        [[nodiscard]] const std::vector<PackEntry>& GetEntries() const { return m_entries; }
+        [[nodiscard]] std::string GetName(const PackEntry& entry) const;
+
+    private:
+        RFileMapping m_mapping;
+        std::string m_path;
+        std::vector<PackEntry> m_entries;
+        const char* m_names = nullptr;
+    };
+}
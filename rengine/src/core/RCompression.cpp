@@ -0,0 +1,170 @@
+﻿#include "RCompression.h"
+#include <algorithm>
+#include <cstring>
+
+namespace REngine {
+    namespace {
+        constexpr size_t MIN_MATCH = 4;
+        constexpr size_t LAST_LITERALS = 5;    // The block always ends with this many literals
+        constexpr size_t MATCH_SAFE_END = 12;  // No match may start closer to the end
+        constexpr size_t MAX_OFFSET = 65535;
+        constexpr uint32_t HASH_BITS = 12;
+
+        uint32_t Read32(const uint8_t* data) {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            return value;
+        }
+
+        uint32_t Hash(const uint32_t sequence) {
+            return sequence * 2654435761u >> (32 - HASH_BITS);
+        }
+
+        // Lengths past a token's 4 bits continue in bytes of 255 and a remainder
+        void WriteLength(std::vector<uint8_t>& out, size_t length) {
+            while (length >= 255) {
+                out.push_back(255);
+                length -= 255;
+            }
+            out.push_back(static_cast<uint8_t>(length));
+        }
+
+        bool ReadLength(const uint8_t*& ip, const uint8_t* end, size_t& length) {
+            uint8_t byte;
+            do {
+                if (ip >= end) {
+                    return false;
+                }
+                byte = *ip++;
+                length += byte;
+            } while (byte == 255);
+            return true;
+        }
+
+        void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, const size_t literalLength,
+                           const size_t offset, const size_t matchLength) {
+            const size_t matchCode = matchLength - MIN_MATCH;
+            out.push_back(static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4 | std::min<size_t>(matchCode, 15)));
+            if (literalLength >= 15) {
+                WriteLength(out, literalLength - 15);
+            }
+            out.insert(out.end(), literals, literals + literalLength);
+            out.push_back(static_cast<uint8_t>(offset));
+            out.push_back(static_cast<uint8_t>(offset >> 8));
+            if (matchCode >= 15) {
+                WriteLength(out, matchCode - 15);
+            }
+        }
+    }
+
+    size_t Lz4CompressBound(const size_t size) {
+        return size + size / 255 + 16;
+    }
+
+    std::vector<uint8_t> Lz4Compress(const void* data, const size_t size) {
+        const auto* source = static_cast<const uint8_t*>(data);
+        std::vector<uint8_t> out;
+        out.reserve(Lz4CompressBound(size));
+
+        size_t anchor = 0;
+        if (size > MATCH_SAFE_END) {
+            // Last position each hashed 4 byte sequence was seen at, plus one
+            std::vector<uint32_t> table(size_t(1) << HASH_BITS, 0);
+            const size_t matchLimit = size - LAST_LITERALS;
+            size_t position = 0;
+            while (position + MATCH_SAFE_END <= size) {
+                const uint32_t sequence = Read32(source + position);
+                uint32_t& slot = table[Hash(sequence)];
+                const size_t candidate = slot;
+                slot = static_cast<uint32_t>(position + 1);
+
+                if (candidate == 0 || position - (candidate - 1) > MAX_OFFSET || Read32(source + candidate - 1) != sequence) {
+                    position++;
+                    continue;
+                }
+
+                size_t match = candidate - 1;
+                size_t length = MIN_MATCH;
+                while (position + length < matchLimit && source[match + length] == source[position + length]) {
+                    length++;
+                }
+                // Take over equal literals in front of the match
+                while (position > anchor && match > 0 && source[position - 1] == source[match - 1]) {
+                    position--;
+                    match--;
+                    length++;
+                }
+
+                WriteSequence(out, source + anchor, position - anchor, position - match, length);
+                position += length;
+                anchor = position;
+            }
+        }
+
+        const size_t literalLength = size - anchor;
+        out.push_back(static_cast<uint8_t>(std::min<size_t>(literalLength, 15) << 4));
+        if (literalLength >= 15) {
+            WriteLength(out, literalLength - 15);
+        }
+        out.insert(out.end(), source + anchor, source + size);
+        return out;
+    }
+
+    bool Lz4Decompress(const void* src, const size_t srcSize, void* dst, const size_t dstSize) {
+        const auto* ip = static_cast<const uint8_t*>(src);
+        const uint8_t* const inputEnd = ip + srcSize;
+        auto* const output = static_cast<uint8_t*>(dst);
+        uint8_t* op = output;
+        uint8_t* const outputEnd = output + dstSize;
+
+        while (ip < inputEnd) {
+            const uint8_t token = *ip++;
+
+            size_t literalLength = token >> 4;
+            if (literalLength == 15 && !ReadLength(ip, inputEnd, literalLength)) {
+                return false;
+            }
+            if (literalLength > static_cast<size_t>(inputEnd - ip) || literalLength > static_cast<size_t>(outputEnd - op)) {
+                return false;
+            }
+            std::memcpy(op, ip, literalLength);
+            ip += literalLength;
+            op += literalLength;
+
+            // The last sequence has literals only
+            if (ip == inputEnd) {
+                return op == outputEnd;
+            }
+
+            if (inputEnd - ip < 2) {
+                return false;
+            }
+            const size_t offset = ip[0] | static_cast<size_t>(ip[1]) << 8;
+            ip += 2;
+            if (offset == 0 || offset > static_cast<size_t>(op - output)) {
+                return false;
+            }
+
+            size_t matchLength = token & 15;
+            if (matchLength == 15 && !ReadLength(ip, inputEnd, matchLength)) {
+                return false;
+            }
+            matchLength += MIN_MATCH;
+            if (matchLength > static_cast<size_t>(outputEnd - op)) {
+                return false;
+            }
+
+            // A match closer than its length repeats bytes it is still producing
+            const uint8_t* match = op - offset;
+            if (offset >= matchLength) {
+                std::memcpy(op, match, matchLength);
+                op += matchLength;
+            } else {
+                for (size_t i = 0; i < matchLength; i++) {
+                    *op++ = *match++;
+                }
+            }
+        }
+        return false;
+    }
+}
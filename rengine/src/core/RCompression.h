@@ -0,0 +1,15 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace REngine {
+    // LZ4 block format (no frame header), readable by any LZ4 implementation.
+    // The encoder is a plain greedy one: fast, not the smallest output.
+    size_t Lz4CompressBound(size_t size);
+    std::vector<uint8_t> Lz4Compress(const void* data, size_t size);
+
+    // The decompressed size has to be known, as the block format does not store
+    // it. False on malformed input or if it does not decode to exactly dstSize.
+    bool Lz4Decompress(const void* src, size_t srcSize, void* dst, size_t dstSize);
+}
@@ -1,20 +1,29 @@
 ﻿#pragma once
 #include <platform/RWindows.h>
 #include <core/RTime.h>
+#include <core/RProfiler.h>
 #include <renderers/VulkanRenderer.h>
 #include <renderers/DisplayManager.h>
 #include <renderers/Texture.h>
+#include <renderers/TextureLoader.h>
+#include <renderers/ResourceManager.h>
 
 using REngine::RWindows;
 
 using REngine::RTime;
 
+using REngine::RProfiler;
+
 using REngine::VulkanRenderer;
 
 using REngine::DisplayManager;
 
 using REngine::Texture;
 
+using REngine::TextureLoader;
+
+using REngine::ResourceManager;
+
 namespace REngine {
     class REngineCore {
     public:
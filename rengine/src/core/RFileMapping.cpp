@@ -0,0 +1,107 @@
+﻿#include "RFileMapping.h"
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace REngine {
+    RFileMapping::~RFileMapping() {
+        Close();
+    }
+
+    void RFileMapping::Open(const std::string& path) {
+        Close();
+
+#ifdef _WIN32
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                  FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        LARGE_INTEGER size;
+        if (!GetFileSizeEx(file, &size)) {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to read file size: " + path);
+        }
+        m_file = file;
+        m_size = static_cast<size_t>(size.QuadPart);
+        m_open = true;
+
+        // Empty files cannot be mapped
+        if (m_size == 0) {
+            return;
+        }
+
+        m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (!m_mapping) {
+            Close();
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+        m_data = static_cast<const uint8_t*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!m_data) {
+            Close();
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+#else
+        const int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (file < 0) {
+            throw std::runtime_error("Failed to open file: " + path);
+        }
+        struct stat status{};
+        if (fstat(file, &status) != 0) {
+            close(file);
+            throw std::runtime_error("Failed to read file size: " + path);
+        }
+        m_size = static_cast<size_t>(status.st_size);
+        m_open = true;
+
+        // Empty files cannot be mapped
+        if (m_size == 0) {
+            close(file);
+            return;
+        }
+
+        // The mapping keeps its own reference to the file
+        void* data = mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file, 0);
+        close(file);
+        if (data == MAP_FAILED) {
+            m_size = 0;
+            m_open = false;
+            throw std::runtime_error("Failed to map file: " + path);
+        }
+        m_data = static_cast<const uint8_t*>(data);
+#endif
+    }
+
+    void RFileMapping::Close() {
+#ifdef _WIN32
+        if (m_data) {
+            UnmapViewOfFile(m_data);
+        }
+        if (m_mapping) {
+            CloseHandle(m_mapping);
+            m_mapping = nullptr;
+        }
+        if (m_file) {
+            CloseHandle(m_file);
+            m_file = nullptr;
+        }
+#else
+        if (m_data) {
+            munmap(const_cast<uint8_t*>(m_data), m_size);
+        }
+#endif
+        m_data = nullptr;
+        m_size = 0;
+        m_open = false;
+    }
+}
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace REngine {
+    // Read-only memory mapping of a whole file. Pages are faulted in on first
+    // touch, so only what is read costs I/O, and the OS can drop them again
+    // under memory pressure. Uses mmap, or file mappings on Windows.
+    class RFileMapping {
+    public:
+        RFileMapping() = default;
+        explicit RFileMapping(const std::string& path) { Open(path); }
+        ~RFileMapping();
+
+        // Disable copying
+        RFileMapping(const RFileMapping&) = delete;
+        RFileMapping& operator=(const RFileMapping&) = delete;
+
+        void Open(const std::string& path);
+        void Close();
+
+        [[nodiscard]] bool IsOpen() const { return m_open; }
+        [[nodiscard]] const uint8_t* GetData() const { return m_data; }
+        [[nodiscard]] size_t GetSize() const { return m_size; }
+
+    private:
+        const uint8_t* m_data = nullptr;
+        size_t m_size = 0;
+        bool m_open = false;
+
+#ifdef _WIN32
+        void* m_file = nullptr;
+        void* m_mapping = nullptr;
+#endif
+    };
+}
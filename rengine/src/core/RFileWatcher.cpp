@@ -0,0 +1,141 @@
+﻿#include "RFileWatcher.h"
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace REngine {
+    RFileWatcher::RFileWatcher(Callback callback) : m_callback(std::move(callback)) {
+#ifdef __linux__
+        m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (m_inotify < 0) {
+            throw std::runtime_error("Failed to initialize inotify!");
+        }
+#endif
+        m_thread = std::thread(&RFileWatcher::ThreadLoop, this);
+    }
+
+    RFileWatcher::~RFileWatcher() {
+        m_stopping = true;
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+#ifdef __linux__
+        if (m_inotify >= 0) {
+            close(m_inotify);
+        }
+#endif
+    }
+
+    std::string RFileWatcher::NormalizePath(const std::string& path) {
+        std::error_code error;
+        const std::filesystem::path absolute = std::filesystem::absolute(path, error);
+        return (error ? std::filesystem::path(path) : absolute).lexically_normal().string();
+    }
+
+    std::string RFileWatcher::Watch(const std::string& path) {
+        const std::string file = NormalizePath(path);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_files[file]++ > 0) {
+            return file;
+        }
+
+#ifdef __linux__
+        const std::string directory = std::filesystem::path(file).parent_path().string();
+        if (m_directoryRefs[directory]++ == 0) {
+            const int watch = inotify_add_watch(m_inotify, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (watch < 0) {
+                m_directoryRefs.erase(directory);
+                m_files.erase(file);
+                throw std::runtime_error("Failed to watch directory: " + directory);
+            }
+            m_directoryWatches[directory] = watch;
+            m_watchDirectories[watch] = directory;
+        }
+#else
+        std::error_code error;
+        m_writeTimes[file] = std::filesystem::last_write_time(file, error);
+#endif
+        return file;
+    }
+
+    void RFileWatcher::Unwatch(const std::string& path) {
+        const std::string file = NormalizePath(path);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_files.find(file);
+        if (it == m_files.end() || --it->second > 0) {
+            return;
+        }
+        m_files.erase(it);
+
+#ifdef __linux__
+        const std::string directory = std::filesystem::path(file).parent_path().string();
+        if (--m_directoryRefs[directory] == 0) {
+            const int watch = m_directoryWatches[directory];
+            inotify_rm_watch(m_inotify, watch);
+            m_watchDirectories.erase(watch);
+            m_directoryWatches.erase(directory);
+            m_directoryRefs.erase(directory);
+        }
+#else
+        m_writeTimes.erase(file);
+#endif
+    }
+
+    void RFileWatcher::ThreadLoop() {
+        while (!m_stopping) {
+            // A save usually produces several events, report each file once per wakeup
+            std::unordered_set<std::string> changed;
+
+#ifdef __linux__
+            pollfd descriptor{m_inotify, POLLIN, 0};
+            if (poll(&descriptor, 1, POLL_INTERVAL_MS) <= 0) {
+                continue;
+            }
+
+            alignas(inotify_event) char buffer[4096];
+            ssize_t length;
+            while ((length = read(m_inotify, buffer, sizeof(buffer))) > 0) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (char* cursor = buffer; cursor < buffer + length; ) {
+                    const auto* event = reinterpret_cast<const inotify_event*>(cursor);
+                    cursor += sizeof(inotify_event) + event->len;
+
+                    const auto directory = m_watchDirectories.find(event->wd);
+                    if (event->len == 0 || directory == m_watchDirectories.end()) {
+                        continue;
+                    }
+                    std::string file = (std::filesystem::path(directory->second) / event->name).string();
+                    if (m_files.count(file)) {
+                        changed.insert(std::move(file));
+                    }
+                }
+            }
+#else
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_INTERVAL_MS));
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for (auto& [file, writeTime] : m_writeTimes) {
+                    std::error_code error;
+                    const auto current = std::filesystem::last_write_time(file, error);
+                    if (!error && current != writeTime) {
+                        writeTime = current;
+                        changed.insert(file);
+                    }
+                }
+            }
+#endif
+
+            for (const auto& file : changed) {
+                m_callback(file);
+            }
+        }
+    }
+}
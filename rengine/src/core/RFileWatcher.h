@@ -0,0 +1,55 @@
+﻿#pragma once
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <filesystem>
+
+namespace REngine {
+    // Watches individual files for changes on a background thread. Uses inotify
+    // on Linux (directories are watched so editors that save by renaming a
+    // temporary file are caught) and polls modification times elsewhere.
+    // The callback runs on the watcher thread with the normalized path.
+    class RFileWatcher {
+    public:
+        using Callback = std::function<void(const std::string& path)>;
+
+        explicit RFileWatcher(Callback callback);
+        ~RFileWatcher();
+
+        // Disable copying
+        RFileWatcher(const RFileWatcher&) = delete;
+        RFileWatcher& operator=(const RFileWatcher&) = delete;
+
+        // Returns the normalized path the callback will report
+        std::string Watch(const std::string& path);
+        void Unwatch(const std::string& path);
+
+        static std::string NormalizePath(const std::string& path);
+
+    private:
+        static constexpr int POLL_INTERVAL_MS = 100;
+
+        void ThreadLoop();
+
+        Callback m_callback;
+        std::thread m_thread;
+        std::atomic<bool> m_stopping{false};
+        std::mutex m_mutex;
+
+        // Watched file -> number of Watch() calls
+        std::unordered_map<std::string, uint32_t> m_files;
+
+#ifdef __linux__
+        int m_inotify = -1;
+        std::unordered_map<std::string, int> m_directoryWatches;  // Directory -> watch descriptor
+        std::unordered_map<int, std::string> m_watchDirectories;  // Watch descriptor -> directory
+        std::unordered_map<std::string, uint32_t> m_directoryRefs;
+#else
+        std::unordered_map<std::string, std::filesystem::file_time_type> m_writeTimes;
+#endif
+    };
+}
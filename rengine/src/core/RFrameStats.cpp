@@ -0,0 +1,178 @@
+﻿#include "RFrameStats.h"
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+namespace REngine {
+    namespace {
+        // 1-based rank of the sample at the given percentile (nearest-rank method)
+        uint64_t PercentileRank(const float percentile, const uint32_t count) {
+            const double rank = std::ceil(static_cast<double>(percentile) / 100.0 * count - 1e-6);
+            return std::max<uint64_t>(1, static_cast<uint64_t>(std::max(rank, 0.0)));
+        }
+    }
+
+    RFrameStats::RFrameStats(const uint32_t windowFrames, const float hitchThresholdMS)
+        : m_window(windowFrames)
+        , m_hitchThresholdMS(hitchThresholdMS) {
+        m_histogram.resize(BucketIndex(MAX_MS) + 1, 0);
+    }
+
+    uint32_t RFrameStats::BucketIndex(const float frameTimeMS) {
+        if (!(frameTimeMS > MIN_MS)) {
+            return 0;
+        }
+        const float clamped = std::min(frameTimeMS, MAX_MS);
+        return static_cast<uint32_t>(std::ceil(std::log(clamped / MIN_MS) / std::log(BUCKET_GROWTH)));
+    }
+
+    float RFrameStats::BucketValue(const uint32_t bucket) const {
+        if (bucket == 0) {
+            return MIN_MS;
+        }
+        // Geometric middle of (MIN * G^(b-1), MIN * G^b]
+        const float value = MIN_MS * std::pow(BUCKET_GROWTH, static_cast<float>(bucket) - 0.5f);
+        return m_maxCandidates.empty() ? value : std::min(value, m_maxCandidates.front());
+    }
+
+    void RFrameStats::AddSample(const float frameTimeMS) {
+        m_histogram[BucketIndex(frameTimeMS)]++;
+        m_sumMS += frameTimeMS;
+        m_sampleCount++;
+
+        if (frameTimeMS > m_hitchThresholdMS) {
+            m_hitchCount++;
+            m_totalHitchCount++;
+        }
+
+        if (m_window == 0) {
+            // Unbounded: nothing ever leaves, only the overall max matters
+            if (m_maxCandidates.empty()) {
+                m_maxCandidates.push_back(frameTimeMS);
+            } else {
+                m_maxCandidates.front() = std::max(m_maxCandidates.front(), frameTimeMS);
+            }
+        } else {
+            while (!m_maxCandidates.empty() && m_maxCandidates.back() < frameTimeMS) {
+                m_maxCandidates.pop_back();
+            }
+            m_maxCandidates.push_back(frameTimeMS);
+
+            m_samples.push_back(frameTimeMS);
+            while (m_samples.size() > m_window) {
+                RemoveOldest();
+            }
+        }
+
+        m_snapshotDirty = true;
+    }
+
+    void RFrameStats::RemoveOldest() {
+        const float oldest = m_samples.front();
+        m_samples.pop_front();
+
+        m_histogram[BucketIndex(oldest)]--;
+        m_sumMS -= oldest;
+        m_sampleCount--;
+        if (oldest > m_hitchThresholdMS && m_hitchCount > 0) {
+            m_hitchCount--;
+        }
+        if (!m_maxCandidates.empty() && m_maxCandidates.front() == oldest) {
+            m_maxCandidates.pop_front();
+        }
+    }
+
+    void RFrameStats::Reset() {
+        std::fill(m_histogram.begin(), m_histogram.end(), 0);
+        m_samples.clear();
+        m_maxCandidates.clear();
+        m_sumMS = 0.0;
+        m_sampleCount = 0;
+        m_hitchCount = 0;
+        m_totalHitchCount = 0;
+        m_snapshot = {};
+        m_snapshotDirty = true;
+    }
+
+    void RFrameStats::SetWindow(const uint32_t frames) {
+        if (frames == m_window) {
+            return;
+        }
+        // Switching to or from the unbounded mode invalidates the bookkeeping
+        if (frames == 0 || m_window == 0) {
+            m_window = frames;
+            Reset();
+            return;
+        }
+
+        m_window = frames;
+        while (m_samples.size() > m_window) {
+            RemoveOldest();
+        }
+        m_snapshotDirty = true;
+    }
+
+    void RFrameStats::SetHitchThreshold(const float thresholdMS) {
+        m_hitchThresholdMS = thresholdMS;
+
+        // The window can be recounted, the unbounded mode only applies it from now on
+        if (m_window > 0) {
+            m_hitchCount = static_cast<uint32_t>(std::count_if(m_samples.begin(), m_samples.end(),
+                [thresholdMS](const float sample) { return sample > thresholdMS; }));
+        }
+        m_snapshotDirty = true;
+    }
+
+    const FrameStatsSnapshot& RFrameStats::GetSnapshot() const {
+        if (!m_snapshotDirty) {
+            return m_snapshot;
+        }
+
+        const uint32_t count = m_sampleCount;
+
+        FrameStatsSnapshot snapshot;
+        snapshot.frameCount = count;
+        snapshot.hitchCount = m_hitchCount;
+        snapshot.totalHitchCount = m_totalHitchCount;
+
+        if (count > 0) {
+            snapshot.meanMS = static_cast<float>(m_sumMS / count);
+            snapshot.maxMS = m_maxCandidates.front();
+
+            // One pass over the histogram for every percentile
+            const float percentiles[] = {50.0f, 95.0f, 99.0f, 99.9f};
+            float* outputs[] = {&snapshot.p50MS, &snapshot.p95MS, &snapshot.p99MS, &snapshot.p999MS};
+
+            size_t next = 0;
+            uint64_t cumulative = 0;
+            for (uint32_t bucket = 0; bucket < m_histogram.size() && next < std::size(percentiles); bucket++) {
+                cumulative += m_histogram[bucket];
+                while (next < std::size(percentiles) &&
+                       cumulative >= PercentileRank(percentiles[next], count)) {
+                    *outputs[next++] = BucketValue(bucket);
+                }
+            }
+        }
+
+        m_snapshot = snapshot;
+        m_snapshotDirty = false;
+        return m_snapshot;
+    }
+
+    float RFrameStats::GetPercentile(const float percentile) const {
+        const uint32_t count = GetSnapshot().frameCount;
+        if (count == 0) {
+            return 0.0f;
+        }
+
+        const uint64_t rank = PercentileRank(std::clamp(percentile, 0.0f, 100.0f), count);
+        uint64_t cumulative = 0;
+        for (uint32_t bucket = 0; bucket < m_histogram.size(); bucket++) {
+            cumulative += m_histogram[bucket];
+            if (cumulative >= rank) {
+                return BucketValue(bucket);
+            }
+        }
+        return m_maxCandidates.front();
+    }
+}
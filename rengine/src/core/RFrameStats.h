@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace REngine {
+    struct FrameStatsSnapshot {
+        uint32_t frameCount = 0;  // Samples in the window
+        float meanMS = 0.0f;
+        float p50MS = 0.0f;
+        float p95MS = 0.0f;
+        float p99MS = 0.0f;
+        float p999MS = 0.0f;
+        float maxMS = 0.0f;
+        uint32_t hitchCount = 0;      // Frames in the window above the hitch threshold
+        uint64_t totalHitchCount = 0; // Since the last Reset()
+    };
+
+    // Streaming frame-time statistics over a sliding window of frames. Samples
+    // go into a log-scale histogram (about 1% relative error) and a running
+    // sum, so adding a frame is O(1) and a snapshot is a single histogram scan.
+    class RFrameStats {
+    public:
+        static constexpr uint32_t DEFAULT_WINDOW = 1000;
+        static constexpr float DEFAULT_HITCH_THRESHOLD_MS = 33.3f;
+
+        // A window of 0 keeps every sample since the last Reset()
+        explicit RFrameStats(uint32_t windowFrames = DEFAULT_WINDOW, float hitchThresholdMS = DEFAULT_HITCH_THRESHOLD_MS);
+
+        void AddSample(float frameTimeMS);
+        void Reset();
+
+        void SetWindow(uint32_t frames);
+        void SetHitchThreshold(float thresholdMS);
+
+        [[nodiscard]] uint32_t GetWindow() const { return m_window; }
+        [[nodiscard]] float GetHitchThreshold() const { return m_hitchThresholdMS; }
+
+        // Cached until the next sample, so calling it every frame from several
+        // places costs one scan
+        const FrameStatsSnapshot& GetSnapshot() const;
+
+        // Any percentile in [0, 100]
+        [[nodiscard]] float GetPercentile(float percentile) const;
+
+    private:
+        static constexpr float MIN_MS = 0.01f;
+        static constexpr float MAX_MS = 10000.0f;
+        static constexpr float BUCKET_GROWTH = 1.01f;
+
+        static uint32_t BucketIndex(float frameTimeMS);
+        float BucketValue(uint32_t bucket) const;
+
+        void RemoveOldest();
+
+        uint32_t m_window;
+        float m_hitchThresholdMS;
+
+        std::vector<uint32_t> m_histogram;
+        std::deque<float> m_samples;          // Samples in the window, oldest first
+        std::deque<float> m_maxCandidates;    // Monotonic decreasing, front is the window max
+        double m_sumMS = 0.0;
+        uint32_t m_sampleCount = 0;
+        uint32_t m_hitchCount = 0;
+        uint64_t m_totalHitchCount = 0;
+
+        mutable FrameStatsSnapshot m_snapshot;
+        mutable bool m_snapshotDirty = true;
+    };
+}
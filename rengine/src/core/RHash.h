@@ -0,0 +1,21 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+namespace REngine {
+    // FNV-1a, used for content hashes of blobs (shaders, cache files)
+    inline uint64_t HashBytes(const void* data, const size_t size, uint64_t hash = 14695981039346656037ull) {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // Mixes value into seed, for hashing keys field by field
+    inline void HashCombine(size_t& seed, const uint64_t value) {
+        seed ^= std::hash<uint64_t>{}(value) + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+    }
+}
@@ -0,0 +1,149 @@
+﻿#include "RProfiler.h"
+#include <fstream>
+
+namespace REngine {
+    // Initialize static members
+    const RProfiler::Clock::time_point RProfiler::s_Epoch = RProfiler::Clock::now();
+    std::atomic<bool> RProfiler::s_Enabled{true};
+    std::atomic<uint64_t> RProfiler::s_DroppedZones{0};
+    std::mutex RProfiler::s_Mutex;
+    std::vector<std::shared_ptr<RProfiler::ThreadBuffer>> RProfiler::s_Buffers;
+    std::deque<RProfiler::Frame> RProfiler::s_History;
+    uint32_t RProfiler::s_HistorySize = 300;
+    uint32_t RProfiler::s_NextThreadId = 1;
+    uint64_t RProfiler::s_FrameStartNS = 0;
+
+    namespace {
+        void WriteEscaped(std::ofstream& file, const char* text) {
+            for (const char* c = text; *c; c++) {
+                if (*c == '"' || *c == '\\') {
+                    file << '\\';
+                }
+                file << *c;
+            }
+        }
+    }
+
+    void RProfiler::SetEnabled(const bool enabled) {
+        s_Enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    RProfiler::ThreadBuffer& RProfiler::GetThreadBuffer() {
+        // The registry keeps a reference so zones of exited threads can still be collected
+        thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+            auto created = std::make_shared<ThreadBuffer>();
+            std::lock_guard<std::mutex> lock(s_Mutex);
+            created->threadId = s_NextThreadId++;
+            created->name = "Thread " + std::to_string(created->threadId);
+            s_Buffers.push_back(created);
+            return created;
+        }();
+        return *buffer;
+    }
+
+    void RProfiler::SetThreadName(const std::string& name) {
+        ThreadBuffer& buffer = GetThreadBuffer();
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        buffer.name = name;
+    }
+
+    void RProfiler::Record(const char* name, const uint64_t startNS, const uint64_t endNS) {
+        ThreadBuffer& buffer = GetThreadBuffer();
+
+        const uint64_t write = buffer.writeIndex.load(std::memory_order_relaxed);
+        if (write - buffer.readIndex.load(std::memory_order_acquire) >= THREAD_BUFFER_SIZE) {
+            // Nobody collected in time, drop rather than block
+            s_DroppedZones.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        buffer.zones[write % THREAD_BUFFER_SIZE] = {name, startNS, endNS - startNS, buffer.threadId};
+        buffer.writeIndex.store(write + 1, std::memory_order_release);
+    }
+
+    void RProfiler::NewFrame() {
+        const uint64_t now = Now();
+
+        std::lock_guard<std::mutex> lock(s_Mutex);
+
+        Frame frame{s_FrameStartNS, now, {}};
+        for (auto it = s_Buffers.begin(); it != s_Buffers.end(); ) {
+            ThreadBuffer& buffer = **it;
+
+            const uint64_t write = buffer.writeIndex.load(std::memory_order_acquire);
+            const uint64_t read = buffer.readIndex.load(std::memory_order_relaxed);
+            for (uint64_t i = read; i < write; i++) {
+                frame.zones.push_back(buffer.zones[i % THREAD_BUFFER_SIZE]);
+            }
+            buffer.readIndex.store(write, std::memory_order_release);
+
+            // Only the registry still references the buffer of an exited thread
+            if (it->use_count() == 1 && read == write) {
+                it = s_Buffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        s_FrameStartNS = now;
+
+        if (s_HistorySize == 0) {
+            return;
+        }
+        s_History.push_back(std::move(frame));
+        while (s_History.size() > s_HistorySize) {
+            s_History.pop_front();
+        }
+    }
+
+    void RProfiler::SetHistorySize(const uint32_t frames) {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        s_HistorySize = frames;
+        while (s_History.size() > s_HistorySize) {
+            s_History.pop_front();
+        }
+    }
+
+    std::deque<RProfiler::Frame> RProfiler::GetHistory() {
+        std::lock_guard<std::mutex> lock(s_Mutex);
+        return s_History;
+    }
+
+    bool RProfiler::WriteChromeTrace(const std::string& path) {
+        std::ofstream file(path, std::ios::trunc);
+        if (!file.is_open()) {
+            return false;
+        }
+
+        std::lock_guard<std::mutex> lock(s_Mutex);
+
+        // Timestamps are in microseconds
+        file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        file << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"REngine\"}}";
+
+        for (const auto& buffer : s_Buffers) {
+            file << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId
+                 << ",\"args\":{\"name\":\"";
+            WriteEscaped(file, buffer->name.c_str());
+            file << "\"}}";
+        }
+
+        file.precision(3);
+        file << std::fixed;
+        uint64_t frameIndex = 0;
+        for (const auto& frame : s_History) {
+            file << ",\n{\"name\":\"Frame " << frameIndex++ << "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":0,\"ts\":"
+                 << frame.startNS / 1000.0 << "}";
+
+            for (const auto& zone : frame.zones) {
+                file << ",\n{\"name\":\"";
+                WriteEscaped(file, zone.name);
+                file << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << zone.threadId
+                     << ",\"ts\":" << zone.startNS / 1000.0
+                     << ",\"dur\":" << zone.durationNS / 1000.0 << "}";
+            }
+        }
+
+        file << "\n]}\n";
+        return file.good();
+    }
+}
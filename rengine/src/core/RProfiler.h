@@ -0,0 +1,115 @@
+﻿#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace REngine {
+    // CPU zone profiler. Every thread writes into its own single-producer ring,
+    // so recording a zone takes no lock. NewFrame() drains the rings into a
+    // bounded history of frames which WriteChromeTrace() dumps as Chrome trace
+    // JSON (also readable by Perfetto).
+    class RProfiler {
+    public:
+        struct Zone {
+            const char* name;
+            uint64_t startNS;
+            uint64_t durationNS;
+            uint32_t threadId;
+        };
+
+        struct Frame {
+            uint64_t startNS;
+            uint64_t endNS;
+            std::vector<Zone> zones;
+        };
+
+        static void SetEnabled(bool enabled);
+        static bool IsEnabled() { return s_Enabled.load(std::memory_order_relaxed); }
+
+        // Name shown for the calling thread in the trace
+        static void SetThreadName(const std::string& name);
+
+        // Collects zones recorded since the previous call. Call once per frame.
+        static void NewFrame();
+
+        // Number of frames kept for export (default 300)
+        static void SetHistorySize(uint32_t frames);
+
+        // Dumps the collected history, returns false if the file can't be written
+        static bool WriteChromeTrace(const std::string& path);
+
+        static uint64_t GetDroppedZoneCount() { return s_DroppedZones.load(std::memory_order_relaxed); }
+        static std::deque<Frame> GetHistory();
+
+        // name must outlive the profiler (string literal or __func__)
+        static void Record(const char* name, uint64_t startNS, uint64_t endNS);
+
+        // Nanoseconds since the profiler epoch
+        static uint64_t Now() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - s_Epoch).count());
+        }
+
+    private:
+        using Clock = std::chrono::steady_clock;
+
+        static constexpr uint32_t THREAD_BUFFER_SIZE = 16384;
+
+        struct ThreadBuffer {
+            uint32_t threadId = 0;
+            std::string name;
+            std::array<Zone, THREAD_BUFFER_SIZE> zones;
+            std::atomic<uint64_t> writeIndex{0};  // Written by the owning thread only
+            std::atomic<uint64_t> readIndex{0};   // Written by NewFrame() only
+        };
+
+        static ThreadBuffer& GetThreadBuffer();
+
+        static const Clock::time_point s_Epoch;
+        static std::atomic<bool> s_Enabled;
+        static std::atomic<uint64_t> s_DroppedZones;
+
+        // Guards buffer registration and the history, never taken while recording
+        static std::mutex s_Mutex;
+        static std::vector<std::shared_ptr<ThreadBuffer>> s_Buffers;
+        static std::deque<Frame> s_History;
+        static uint32_t s_HistorySize;
+        static uint32_t s_NextThreadId;
+        static uint64_t s_FrameStartNS;
+    };
+
+    class RProfileScope {
+    public:
+        explicit RProfileScope(const char* name)
+            : m_name(name), m_startNS(RProfiler::IsEnabled() ? RProfiler::Now() : 0) {}
+
+        ~RProfileScope() {
+            if (m_startNS != 0) {
+                RProfiler::Record(m_name, m_startNS, RProfiler::Now());
+            }
+        }
+
+        RProfileScope(const RProfileScope&) = delete;
+        RProfileScope& operator=(const RProfileScope&) = delete;
+
+    private:
+        const char* m_name;
+        uint64_t m_startNS;
+    };
+}
+
+#define RPROFILE_CONCAT_IMPL(a, b) a##b
+#define RPROFILE_CONCAT(a, b) RPROFILE_CONCAT_IMPL(a, b)
+
+#ifndef RENGINE_DISABLE_PROFILER
+#define RPROFILE_SCOPE(name) ::REngine::RProfileScope RPROFILE_CONCAT(rprofileScope, __LINE__)(name)
+#define RPROFILE_FUNCTION() RPROFILE_SCOPE(__func__)
+#else
+#define RPROFILE_SCOPE(name)
+#define RPROFILE_FUNCTION()
+#endif
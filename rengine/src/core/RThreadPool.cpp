@@ -0,0 +1,49 @@
+﻿#include "RThreadPool.h"
+#include "RProfiler.h"
+#include <algorithm>
+
+namespace REngine {
+    RThreadPool::RThreadPool(uint32_t threadCount) {
+        if (threadCount == 0) {
+            const uint32_t hardwareThreads = std::thread::hardware_concurrency();
+            threadCount = std::max(hardwareThreads, 2u) - 1;
+        }
+
+        m_workers.reserve(threadCount);
+        for (uint32_t i = 0; i < threadCount; i++) {
+            m_workers.emplace_back(&RThreadPool::WorkerLoop, this);
+        }
+    }
+
+    RThreadPool::~RThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void RThreadPool::WorkerLoop() {
+        RProfiler::SetThreadName("Worker");
+
+        for (;;) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stopping || !m_tasks.empty(); });
+
+                // Drain the queue before stopping so no future is left unfulfilled
+                if (m_tasks.empty()) {
+                    return;
+                }
+                task = std::move(m_tasks.front());
+                m_tasks.pop();
+            }
+            task();
+        }
+    }
+}
@@ -0,0 +1,49 @@
+﻿#pragma once
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace REngine {
+    // Fixed-size pool of worker threads fed from a single FIFO queue
+    class RThreadPool {
+    public:
+        // 0 picks hardware_concurrency - 1 (at least one worker)
+        explicit RThreadPool(uint32_t threadCount = 0);
+        ~RThreadPool();
+
+        // Disable copying
+        RThreadPool(const RThreadPool&) = delete;
+        RThreadPool& operator=(const RThreadPool&) = delete;
+
+        template<typename F>
+        auto Submit(F&& task) -> std::future<std::invoke_result_t<std::decay_t<F>>> {
+            using Result = std::invoke_result_t<std::decay_t<F>>;
+
+            auto packaged = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(task));
+            std::future<Result> future = packaged->get_future();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_tasks.emplace([packaged]() { (*packaged)(); });
+            }
+            m_condition.notify_one();
+            return future;
+        }
+
+        [[nodiscard]] uint32_t GetThreadCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+    private:
+        void WorkerLoop();
+
+        std::vector<std::thread> m_workers;
+        std::queue<std::function<void()>> m_tasks;
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        bool m_stopping = false;
+    };
+}
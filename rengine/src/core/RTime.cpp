@@ -13,13 +13,18 @@ namespace REngine {
     bool RTime::s_Paused = false;
     std::array<float, RTime::FRAME_TIME_WINDOW> RTime::s_FrameTimeSamples;
     int RTime::s_CurrentSampleIndex = 0;
+    double RTime::s_FrameTimeSampleSum = 16.666 * RTime::FRAME_TIME_WINDOW;
     float RTime::s_SmoothedFrameTimeMS = 16.666f; // Initialize to ~60FPS
+    RFrameStats RTime::s_FrameStats;
 
     void RTime::Init() {
         s_StartTime = Clock::now();
         s_LastFrameTime = s_StartTime;
         s_CurrentFrameTime = s_StartTime;
         std::fill(s_FrameTimeSamples.begin(), s_FrameTimeSamples.end(), 16.666f);
+        s_FrameTimeSampleSum = 16.666 * FRAME_TIME_WINDOW;
+        s_CurrentSampleIndex = 0;
+        s_FrameStats.Reset();
     }
 
     void RTime::Update() {
@@ -37,6 +42,9 @@ namespace REngine {
         s_DeltaTimeMS = delta.count();
         s_DeltaTime = s_DeltaTimeMS * 0.001f; // Convert to seconds
 
+        // Statistics see the real frame time, hitches are what they are for
+        s_FrameStats.AddSample(s_DeltaTimeMS);
+
         // Clamp to avoid extreme values (e.g., during debugging)
         const float MAX_DELTA_MS = 100.0f; // 100ms max frame time
         s_DeltaTimeMS = std::min(s_DeltaTimeMS, MAX_DELTA_MS);
@@ -47,16 +55,13 @@ namespace REngine {
         s_SmoothDeltaTimeMS = s_SmoothDeltaTimeMS * (1.0f - smoothFactor) + s_DeltaTimeMS * smoothFactor;
         s_SmoothDeltaTime = s_SmoothDeltaTimeMS * 0.001f;
 
-        // Update frame time samples for smoothing
+        // Update frame time samples for smoothing, keeping the running sum in step
+        s_FrameTimeSampleSum += s_DeltaTimeMS - s_FrameTimeSamples[s_CurrentSampleIndex];
         s_FrameTimeSamples[s_CurrentSampleIndex] = s_DeltaTimeMS;
         s_CurrentSampleIndex = (s_CurrentSampleIndex + 1) % FRAME_TIME_WINDOW;
 
-        // Calculate smoothed frame time (average of last N frames)
-        float total = 0.0f;
-        for (float sample : s_FrameTimeSamples) {
-            total += sample;
-        }
-        s_SmoothedFrameTimeMS = total / FRAME_TIME_WINDOW;
+        // Smoothed frame time (average of last N frames)
+        s_SmoothedFrameTimeMS = static_cast<float>(s_FrameTimeSampleSum / FRAME_TIME_WINDOW);
 
         s_FrameCount++;
     }
@@ -87,4 +92,11 @@ namespace REngine {
     uint64_t RTime::GetFrameCount() { return s_FrameCount; }
     void RTime::SetPaused(bool paused) { s_Paused = paused; }
     bool RTime::IsPaused() { return s_Paused; }
+
+    const FrameStatsSnapshot& RTime::GetFrameStats() { return s_FrameStats.GetSnapshot(); }
+    float RTime::GetFrameTimePercentileMS(const float percentile) { return s_FrameStats.GetPercentile(percentile); }
+    void RTime::SetFrameStatsWindow(const uint32_t frames) { s_FrameStats.SetWindow(frames); }
+    void RTime::SetHitchThresholdMS(const float thresholdMS) { s_FrameStats.SetHitchThreshold(thresholdMS); }
+    float RTime::GetHitchThresholdMS() { return s_FrameStats.GetHitchThreshold(); }
+    void RTime::ResetFrameStats() { s_FrameStats.Reset(); }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include <chrono>
 #include <array>
+#include "RFrameStats.h"
 namespace REngine {
     class RTime {
     public:
@@ -37,6 +38,15 @@ namespace REngine {
         static void SetPaused(bool paused);
         static bool IsPaused();
 
+        // Frame-time distribution over the stats window (unclamped frame times).
+        // The snapshot is computed at most once per frame.
+        static const FrameStatsSnapshot& GetFrameStats();
+        static float GetFrameTimePercentileMS(float percentile);
+        static void SetFrameStatsWindow(uint32_t frames);
+        static void SetHitchThresholdMS(float thresholdMS);
+        static float GetHitchThresholdMS();
+        static void ResetFrameStats();
+
     private:
         using Clock = std::chrono::high_resolution_clock;
         using TimePoint = std::chrono::time_point<Clock>;
@@ -56,6 +66,9 @@ namespace REngine {
         static constexpr int FRAME_TIME_WINDOW = 60;
         static std::array<float, FRAME_TIME_WINDOW> s_FrameTimeSamples;
         static int s_CurrentSampleIndex;
+        static double s_FrameTimeSampleSum; // Running sum of s_FrameTimeSamples
         static float s_SmoothedFrameTimeMS;
+
+        static RFrameStats s_FrameStats;
     };
 }
\ No newline at end of file
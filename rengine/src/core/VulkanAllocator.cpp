@@ -0,0 +1,514 @@
+﻿#include "VulkanAllocator.h"
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+
+namespace REngine {
+    namespace {
+        VkDeviceSize AlignUp(const VkDeviceSize value, const VkDeviceSize alignment) {
+            return (value + alignment - 1) & ~(alignment - 1);
+        }
+
+        VkDeviceSize NextPowerOfTwo(VkDeviceSize value) {
+            VkDeviceSize result = 1;
+            while (result < value) {
+                result <<= 1;
+            }
+            return result;
+        }
+    }
+
+    VulkanAllocator::~VulkanAllocator() {
+        Shutdown();
+    }
+
+    void VulkanAllocator::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget) {
+        m_device = device;
+        m_physicalDevice = physicalDevice;
+        m_memoryBudget = memoryBudget;
+
+        vkGetPhysicalDeviceProperties(physicalDevice, &m_deviceProperties);
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+        m_granularity = std::max<VkDeviceSize>(m_deviceProperties.limits.bufferImageGranularity, 1);
+
+        m_pools.clear();
+        m_pools.resize(m_memoryProperties.memoryTypeCount);
+
+        for (uint32_t type = 0; type < m_memoryProperties.memoryTypeCount; type++) {
+            // Keep small heaps (e.g. 256 MB BAR) from being eaten by a couple of blocks
+            const uint32_t heapIndex = m_memoryProperties.memoryTypes[type].heapIndex;
+            const VkDeviceSize heapSize = m_memoryProperties.memoryHeaps[heapIndex].size;
+            const VkDeviceSize blockSize = std::clamp<VkDeviceSize>(
+                NextPowerOfTwo(heapSize / 8) / 2, SLAB_BLOCK_SIZE, DEFAULT_BLOCK_SIZE);
+
+            MemoryTypePools& pools = m_pools[type];
+            for (size_t kind = 0; kind < static_cast<size_t>(AllocationKind::Count); kind++) {
+                for (uint32_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+                    Pool& pool = pools.buckets[kind][bucket];
+                    pool.strategy = AllocationStrategy::Default;
+                    pool.memoryType = type;
+                    pool.blockSize = SLAB_BLOCK_SIZE;
+                    pool.slotSize = MIN_BUCKET_SIZE << bucket;
+                }
+
+                pools.general[kind].strategy = AllocationStrategy::Default;
+                pools.general[kind].memoryType = type;
+                pools.general[kind].blockSize = blockSize;
+
+                pools.linear[kind].strategy = AllocationStrategy::Linear;
+                pools.linear[kind].memoryType = type;
+                pools.linear[kind].blockSize = blockSize;
+            }
+        }
+
+        m_heapStats = {};
+        m_dedicatedCount = 0;
+        m_deviceMemoryCount = 0;
+    }
+
+    void VulkanAllocator::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t leaked = m_dedicatedCount;
+        for (auto& pools : m_pools) {
+            auto destroyPool = [&](Pool& pool) {
+                for (auto& block : pool.blocks) {
+                    if (pool.strategy != AllocationStrategy::Linear) {
+                        leaked += block->allocationCount;
+                    }
+                    DestroyBlock(*block);
+                }
+                pool.blocks.clear();
+            };
+
+            for (auto& kindBuckets : pools.buckets) {
+                for (auto& pool : kindBuckets) {
+                    destroyPool(pool);
+                }
+            }
+            for (auto& pool : pools.general) {
+                destroyPool(pool);
+            }
+            for (auto& pool : pools.linear) {
+                destroyPool(pool);
+            }
+        }
+
+        for (auto& block : m_dedicatedBlocks) {
+            DestroyBlock(*block);
+        }
+        m_dedicatedBlocks.clear();
+
+        if (leaked > 0) {
+            std::cerr << "VulkanAllocator: " << leaked << " allocation(s) still alive at shutdown" << std::endl;
+        }
+
+        m_pools.clear();
+        m_device = VK_NULL_HANDLE;
+        m_physicalDevice = VK_NULL_HANDLE;
+    }
+
+    uint32_t VulkanAllocator::FindMemoryType(const uint32_t typeFilter, const VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+            if ((typeFilter & (1 << i)) &&
+                (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("Failed to find suitable memory type!");
+    }
+
+    VulkanAllocator::Pool& VulkanAllocator::SelectPool(
+        const uint32_t memoryType,
+        const AllocationKind kind,
+        const AllocationStrategy strategy,
+        const VkDeviceSize size,
+        const VkDeviceSize alignment
+    ) {
+        // With a granularity of 1 linear and optimal resources can share blocks,
+        // otherwise they live in separate pools so they never share a page.
+        const size_t kindIndex = m_granularity > 1 ? static_cast<size_t>(kind) : 0;
+        MemoryTypePools& pools = m_pools[memoryType];
+
+        if (strategy == AllocationStrategy::Linear) {
+            return pools.linear[kindIndex];
+        }
+
+        // Slots are power-of-two sized and slab offsets are multiples of the slot
+        // size, so any power-of-two alignment up to the slot size is satisfied.
+        const VkDeviceSize slotSize = NextPowerOfTwo(std::max({size, alignment, MIN_BUCKET_SIZE}));
+        for (uint32_t bucket = 0; bucket < BUCKET_COUNT; bucket++) {
+            if (pools.buckets[kindIndex][bucket].slotSize == slotSize) {
+                return pools.buckets[kindIndex][bucket];
+            }
+        }
+
+        return pools.general[kindIndex];
+    }
+
+    std::unique_ptr<VulkanAllocator::Block> VulkanAllocator::CreateBlock(const uint32_t memoryType, const VkDeviceSize size) {
+        if (m_deviceMemoryCount >= m_deviceProperties.limits.maxMemoryAllocationCount) {
+            throw std::runtime_error("Exceeded maxMemoryAllocationCount!");
+        }
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memoryType;
+
+        auto block = std::make_unique<Block>();
+        block->memoryType = memoryType;
+        block->size = size;
+
+        if (vkAllocateMemory(m_device, &allocInfo, nullptr, &block->memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate device memory block!");
+        }
+
+        // Host-visible blocks stay mapped for their whole lifetime
+        if (m_memoryProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+            if (vkMapMemory(m_device, block->memory, 0, VK_WHOLE_SIZE, 0, &block->mapped) != VK_SUCCESS) {
+                vkFreeMemory(m_device, block->memory, nullptr);
+                throw std::runtime_error("Failed to map device memory block!");
+            }
+        }
+
+        auto& heap = m_heapStats[m_memoryProperties.memoryTypes[memoryType].heapIndex];
+        heap.blockBytes += size;
+        heap.blockCount++;
+        m_deviceMemoryCount++;
+
+        return block;
+    }
+
+    void VulkanAllocator::DestroyBlock(Block& block) {
+        if (block.memory == VK_NULL_HANDLE) {
+            return;
+        }
+
+        if (block.mapped) {
+            vkUnmapMemory(m_device, block.memory);
+            block.mapped = nullptr;
+        }
+        vkFreeMemory(m_device, block.memory, nullptr);
+        block.memory = VK_NULL_HANDLE;
+
+        auto& heap = m_heapStats[m_memoryProperties.memoryTypes[block.memoryType].heapIndex];
+        heap.blockBytes -= block.size;
+        heap.blockCount--;
+        m_deviceMemoryCount--;
+    }
+
+    bool VulkanAllocator::AllocateFromBlock(Block& block, const VkDeviceSize size, const VkDeviceSize alignment, VkDeviceSize& offset) {
+        const Pool& pool = *block.pool;
+
+        if (pool.slotSize != 0) {
+            if (block.freeSlots.empty()) {
+                return false;
+            }
+            offset = static_cast<VkDeviceSize>(block.freeSlots.back()) * pool.slotSize;
+            block.freeSlots.pop_back();
+            return true;
+        }
+
+        if (pool.strategy == AllocationStrategy::Linear) {
+            const VkDeviceSize aligned = AlignUp(block.head, alignment);
+            if (aligned + size > block.size) {
+                return false;
+            }
+            offset = aligned;
+            block.head = aligned + size;
+            return true;
+        }
+
+        // First fit over the free ranges
+        for (auto it = block.freeRanges.begin(); it != block.freeRanges.end(); ++it) {
+            const VkDeviceSize rangeOffset = it->first;
+            const VkDeviceSize rangeEnd = it->first + it->second;
+            const VkDeviceSize aligned = AlignUp(rangeOffset, alignment);
+
+            if (aligned + size > rangeEnd) {
+                continue;
+            }
+
+            block.freeRanges.erase(it);
+            if (aligned > rangeOffset) {
+                block.freeRanges.emplace(rangeOffset, aligned - rangeOffset);
+            }
+            if (aligned + size < rangeEnd) {
+                block.freeRanges.emplace(aligned + size, rangeEnd - (aligned + size));
+            }
+
+            offset = aligned;
+            return true;
+        }
+
+        return false;
+    }
+
+    void VulkanAllocator::FreeToBlock(Block& block, const VkDeviceSize offset, VkDeviceSize size) {
+        const Pool& pool = *block.pool;
+
+        if (pool.slotSize != 0) {
+            block.freeSlots.push_back(static_cast<uint32_t>(offset / pool.slotSize));
+            return;
+        }
+
+        // Coalesce with the following and preceding free ranges
+        auto next = block.freeRanges.lower_bound(offset);
+        if (next != block.freeRanges.end() && offset + size == next->first) {
+            size += next->second;
+            next = block.freeRanges.erase(next);
+        }
+        if (next != block.freeRanges.begin()) {
+            auto prev = std::prev(next);
+            if (prev->first + prev->second == offset) {
+                prev->second += size;
+                return;
+            }
+        }
+        block.freeRanges.emplace(offset, size);
+    }
+
+    VulkanAllocation VulkanAllocator::Allocate(
+        const VkMemoryRequirements& requirements,
+        const VkMemoryPropertyFlags properties,
+        const AllocationKind kind,
+        AllocationStrategy strategy
+    ) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, properties);
+        const VkDeviceSize size = requirements.size;
+        const VkDeviceSize alignment = std::max<VkDeviceSize>(requirements.alignment, 1);
+
+        if (strategy != AllocationStrategy::Dedicated &&
+            size > m_pools[memoryType].general[0].blockSize / 2) {
+            strategy = AllocationStrategy::Dedicated;
+        }
+
+        VulkanAllocation allocation;
+        allocation.memoryType = memoryType;
+        allocation.size = size;
+        allocation.strategy = strategy;
+
+        if (strategy == AllocationStrategy::Dedicated) {
+            m_dedicatedBlocks.push_back(CreateBlock(memoryType, size));
+            Block* block = m_dedicatedBlocks.back().get();
+            block->allocationCount = 1;
+            m_dedicatedCount++;
+
+            allocation.memory = block->memory;
+            allocation.offset = 0;
+            allocation.mapped = block->mapped;
+            allocation.block = block;
+        } else {
+            Pool& pool = SelectPool(memoryType, kind, strategy, size, alignment);
+
+            Block* target = nullptr;
+            VkDeviceSize offset = 0;
+            for (auto& block : pool.blocks) {
+                if (AllocateFromBlock(*block, size, alignment, offset)) {
+                    target = block.get();
+                    break;
+                }
+            }
+
+            if (!target) {
+                auto block = CreateBlock(memoryType, pool.blockSize);
+                block->pool = &pool;
+                if (pool.slotSize != 0) {
+                    const auto slotCount = static_cast<uint32_t>(pool.blockSize / pool.slotSize);
+                    block->freeSlots.reserve(slotCount);
+                    for (uint32_t slot = slotCount; slot > 0; slot--) {
+                        block->freeSlots.push_back(slot - 1);
+                    }
+                } else if (pool.strategy != AllocationStrategy::Linear) {
+                    block->freeRanges.emplace(0, pool.blockSize);
+                }
+
+                target = block.get();
+                pool.blocks.push_back(std::move(block));
+
+                if (!AllocateFromBlock(*target, size, alignment, offset)) {
+                    throw std::runtime_error("Failed to sub-allocate from a fresh memory block!");
+                }
+            }
+
+            target->allocationCount++;
+            target->used += size;
+
+            allocation.memory = target->memory;
+            allocation.offset = offset;
+            allocation.mapped = target->mapped ? static_cast<char*>(target->mapped) + offset : nullptr;
+            allocation.block = target;
+        }
+
+        auto& heap = m_heapStats[m_memoryProperties.memoryTypes[memoryType].heapIndex];
+        heap.usedBytes += size;
+        heap.allocationCount++;
+
+        return allocation;
+    }
+
+    VulkanAllocation VulkanAllocator::AllocateForBuffer(
+        VkBuffer buffer,
+        const VkMemoryPropertyFlags properties,
+        const AllocationStrategy strategy
+    ) {
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(m_device, buffer, &memRequirements);
+
+        VulkanAllocation allocation = Allocate(memRequirements, properties, AllocationKind::Linear, strategy);
+
+        if (vkBindBufferMemory(m_device, buffer, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            Free(allocation);
+            throw std::runtime_error("Failed to bind buffer memory!");
+        }
+        return allocation;
+    }
+
+    VulkanAllocation VulkanAllocator::AllocateForImage(
+        VkImage image,
+        const VkMemoryPropertyFlags properties,
+        const AllocationStrategy strategy
+    ) {
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(m_device, image, &memRequirements);
+
+        // The engine only creates VK_IMAGE_TILING_OPTIMAL images
+        VulkanAllocation allocation = Allocate(memRequirements, properties, AllocationKind::Optimal, strategy);
+
+        if (vkBindImageMemory(m_device, image, allocation.memory, allocation.offset) != VK_SUCCESS) {
+            Free(allocation);
+            throw std::runtime_error("Failed to bind image memory!");
+        }
+        return allocation;
+    }
+
+    void VulkanAllocator::Free(VulkanAllocation& allocation) {
+        if (!allocation.IsValid()) {
+            return;
+        }
+
+        // Linear allocations are only released by ResetLinearPools()
+        if (allocation.strategy == AllocationStrategy::Linear) {
+            allocation = {};
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto& heap = m_heapStats[m_memoryProperties.memoryTypes[allocation.memoryType].heapIndex];
+        heap.usedBytes -= allocation.size;
+        heap.allocationCount--;
+
+        auto* block = static_cast<Block*>(allocation.block);
+
+        if (allocation.strategy == AllocationStrategy::Dedicated) {
+            auto it = std::find_if(m_dedicatedBlocks.begin(), m_dedicatedBlocks.end(),
+                [block](const std::unique_ptr<Block>& candidate) { return candidate.get() == block; });
+            DestroyBlock(*block);
+            m_dedicatedBlocks.erase(it);
+            m_dedicatedCount--;
+        } else {
+            FreeToBlock(*block, allocation.offset, allocation.size);
+            block->allocationCount--;
+            block->used -= allocation.size;
+
+            // Keep one empty block per pool around to avoid allocate/free thrashing
+            Pool& pool = *block->pool;
+            if (block->allocationCount == 0 && pool.blocks.size() > 1) {
+                auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                    [block](const std::unique_ptr<Block>& candidate) { return candidate.get() == block; });
+                DestroyBlock(*block);
+                pool.blocks.erase(it);
+            }
+        }
+
+        allocation = {};
+    }
+
+    void VulkanAllocator::ResetLinearPools() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto& pools : m_pools) {
+            for (auto& pool : pools.linear) {
+                for (auto& block : pool.blocks) {
+                    auto& heap = m_heapStats[m_memoryProperties.memoryTypes[block->memoryType].heapIndex];
+                    heap.usedBytes -= block->used;
+                    heap.allocationCount -= block->allocationCount;
+
+                    block->head = 0;
+                    block->used = 0;
+                    block->allocationCount = 0;
+                }
+            }
+        }
+    }
+
+    VulkanAllocatorStats VulkanAllocator::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        VulkanAllocatorStats stats;
+        stats.heapCount = m_memoryProperties.memoryHeapCount;
+        stats.heaps = m_heapStats;
+        stats.dedicatedAllocationCount = m_dedicatedCount;
+        stats.deviceMemoryCount = m_deviceMemoryCount;
+        stats.maxDeviceMemoryCount = m_deviceProperties.limits.maxMemoryAllocationCount;
+
+        for (uint32_t i = 0; i < stats.heapCount; i++) {
+            stats.blockBytes += stats.heaps[i].blockBytes;
+            stats.usedBytes += stats.heaps[i].usedBytes;
+            stats.blockCount += stats.heaps[i].blockCount;
+            stats.allocationCount += stats.heaps[i].allocationCount;
+        }
+
+        return stats;
+    }
+
+    VulkanHeapBudget VulkanAllocator::GetHeapBudget(uint32_t heapIndex) const {
+        VulkanHeapBudget result;
+        if (heapIndex >= m_memoryProperties.memoryHeapCount) {
+            return result;
+        }
+
+        if (m_memoryBudget) {
+            VkPhysicalDeviceMemoryBudgetPropertiesEXT budget{};
+            budget.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+            VkPhysicalDeviceMemoryProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+            properties.pNext = &budget;
+            vkGetPhysicalDeviceMemoryProperties2(m_physicalDevice, &properties);
+
+            result.budget = budget.heapBudget[heapIndex];
+            result.usage = budget.heapUsage[heapIndex];
+            return result;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        result.budget = m_memoryProperties.memoryHeaps[heapIndex].size / 100 * FALLBACK_BUDGET_PERCENT;
+        result.usage = m_heapStats[heapIndex].blockBytes;
+        return result;
+    }
+
+    uint32_t VulkanAllocator::GetDeviceLocalHeap() const {
+        uint32_t best = 0;
+        VkDeviceSize bestSize = 0;
+        for (uint32_t i = 0; i < m_memoryProperties.memoryHeapCount; i++) {
+            const VkMemoryHeap& heap = m_memoryProperties.memoryHeaps[i];
+            if ((heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) && heap.size > bestSize) {
+                best = i;
+                bestSize = heap.size;
+            }
+        }
+        return best;
+    }
+}
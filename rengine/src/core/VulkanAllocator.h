@@ -0,0 +1,187 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace REngine {
+    // Buffers and linear images are "linear" resources, optimal-tiling images are
+    // "optimal". Neighbours of different kinds must be bufferImageGranularity apart.
+    enum class AllocationKind : uint8_t {
+        Linear = 0,
+        Optimal,
+        Count
+    };
+
+    enum class AllocationStrategy : uint8_t {
+        Default = 0, // Size bucket or free-list block, freed individually
+        Linear,      // Bump allocated, released all at once by ResetLinearPools()
+        Dedicated    // Own VkDeviceMemory
+    };
+
+    struct VulkanAllocation {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;  // Non-null for host-visible memory
+        uint32_t memoryType = UINT32_MAX;
+
+        [[nodiscard]] bool IsValid() const { return memory != VK_NULL_HANDLE; }
+
+    private:
+        friend class VulkanAllocator;
+        void* block = nullptr;
+        AllocationStrategy strategy = AllocationStrategy::Default;
+    };
+
+    struct VulkanAllocatorStats {
+        struct Heap {
+            VkDeviceSize blockBytes = 0;  // Reserved with vkAllocateMemory
+            VkDeviceSize usedBytes = 0;   // Handed out to resources
+            uint32_t blockCount = 0;
+            uint32_t allocationCount = 0;
+        };
+
+        std::array<Heap, VK_MAX_MEMORY_HEAPS> heaps{};
+        uint32_t heapCount = 0;
+
+        VkDeviceSize blockBytes = 0;
+        VkDeviceSize usedBytes = 0;
+        uint32_t blockCount = 0;
+        uint32_t allocationCount = 0;
+        uint32_t dedicatedAllocationCount = 0;
+        uint32_t deviceMemoryCount = 0;     // Live vkAllocateMemory objects
+        uint32_t maxDeviceMemoryCount = 0;  // maxMemoryAllocationCount
+    };
+
+    // What a heap may hold and what it holds. With VK_EXT_memory_budget both
+    // cover the whole process as the driver sees it, otherwise the usage is this
+    // allocator's blocks and the budget a share of the heap size.
+    struct VulkanHeapBudget {
+        VkDeviceSize budget = 0;
+        VkDeviceSize usage = 0;
+    };
+
+    // Block based sub-allocator for device memory. Every memory type gets a set of
+    // size-bucketed slab pools for small resources, a free-list pool for medium
+    // ones and a linear pool for transient data. Large resources get a dedicated
+    // allocation. Host-visible blocks stay persistently mapped.
+    class VulkanAllocator {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull * 1024 * 1024;
+        static constexpr VkDeviceSize SLAB_BLOCK_SIZE = 2ull * 1024 * 1024;
+        static constexpr VkDeviceSize MIN_BUCKET_SIZE = 256;
+        static constexpr uint32_t BUCKET_COUNT = 9; // 256 B .. 64 KB
+
+        VulkanAllocator() = default;
+        ~VulkanAllocator();
+
+        // Disable copying
+        VulkanAllocator(const VulkanAllocator&) = delete;
+        VulkanAllocator& operator=(const VulkanAllocator&) = delete;
+
+        // Heap share assumed available without VK_EXT_memory_budget, in percent
+        static constexpr VkDeviceSize FALLBACK_BUDGET_PERCENT = 80;
+
+        // memoryBudget: VK_EXT_memory_budget is enabled on the device
+        void Initialize(VkDevice device, VkPhysicalDevice physicalDevice, bool memoryBudget = false);
+        void Shutdown();
+
+        VulkanAllocation Allocate(
+            const VkMemoryRequirements& requirements,
+            VkMemoryPropertyFlags properties,
+            AllocationKind kind,
+            AllocationStrategy strategy = AllocationStrategy::Default
+        );
+
+        // Allocate and bind at the allocation offset
+        VulkanAllocation AllocateForBuffer(
+            VkBuffer buffer,
+            VkMemoryPropertyFlags properties,
+            AllocationStrategy strategy = AllocationStrategy::Default
+        );
+
+        VulkanAllocation AllocateForImage(
+            VkImage image,
+            VkMemoryPropertyFlags properties,
+            AllocationStrategy strategy = AllocationStrategy::Default
+        );
+
+        void Free(VulkanAllocation& allocation);
+
+        // Rewinds every linear pool. Caller guarantees the GPU is done with them.
+        void ResetLinearPools();
+
+        [[nodiscard]] VulkanAllocatorStats GetStats() const;
+
+        [[nodiscard]] VulkanHeapBudget GetHeapBudget(uint32_t heapIndex) const;
+
+        // Largest DEVICE_LOCAL heap, where optimal images live
+        [[nodiscard]] uint32_t GetDeviceLocalHeap() const;
+        [[nodiscard]] bool UsesMemoryBudget() const { return m_memoryBudget; }
+
+        [[nodiscard]] VkDevice GetDevice() const { return m_device; }
+        [[nodiscard]] VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
+        [[nodiscard]] const VkPhysicalDeviceProperties& GetDeviceProperties() const { return m_deviceProperties; }
+        [[nodiscard]] const VkPhysicalDeviceMemoryProperties& GetMemoryProperties() const { return m_memoryProperties; }
+
+    private:
+        struct Pool;
+
+        struct Block {
+            Pool* pool = nullptr;  // Null for dedicated allocations
+            VkDeviceMemory memory = VK_NULL_HANDLE;
+            VkDeviceSize size = 0;
+            void* mapped = nullptr;
+            uint32_t memoryType = 0;
+            uint32_t allocationCount = 0;
+            VkDeviceSize used = 0;
+
+            std::map<VkDeviceSize, VkDeviceSize> freeRanges; // Free-list pools: offset -> size
+            std::vector<uint32_t> freeSlots;                 // Bucket pools
+            VkDeviceSize head = 0;                           // Linear pools
+        };
+
+        struct Pool {
+            AllocationStrategy strategy = AllocationStrategy::Default;
+            uint32_t memoryType = 0;
+            VkDeviceSize blockSize = 0;
+            VkDeviceSize slotSize = 0; // Non-zero for size buckets
+            std::vector<std::unique_ptr<Block>> blocks;
+        };
+
+        struct MemoryTypePools {
+            std::array<std::array<Pool, BUCKET_COUNT>, static_cast<size_t>(AllocationKind::Count)> buckets;
+            std::array<Pool, static_cast<size_t>(AllocationKind::Count)> general;
+            std::array<Pool, static_cast<size_t>(AllocationKind::Count)> linear;
+        };
+
+        uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+        Pool& SelectPool(uint32_t memoryType, AllocationKind kind, AllocationStrategy strategy, VkDeviceSize size, VkDeviceSize alignment);
+
+        std::unique_ptr<Block> CreateBlock(uint32_t memoryType, VkDeviceSize size);
+        void DestroyBlock(Block& block);
+
+        bool AllocateFromBlock(Block& block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+        void FreeToBlock(Block& block, VkDeviceSize offset, VkDeviceSize size);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties m_deviceProperties{};
+        VkPhysicalDeviceMemoryProperties m_memoryProperties{};
+        VkDeviceSize m_granularity = 1;
+        bool m_memoryBudget = false;
+
+        std::vector<MemoryTypePools> m_pools;
+        std::vector<std::unique_ptr<Block>> m_dedicatedBlocks;
+
+        // Stats
+        std::array<VulkanAllocatorStats::Heap, VK_MAX_MEMORY_HEAPS> m_heapStats{};
+        uint32_t m_dedicatedCount = 0;
+        uint32_t m_deviceMemoryCount = 0;
+
+        mutable std::mutex m_mutex;
+    };
+}
@@ -0,0 +1,289 @@
+﻿#include "VulkanBindlessTable.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace REngine {
+    namespace {
+        constexpr uint64_t INDEX_MASK = 0xFFFFFFFFull;
+
+        uint64_t PackHead(const uint64_t head, const uint32_t index) {
+            // Bump the tag so a head popped and pushed back in between fails the CAS
+            return ((head >> 32) + 1) << 32 | index;
+        }
+    }
+
+    VulkanBindlessTable::~VulkanBindlessTable() {
+        Shutdown();
+    }
+
+    void VulkanBindlessTable::Initialize(
+        VkDevice device,
+        const bool descriptorIndexing,
+        const uint32_t frameSlots,
+        const uint32_t capacity
+    ) {
+        m_device = device;
+        m_descriptorIndexing = descriptorIndexing;
+        m_capacity = capacity;
+
+        m_freeHead.store(INVALID_INDEX, std::memory_order_relaxed);
+        m_nextFree = std::make_unique<std::atomic<uint32_t>[]>(m_capacity);
+        m_nextFresh.store(0, std::memory_order_relaxed);
+        m_liveCount.store(0, std::memory_order_relaxed);
+
+        VkDescriptorSetLayoutBinding binding{};
+        binding.binding = 0;
+        binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        binding.descriptorCount = m_capacity;
+        binding.stageFlags = VK_SHADER_STAGE_ALL;
+
+        const VkDescriptorBindingFlagsEXT bindingFlags =
+            VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT_EXT |
+            VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT_EXT |
+            VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT_EXT;
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfoEXT bindingFlagsInfo{};
+        bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO_EXT;
+        bindingFlagsInfo.bindingCount = 1;
+        bindingFlagsInfo.pBindingFlags = &bindingFlags;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 1;
+        layoutInfo.pBindings = &binding;
+        if (m_descriptorIndexing) {
+            layoutInfo.pNext = &bindingFlagsInfo;
+            layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT;
+        }
+
+        if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create bindless descriptor set layout!");
+        }
+
+        // Updated in place with descriptor indexing, otherwise one copy per frame slot
+        const uint32_t setCount = m_descriptorIndexing ? 1 : frameSlots;
+
+        VkDescriptorPoolSize poolSize{};
+        poolSize.type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        poolSize.descriptorCount = m_capacity * setCount;
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = m_descriptorIndexing ? VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT_EXT : 0;
+        poolInfo.maxSets = setCount;
+        poolInfo.poolSizeCount = 1;
+        poolInfo.pPoolSizes = &poolSize;
+
+        if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &m_pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create bindless descriptor pool!");
+        }
+
+        const std::vector<VkDescriptorSetLayout> layouts(setCount, m_setLayout);
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorPool = m_pool;
+        allocInfo.descriptorSetCount = setCount;
+        allocInfo.pSetLayouts = layouts.data();
+
+        m_sets.resize(setCount);
+        if (vkAllocateDescriptorSets(m_device, &allocInfo, m_sets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate bindless descriptor sets!");
+        }
+
+        m_elements.assign(m_capacity, {});
+        m_nextSequence = 1;
+        m_trimmedSequence = 0;
+        m_appliedSequence.assign(setCount, 0);
+        m_activeSlots = setCount;
+    }
+
+    void VulkanBindlessTable::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        // Destroying the pool frees the sets
+        if (m_pool != VK_NULL_HANDLE) {
+            vkDestroyDescriptorPool(m_device, m_pool, nullptr);
+            m_pool = VK_NULL_HANDLE;
+        }
+        if (m_setLayout != VK_NULL_HANDLE) {
+            vkDestroyDescriptorSetLayout(m_device, m_setLayout, nullptr);
+            m_setLayout = VK_NULL_HANDLE;
+        }
+
+        m_sets.clear();
+        m_elements.clear();
+        m_pendingWrites.clear();
+        m_appliedSequence.clear();
+        m_activeSlots = 0;
+        m_nextFree.reset();
+        m_defaultView = VK_NULL_HANDLE;
+        m_defaultSampler = VK_NULL_HANDLE;
+        m_capacity = 0;
+        m_device = VK_NULL_HANDLE;
+    }
+
+    void VulkanBindlessTable::SetDefault(VkImageView view, VkSampler sampler) {
+        m_defaultView = view;
+        m_defaultSampler = sampler;
+
+        {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            for (Element& element : m_elements) {
+                if (element.sequence == 0) {
+                    element.view = view;
+                    element.sampler = sampler;
+                }
+            }
+        }
+
+        // Fill every element of every set, registered textures are queued and land on top
+        const std::vector<VkDescriptorImageInfo> imageInfos(
+            m_capacity, {sampler, view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+
+        std::vector<VkWriteDescriptorSet> writes(m_sets.size());
+        for (size_t i = 0; i < m_sets.size(); i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = m_sets[i];
+            writes[i].dstBinding = 0;
+            writes[i].dstArrayElement = 0;
+            writes[i].descriptorCount = m_capacity;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[i].pImageInfo = imageInfos.data();
+        }
+        vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    uint32_t VulkanBindlessTable::Register(VkImageView view, VkSampler sampler) {
+        const uint32_t index = AllocateIndex();
+        if (index == INVALID_INDEX) {
+            return INVALID_INDEX;
+        }
+
+        QueueWrite(index, view, sampler);
+        m_liveCount.fetch_add(1, std::memory_order_relaxed);
+        return index;
+    }
+
+    void VulkanBindlessTable::Unregister(const uint32_t index) {
+        if (index >= m_capacity) {
+            return;
+        }
+
+        // Point the element back at the default before anyone can reuse it. This
+        // also supersedes a write of the texture that has not been applied yet.
+        QueueWrite(index, m_defaultView, m_defaultSampler);
+        ReleaseIndex(index);
+        m_liveCount.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    uint32_t VulkanBindlessTable::AllocateIndex() {
+        uint64_t head = m_freeHead.load(std::memory_order_acquire);
+        while ((head & INDEX_MASK) != INVALID_INDEX) {
+            const auto index = static_cast<uint32_t>(head & INDEX_MASK);
+            const uint32_t next = m_nextFree[index].load(std::memory_order_relaxed);
+            if (m_freeHead.compare_exchange_weak(head, PackHead(head, next),
+                                                 std::memory_order_acquire, std::memory_order_acquire)) {
+                return index;
+            }
+        }
+
+        // Free list empty, hand out an index that was never used
+        uint32_t fresh = m_nextFresh.load(std::memory_order_relaxed);
+        while (fresh < m_capacity) {
+            if (m_nextFresh.compare_exchange_weak(fresh, fresh + 1, std::memory_order_relaxed)) {
+                return fresh;
+            }
+        }
+        return INVALID_INDEX;
+    }
+
+    void VulkanBindlessTable::ReleaseIndex(const uint32_t index) {
+        uint64_t head = m_freeHead.load(std::memory_order_relaxed);
+        do {
+            m_nextFree[index].store(static_cast<uint32_t>(head & INDEX_MASK), std::memory_order_relaxed);
+        } while (!m_freeHead.compare_exchange_weak(head, PackHead(head, index),
+                                                   std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void VulkanBindlessTable::QueueWrite(const uint32_t index, VkImageView view, VkSampler sampler) {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        const uint64_t sequence = m_nextSequence++;
+        m_elements[index] = {view, sampler, sequence};
+        m_pendingWrites.push_back({sequence, index});
+    }
+
+    void VulkanBindlessTable::SetActiveSlots(const uint32_t count) {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_activeSlots = std::clamp(count, 1u, static_cast<uint32_t>(m_sets.size()));
+    }
+
+    void VulkanBindlessTable::BeginFrame(const uint32_t frameSlot) {
+        const size_t setIndex = m_descriptorIndexing ? 0 : frameSlot;
+
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+
+        uint64_t& applied = m_appliedSequence[setIndex];
+        const uint64_t latest = m_nextSequence - 1;
+        if (applied >= latest) {
+            return;
+        }
+
+        m_imageInfos.clear();
+        m_writes.clear();
+        if (applied < m_trimmedSequence) {
+            // The slot sat unused while writes it missed were dropped
+            for (const Element& element : m_elements) {
+                m_imageInfos.push_back({element.sampler, element.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+            }
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = m_sets[setIndex];
+            write.dstBinding = 0;
+            write.dstArrayElement = 0;
+            write.descriptorCount = m_capacity;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            write.pImageInfo = m_imageInfos.data();
+            m_writes.push_back(write);
+        } else {
+            // Only the latest write of each element, with what the element holds now
+            for (const auto& pending : m_pendingWrites) {
+                const Element& element = m_elements[pending.index];
+                if (pending.sequence > applied && pending.sequence == element.sequence &&
+                    element.view != VK_NULL_HANDLE) {
+                    m_imageInfos.push_back({element.sampler, element.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL});
+                }
+            }
+            size_t infoIndex = 0;
+            for (const auto& pending : m_pendingWrites) {
+                const Element& element = m_elements[pending.index];
+                if (pending.sequence <= applied || pending.sequence != element.sequence ||
+                    element.view == VK_NULL_HANDLE) {
+                    continue;
+                }
+                VkWriteDescriptorSet write{};
+                write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                write.dstSet = m_sets[setIndex];
+                write.dstBinding = 0;
+                write.dstArrayElement = pending.index;
+                write.descriptorCount = 1;
+                write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                write.pImageInfo = &m_imageInfos[infoIndex++];
+                m_writes.push_back(write);
+            }
+        }
+        if (!m_writes.empty()) {
+            vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(m_writes.size()), m_writes.data(), 0, nullptr);
+        }
+        applied = latest;
+
+        // Forget writes every active set has seen, and superseded ones
+        const uint64_t oldest = *std::min_element(m_appliedSequence.begin(), m_appliedSequence.begin() + m_activeSlots);
+        m_pendingWrites.erase(std::remove_if(m_pendingWrites.begin(), m_pendingWrites.end(),
+            [this, oldest](const PendingWrite& pending) {
+                return pending.sequence <= oldest || pending.sequence != m_elements[pending.index].sequence;
+            }), m_pendingWrites.end());
+        m_trimmedSequence = std::max(m_trimmedSequence, oldest);
+    }
+}
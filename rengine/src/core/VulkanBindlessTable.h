@@ -0,0 +1,111 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace REngine {
+    // One large array of combined image samplers that shaders index directly,
+    // so materials need no descriptor sets of their own. Indices come from a
+    // lock-free free list and can be registered and released from any thread;
+    // the descriptor writes are queued and applied by BeginFrame().
+    //
+    // With descriptor indexing the array is a single UPDATE_AFTER_BIND +
+    // PARTIALLY_BOUND set updated in place. Without it every frame slot gets its
+    // own copy, updated only once the slot's previous frame has finished, and
+    // unused elements point at the default texture. Queued writes read the
+    // element's latest contents when applied, so a texture unregistered before
+    // its write lands never reaches a set.
+    class VulkanBindlessTable {
+    public:
+        static constexpr uint32_t DEFAULT_CAPACITY = 16384;
+        static constexpr uint32_t INVALID_INDEX = UINT32_MAX;
+
+        VulkanBindlessTable() = default;
+        ~VulkanBindlessTable();
+
+        // Disable copying
+        VulkanBindlessTable(const VulkanBindlessTable&) = delete;
+        VulkanBindlessTable& operator=(const VulkanBindlessTable&) = delete;
+
+        // descriptorIndexing requires the update-after-bind, partially-bound and
+        // update-unused-while-pending features for sampled images. The caller
+        // keeps capacity within the device's descriptor limits.
+        void Initialize(VkDevice device, bool descriptorIndexing, uint32_t frameSlots, uint32_t capacity);
+        void Shutdown();
+
+        // Written to every element that holds no texture. Render thread, before
+        // the first BeginFrame().
+        void SetDefault(VkImageView view, VkSampler sampler);
+
+        // INVALID_INDEX when the table is full. Thread-safe.
+        uint32_t Register(VkImageView view, VkSampler sampler);
+
+        // The caller guarantees no frame in flight still samples the index. Thread-safe.
+        void Unregister(uint32_t index);
+
+        // Slots the renderer currently cycles through. Queued writes are kept
+        // until all of them have seen them; a slot that comes back into use
+        // after its writes were dropped is rewritten whole. Render thread.
+        void SetActiveSlots(uint32_t count);
+
+        // Applies queued writes to the slot's set. Call after the slot's fence has been waited on.
+        void BeginFrame(uint32_t frameSlot);
+
+        [[nodiscard]] VkDescriptorSetLayout GetSetLayout() const { return m_setLayout; }
+        [[nodiscard]] VkDescriptorSet GetSet(uint32_t frameSlot) const { return m_sets[m_descriptorIndexing ? 0 : frameSlot]; }
+
+        [[nodiscard]] bool UsesDescriptorIndexing() const { return m_descriptorIndexing; }
+        [[nodiscard]] uint32_t GetCapacity() const { return m_capacity; }
+        [[nodiscard]] uint32_t GetLiveCount() const { return m_liveCount.load(std::memory_order_relaxed); }
+
+    private:
+        struct Element {
+            VkImageView view = VK_NULL_HANDLE;
+            VkSampler sampler = VK_NULL_HANDLE;
+            uint64_t sequence = 0;  // Of the latest write
+        };
+
+        struct PendingWrite {
+            uint64_t sequence;
+            uint32_t index;
+        };
+
+        uint32_t AllocateIndex();
+        void ReleaseIndex(uint32_t index);
+        void QueueWrite(uint32_t index, VkImageView view, VkSampler sampler);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+        VkDescriptorPool m_pool = VK_NULL_HANDLE;
+        std::vector<VkDescriptorSet> m_sets;
+        bool m_descriptorIndexing = false;
+        uint32_t m_capacity = 0;
+
+        // Free list: Treiber stack of indices. The head packs an ABA tag in the
+        // upper 32 bits and the top index in the lower 32.
+        std::atomic<uint64_t> m_freeHead{INVALID_INDEX};
+        std::unique_ptr<std::atomic<uint32_t>[]> m_nextFree;
+        std::atomic<uint32_t> m_nextFresh{0};  // Indices never handed out start here
+        std::atomic<uint32_t> m_liveCount{0};
+
+        VkImageView m_defaultView = VK_NULL_HANDLE;
+        VkSampler m_defaultSampler = VK_NULL_HANDLE;
+
+        // Writes not yet applied to every active set, in submission order. An
+        // entry older than its element's latest write is superseded and skipped.
+        std::mutex m_writeMutex;
+        std::vector<Element> m_elements;
+        std::vector<PendingWrite> m_pendingWrites;
+        uint64_t m_nextSequence = 1;
+        uint64_t m_trimmedSequence = 0;           // Writes up to here may be dropped
+        std::vector<uint64_t> m_appliedSequence;  // Per set
+        uint32_t m_activeSlots = 0;
+
+        // Reused by BeginFrame()
+        std::vector<VkDescriptorImageInfo> m_imageInfos;
+        std::vector<VkWriteDescriptorSet> m_writes;
+    };
+}
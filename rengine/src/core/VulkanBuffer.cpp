@@ -1,14 +1,17 @@
 ﻿#include "VulkanBuffer.h"
-#include <VulkanHelpers.h>
+#include <VulkanUploadManager.h>
+#include <cstring>
+#include <stdexcept>
 namespace REngine {
     void VulkanBuffer::Create(
-        VkDevice device,
-        VkPhysicalDevice physicalDevice,
+        VulkanAllocator& allocator,
         VkDeviceSize size,
         VkBufferUsageFlags usage,
-        VkMemoryPropertyFlags properties
+        VkMemoryPropertyFlags properties,
+        AllocationStrategy strategy
     ) {
-        m_device = device;
+        m_allocator = &allocator;
+        m_size = size;
 
         VkBufferCreateInfo bufferInfo{};
         bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -16,35 +19,83 @@ namespace REngine {
         bufferInfo.usage = usage;
         bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
 
-        if (vkCreateBuffer(device, &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS) {
+        if (vkCreateBuffer(allocator.GetDevice(), &bufferInfo, nullptr, &m_buffer) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create buffer!");
         }
 
-        VkMemoryRequirements memRequirements;
-        vkGetBufferMemoryRequirements(device, m_buffer, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(
-            physicalDevice,
-            memRequirements.memoryTypeBits,
-            properties
-        );
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate buffer memory!");
+        try {
+            m_allocation = allocator.AllocateForBuffer(m_buffer, properties, strategy);
+        } catch (...) {
+            vkDestroyBuffer(allocator.GetDevice(), m_buffer, nullptr);
+            m_buffer = VK_NULL_HANDLE;
+            throw;
         }
-
-        vkBindBufferMemory(device, m_buffer, m_memory, 0);
     }
 
     void VulkanBuffer::Destroy() {
-        if (m_device) {
-            vkDestroyBuffer(m_device, m_buffer, nullptr);
-            vkFreeMemory(m_device, m_memory, nullptr);
+        if (m_allocator) {
+            vkDestroyBuffer(m_allocator->GetDevice(), m_buffer, nullptr);
+            m_allocator->Free(m_allocation);
             m_buffer = VK_NULL_HANDLE;
-            m_memory = VK_NULL_HANDLE;
+            m_allocator = nullptr;
+        }
+    }
+
+    UploadHandle VulkanBuffer::Upload(
+        VulkanUploadManager& uploadManager,
+        const void* data,
+        VkDeviceSize size,
+        VkDeviceSize offset
+    ) {
+        if (offset + size > m_size) {
+            throw std::out_of_range("Buffer upload out of range!");
         }
+
+        if (m_allocation.mapped) {
+            memcpy(static_cast<char*>(m_allocation.mapped) + offset, data, static_cast<size_t>(size));
+            return {};
+        }
+
+        const uint32_t transferFamily = uploadManager.GetTransferQueueFamily();
+        const uint32_t graphicsFamily = uploadManager.GetGraphicsQueueFamily();
+
+        return uploadManager.Upload(size,
+            [&](const StagingRegion& staging, VkCommandBuffer transfer, VkCommandBuffer graphics) {
+                memcpy(staging.mapped, data, static_cast<size_t>(size));
+
+                VkBufferCopy copy{};
+                copy.srcOffset = staging.offset;
+                copy.dstOffset = offset;
+                copy.size = size;
+                vkCmdCopyBuffer(transfer, staging.buffer, m_buffer, 1, &copy);
+
+                if (transferFamily == graphicsFamily) {
+                    return;
+                }
+
+                // Hand the range over to the graphics queue family
+                VkBufferMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+                barrier.srcQueueFamilyIndex = transferFamily;
+                barrier.dstQueueFamilyIndex = graphicsFamily;
+                barrier.buffer = m_buffer;
+                barrier.offset = offset;
+                barrier.size = size;
+
+                barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                vkCmdPipelineBarrier(transfer,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+                    0, nullptr,
+                    1, &barrier,
+                    0, nullptr);
+
+                barrier.srcAccessMask = 0;
+                barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+                vkCmdPipelineBarrier(graphics,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0,
+                    0, nullptr,
+                    1, &barrier,
+                    0, nullptr);
+            });
     }
 }
\ No newline at end of file
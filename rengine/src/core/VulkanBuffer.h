@@ -1,24 +1,43 @@
 ﻿#pragma once
 #include <vulkan/vulkan.h>
+#include <VulkanAllocator.h>
 namespace REngine {
+    class VulkanUploadManager;
+    struct UploadHandle;
+
     class VulkanBuffer {
     public:
         VkBuffer GetBuffer() const { return m_buffer; }
-        VkDeviceMemory GetMemory() const { return m_memory; }
+        VkDeviceMemory GetMemory() const { return m_allocation.memory; }
+        VkDeviceSize GetOffset() const { return m_allocation.offset; }
+        VkDeviceSize GetSize() const { return m_size; }
+
+        // Persistently mapped pointer, null unless the memory is host-visible
+        void* GetMappedData() const { return m_allocation.mapped; }
 
         void Create(
-            VkDevice device,
-            VkPhysicalDevice physicalDevice,
+            VulkanAllocator& allocator,
             VkDeviceSize size,
             VkBufferUsageFlags usage,
-            VkMemoryPropertyFlags properties
+            VkMemoryPropertyFlags properties,
+            AllocationStrategy strategy = AllocationStrategy::Default
         );
 
         void Destroy();
 
+        // Host-visible buffers are written directly, anything else is recorded into
+        // the open upload batch (requires VK_BUFFER_USAGE_TRANSFER_DST_BIT).
+        UploadHandle Upload(
+            VulkanUploadManager& uploadManager,
+            const void* data,
+            VkDeviceSize size,
+            VkDeviceSize offset = 0
+        );
+
     private:
-        VkDevice m_device = VK_NULL_HANDLE;
+        VulkanAllocator* m_allocator = nullptr;
         VkBuffer m_buffer = VK_NULL_HANDLE;
-        VkDeviceMemory m_memory = VK_NULL_HANDLE;
+        VulkanAllocation m_allocation;
+        VkDeviceSize m_size = 0;
     };
 }
\ No newline at end of file
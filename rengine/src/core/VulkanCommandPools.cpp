@@ -0,0 +1,77 @@
+﻿#include "VulkanCommandPools.h"
+#include <stdexcept>
+
+namespace REngine {
+    VulkanCommandPools::~VulkanCommandPools() {
+        Shutdown();
+    }
+
+    void VulkanCommandPools::Initialize(
+        VkDevice device,
+        const uint32_t queueFamilyIndex,
+        const uint32_t frameSlots,
+        const uint32_t workerCount
+    ) {
+        m_device = device;
+        m_workerCount = workerCount;
+        m_currentSlot = 0;
+        m_pools.resize(static_cast<size_t>(frameSlots) * workerCount);
+
+        // No per-buffer reset, the whole pool is reset every frame
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+        poolInfo.queueFamilyIndex = queueFamilyIndex;
+
+        for (auto& pool : m_pools) {
+            if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &pool.pool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create recording command pool!");
+            }
+        }
+    }
+
+    void VulkanCommandPools::Shutdown() {
+        // Destroying a pool frees its buffers
+        for (auto& pool : m_pools) {
+            if (pool.pool != VK_NULL_HANDLE) {
+                vkDestroyCommandPool(m_device, pool.pool, nullptr);
+            }
+        }
+        m_pools.clear();
+        m_workerCount = 0;
+        m_device = VK_NULL_HANDLE;
+    }
+
+    void VulkanCommandPools::BeginFrame(const uint32_t frameSlot) {
+        m_currentSlot = frameSlot;
+        for (uint32_t worker = 0; worker < m_workerCount; worker++) {
+            WorkerPool& pool = m_pools[static_cast<size_t>(frameSlot) * m_workerCount + worker];
+            if (pool.used == 0) {
+                continue;
+            }
+            vkResetCommandPool(m_device, pool.pool, 0);
+            pool.used = 0;
+        }
+    }
+
+    VkCommandBuffer VulkanCommandPools::AcquireSecondary(const uint32_t worker) {
+        WorkerPool& pool = m_pools[static_cast<size_t>(m_currentSlot) * m_workerCount + worker];
+        std::vector<VkCommandBuffer>& buffers = pool.buffers;
+        uint32_t& used = pool.used;
+
+        if (used == buffers.size()) {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = pool.pool;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer buffer;
+            if (vkAllocateCommandBuffers(m_device, &allocInfo, &buffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate recording command buffer!");
+            }
+            buffers.push_back(buffer);
+        }
+        return buffers[used++];
+    }
+}
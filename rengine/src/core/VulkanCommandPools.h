@@ -0,0 +1,44 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <vector>
+
+namespace REngine {
+    // Transient command pools for parallel recording, one per frame slot and
+    // worker. A worker only ever touches its own pool, so recording takes no
+    // lock. A slot's pools are reset together once its fence has signaled,
+    // which recycles every buffer at once instead of resetting them one by one.
+    class VulkanCommandPools {
+    public:
+        VulkanCommandPools() = default;
+        ~VulkanCommandPools();
+
+        // Disable copying
+        VulkanCommandPools(const VulkanCommandPools&) = delete;
+        VulkanCommandPools& operator=(const VulkanCommandPools&) = delete;
+
+        void Initialize(VkDevice device, uint32_t queueFamilyIndex, uint32_t frameSlots, uint32_t workerCount);
+        void Shutdown();
+
+        // Resets every pool of the slot. Call after the slot's fence has been waited on.
+        void BeginFrame(uint32_t frameSlot);
+
+        // Buffers are reused across frames and stay valid until the slot comes
+        // around again. Safe to call concurrently for different workers.
+        VkCommandBuffer AcquireSecondary(uint32_t worker);
+
+        [[nodiscard]] uint32_t GetWorkerCount() const { return m_workerCount; }
+
+    private:
+        struct WorkerPool {
+            VkCommandPool pool = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> buffers;  // Secondaries
+            uint32_t used = 0;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        uint32_t m_workerCount = 0;
+        uint32_t m_currentSlot = 0;
+        std::vector<WorkerPool> m_pools;  // frameSlots * workerCount, slot major
+    };
+}
@@ -0,0 +1,366 @@
+﻿#include "VulkanDescriptorAllocator.h"
+#include <VulkanLayoutCache.h>
+#include <RHash.h>
+#include <algorithm>
+#include <stdexcept>
+
+namespace REngine {
+    DescriptorWrite DescriptorWrite::Buffer(
+        const uint32_t binding,
+        const VkDescriptorType type,
+        VkBuffer buffer,
+        const VkDeviceSize offset,
+        const VkDeviceSize range
+    ) {
+        DescriptorWrite write;
+        write.binding = binding;
+        write.type = type;
+        write.buffer = {buffer, offset, range};
+        return write;
+    }
+
+    DescriptorWrite DescriptorWrite::Image(
+        const uint32_t binding,
+        const VkDescriptorType type,
+        VkImageView view,
+        VkSampler sampler,
+        const VkImageLayout layout
+    ) {
+        DescriptorWrite write;
+        write.binding = binding;
+        write.type = type;
+        write.image = {sampler, view, layout};
+        return write;
+    }
+
+    bool DescriptorWrite::operator==(const DescriptorWrite& other) const {
+        return binding == other.binding &&
+               arrayElement == other.arrayElement &&
+               type == other.type &&
+               buffer.buffer == other.buffer.buffer &&
+               buffer.offset == other.buffer.offset &&
+               buffer.range == other.buffer.range &&
+               image.sampler == other.image.sampler &&
+               image.imageView == other.image.imageView &&
+               image.imageLayout == other.image.imageLayout &&
+               texelView == other.texelView;
+    }
+
+    bool VulkanDescriptorAllocator::CacheKey::operator==(const CacheKey& other) const {
+        return layout == other.layout && writes == other.writes;
+    }
+
+    size_t VulkanDescriptorAllocator::CacheKeyHash::operator()(const CacheKey& key) const {
+        size_t seed = key.writes.size();
+        HashCombine(seed, reinterpret_cast<uint64_t>(key.layout));
+        for (const auto& write : key.writes) {
+            HashCombine(seed, write.binding);
+            HashCombine(seed, write.arrayElement);
+            HashCombine(seed, static_cast<uint64_t>(write.type));
+            HashCombine(seed, reinterpret_cast<uint64_t>(write.buffer.buffer));
+            HashCombine(seed, write.buffer.offset);
+            HashCombine(seed, write.buffer.range);
+            HashCombine(seed, reinterpret_cast<uint64_t>(write.image.sampler));
+            HashCombine(seed, reinterpret_cast<uint64_t>(write.image.imageView));
+            HashCombine(seed, static_cast<uint64_t>(write.image.imageLayout));
+            HashCombine(seed, reinterpret_cast<uint64_t>(write.texelView));
+        }
+        return seed;
+    }
+
+    VulkanDescriptorAllocator::~VulkanDescriptorAllocator() {
+        Shutdown();
+    }
+
+    void VulkanDescriptorAllocator::Initialize(VkDevice device, VulkanLayoutCache& layoutCache, const uint32_t frameSlots) {
+        m_device = device;
+        m_layoutCache = &layoutCache;
+        m_slots.resize(frameSlots);
+        m_currentSlot = 0;
+    }
+
+    void VulkanDescriptorAllocator::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Destroying a pool frees its sets
+        for (auto& slot : m_slots) {
+            DestroyPools(slot.framePools);
+            DestroyPools(slot.cachePools);
+        }
+        m_slots.clear();
+        m_layouts.clear();
+        m_typeTotals.clear();
+        m_setTotal = 0;
+        m_layoutCache = nullptr;
+        m_device = VK_NULL_HANDLE;
+    }
+
+    void VulkanDescriptorAllocator::BeginFrame(const uint32_t frameSlot) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_currentSlot = frameSlot;
+        m_setsThisFrame = 0;
+
+        FrameSlot& slot = m_slots[frameSlot];
+        ResetPools(slot.framePools);
+
+        // Most cached sets went unused last round, start over rather than keep them around
+        const bool stale = slot.cache.size() >= MIN_CACHE_RESET_SETS && slot.usedThisRound * 2 < slot.cache.size();
+        if (slot.invalidated || stale) {
+            slot.cache.clear();
+            ResetPools(slot.cachePools);
+            slot.invalidated = false;
+        }
+
+        slot.round++;
+        slot.usedThisRound = 0;
+    }
+
+    VkDescriptorSet VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const LayoutInfo& info = GetLayoutInfo(layout);
+        CountAllocation(info);
+        m_setsThisFrame++;
+        return AllocateFrom(m_slots[m_currentSlot].framePools, layout, info);
+    }
+
+    VkDescriptorSet VulkanDescriptorAllocator::Allocate(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes) {
+        const VkDescriptorSet set = Allocate(layout);
+        Write(set, writes);
+        return set;
+    }
+
+    VkDescriptorSet VulkanDescriptorAllocator::GetCached(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes) {
+        CacheKey key{layout, writes};
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        FrameSlot& slot = m_slots[m_currentSlot];
+        const auto it = slot.cache.find(key);
+        if (it != slot.cache.end()) {
+            m_cacheHits++;
+            if (it->second.lastRound != slot.round) {
+                it->second.lastRound = slot.round;
+                slot.usedThisRound++;
+            }
+            return it->second.set;
+        }
+
+        m_cacheMisses++;
+        const LayoutInfo& info = GetLayoutInfo(layout);
+        CountAllocation(info);
+
+        const VkDescriptorSet set = AllocateFrom(slot.cachePools, layout, info);
+        Write(set, writes);
+
+        slot.cache.emplace(std::move(key), CachedSet{set, slot.round});
+        slot.usedThisRound++;
+        return set;
+    }
+
+    void VulkanDescriptorAllocator::InvalidateCache() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto& slot : m_slots) {
+            slot.invalidated = true;
+        }
+    }
+
+    void VulkanDescriptorAllocator::Write(VkDescriptorSet set, const std::vector<DescriptorWrite>& writes) const {
+        if (writes.empty()) {
+            return;
+        }
+
+        std::vector<VkWriteDescriptorSet> descriptorWrites;
+        descriptorWrites.reserve(writes.size());
+        for (const auto& write : writes) {
+            VkWriteDescriptorSet descriptorWrite{};
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = set;
+            descriptorWrite.dstBinding = write.binding;
+            descriptorWrite.dstArrayElement = write.arrayElement;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.descriptorType = write.type;
+
+            switch (write.type) {
+                case VK_DESCRIPTOR_TYPE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+                case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+                case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+                case VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT:
+                    descriptorWrite.pImageInfo = &write.image;
+                    break;
+                case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+                case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+                    descriptorWrite.pTexelBufferView = &write.texelView;
+                    break;
+                default:
+                    descriptorWrite.pBufferInfo = &write.buffer;
+                    break;
+            }
+            descriptorWrites.push_back(descriptorWrite);
+        }
+
+        vkUpdateDescriptorSets(m_device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    }
+
+    DescriptorAllocatorStats VulkanDescriptorAllocator::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        DescriptorAllocatorStats stats;
+        for (const auto& slot : m_slots) {
+            stats.poolCount += static_cast<uint32_t>(slot.framePools.pools.size() + slot.cachePools.pools.size());
+        }
+        stats.setsThisFrame = m_setsThisFrame;
+        stats.cachedSets = m_slots.empty() ? 0 : static_cast<uint32_t>(m_slots[m_currentSlot].cache.size());
+        stats.cacheHits = m_cacheHits;
+        stats.cacheMisses = m_cacheMisses;
+        return stats;
+    }
+
+    const VulkanDescriptorAllocator::LayoutInfo& VulkanDescriptorAllocator::GetLayoutInfo(VkDescriptorSetLayout layout) {
+        const auto it = m_layouts.find(layout);
+        if (it != m_layouts.end()) {
+            return it->second;
+        }
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings;
+        VkDescriptorSetLayoutCreateFlags flags = 0;
+        if (!m_layoutCache->GetSetLayoutInfo(layout, bindings, flags)) {
+            throw std::runtime_error("Descriptor set layout is not owned by the layout cache!");
+        }
+        if (flags & VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT_EXT) {
+            throw std::runtime_error("Update-after-bind layouts are not supported by the descriptor allocator!");
+        }
+
+        LayoutInfo info;
+        for (const auto& binding : bindings) {
+            if (binding.descriptorCount == 0) {
+                continue;
+            }
+            const auto size = std::find_if(info.sizes.begin(), info.sizes.end(),
+                [&](const VkDescriptorPoolSize& poolSize) { return poolSize.type == binding.descriptorType; });
+            if (size != info.sizes.end()) {
+                size->descriptorCount += binding.descriptorCount;
+            } else {
+                info.sizes.push_back({binding.descriptorType, binding.descriptorCount});
+            }
+        }
+
+        return m_layouts.emplace(layout, std::move(info)).first->second;
+    }
+
+    void VulkanDescriptorAllocator::CountAllocation(const LayoutInfo& info) {
+        for (const auto& size : info.sizes) {
+            m_typeTotals[size.type] += size.descriptorCount;
+        }
+        m_setTotal++;
+
+        if (m_setTotal >= TYPE_HISTORY_SETS) {
+            for (auto& [type, total] : m_typeTotals) {
+                total /= 2;
+            }
+            m_setTotal /= 2;
+        }
+    }
+
+    VkDescriptorSet VulkanDescriptorAllocator::AllocateFrom(PoolList& list, VkDescriptorSetLayout layout, const LayoutInfo& info) {
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &layout;
+
+        VkDescriptorSet set;
+        while (list.current < list.pools.size()) {
+            Pool& pool = list.pools[list.current];
+            if (pool.allocatedSets < pool.maxSets) {
+                allocInfo.descriptorPool = pool.pool;
+                const VkResult result = vkAllocateDescriptorSets(m_device, &allocInfo, &set);
+                if (result == VK_SUCCESS) {
+                    pool.allocatedSets++;
+                    return set;
+                }
+                // Without VK_KHR_maintenance1 an exhausted pool may report any error
+                if (pool.allocatedSets == 0 && result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+                    throw std::runtime_error("Failed to allocate descriptor set!");
+                }
+            }
+            // Out of sets or of one descriptor type, skip the pool until the next reset
+            list.current++;
+        }
+
+        // Every pool is full, grow by a pool twice the size of the last one
+        const size_t shift = std::min<size_t>(list.pools.size(), 16);
+        const uint32_t maxSets = static_cast<uint32_t>(std::min<uint64_t>(static_cast<uint64_t>(FIRST_POOL_SETS) << shift, MAX_POOL_SETS));
+
+        Pool pool;
+        pool.pool = CreatePool(maxSets, info);
+        pool.maxSets = maxSets;
+        list.pools.push_back(pool);
+
+        allocInfo.descriptorPool = pool.pool;
+        if (vkAllocateDescriptorSets(m_device, &allocInfo, &set) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate descriptor set!");
+        }
+        list.pools.back().allocatedSets++;
+        return set;
+    }
+
+    VkDescriptorPool VulkanDescriptorAllocator::CreatePool(const uint32_t maxSets, const LayoutInfo& info) const {
+        // Scale the average mix of every set allocated so far, but always fit the set that asked
+        std::vector<VkDescriptorPoolSize> poolSizes;
+        for (const auto& [type, total] : m_typeTotals) {
+            const uint64_t scaled = (total * maxSets + m_setTotal - 1) / std::max<uint64_t>(m_setTotal, 1);
+            poolSizes.push_back({type, static_cast<uint32_t>(std::max<uint64_t>(scaled, 1))});
+        }
+        for (const auto& size : info.sizes) {
+            const auto it = std::find_if(poolSizes.begin(), poolSizes.end(),
+                [&](const VkDescriptorPoolSize& poolSize) { return poolSize.type == size.type; });
+            if (it == poolSizes.end()) {
+                poolSizes.push_back(size);
+            } else {
+                it->descriptorCount = std::max(it->descriptorCount, size.descriptorCount);
+            }
+        }
+        // A pool needs at least one size, even for sets without bindings
+        if (poolSizes.empty()) {
+            poolSizes.push_back({VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1});
+        }
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.maxSets = maxSets;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+        poolInfo.pPoolSizes = poolSizes.data();
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create descriptor pool!");
+        }
+        return pool;
+    }
+
+    void VulkanDescriptorAllocator::ResetPools(PoolList& list) {
+        for (auto& pool : list.pools) {
+            if (pool.allocatedSets == 0) {
+                continue;
+            }
+            vkResetDescriptorPool(m_device, pool.pool, 0);
+            pool.allocatedSets = 0;
+        }
+        list.current = 0;
+    }
+
+    void VulkanDescriptorAllocator::DestroyPools(PoolList& list) {
+        for (auto& pool : list.pools) {
+            vkDestroyDescriptorPool(m_device, pool.pool, nullptr);
+        }
+        list.pools.clear();
+        list.current = 0;
+    }
+}
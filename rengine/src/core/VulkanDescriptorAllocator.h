@@ -0,0 +1,152 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace REngine {
+    class VulkanLayoutCache;
+
+    // One resource bound to a descriptor. Buffer types read buffer, image and
+    // sampler types read image, texel buffer types read texelView.
+    struct DescriptorWrite {
+        uint32_t binding = 0;
+        uint32_t arrayElement = 0;
+        VkDescriptorType type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        VkDescriptorBufferInfo buffer{};
+        VkDescriptorImageInfo image{};
+        VkBufferView texelView = VK_NULL_HANDLE;
+
+        static DescriptorWrite Buffer(uint32_t binding, VkDescriptorType type, VkBuffer buffer,
+                                      VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+        static DescriptorWrite Image(uint32_t binding, VkDescriptorType type, VkImageView view, VkSampler sampler,
+                                     VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        bool operator==(const DescriptorWrite& other) const;
+    };
+
+    struct DescriptorAllocatorStats {
+        uint32_t poolCount = 0;          // Frame and cache pools over every slot
+        uint32_t setsThisFrame = 0;      // Allocated by Allocate() since the last BeginFrame()
+        uint32_t cachedSets = 0;         // Alive in the current slot's cache
+        uint64_t cacheHits = 0;
+        uint64_t cacheMisses = 0;
+    };
+
+    // Descriptor sets for the layouts built by Shader::BuildPipelineLayout().
+    // Every frame slot owns a growing list of pools that are reset together
+    // once the slot's fence has signaled, so sets are never freed one by one.
+    // New pools are sized from the descriptor types of the layouts actually
+    // allocated, looked up in the layout cache.
+    //
+    // GetCached() hands out a set that lives across frames for as long as its
+    // bindings do not change. Cached sets live in separate per-slot pools that
+    // are dropped wholesale once most of their sets went unused for a round.
+    class VulkanDescriptorAllocator {
+    public:
+        VulkanDescriptorAllocator() = default;
+        ~VulkanDescriptorAllocator();
+
+        // Disable copying
+        VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+        VulkanDescriptorAllocator& operator=(const VulkanDescriptorAllocator&) = delete;
+
+        void Initialize(VkDevice device, VulkanLayoutCache& layoutCache, uint32_t frameSlots);
+        void Shutdown();
+
+        // Resets the slot's frame pools and drops a stale cache. Call after the
+        // slot's fence has been waited on.
+        void BeginFrame(uint32_t frameSlot);
+
+        // Valid until the slot comes around again. The layout must come from the
+        // layout cache. Thread-safe.
+        VkDescriptorSet Allocate(VkDescriptorSetLayout layout);
+        VkDescriptorSet Allocate(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes);
+
+        // Returns the set this slot used last time for the same layout and
+        // writes, or allocates and writes a new one. The caller keeps the bound
+        // resources alive while the set can be returned. Thread-safe.
+        VkDescriptorSet GetCached(VkDescriptorSetLayout layout, const std::vector<DescriptorWrite>& writes);
+
+        // Drops every cached set, slot by slot at its next BeginFrame(). Call
+        // when resources a cached set refers to are destroyed.
+        void InvalidateCache();
+
+        // Writes are applied immediately, the set must not be in use by a pending frame
+        void Write(VkDescriptorSet set, const std::vector<DescriptorWrite>& writes) const;
+
+        [[nodiscard]] DescriptorAllocatorStats GetStats() const;
+
+    private:
+        static constexpr uint32_t FIRST_POOL_SETS = 64;
+        static constexpr uint32_t MAX_POOL_SETS = 4096;
+        static constexpr size_t MIN_CACHE_RESET_SETS = 256;  // Smaller caches are never dropped for being stale
+        static constexpr uint64_t TYPE_HISTORY_SETS = 65536;  // Type totals are halved past this, so the mix can shift
+
+        struct Pool {
+            VkDescriptorPool pool = VK_NULL_HANDLE;
+            uint32_t maxSets = 0;
+            uint32_t allocatedSets = 0;
+        };
+
+        // Pools are filled in order. Full ones are skipped until the next reset.
+        struct PoolList {
+            std::vector<Pool> pools;
+            size_t current = 0;
+        };
+
+        struct LayoutInfo {
+            std::vector<VkDescriptorPoolSize> sizes;  // Descriptors per set by type
+        };
+
+        struct CacheKey {
+            VkDescriptorSetLayout layout;
+            std::vector<DescriptorWrite> writes;
+
+            bool operator==(const CacheKey& other) const;
+        };
+
+        struct CacheKeyHash {
+            size_t operator()(const CacheKey& key) const;
+        };
+
+        struct CachedSet {
+            VkDescriptorSet set;
+            uint64_t lastRound;
+        };
+
+        struct FrameSlot {
+            PoolList framePools;
+            PoolList cachePools;
+            std::unordered_map<CacheKey, CachedSet, CacheKeyHash> cache;
+            uint64_t round = 0;          // BeginFrame() calls for this slot
+            size_t usedThisRound = 0;    // Distinct cached sets returned this round
+            bool invalidated = false;
+        };
+
+        const LayoutInfo& GetLayoutInfo(VkDescriptorSetLayout layout);
+        VkDescriptorSet AllocateFrom(PoolList& list, VkDescriptorSetLayout layout, const LayoutInfo& info);
+        void CountAllocation(const LayoutInfo& info);
+        VkDescriptorPool CreatePool(uint32_t maxSets, const LayoutInfo& info) const;
+        void ResetPools(PoolList& list);
+        void DestroyPools(PoolList& list);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VulkanLayoutCache* m_layoutCache = nullptr;
+        std::vector<FrameSlot> m_slots;
+        uint32_t m_currentSlot = 0;
+
+        std::unordered_map<VkDescriptorSetLayout, LayoutInfo> m_layouts;
+
+        // Descriptors by type over every allocation, the mix new pools are sized for
+        std::unordered_map<VkDescriptorType, uint64_t> m_typeTotals;
+        uint64_t m_setTotal = 0;
+
+        uint32_t m_setsThisFrame = 0;
+        uint64_t m_cacheHits = 0;
+        uint64_t m_cacheMisses = 0;
+
+        mutable std::mutex m_mutex;
+    };
+}
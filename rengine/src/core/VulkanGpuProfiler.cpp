@@ -0,0 +1,173 @@
+﻿#include "VulkanGpuProfiler.h"
+#include <stdexcept>
+
+namespace REngine {
+    namespace {
+        constexpr uint32_t DROPPED_SCOPE = UINT32_MAX;
+    }
+
+    VulkanGpuProfiler::~VulkanGpuProfiler() {
+        Shutdown();
+    }
+
+    void VulkanGpuProfiler::Initialize(
+        VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        const uint32_t queueFamilyIndex,
+        const uint32_t frameSlots,
+        const uint32_t maxScopesPerFrame
+    ) {
+        m_device = device;
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+        uint32_t queueFamilyCount = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+        std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+        vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+        const uint32_t validBits = queueFamilyIndex < queueFamilyCount ? queueFamilies[queueFamilyIndex].timestampValidBits : 0;
+        m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+        if (!m_supported) {
+            return;
+        }
+
+        m_timestampPeriodNS = properties.limits.timestampPeriod;
+        m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+        m_maxQueriesPerFrame = maxScopesPerFrame * 2;
+
+        VkQueryPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        poolInfo.queryCount = m_maxQueriesPerFrame * frameSlots;
+
+        if (vkCreateQueryPool(m_device, &poolInfo, nullptr, &m_queryPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create timestamp query pool!");
+        }
+
+        m_slots.assign(frameSlots, {});
+        for (auto& slot : m_slots) {
+            slot.scopes.reserve(maxScopesPerFrame);
+        }
+        m_timestamps.resize(m_maxQueriesPerFrame);
+    }
+
+    void VulkanGpuProfiler::Shutdown() {
+        if (m_queryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device, m_queryPool, nullptr);
+            m_queryPool = VK_NULL_HANDLE;
+        }
+        m_slots.clear();
+        m_openScopes.clear();
+        m_results.clear();
+        m_frameTimeMS = 0.0;
+        m_supported = false;
+        m_device = VK_NULL_HANDLE;
+    }
+
+    void VulkanGpuProfiler::BeginFrame(VkCommandBuffer cmd, const uint32_t frameSlot) {
+        if (!m_supported) {
+            return;
+        }
+
+        m_currentSlot = frameSlot;
+        FrameSlot& slot = m_slots[frameSlot];
+        const uint32_t firstQuery = frameSlot * m_maxQueriesPerFrame;
+
+        // The caller waited on this slot's fence, its previous frame is complete
+        if (slot.recorded) {
+            Resolve(slot, firstQuery);
+        }
+
+        vkCmdResetQueryPool(cmd, m_queryPool, firstQuery, m_maxQueriesPerFrame);
+        slot.scopes.clear();
+        slot.queryCount = 0;
+        slot.recorded = true;
+        m_openScopes.clear();
+
+        BeginScope(cmd, "Frame");
+    }
+
+    void VulkanGpuProfiler::EndFrame(VkCommandBuffer cmd) {
+        if (!m_supported) {
+            return;
+        }
+
+        while (!m_openScopes.empty()) {
+            EndScope(cmd);
+        }
+    }
+
+    void VulkanGpuProfiler::BeginScope(VkCommandBuffer cmd, const std::string& name) {
+        if (!m_supported) {
+            return;
+        }
+
+        FrameSlot& slot = m_slots[m_currentSlot];
+        if (slot.queryCount + 2 > m_maxQueriesPerFrame) {
+            m_openScopes.push_back(DROPPED_SCOPE);
+            return;
+        }
+
+        // Both queries are reserved up front so every begun scope can be closed
+        const uint32_t firstQuery = m_currentSlot * m_maxQueriesPerFrame;
+        Scope scope{name, static_cast<uint32_t>(m_openScopes.size()), firstQuery + slot.queryCount, firstQuery + slot.queryCount + 1};
+        slot.queryCount += 2;
+
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, scope.beginQuery);
+
+        m_openScopes.push_back(static_cast<uint32_t>(slot.scopes.size()));
+        slot.scopes.push_back(std::move(scope));
+    }
+
+    void VulkanGpuProfiler::EndScope(VkCommandBuffer cmd) {
+        if (!m_supported || m_openScopes.empty()) {
+            return;
+        }
+
+        const uint32_t index = m_openScopes.back();
+        m_openScopes.pop_back();
+        if (index == DROPPED_SCOPE) {
+            return;
+        }
+
+        const Scope& scope = m_slots[m_currentSlot].scopes[index];
+        vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, scope.endQuery);
+    }
+
+    void VulkanGpuProfiler::Resolve(FrameSlot& slot, const uint32_t firstQuery) {
+        if (slot.queryCount == 0) {
+            return;
+        }
+
+        // No WAIT flag: a frame that never reached the GPU just keeps the previous results
+        const VkResult result = vkGetQueryPoolResults(
+            m_device, m_queryPool, firstQuery, slot.queryCount,
+            slot.queryCount * sizeof(uint64_t), m_timestamps.data(), sizeof(uint64_t),
+            VK_QUERY_RESULT_64_BIT
+        );
+        if (result != VK_SUCCESS) {
+            return;
+        }
+
+        m_results.clear();
+        for (const auto& scope : slot.scopes) {
+            const uint64_t begin = m_timestamps[scope.beginQuery - firstQuery];
+            const uint64_t end = m_timestamps[scope.endQuery - firstQuery];
+            const uint64_t ticks = (end - begin) & m_timestampMask;
+            m_results.push_back({scope.name, scope.depth, static_cast<double>(ticks) * m_timestampPeriodNS / 1e6});
+        }
+        m_frameTimeMS = m_results.empty() ? 0.0 : m_results.front().timeMS;
+    }
+
+    double VulkanGpuProfiler::GetScopeTimeMS(const std::string& name) const {
+        double total = 0.0;
+        for (const auto& result : m_results) {
+            if (result.name == name) {
+                total += result.timeMS;
+            }
+        }
+        return total;
+    }
+}
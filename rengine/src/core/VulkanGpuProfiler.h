@@ -0,0 +1,103 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace REngine {
+    struct GpuScopeResult {
+        std::string name;
+        uint32_t depth;
+        double timeMS;
+    };
+
+    // Timestamp queries recorded into the frame command buffer. Each frame slot
+    // has its own range in the query pool; results are read when the slot comes
+    // around again, after its fence has signaled, so reading never stalls and
+    // lags the current frame by the number of frames in flight.
+    class VulkanGpuProfiler {
+    public:
+        static constexpr uint32_t DEFAULT_MAX_SCOPES = 128;
+
+        VulkanGpuProfiler() = default;
+        ~VulkanGpuProfiler();
+
+        // Disable copying
+        VulkanGpuProfiler(const VulkanGpuProfiler&) = delete;
+        VulkanGpuProfiler& operator=(const VulkanGpuProfiler&) = delete;
+
+        void Initialize(
+            VkDevice device,
+            VkPhysicalDevice physicalDevice,
+            uint32_t queueFamilyIndex,
+            uint32_t frameSlots,
+            uint32_t maxScopesPerFrame = DEFAULT_MAX_SCOPES
+        );
+        void Shutdown();
+
+        // Must be recorded outside a render pass (resets the slot's queries),
+        // after the slot's fence has been waited on
+        void BeginFrame(VkCommandBuffer cmd, uint32_t frameSlot);
+        void EndFrame(VkCommandBuffer cmd);
+
+        // Scopes nest; scopes beyond the per-frame limit are dropped
+        void BeginScope(VkCommandBuffer cmd, const std::string& name);
+        void EndScope(VkCommandBuffer cmd);
+
+        // False when the queue has no timestamp support; every call is then a no-op
+        [[nodiscard]] bool IsSupported() const { return m_supported; }
+
+        // Most recently resolved frame, in recording order (parents before children)
+        [[nodiscard]] const std::vector<GpuScopeResult>& GetResults() const { return m_results; }
+        [[nodiscard]] double GetFrameTimeMS() const { return m_frameTimeMS; }
+        [[nodiscard]] double GetScopeTimeMS(const std::string& name) const;
+
+    private:
+        struct Scope {
+            std::string name;
+            uint32_t depth;
+            uint32_t beginQuery;
+            uint32_t endQuery;
+        };
+
+        struct FrameSlot {
+            std::vector<Scope> scopes;
+            uint32_t queryCount = 0;
+            bool recorded = false;
+        };
+
+        void Resolve(FrameSlot& slot, uint32_t firstQuery);
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkQueryPool m_queryPool = VK_NULL_HANDLE;
+        bool m_supported = false;
+        double m_timestampPeriodNS = 1.0;
+        uint64_t m_timestampMask = ~0ull;
+        uint32_t m_maxQueriesPerFrame = 0;
+
+        std::vector<FrameSlot> m_slots;
+        uint32_t m_currentSlot = 0;
+        std::vector<uint32_t> m_openScopes;  // Indices into the current slot's scopes
+
+        std::vector<uint64_t> m_timestamps;
+        std::vector<GpuScopeResult> m_results;
+        double m_frameTimeMS = 0.0;
+    };
+
+    // Closes the scope when it goes out of scope
+    class GpuScope {
+    public:
+        GpuScope(VulkanGpuProfiler& profiler, VkCommandBuffer cmd, const std::string& name)
+            : m_profiler(profiler), m_cmd(cmd) {
+            m_profiler.BeginScope(m_cmd, name);
+        }
+        ~GpuScope() { m_profiler.EndScope(m_cmd); }
+
+        GpuScope(const GpuScope&) = delete;
+        GpuScope& operator=(const GpuScope&) = delete;
+
+    private:
+        VulkanGpuProfiler& m_profiler;
+        VkCommandBuffer m_cmd;
+    };
+}
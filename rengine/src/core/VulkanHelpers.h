@@ -44,7 +44,8 @@ namespace REngine {
         const VkDevice device,
         const VkCommandPool commandPool,
         const VkQueue queue,
-        const VkCommandBuffer commandBuffer
+        const VkCommandBuffer commandBuffer,
+        const VkFence fence = VK_NULL_HANDLE
     ) {
         vkEndCommandBuffer(commandBuffer);
 
@@ -53,7 +54,7 @@ namespace REngine {
         submitInfo.commandBufferCount = 1;
         submitInfo.pCommandBuffers = &commandBuffer;
 
-        vkQueueSubmit(queue, 1, &submitInfo, VK_NULL_HANDLE);
+        vkQueueSubmit(queue, 1, &submitInfo, fence);
         vkQueueWaitIdle(queue);
 
         vkFreeCommandBuffers(device, commandPool, 1, &commandBuffer);
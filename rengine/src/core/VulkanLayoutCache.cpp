@@ -0,0 +1,333 @@
+﻿#include "VulkanLayoutCache.h"
+#include <RHash.h>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace REngine {
+    namespace {
+        void Append(std::vector<uint32_t>& words, const uint32_t value) {
+            words.push_back(value);
+        }
+
+        void Append(std::vector<uint32_t>& words, const float value) {
+            uint32_t bits;
+            std::memcpy(&bits, &value, sizeof(bits));
+            words.push_back(bits);
+        }
+
+        // Count first, so references of different lists cannot run together
+        void Append(std::vector<uint32_t>& words, const VkAttachmentReference* references, const uint32_t count) {
+            words.push_back(references ? count : 0);
+            for (uint32_t i = 0; references && i < count; i++) {
+                words.push_back(references[i].attachment);
+                words.push_back(static_cast<uint32_t>(references[i].layout));
+            }
+        }
+    }
+
+    bool VulkanLayoutCache::SetLayoutKey::operator==(const SetLayoutKey& other) const {
+        return flags == other.flags &&
+               std::equal(bindings.begin(), bindings.end(), other.bindings.begin(), other.bindings.end(),
+                   [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+                       return a.binding == b.binding &&
+                              a.descriptorType == b.descriptorType &&
+                              a.descriptorCount == b.descriptorCount &&
+                              a.stageFlags == b.stageFlags;
+                   });
+    }
+
+    bool VulkanLayoutCache::PipelineLayoutKey::operator==(const PipelineLayoutKey& other) const {
+        return setLayouts == other.setLayouts &&
+               std::equal(pushConstants.begin(), pushConstants.end(), other.pushConstants.begin(), other.pushConstants.end(),
+                   [](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+                       return a.stageFlags == b.stageFlags && a.offset == b.offset && a.size == b.size;
+                   });
+    }
+
+    size_t VulkanLayoutCache::KeyHash::operator()(const SetLayoutKey& key) const {
+        size_t seed = key.bindings.size();
+        HashCombine(seed, key.flags);
+        for (const auto& binding : key.bindings) {
+            HashCombine(seed, binding.binding);
+            HashCombine(seed, static_cast<uint64_t>(binding.descriptorType));
+            HashCombine(seed, binding.descriptorCount);
+            HashCombine(seed, binding.stageFlags);
+        }
+        return seed;
+    }
+
+    size_t VulkanLayoutCache::KeyHash::operator()(const PipelineLayoutKey& key) const {
+        size_t seed = key.setLayouts.size();
+        for (const auto& layout : key.setLayouts) {
+            HashCombine(seed, reinterpret_cast<uint64_t>(layout));
+        }
+        for (const auto& range : key.pushConstants) {
+            HashCombine(seed, range.stageFlags);
+            HashCombine(seed, range.offset);
+            HashCombine(seed, range.size);
+        }
+        return seed;
+    }
+
+    size_t VulkanLayoutCache::KeyHash::operator()(const StateKey& key) const {
+        return static_cast<size_t>(HashBytes(key.words.data(), key.words.size() * sizeof(uint32_t)));
+    }
+
+    VulkanLayoutCache::~VulkanLayoutCache() {
+        Shutdown();
+    }
+
+    void VulkanLayoutCache::Initialize(VkDevice device) {
+        m_device = device;
+    }
+
+    void VulkanLayoutCache::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto& [key, layout] : m_pipelineLayouts) {
+            vkDestroyPipelineLayout(m_device, layout, nullptr);
+        }
+        m_pipelineLayouts.clear();
+
+        for (auto& [key, layout] : m_setLayouts) {
+            vkDestroyDescriptorSetLayout(m_device, layout, nullptr);
+        }
+        m_setLayouts.clear();
+        m_setLayoutKeys.clear();
+
+        for (auto& [key, sampler] : m_samplers) {
+            vkDestroySampler(m_device, sampler, nullptr);
+        }
+        m_samplers.clear();
+
+        for (auto& [key, renderPass] : m_renderPasses) {
+            vkDestroyRenderPass(m_device, renderPass, nullptr);
+        }
+        m_renderPasses.clear();
+
+        m_stats = {};
+        m_device = VK_NULL_HANDLE;
+    }
+
+    VkDescriptorSetLayout VulkanLayoutCache::GetSetLayout(
+        std::vector<VkDescriptorSetLayoutBinding> bindings,
+        const VkDescriptorSetLayoutCreateFlags flags
+    ) {
+        for (const auto& binding : bindings) {
+            // The key only stores the pointer, not the samplers behind it
+            if (binding.pImmutableSamplers != nullptr) {
+                throw std::runtime_error("Immutable samplers are not supported by the layout cache!");
+            }
+        }
+
+        std::sort(bindings.begin(), bindings.end(),
+            [](const VkDescriptorSetLayoutBinding& a, const VkDescriptorSetLayoutBinding& b) {
+                return a.binding < b.binding;
+            });
+
+        SetLayoutKey key{flags, std::move(bindings)};
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const auto it = m_setLayouts.find(key);
+        if (it != m_setLayouts.end()) {
+            m_stats.setLayouts.hits++;
+            return it->second;
+        }
+        m_stats.setLayouts.misses++;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.flags = key.flags;
+        layoutInfo.bindingCount = static_cast<uint32_t>(key.bindings.size());
+        layoutInfo.pBindings = key.bindings.data();
+
+        VkDescriptorSetLayout layout;
+        if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create descriptor set layout!");
+        }
+
+        const auto inserted = m_setLayouts.emplace(std::move(key), layout).first;
+        m_setLayoutKeys.emplace(layout, &inserted->first);
+        return layout;
+    }
+
+    VkPipelineLayout VulkanLayoutCache::GetPipelineLayout(
+        const std::vector<VkDescriptorSetLayout>& setLayouts,
+        const std::vector<VkPushConstantRange>& pushConstants
+    ) {
+        PipelineLayoutKey key{setLayouts, pushConstants};
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const auto it = m_pipelineLayouts.find(key);
+        if (it != m_pipelineLayouts.end()) {
+            m_stats.pipelineLayouts.hits++;
+            return it->second;
+        }
+        m_stats.pipelineLayouts.misses++;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(key.setLayouts.size());
+        pipelineLayoutInfo.pSetLayouts = key.setLayouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(key.pushConstants.size());
+        pipelineLayoutInfo.pPushConstantRanges = key.pushConstants.data();
+
+        VkPipelineLayout layout;
+        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &layout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+
+        m_pipelineLayouts.emplace(std::move(key), layout);
+        return layout;
+    }
+
+    VkSampler VulkanLayoutCache::GetSampler(const VkSamplerCreateInfo& info) {
+        if (info.pNext != nullptr) {
+            throw std::runtime_error("Sampler create info chains are not supported by the layout cache!");
+        }
+
+        StateKey key;
+        key.words.reserve(16);
+        Append(key.words, static_cast<uint32_t>(info.flags));
+        Append(key.words, static_cast<uint32_t>(info.magFilter));
+        Append(key.words, static_cast<uint32_t>(info.minFilter));
+        Append(key.words, static_cast<uint32_t>(info.mipmapMode));
+        Append(key.words, static_cast<uint32_t>(info.addressModeU));
+        Append(key.words, static_cast<uint32_t>(info.addressModeV));
+        Append(key.words, static_cast<uint32_t>(info.addressModeW));
+        Append(key.words, info.mipLodBias);
+        Append(key.words, static_cast<uint32_t>(info.anisotropyEnable));
+        Append(key.words, info.anisotropyEnable ? info.maxAnisotropy : 0.0f);
+        Append(key.words, static_cast<uint32_t>(info.compareEnable));
+        Append(key.words, static_cast<uint32_t>(info.compareOp));
+        Append(key.words, info.minLod);
+        Append(key.words, info.maxLod);
+        Append(key.words, static_cast<uint32_t>(info.borderColor));
+        Append(key.words, static_cast<uint32_t>(info.unnormalizedCoordinates));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const auto it = m_samplers.find(key);
+        if (it != m_samplers.end()) {
+            m_stats.samplers.hits++;
+            return it->second;
+        }
+        m_stats.samplers.misses++;
+
+        VkSampler sampler;
+        if (vkCreateSampler(m_device, &info, nullptr, &sampler) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create sampler!");
+        }
+        m_samplers.emplace(std::move(key), sampler);
+        return sampler;
+    }
+
+    VkRenderPass VulkanLayoutCache::GetRenderPass(const VkRenderPassCreateInfo& info) {
+        if (info.pNext != nullptr) {
+            throw std::runtime_error("Render pass create info chains are not supported by the layout cache!");
+        }
+
+        StateKey key;
+        Append(key.words, static_cast<uint32_t>(info.flags));
+
+        Append(key.words, info.attachmentCount);
+        for (uint32_t i = 0; i < info.attachmentCount; i++) {
+            const VkAttachmentDescription& attachment = info.pAttachments[i];
+            Append(key.words, static_cast<uint32_t>(attachment.flags));
+            Append(key.words, static_cast<uint32_t>(attachment.format));
+            Append(key.words, static_cast<uint32_t>(attachment.samples));
+            Append(key.words, static_cast<uint32_t>(attachment.loadOp));
+            Append(key.words, static_cast<uint32_t>(attachment.storeOp));
+            Append(key.words, static_cast<uint32_t>(attachment.stencilLoadOp));
+            Append(key.words, static_cast<uint32_t>(attachment.stencilStoreOp));
+            Append(key.words, static_cast<uint32_t>(attachment.initialLayout));
+            Append(key.words, static_cast<uint32_t>(attachment.finalLayout));
+        }
+
+        Append(key.words, info.subpassCount);
+        for (uint32_t i = 0; i < info.subpassCount; i++) {
+            const VkSubpassDescription& subpass = info.pSubpasses[i];
+            Append(key.words, static_cast<uint32_t>(subpass.flags));
+            Append(key.words, static_cast<uint32_t>(subpass.pipelineBindPoint));
+            Append(key.words, subpass.pInputAttachments, subpass.inputAttachmentCount);
+            Append(key.words, subpass.pColorAttachments, subpass.colorAttachmentCount);
+            Append(key.words, subpass.pResolveAttachments, subpass.colorAttachmentCount);
+            Append(key.words, subpass.pDepthStencilAttachment, 1);
+            Append(key.words, subpass.pPreserveAttachments ? subpass.preserveAttachmentCount : 0);
+            for (uint32_t p = 0; subpass.pPreserveAttachments && p < subpass.preserveAttachmentCount; p++) {
+                Append(key.words, subpass.pPreserveAttachments[p]);
+            }
+        }
+
+        Append(key.words, info.dependencyCount);
+        for (uint32_t i = 0; i < info.dependencyCount; i++) {
+            const VkSubpassDependency& dependency = info.pDependencies[i];
+            Append(key.words, dependency.srcSubpass);
+            Append(key.words, dependency.dstSubpass);
+            Append(key.words, static_cast<uint32_t>(dependency.srcStageMask));
+            Append(key.words, static_cast<uint32_t>(dependency.dstStageMask));
+            Append(key.words, static_cast<uint32_t>(dependency.srcAccessMask));
+            Append(key.words, static_cast<uint32_t>(dependency.dstAccessMask));
+            Append(key.words, static_cast<uint32_t>(dependency.dependencyFlags));
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const auto it = m_renderPasses.find(key);
+        if (it != m_renderPasses.end()) {
+            m_stats.renderPasses.hits++;
+            return it->second;
+        }
+        m_stats.renderPasses.misses++;
+
+        VkRenderPass renderPass;
+        if (vkCreateRenderPass(m_device, &info, nullptr, &renderPass) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render pass!");
+        }
+        m_renderPasses.emplace(std::move(key), renderPass);
+        return renderPass;
+    }
+
+    bool VulkanLayoutCache::GetSetLayoutInfo(
+        VkDescriptorSetLayout layout,
+        std::vector<VkDescriptorSetLayoutBinding>& bindings,
+        VkDescriptorSetLayoutCreateFlags& flags
+    ) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const auto it = m_setLayoutKeys.find(layout);
+        if (it == m_setLayoutKeys.end()) {
+            return false;
+        }
+        bindings = it->second->bindings;
+        flags = it->second->flags;
+        return true;
+    }
+
+    uint32_t VulkanLayoutCache::GetSetLayoutCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<uint32_t>(m_setLayouts.size());
+    }
+
+    uint32_t VulkanLayoutCache::GetPipelineLayoutCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<uint32_t>(m_pipelineLayouts.size());
+    }
+
+    LayoutCacheStats VulkanLayoutCache::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        LayoutCacheStats stats = m_stats;
+        stats.setLayouts.objects = static_cast<uint32_t>(m_setLayouts.size());
+        stats.pipelineLayouts.objects = static_cast<uint32_t>(m_pipelineLayouts.size());
+        stats.samplers.objects = static_cast<uint32_t>(m_samplers.size());
+        stats.renderPasses.objects = static_cast<uint32_t>(m_renderPasses.size());
+        return stats;
+    }
+}
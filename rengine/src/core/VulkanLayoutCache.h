@@ -0,0 +1,108 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace REngine {
+    struct LayoutCacheCounts {
+        uint32_t objects = 0;
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+    };
+
+    struct LayoutCacheStats {
+        LayoutCacheCounts setLayouts;
+        LayoutCacheCounts pipelineLayouts;
+        LayoutCacheCounts samplers;
+        LayoutCacheCounts renderPasses;
+    };
+
+    // Deduplicates descriptor set layouts, pipeline layouts, samplers and render
+    // passes, keyed by a hash of their create info. Identical binding sets map to
+    // the same VkDescriptorSetLayout, so pipelines built from different shaders
+    // stay layout-compatible and can share descriptor binds; textures share a
+    // handful of samplers instead of one each. Every handle is owned by the cache
+    // and lives until Shutdown().
+    class VulkanLayoutCache {
+    public:
+        VulkanLayoutCache() = default;
+        ~VulkanLayoutCache();
+
+        // Disable copying
+        VulkanLayoutCache(const VulkanLayoutCache&) = delete;
+        VulkanLayoutCache& operator=(const VulkanLayoutCache&) = delete;
+
+        void Initialize(VkDevice device);
+        void Shutdown();
+
+        // Binding order does not matter, the key is sorted by binding index
+        VkDescriptorSetLayout GetSetLayout(
+            std::vector<VkDescriptorSetLayoutBinding> bindings,
+            VkDescriptorSetLayoutCreateFlags flags = 0
+        );
+
+        VkPipelineLayout GetPipelineLayout(
+            const std::vector<VkDescriptorSetLayout>& setLayouts,
+            const std::vector<VkPushConstantRange>& pushConstants = {}
+        );
+
+        // pNext chains are not supported. Unlike every other handle here, samplers
+        // count against maxSamplerAllocationCount.
+        VkSampler GetSampler(const VkSamplerCreateInfo& info);
+
+        // Everything the create info points to is part of the key. pNext chains
+        // are not supported.
+        VkRenderPass GetRenderPass(const VkRenderPassCreateInfo& info);
+
+        // Reverse lookup for layouts created here, false for any other layout.
+        // bindings is sorted by binding index.
+        bool GetSetLayoutInfo(
+            VkDescriptorSetLayout layout,
+            std::vector<VkDescriptorSetLayoutBinding>& bindings,
+            VkDescriptorSetLayoutCreateFlags& flags
+        ) const;
+
+        [[nodiscard]] uint32_t GetSetLayoutCount() const;
+        [[nodiscard]] uint32_t GetPipelineLayoutCount() const;
+        [[nodiscard]] LayoutCacheStats GetStats() const;
+
+    private:
+        struct SetLayoutKey {
+            VkDescriptorSetLayoutCreateFlags flags = 0;
+            std::vector<VkDescriptorSetLayoutBinding> bindings;
+
+            bool operator==(const SetLayoutKey& other) const;
+        };
+
+        struct PipelineLayoutKey {
+            std::vector<VkDescriptorSetLayout> setLayouts;
+            std::vector<VkPushConstantRange> pushConstants;
+
+            bool operator==(const PipelineLayoutKey& other) const;
+        };
+
+        // Create info flattened to words, pointers replaced by what they point to
+        struct StateKey {
+            std::vector<uint32_t> words;
+
+            bool operator==(const StateKey& other) const { return words == other.words; }
+        };
+
+        struct KeyHash {
+            size_t operator()(const SetLayoutKey& key) const;
+            size_t operator()(const PipelineLayoutKey& key) const;
+            size_t operator()(const StateKey& key) const;
+        };
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        std::unordered_map<SetLayoutKey, VkDescriptorSetLayout, KeyHash> m_setLayouts;
+        std::unordered_map<VkDescriptorSetLayout, const SetLayoutKey*> m_setLayoutKeys;  // Points into m_setLayouts
+        std::unordered_map<PipelineLayoutKey, VkPipelineLayout, KeyHash> m_pipelineLayouts;
+        std::unordered_map<StateKey, VkSampler, KeyHash> m_samplers;
+        std::unordered_map<StateKey, VkRenderPass, KeyHash> m_renderPasses;
+        LayoutCacheStats m_stats;
+        mutable std::mutex m_mutex;
+    };
+}
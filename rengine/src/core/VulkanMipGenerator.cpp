@@ -0,0 +1,450 @@
+﻿#include "VulkanMipGenerator.h"
+#include "VulkanLayoutCache.h"
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace REngine {
+    namespace {
+#ifdef RENGINE_MIP_DOWNSAMPLE_SPV
+        // shaders/mip_downsample.comp, compiled by the build
+        const uint32_t MIP_DOWNSAMPLE_SPV[] = {
+#include "mip_downsample.comp.inc"
+        };
+#endif
+
+        // Must match shaders/mip_downsample.comp
+        constexpr uint32_t FLAG_SRGB = 1;
+        constexpr uint32_t FLAG_ALPHA_WEIGHTED = 2;
+        constexpr uint32_t FLAG_SWAP_RB = 4;
+        constexpr uint32_t TILE_SIZE = 32;  // First level texels per workgroup side
+
+        // The shader writes through an rgba8 view, other 8-bit layouts are converted on store
+        bool GetComputeFlags(const VkFormat format, uint32_t& flags) {
+            switch (format) {
+                case VK_FORMAT_R8G8B8A8_UNORM: flags = 0; return true;
+                case VK_FORMAT_R8G8B8A8_SRGB: flags = FLAG_SRGB; return true;
+                case VK_FORMAT_B8G8R8A8_UNORM: flags = FLAG_SWAP_RB; return true;
+                case VK_FORMAT_B8G8R8A8_SRGB: flags = FLAG_SRGB | FLAG_SWAP_RB; return true;
+                default: return false;
+            }
+        }
+
+        VkExtent2D LevelExtent(const VkExtent2D extent, const uint32_t level) {
+            return {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+        }
+    }
+
+    VulkanMipGenerator::~VulkanMipGenerator() {
+        Shutdown();
+    }
+
+    void VulkanMipGenerator::Initialize(
+        VkDevice device,
+        VkPhysicalDevice physicalDevice,
+        VulkanLayoutCache& layoutCache,
+        VkPipelineCache pipelineCache,
+        const bool extendedUsage
+    ) {
+        m_device = device;
+        m_physicalDevice = physicalDevice;
+        m_extendedUsage = extendedUsage;
+        m_stats = {};
+
+#ifdef RENGINE_MIP_DOWNSAMPLE_SPV
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = VK_FILTER_NEAREST;
+        samplerInfo.minFilter = VK_FILTER_NEAREST;
+        samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create mip generator sampler!");
+        }
+
+        std::vector<VkDescriptorSetLayoutBinding> bindings(2);
+        bindings[0].binding = 0;
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[0].descriptorCount = 1;
+        bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[1].binding = 1;
+        bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        bindings[1].descriptorCount = LEVELS_PER_DISPATCH;
+        bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        m_setLayout = layoutCache.GetSetLayout(bindings);
+        m_pipelineLayout = layoutCache.GetPipelineLayout(
+            {m_setLayout}, {{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushConstants)}});
+
+        VkShaderModuleCreateInfo moduleInfo{};
+        moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        moduleInfo.codeSize = sizeof(MIP_DOWNSAMPLE_SPV);
+        moduleInfo.pCode = MIP_DOWNSAMPLE_SPV;
+
+        VkShaderModule module;
+        if (vkCreateShaderModule(m_device, &moduleInfo, nullptr, &module) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create mip generator shader module!");
+        }
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipelineInfo.stage.module = module;
+        pipelineInfo.stage.pName = "main";
+        pipelineInfo.layout = m_pipelineLayout;
+
+        const VkResult result = vkCreateComputePipelines(m_device, pipelineCache, 1, &pipelineInfo, nullptr, &m_pipeline);
+        vkDestroyShaderModule(m_device, module, nullptr);
+        if (result != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create mip generator pipeline!");
+        }
+#else
+        (void)layoutCache;
+        (void)pipelineCache;
+#endif
+    }
+
+    void VulkanMipGenerator::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        for (const auto pool : m_pools) {
+            vkDestroyDescriptorPool(m_device, pool, nullptr);
+        }
+        m_pools.clear();
+
+        if (m_pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(m_device, m_pipeline, nullptr);
+            m_pipeline = VK_NULL_HANDLE;
+        }
+        if (m_sampler != VK_NULL_HANDLE) {
+            vkDestroySampler(m_device, m_sampler, nullptr);
+            m_sampler = VK_NULL_HANDLE;
+        }
+        m_pipelineLayout = VK_NULL_HANDLE;
+        m_setLayout = VK_NULL_HANDLE;
+        m_device = VK_NULL_HANDLE;
+    }
+
+    bool VulkanMipGenerator::SupportsCompute(const VkFormat format) const {
+        uint32_t flags;
+        if (m_pipeline == VK_NULL_HANDLE || !GetComputeFlags(format, flags)) {
+            return false;
+        }
+
+        // Storage usage on a format that cannot be stored to needs VK_IMAGE_CREATE_EXTENDED_USAGE_BIT
+        if (format != VK_FORMAT_R8G8B8A8_UNORM && !m_extendedUsage) {
+            return false;
+        }
+
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(m_physicalDevice, VK_FORMAT_R8G8B8A8_UNORM, &properties);
+        return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT) != 0;
+    }
+
+    void VulkanMipGenerator::GetImageRequirements(const VkFormat format, VkImageUsageFlags& usage, VkImageCreateFlags& flags) const {
+        usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        flags = 0;
+
+        if (!SupportsCompute(format)) {
+            usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            return;
+        }
+
+        usage |= VK_IMAGE_USAGE_STORAGE_BIT;
+        if (format != VK_FORMAT_R8G8B8A8_UNORM) {
+            flags = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT | VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+        }
+    }
+
+    std::function<void()> VulkanMipGenerator::Generate(VkCommandBuffer cmd, const MipChainDesc& desc) {
+        if (SupportsCompute(desc.format)) {
+            return GenerateWithCompute(cmd, desc);
+        }
+        GenerateWithBlits(cmd, desc);
+        return [] {};
+    }
+
+    std::function<void()> VulkanMipGenerator::GenerateWithCompute(VkCommandBuffer cmd, const MipChainDesc& desc) {
+        uint32_t flags = 0;
+        GetComputeFlags(desc.format, flags);
+        if (desc.alphaWeighted) {
+            flags |= FLAG_ALPHA_WEIGHTED;
+        }
+
+        // One storage view per written level, one sampled view per dispatch base
+        std::vector<VkImageView> views;
+        std::vector<std::pair<VkDescriptorPool, VkDescriptorSet>> sets;
+        std::vector<VkImageView> storageViews(desc.mipLevels, VK_NULL_HANDLE);
+        for (uint32_t level = 1; level < desc.mipLevels; level++) {
+            storageViews[level] = CreateView(desc.image, VK_FORMAT_R8G8B8A8_UNORM, level, VK_IMAGE_USAGE_STORAGE_BIT);
+            views.push_back(storageViews[level]);
+        }
+
+        // The copy leaves every level in TRANSFER_DST, the whole chain stays in GENERAL while it is built
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = desc.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, desc.mipLevels, 0, 1};
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+        uint32_t barrierCount = 1;
+        uint32_t dispatchCount = 0;
+
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+
+        for (uint32_t base = 0; base + 1 < desc.mipLevels; base += LEVELS_PER_DISPATCH) {
+            const uint32_t levelCount = std::min(LEVELS_PER_DISPATCH, desc.mipLevels - 1 - base);
+
+            // The previous dispatch wrote this one's base level
+            if (base > 0) {
+                VkMemoryBarrier memoryBarrier{};
+                memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+                memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+                memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                                     1, &memoryBarrier, 0, nullptr, 0, nullptr);
+                barrierCount++;
+            }
+
+            const VkImageView baseView = CreateView(desc.image, desc.format, base, VK_IMAGE_USAGE_SAMPLED_BIT);
+            views.push_back(baseView);
+
+            VkDescriptorPool pool;
+            const VkDescriptorSet set = AllocateSet(pool);
+            sets.emplace_back(pool, set);
+
+            // Levels past the end of the chain are never stored to but must still be valid
+            VkDescriptorImageInfo baseInfo{m_sampler, baseView, VK_IMAGE_LAYOUT_GENERAL};
+            VkDescriptorImageInfo levelInfos[LEVELS_PER_DISPATCH];
+            for (uint32_t i = 0; i < LEVELS_PER_DISPATCH; i++) {
+                const uint32_t level = std::min(base + 1 + i, desc.mipLevels - 1);
+                levelInfos[i] = {VK_NULL_HANDLE, storageViews[level], VK_IMAGE_LAYOUT_GENERAL};
+            }
+
+            VkWriteDescriptorSet writes[2]{};
+            writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[0].dstSet = set;
+            writes[0].dstBinding = 0;
+            writes[0].descriptorCount = 1;
+            writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            writes[0].pImageInfo = &baseInfo;
+            writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[1].dstSet = set;
+            writes[1].dstBinding = 1;
+            writes[1].descriptorCount = LEVELS_PER_DISPATCH;
+            writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[1].pImageInfo = levelInfos;
+            vkUpdateDescriptorSets(m_device, 2, writes, 0, nullptr);
+
+            const VkExtent2D baseExtent = LevelExtent(desc.extent, base);
+            const VkExtent2D firstExtent = LevelExtent(desc.extent, base + 1);
+
+            PushConstants constants{};
+            constants.baseWidth = static_cast<int32_t>(baseExtent.width);
+            constants.baseHeight = static_cast<int32_t>(baseExtent.height);
+            constants.levelCount = levelCount;
+            constants.flags = flags;
+
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &set, 0, nullptr);
+            vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+            vkCmdDispatch(cmd, (firstExtent.width + TILE_SIZE - 1) / TILE_SIZE, (firstExtent.height + TILE_SIZE - 1) / TILE_SIZE, 1);
+            dispatchCount++;
+        }
+
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                             0, nullptr, 0, nullptr, 1, &barrier);
+        barrierCount++;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.computeChains++;
+            m_stats.dispatches += dispatchCount;
+            m_stats.barriers += barrierCount;
+        }
+
+        return [this, views = std::move(views), sets = std::move(sets)]() {
+            for (const auto view : views) {
+                vkDestroyImageView(m_device, view, nullptr);
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (const auto& [pool, set] : sets) {
+                vkFreeDescriptorSets(m_device, pool, 1, &set);
+            }
+        };
+    }
+
+    void VulkanMipGenerator::GenerateWithBlits(VkCommandBuffer cmd, const MipChainDesc& desc) {
+        VkFormatProperties formatProperties;
+        vkGetPhysicalDeviceFormatProperties(m_physicalDevice, desc.format, &formatProperties);
+
+        constexpr VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT;
+        if ((formatProperties.optimalTilingFeatures & blitFeatures) != blitFeatures) {
+            throw std::runtime_error("Texture image format supports neither compute nor blit mip generation!");
+        }
+        const VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)
+            ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.image = desc.image;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.subresourceRange.levelCount = 1;
+
+        int32_t mipWidth = static_cast<int32_t>(desc.extent.width);
+        int32_t mipHeight = static_cast<int32_t>(desc.extent.height);
+
+        for (uint32_t i = 1; i < desc.mipLevels; i++) {
+            barrier.subresourceRange.baseMipLevel = i - 1;
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+            vkCmdPipelineBarrier(cmd,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = {0, 0, 0};
+            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = i - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = {0, 0, 0};
+            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1,
+                                 mipHeight > 1 ? mipHeight / 2 : 1, 1};
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = i;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(cmd,
+                desc.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                desc.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                1, &blit,
+                filter);
+
+            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+            vkCmdPipelineBarrier(cmd,
+                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+                0, nullptr,
+                0, nullptr,
+                1, &barrier);
+
+            if (mipWidth > 1) mipWidth /= 2;
+            if (mipHeight > 1) mipHeight /= 2;
+        }
+
+        // Transition last mip level
+        barrier.subresourceRange.baseMipLevel = desc.mipLevels - 1;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(cmd,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stats.blitChains++;
+        m_stats.barriers += 2 * (desc.mipLevels - 1) + 1;
+    }
+
+    VkDescriptorSet VulkanMipGenerator::AllocateSet(VkDescriptorPool& pool) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        VkDescriptorSetAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocInfo.descriptorSetCount = 1;
+        allocInfo.pSetLayouts = &m_setLayout;
+
+        // Sets are freed as uploads complete, so older pools regain room. Newest first.
+        VkDescriptorSet set;
+        for (auto it = m_pools.rbegin(); it != m_pools.rend(); ++it) {
+            allocInfo.descriptorPool = *it;
+            if (vkAllocateDescriptorSets(m_device, &allocInfo, &set) == VK_SUCCESS) {
+                pool = *it;
+                return set;
+            }
+        }
+
+        const VkDescriptorPoolSize sizes[] = {
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, SETS_PER_POOL},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, SETS_PER_POOL * LEVELS_PER_DISPATCH},
+        };
+
+        VkDescriptorPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+        poolInfo.maxSets = SETS_PER_POOL;
+        poolInfo.poolSizeCount = 2;
+        poolInfo.pPoolSizes = sizes;
+
+        if (vkCreateDescriptorPool(m_device, &poolInfo, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create mip generator descriptor pool!");
+        }
+        m_pools.push_back(pool);
+
+        allocInfo.descriptorPool = pool;
+        if (vkAllocateDescriptorSets(m_device, &allocInfo, &set) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate mip generator descriptor set!");
+        }
+        return set;
+    }
+
+    VkImageView VulkanMipGenerator::CreateView(VkImage image, const VkFormat format, const uint32_t level,
+                                               const VkImageUsageFlags usage) const {
+        // sRGB and BGRA formats cannot carry the image's storage usage
+        VkImageViewUsageCreateInfo usageInfo{};
+        usageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO;
+        usageInfo.usage = usage;
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.pNext = m_extendedUsage ? &usageInfo : nullptr;
+        viewInfo.image = image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = format;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+
+        VkImageView view;
+        if (vkCreateImageView(m_device, &viewInfo, nullptr, &view) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create mip generator image view!");
+        }
+        return view;
+    }
+
+    MipGeneratorStats VulkanMipGenerator::GetStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+}
@@ -0,0 +1,97 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+namespace REngine {
+    class VulkanLayoutCache;
+
+    struct MipChainDesc {
+        VkImage image = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{};
+        uint32_t mipLevels = 1;
+
+        // Colors are averaged weighted by alpha, so fully transparent texels do
+        // not darken or tint their neighbours. Compute path only.
+        bool alphaWeighted = false;
+    };
+
+    struct MipGeneratorStats {
+        uint64_t computeChains = 0;
+        uint64_t blitChains = 0;
+        uint64_t dispatches = 0;
+        uint64_t barriers = 0;   // vkCmdPipelineBarrier calls over both paths
+    };
+
+    // Builds mip chains on the GPU. 8-bit RGBA and BGRA formats, sRGB or not,
+    // take a compute path that writes up to six levels per dispatch with one
+    // barrier between dispatches, averaging sRGB data in linear space. Other
+    // formats, and builds without the embedded shader, blit level by level
+    // with a linear filter, or a nearest one where the format cannot filter.
+    class VulkanMipGenerator {
+    public:
+        static constexpr uint32_t LEVELS_PER_DISPATCH = 6;
+
+        VulkanMipGenerator() = default;
+        ~VulkanMipGenerator();
+
+        // Disable copying
+        VulkanMipGenerator(const VulkanMipGenerator&) = delete;
+        VulkanMipGenerator& operator=(const VulkanMipGenerator&) = delete;
+
+        // extendedUsage: the device is used as Vulkan 1.1, so storage usage can be
+        // declared on sRGB and BGRA images whose storage view uses another format
+        void Initialize(VkDevice device, VkPhysicalDevice physicalDevice, VulkanLayoutCache& layoutCache,
+                        VkPipelineCache pipelineCache, bool extendedUsage);
+        void Shutdown();
+
+        [[nodiscard]] bool SupportsCompute(VkFormat format) const;
+
+        // Usage and create flags an image of this format needs for Generate().
+        // With VK_IMAGE_CREATE_EXTENDED_USAGE_BIT in flags, views in the image's
+        // own format must limit their usage with VkImageViewUsageCreateInfo.
+        void GetImageRequirements(VkFormat format, VkImageUsageFlags& usage, VkImageCreateFlags& flags) const;
+
+        // Fills levels 1 and up from level 0. Every level must be in
+        // TRANSFER_DST_OPTIMAL with level 0 written by a transfer; all of them end
+        // up in SHADER_READ_ONLY_OPTIMAL. Returns what destroys the objects the
+        // recorded commands use, to be run once cmd has completed.
+        std::function<void()> Generate(VkCommandBuffer cmd, const MipChainDesc& desc);
+
+        [[nodiscard]] MipGeneratorStats GetStats() const;
+
+    private:
+        static constexpr uint32_t SETS_PER_POOL = 64;
+
+        struct PushConstants {
+            int32_t baseWidth;
+            int32_t baseHeight;
+            uint32_t levelCount;
+            uint32_t flags;
+        };
+
+        std::function<void()> GenerateWithCompute(VkCommandBuffer cmd, const MipChainDesc& desc);
+        void GenerateWithBlits(VkCommandBuffer cmd, const MipChainDesc& desc);
+        VkDescriptorSet AllocateSet(VkDescriptorPool& pool);
+        VkImageView CreateView(VkImage image, VkFormat format, uint32_t level, VkImageUsageFlags usage) const;
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+        bool m_extendedUsage = false;
+
+        // Null without the embedded shader
+        VkPipeline m_pipeline = VK_NULL_HANDLE;
+        VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;  // Owned by the layout cache
+        VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;  // Owned by the layout cache
+        VkSampler m_sampler = VK_NULL_HANDLE;
+
+        // Sets are freed one by one as their uploads complete
+        std::vector<VkDescriptorPool> m_pools;
+
+        MipGeneratorStats m_stats;
+        mutable std::mutex m_mutex;
+    };
+}
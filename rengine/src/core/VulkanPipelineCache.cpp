@@ -0,0 +1,150 @@
+﻿#include "VulkanPipelineCache.h"
+#include <RHash.h>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace REngine {
+    VulkanPipelineCache::~VulkanPipelineCache() {
+        Shutdown(false);
+    }
+
+    void VulkanPipelineCache::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path) {
+        m_device = device;
+        m_path = path;
+        vkGetPhysicalDeviceProperties(physicalDevice, &m_deviceProperties);
+
+        const std::vector<uint8_t> data = LoadValidated();
+        m_warm = !data.empty();
+        m_loadedSize = data.size();
+
+        VkPipelineCacheCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        createInfo.initialDataSize = data.size();
+        createInfo.pInitialData = data.empty() ? nullptr : data.data();
+
+        if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) {
+            // The driver may still reject data that passed our checks, retry empty
+            createInfo.initialDataSize = 0;
+            createInfo.pInitialData = nullptr;
+            m_warm = false;
+            m_loadedSize = 0;
+
+            if (vkCreatePipelineCache(m_device, &createInfo, nullptr, &m_cache) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline cache!");
+            }
+        }
+    }
+
+    void VulkanPipelineCache::Shutdown(const bool save) {
+        if (m_cache == VK_NULL_HANDLE) {
+            return;
+        }
+
+        if (save) {
+            Save();
+        }
+
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+        m_cache = VK_NULL_HANDLE;
+        m_device = VK_NULL_HANDLE;
+    }
+
+    bool VulkanPipelineCache::Save() const {
+        if (m_cache == VK_NULL_HANDLE || m_path.empty()) {
+            return false;
+        }
+
+        size_t dataSize = 0;
+        if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) {
+            return false;
+        }
+
+        std::vector<uint8_t> data(dataSize);
+        if (vkGetPipelineCacheData(m_device, m_cache, &dataSize, data.data()) != VK_SUCCESS) {
+            return false;
+        }
+        data.resize(dataSize);
+
+        FileHeader header{};
+        header.magic = FILE_MAGIC;
+        header.version = FILE_VERSION;
+        header.driverVersion = m_deviceProperties.driverVersion;
+        header.dataSize = data.size();
+        header.dataHash = HashBytes(data.data(), data.size());
+
+        const std::string tempPath = m_path + ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            if (!file.is_open()) {
+                std::cerr << "Failed to write pipeline cache: " << tempPath << std::endl;
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+            file.flush();
+            if (!file.good()) {
+                std::cerr << "Failed to write pipeline cache: " << tempPath << std::endl;
+                file.close();
+                std::error_code ignored;
+                std::filesystem::remove(tempPath, ignored);
+                return false;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, m_path, error);
+        if (error) {
+            std::cerr << "Failed to replace pipeline cache " << m_path << ": " << error.message() << std::endl;
+            std::filesystem::remove(tempPath, error);
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<uint8_t> VulkanPipelineCache::LoadValidated() const {
+        std::ifstream file(m_path, std::ios::binary | std::ios::ate);
+        if (!file.is_open()) {
+            return {};
+        }
+
+        const std::streamsize fileSize = file.tellg();
+        file.seekg(0);
+
+        FileHeader header{};
+        if (fileSize < static_cast<std::streamsize>(sizeof(FileHeader)) ||
+            !file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            return {};
+        }
+
+        if (header.magic != FILE_MAGIC || header.version != FILE_VERSION ||
+            header.driverVersion != m_deviceProperties.driverVersion ||
+            header.dataSize != static_cast<uint64_t>(fileSize) - sizeof(FileHeader) ||
+            header.dataSize < sizeof(VkPipelineCacheHeaderVersionOne)) {
+            return {};
+        }
+
+        std::vector<uint8_t> data(static_cast<size_t>(header.dataSize));
+        if (!file.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(data.size())) ||
+            HashBytes(data.data(), data.size()) != header.dataHash) {
+            std::cerr << "Discarding corrupted pipeline cache: " << m_path << std::endl;
+            return {};
+        }
+
+        // The driver's own header identifies the device that produced the blob
+        VkPipelineCacheHeaderVersionOne cacheHeader{};
+        std::memcpy(&cacheHeader, data.data(), sizeof(cacheHeader));
+
+        if (cacheHeader.headerSize < sizeof(VkPipelineCacheHeaderVersionOne) ||
+            cacheHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE ||
+            cacheHeader.vendorID != m_deviceProperties.vendorID ||
+            cacheHeader.deviceID != m_deviceProperties.deviceID ||
+            std::memcmp(cacheHeader.pipelineCacheUUID, m_deviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+            return {};
+        }
+
+        return data;
+    }
+}
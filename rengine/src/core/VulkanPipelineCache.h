@@ -0,0 +1,59 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace REngine {
+    // VkPipelineCache backed by a file on disk. The blob is only handed to the
+    // driver when its header matches the current vendor, device and cache UUID,
+    // so a driver update or a different GPU silently starts from a cold cache.
+    class VulkanPipelineCache {
+    public:
+        VulkanPipelineCache() = default;
+        ~VulkanPipelineCache();
+
+        // Disable copying
+        VulkanPipelineCache(const VulkanPipelineCache&) = delete;
+        VulkanPipelineCache& operator=(const VulkanPipelineCache&) = delete;
+
+        void Initialize(VkDevice device, VkPhysicalDevice physicalDevice, const std::string& path);
+
+        // Writes the cache to disk (unless save is false) and destroys it
+        void Shutdown(bool save = true);
+
+        // Writes to a temporary file and renames it over the old one, so a crash
+        // mid-write never leaves a truncated cache behind
+        bool Save() const;
+
+        [[nodiscard]] VkPipelineCache GetCache() const { return m_cache; }
+        [[nodiscard]] const std::string& GetPath() const { return m_path; }
+
+        // True when valid data from a previous run was loaded
+        [[nodiscard]] bool IsWarm() const { return m_warm; }
+        [[nodiscard]] size_t GetLoadedSize() const { return m_loadedSize; }
+
+    private:
+        // Prepended to the driver blob to catch truncated or corrupted files
+        struct FileHeader {
+            uint32_t magic;
+            uint32_t version;
+            uint32_t driverVersion;
+            uint32_t reserved;
+            uint64_t dataSize;
+            uint64_t dataHash;
+        };
+
+        static constexpr uint32_t FILE_MAGIC = 0x43505252; // "RRPC"
+        static constexpr uint32_t FILE_VERSION = 1;
+
+        std::vector<uint8_t> LoadValidated() const;
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VkPipelineCache m_cache = VK_NULL_HANDLE;
+        VkPhysicalDeviceProperties m_deviceProperties{};
+        std::string m_path;
+        bool m_warm = false;
+        size_t m_loadedSize = 0;
+    };
+}
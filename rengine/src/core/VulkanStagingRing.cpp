@@ -0,0 +1,139 @@
+﻿#include "VulkanStagingRing.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace REngine {
+    VulkanStagingRing::~VulkanStagingRing() {
+        Shutdown();
+    }
+
+    void VulkanStagingRing::Initialize(VulkanAllocator& allocator, const VkDeviceSize size) {
+        m_device = allocator.GetDevice();
+        m_capacity = size;
+        m_alignment = std::max<VkDeviceSize>(
+            allocator.GetDeviceProperties().limits.optimalBufferCopyOffsetAlignment, 16);
+        m_head = 0;
+        m_tail = 0;
+
+        m_buffer.Create(
+            allocator,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            AllocationStrategy::Dedicated
+        );
+    }
+
+    void VulkanStagingRing::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Anything still in flight has to finish before its memory goes away
+        for (const auto& entry : m_inFlight) {
+            vkWaitForFences(m_device, 1, &entry.fence, VK_TRUE, UINT64_MAX);
+        }
+        m_inFlight.clear();
+
+        for (const VkFence fence : m_allFences) {
+            vkDestroyFence(m_device, fence, nullptr);
+        }
+        m_allFences.clear();
+        m_freeFences.clear();
+
+        m_buffer.Destroy();
+        m_device = VK_NULL_HANDLE;
+    }
+
+    StagingRegion VulkanStagingRing::Allocate(const VkDeviceSize size, VkDeviceSize alignment) {
+        if (size > m_capacity) {
+            throw std::runtime_error("Staging allocation larger than the staging ring!");
+        }
+
+        alignment = std::max(alignment, m_alignment);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (;;) {
+            uint64_t start = m_head;
+            VkDeviceSize physical = start % m_capacity;
+            VkDeviceSize aligned = (physical + alignment - 1) / alignment * alignment;
+
+            // Regions never straddle the end of the buffer
+            if (aligned + size > m_capacity) {
+                start += m_capacity - physical;
+                physical = 0;
+                aligned = 0;
+            }
+
+            const uint64_t end = start + (aligned - physical) + size;
+            if (end - m_tail <= m_capacity) {
+                m_head = end;
+
+                StagingRegion region;
+                region.buffer = m_buffer.GetBuffer();
+                region.offset = aligned;
+                region.size = size;
+                region.mapped = static_cast<char*>(m_buffer.GetMappedData()) + aligned;
+                return region;
+            }
+
+            if (m_inFlight.empty()) {
+                throw std::runtime_error("Staging ring exhausted by uncommitted uploads!");
+            }
+            ReclaimLocked(true);
+        }
+    }
+
+    VkFence VulkanStagingRing::Commit() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const VkFence fence = AcquireFence();
+        m_inFlight.push_back({fence, m_head});
+        return fence;
+    }
+
+    void VulkanStagingRing::Reclaim() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ReclaimLocked(false);
+    }
+
+    void VulkanStagingRing::ReclaimLocked(const bool waitForOldest) {
+        if (waitForOldest && !m_inFlight.empty()) {
+            vkWaitForFences(m_device, 1, &m_inFlight.front().fence, VK_TRUE, UINT64_MAX);
+        }
+
+        while (!m_inFlight.empty() && vkGetFenceStatus(m_device, m_inFlight.front().fence) == VK_SUCCESS) {
+            const InFlight& entry = m_inFlight.front();
+            m_tail = entry.end;
+            vkResetFences(m_device, 1, &entry.fence);
+            m_freeFences.push_back(entry.fence);
+            m_inFlight.pop_front();
+        }
+    }
+
+    VkFence VulkanStagingRing::AcquireFence() {
+        if (!m_freeFences.empty()) {
+            const VkFence fence = m_freeFences.back();
+            m_freeFences.pop_back();
+            return fence;
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VkFence fence;
+        if (vkCreateFence(m_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create staging fence!");
+        }
+        m_allFences.push_back(fence);
+        return fence;
+    }
+
+    VkDeviceSize VulkanStagingRing::GetUsedBytes() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_head - m_tail;
+    }
+}
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <VulkanBuffer.h>
+#include <deque>
+#include <mutex>
+#include <vector>
+
+namespace REngine {
+    struct StagingRegion {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr;
+    };
+
+    // Persistently mapped host-visible ring used as the source of every upload.
+    // Regions handed out by Allocate() belong to the next Commit(); they are
+    // recycled once the fence returned by that Commit() has signaled.
+    class VulkanStagingRing {
+    public:
+        static constexpr VkDeviceSize DEFAULT_SIZE = 64ull * 1024 * 1024;
+
+        VulkanStagingRing() = default;
+        ~VulkanStagingRing();
+
+        // Disable copying
+        VulkanStagingRing(const VulkanStagingRing&) = delete;
+        VulkanStagingRing& operator=(const VulkanStagingRing&) = delete;
+
+        void Initialize(VulkanAllocator& allocator, VkDeviceSize size = DEFAULT_SIZE);
+        void Shutdown();
+
+        // Blocks on the oldest in-flight submission when the ring is full.
+        // Throws if size exceeds the ring capacity.
+        StagingRegion Allocate(VkDeviceSize size, VkDeviceSize alignment = 0);
+
+        // Returns an unsignaled fence that guards every region allocated since the
+        // previous Commit(). The caller must submit work that signals it.
+        VkFence Commit();
+
+        // Recycles regions whose fences have signaled
+        void Reclaim();
+
+        [[nodiscard]] VkDeviceSize GetCapacity() const { return m_capacity; }
+        [[nodiscard]] VkDeviceSize GetUsedBytes() const;
+        [[nodiscard]] VkBuffer GetBuffer() const { return m_buffer.GetBuffer(); }
+
+    private:
+        struct InFlight {
+            VkFence fence;
+            uint64_t end;  // Virtual offset one past the last byte guarded by fence
+        };
+
+        void ReclaimLocked(bool waitForOldest);
+        VkFence AcquireFence();
+
+        VkDevice m_device = VK_NULL_HANDLE;
+        VulkanBuffer m_buffer;
+        VkDeviceSize m_capacity = 0;
+        VkDeviceSize m_alignment = 16;
+
+        // Monotonic virtual offsets, physical offset is value % capacity
+        uint64_t m_head = 0;
+        uint64_t m_tail = 0;
+
+        std::deque<InFlight> m_inFlight;
+        std::vector<VkFence> m_freeFences;
+        std::vector<VkFence> m_allFences;
+
+        mutable std::mutex m_mutex;
+    };
+}
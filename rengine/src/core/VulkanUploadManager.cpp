@@ -0,0 +1,323 @@
+﻿#include "VulkanUploadManager.h"
+#include <stdexcept>
+
+namespace REngine {
+    VulkanUploadManager::~VulkanUploadManager() {
+        Shutdown();
+    }
+
+    void VulkanUploadManager::Initialize(
+        VulkanAllocator& allocator,
+        VulkanStagingRing& stagingRing,
+        VkQueue transferQueue,
+        const uint32_t transferQueueFamily,
+        VkQueue graphicsQueue,
+        const uint32_t graphicsQueueFamily
+    ) {
+        m_allocator = &allocator;
+        m_stagingRing = &stagingRing;
+        m_device = allocator.GetDevice();
+        m_transferQueue = transferQueue;
+        m_transferQueueFamily = transferQueueFamily;
+        m_graphicsQueue = graphicsQueue;
+        m_graphicsQueueFamily = graphicsQueueFamily;
+        m_nextBatchId = 1;
+        m_lastSubmitted = 0;
+        m_lastCompleted = 0;
+        m_ownerThread = std::this_thread::get_id();
+        m_flushRequested = false;
+    }
+
+    void VulkanUploadManager::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (auto& batch : m_inFlight) {
+            vkWaitForFences(m_device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+            DestroyBatch(*batch);
+        }
+        m_inFlight.clear();
+
+        if (m_openBatch) {
+            DestroyBatch(*m_openBatch);
+            m_openBatch.reset();
+        }
+
+        for (auto& batch : m_freeBatches) {
+            DestroyBatch(*batch);
+        }
+        m_freeBatches.clear();
+
+        m_device = VK_NULL_HANDLE;
+    }
+
+    std::unique_ptr<VulkanUploadManager::Batch> VulkanUploadManager::CreateBatch() {
+        auto batch = std::make_unique<Batch>();
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        poolInfo.queueFamilyIndex = m_transferQueueFamily;
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &batch->transferPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload command pool!");
+        }
+
+        poolInfo.queueFamilyIndex = m_graphicsQueueFamily;
+        if (vkCreateCommandPool(m_device, &poolInfo, nullptr, &batch->graphicsPool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload command pool!");
+        }
+
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        allocInfo.commandPool = batch->transferPool;
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &batch->transferCmd) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer!");
+        }
+
+        allocInfo.commandPool = batch->graphicsPool;
+        if (vkAllocateCommandBuffers(m_device, &allocInfo, &batch->graphicsCmd) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upload command buffer!");
+        }
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        if (vkCreateSemaphore(m_device, &semaphoreInfo, nullptr, &batch->transferDone) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload semaphore!");
+        }
+
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        if (vkCreateFence(m_device, &fenceInfo, nullptr, &batch->fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upload fence!");
+        }
+
+        return batch;
+    }
+
+    void VulkanUploadManager::DestroyBatch(Batch& batch) {
+        for (auto& buffer : batch.oversizeBuffers) {
+            buffer.Destroy();
+        }
+        batch.oversizeBuffers.clear();
+
+        for (auto& release : batch.releases) {
+            release();
+        }
+        batch.releases.clear();
+
+        vkDestroyFence(m_device, batch.fence, nullptr);
+        vkDestroySemaphore(m_device, batch.transferDone, nullptr);
+        vkDestroyCommandPool(m_device, batch.graphicsPool, nullptr);
+        vkDestroyCommandPool(m_device, batch.transferPool, nullptr);
+    }
+
+    void VulkanUploadManager::OpenBatch() {
+        if (m_freeBatches.empty()) {
+            m_openBatch = CreateBatch();
+        } else {
+            m_openBatch = std::move(m_freeBatches.back());
+            m_freeBatches.pop_back();
+        }
+
+        m_openBatch->id = m_nextBatchId++;
+        m_openBatch->stagingBytes = 0;
+        m_openBatch->uploadCount = 0;
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(m_openBatch->transferCmd, &beginInfo) != VK_SUCCESS ||
+            vkBeginCommandBuffer(m_openBatch->graphicsCmd, &beginInfo) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to begin upload command buffer!");
+        }
+    }
+
+    UploadHandle VulkanUploadManager::Upload(const VkDeviceSize stagingSize, const RecordFunction& record) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        const VkDeviceSize capacity = m_stagingRing->GetCapacity();
+        bool oversize = stagingSize > capacity;
+
+        // Keep the open batch from pinning the whole ring. Other threads must not
+        // touch the queues, the render thread submits at its next Update(); until
+        // then their uploads stay off the ring, which could not reclaim anything
+        if (m_openBatch && !oversize &&
+            m_openBatch->stagingBytes + stagingSize > capacity / FLUSH_THRESHOLD_DIVISOR) {
+            if (std::this_thread::get_id() == m_ownerThread) {
+                FlushLocked();
+            } else {
+                m_flushRequested = true;
+                oversize = true;
+            }
+        }
+
+        if (!m_openBatch) {
+            OpenBatch();
+        }
+
+        StagingRegion staging;
+        if (oversize) {
+            VulkanBuffer buffer;
+            buffer.Create(
+                *m_allocator,
+                stagingSize,
+                VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+            );
+            staging.buffer = buffer.GetBuffer();
+            staging.size = stagingSize;
+            staging.mapped = buffer.GetMappedData();
+            m_openBatch->oversizeBuffers.push_back(buffer);
+        } else if (stagingSize > 0) {
+            staging = m_stagingRing->Allocate(stagingSize);
+            m_openBatch->stagingBytes += stagingSize;
+        }
+
+        record(staging, m_openBatch->transferCmd, m_openBatch->graphicsCmd);
+        m_openBatch->uploadCount++;
+
+        return {m_openBatch->id};
+    }
+
+    UploadHandle VulkanUploadManager::Flush() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return FlushLocked();
+    }
+
+    UploadHandle VulkanUploadManager::FlushLocked() {
+        m_flushRequested = false;
+        if (!m_openBatch) {
+            return {m_lastSubmitted};
+        }
+
+        Batch& batch = *m_openBatch;
+
+        if (vkEndCommandBuffer(batch.transferCmd) != VK_SUCCESS ||
+            vkEndCommandBuffer(batch.graphicsCmd) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to record upload command buffer!");
+        }
+
+        // The staging ring only needs the copies, so it gets the transfer fence
+        VkSubmitInfo transferSubmit{};
+        transferSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        transferSubmit.commandBufferCount = 1;
+        transferSubmit.pCommandBuffers = &batch.transferCmd;
+
+        VkSubmitInfo graphicsSubmit{};
+        graphicsSubmit.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        graphicsSubmit.commandBufferCount = 1;
+        graphicsSubmit.pCommandBuffers = &batch.graphicsCmd;
+
+        const VkPipelineStageFlags waitStage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        if (HasDedicatedTransferQueue()) {
+            transferSubmit.signalSemaphoreCount = 1;
+            transferSubmit.pSignalSemaphores = &batch.transferDone;
+
+            graphicsSubmit.waitSemaphoreCount = 1;
+            graphicsSubmit.pWaitSemaphores = &batch.transferDone;
+            graphicsSubmit.pWaitDstStageMask = &waitStage;
+        }
+
+        if (vkQueueSubmit(m_transferQueue, 1, &transferSubmit, m_stagingRing->Commit()) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload batch!");
+        }
+        if (vkQueueSubmit(m_graphicsQueue, 1, &graphicsSubmit, batch.fence) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to submit upload batch!");
+        }
+
+        m_lastSubmitted = batch.id;
+        m_inFlight.push_back(std::move(m_openBatch));
+
+        return {m_lastSubmitted};
+    }
+
+    void VulkanUploadManager::Update() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_flushRequested && std::this_thread::get_id() == m_ownerThread) {
+            FlushLocked();
+        }
+        UpdateLocked();
+    }
+
+    void VulkanUploadManager::UpdateLocked() {
+        // Batches finish in submission order on the graphics queue
+        while (!m_inFlight.empty() && vkGetFenceStatus(m_device, m_inFlight.front()->fence) == VK_SUCCESS) {
+            std::unique_ptr<Batch> batch = std::move(m_inFlight.front());
+            m_inFlight.pop_front();
+
+            for (auto& buffer : batch->oversizeBuffers) {
+                buffer.Destroy();
+            }
+            batch->oversizeBuffers.clear();
+
+            for (auto& release : batch->releases) {
+                release();
+            }
+            batch->releases.clear();
+
+            vkResetFences(m_device, 1, &batch->fence);
+            vkResetCommandPool(m_device, batch->transferPool, 0);
+            vkResetCommandPool(m_device, batch->graphicsPool, 0);
+
+            m_lastCompleted = batch->id;
+            m_freeBatches.push_back(std::move(batch));
+        }
+    }
+
+    bool VulkanUploadManager::IsComplete(const UploadHandle handle) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (handle.batch <= m_lastCompleted) {
+            return true;
+        }
+        UpdateLocked();
+        return handle.batch <= m_lastCompleted;
+    }
+
+    void VulkanUploadManager::Wait(const UploadHandle handle) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (handle.batch <= m_lastCompleted) {
+            return;
+        }
+        if (m_openBatch && handle.batch >= m_openBatch->id) {
+            FlushLocked();
+        }
+
+        for (const auto& batch : m_inFlight) {
+            if (batch->id >= handle.batch) {
+                vkWaitForFences(m_device, 1, &batch->fence, VK_TRUE, UINT64_MAX);
+                break;
+            }
+        }
+        UpdateLocked();
+    }
+
+    void VulkanUploadManager::ReleaseAfter(const UploadHandle handle, std::function<void()> release) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            if (m_openBatch && handle.batch == m_openBatch->id) {
+                m_openBatch->releases.push_back(std::move(release));
+                return;
+            }
+            for (auto& batch : m_inFlight) {
+                if (batch->id == handle.batch) {
+                    batch->releases.push_back(std::move(release));
+                    return;
+                }
+            }
+        }
+
+        // Already complete
+        release();
+    }
+}
@@ -0,0 +1,129 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <VulkanBuffer.h>
+#include <VulkanStagingRing.h>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace REngine {
+    // Identifies the batch an upload was recorded into. Default-constructed
+    // handles are always complete.
+    struct UploadHandle {
+        uint64_t batch = 0;
+
+        [[nodiscard]] bool IsValid() const { return batch != 0; }
+    };
+
+    // Batches uploads into one submit per flush instead of one blocking submit
+    // per resource. Copies run on a dedicated transfer queue family when the
+    // device has one; work that needs the graphics queue (mip blits, layout
+    // transitions, queue family acquires) goes into a second command buffer
+    // that is submitted right after and waits on the transfer submit.
+    //
+    // Only the thread that calls Initialize() (the render thread, which owns the
+    // queues) ever submits. Upload(), IsComplete(), Update() and ReleaseAfter()
+    // may be called from any thread.
+    class VulkanUploadManager {
+    public:
+        // Flush early once this fraction of the staging ring is pending. Off the
+        // render thread this only requests a flush, done by the next Update(), and
+        // uploads past the threshold until then get temporary buffers, so the
+        // ring never holds more than this fraction uncommitted.
+        static constexpr VkDeviceSize FLUSH_THRESHOLD_DIVISOR = 2;
+
+        // staging is empty when no staging memory was requested. transfer records
+        // on the transfer queue, graphics runs after it on the graphics queue.
+        using RecordFunction = std::function<void(const StagingRegion& staging, VkCommandBuffer transfer, VkCommandBuffer graphics)>;
+
+        VulkanUploadManager() = default;
+        ~VulkanUploadManager();
+
+        // Disable copying
+        VulkanUploadManager(const VulkanUploadManager&) = delete;
+        VulkanUploadManager& operator=(const VulkanUploadManager&) = delete;
+
+        void Initialize(
+            VulkanAllocator& allocator,
+            VulkanStagingRing& stagingRing,
+            VkQueue transferQueue,
+            uint32_t transferQueueFamily,
+            VkQueue graphicsQueue,
+            uint32_t graphicsQueueFamily
+        );
+
+        void Shutdown();
+
+        // Reserves stagingSize bytes of staging memory and records into the open
+        // batch. Uploads larger than the staging ring, or past the flush threshold
+        // off the render thread, get a temporary buffer that is released with the batch.
+        UploadHandle Upload(VkDeviceSize stagingSize, const RecordFunction& record);
+
+        // Submits the open batch. Render thread only.
+        UploadHandle Flush();
+
+        // Retires finished batches, and on the render thread submits the open
+        // batch if another thread asked for an early flush
+        void Update();
+
+        [[nodiscard]] bool IsComplete(UploadHandle handle);
+
+        // Submits the open batch first if it holds the handle. Render thread only.
+        void Wait(UploadHandle handle);
+
+        // Runs release once the handle's batch has completed, or right away if it
+        // already has. For objects only the recorded commands use.
+        void ReleaseAfter(UploadHandle handle, std::function<void()> release);
+
+        [[nodiscard]] bool HasDedicatedTransferQueue() const { return m_transferQueueFamily != m_graphicsQueueFamily; }
+        [[nodiscard]] uint32_t GetTransferQueueFamily() const { return m_transferQueueFamily; }
+        [[nodiscard]] uint32_t GetGraphicsQueueFamily() const { return m_graphicsQueueFamily; }
+        [[nodiscard]] uint64_t GetSubmittedBatchCount() const { return m_lastSubmitted; }
+
+    private:
+        struct Batch {
+            uint64_t id = 0;
+            VkCommandPool transferPool = VK_NULL_HANDLE;
+            VkCommandPool graphicsPool = VK_NULL_HANDLE;
+            VkCommandBuffer transferCmd = VK_NULL_HANDLE;
+            VkCommandBuffer graphicsCmd = VK_NULL_HANDLE;
+            VkSemaphore transferDone = VK_NULL_HANDLE;
+            VkFence fence = VK_NULL_HANDLE;
+            VkDeviceSize stagingBytes = 0;
+            uint32_t uploadCount = 0;
+            std::vector<VulkanBuffer> oversizeBuffers;
+            std::vector<std::function<void()>> releases;
+        };
+
+        std::unique_ptr<Batch> CreateBatch();
+        void DestroyBatch(Batch& batch);
+        void OpenBatch();
+        UploadHandle FlushLocked();
+        void UpdateLocked();
+
+        VulkanAllocator* m_allocator = nullptr;
+        VulkanStagingRing* m_stagingRing = nullptr;
+        VkDevice m_device = VK_NULL_HANDLE;
+
+        VkQueue m_transferQueue = VK_NULL_HANDLE;
+        VkQueue m_graphicsQueue = VK_NULL_HANDLE;
+        uint32_t m_transferQueueFamily = 0;
+        uint32_t m_graphicsQueueFamily = 0;
+
+        std::unique_ptr<Batch> m_openBatch;
+        std::deque<std::unique_ptr<Batch>> m_inFlight;
+        std::vector<std::unique_ptr<Batch>> m_freeBatches;
+
+        uint64_t m_nextBatchId = 1;
+        uint64_t m_lastSubmitted = 0;
+        uint64_t m_lastCompleted = 0;
+
+        std::thread::id m_ownerThread;  // Submits, see Initialize()
+        bool m_flushRequested = false;
+
+        std::mutex m_mutex;
+    };
+}
@@ -1,6 +1,7 @@
 ﻿#include "RWindows.h"
 #include <stdexcept>
 #include <SDL_syswm.h>
+#include <RProfiler.h>
 
 namespace REngine {
     RWindows::RWindows(const std::string& title, int width, int height) {
@@ -39,6 +40,8 @@ namespace REngine {
     }
 
     void RWindows::Run() {
+        RPROFILE_SCOPE("RWindows::Run");
+
         SDL_Event event;
         while (SDL_PollEvent(&event)) {
             m_Event = event;
@@ -0,0 +1,1210 @@
+﻿#include "RenderGraph.h"
+#include "VulkanRenderer.h"
+#include <RProfiler.h>
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+
+namespace REngine {
+    namespace {
+        VkImageUsageFlags GetImageUsage(const RenderGraphAccess access) {
+            switch (access) {
+                case RenderGraphAccess::SampledRead:
+                    return VK_IMAGE_USAGE_SAMPLED_BIT;
+                case RenderGraphAccess::StorageRead:
+                case RenderGraphAccess::StorageWrite:
+                    return VK_IMAGE_USAGE_STORAGE_BIT;
+                case RenderGraphAccess::TransferSrc:
+                    return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+                case RenderGraphAccess::TransferDst:
+                    return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+                case RenderGraphAccess::ColorAttachment:
+                    return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+                case RenderGraphAccess::DepthAttachment:
+                case RenderGraphAccess::DepthRead:
+                    return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+                default:
+                    return 0;  // Buffer only
+            }
+        }
+
+        VkBufferUsageFlags GetBufferUsage(const RenderGraphAccess access) {
+            switch (access) {
+                case RenderGraphAccess::StorageRead:
+                case RenderGraphAccess::StorageWrite:
+                    return VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+                case RenderGraphAccess::UniformRead:
+                    return VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+                case RenderGraphAccess::VertexRead:
+                    return VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+                case RenderGraphAccess::IndexRead:
+                    return VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+                case RenderGraphAccess::IndirectRead:
+                    return VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+                case RenderGraphAccess::TransferSrc:
+                    return VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+                case RenderGraphAccess::TransferDst:
+                    return VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+                default:
+                    return 0;  // Image only
+            }
+        }
+
+        bool IsAttachmentAccess(const RenderGraphAccess access) {
+            return access == RenderGraphAccess::ColorAttachment ||
+                   access == RenderGraphAccess::DepthAttachment ||
+                   access == RenderGraphAccess::DepthRead;
+        }
+
+        VkDeviceSize AlignUp(const VkDeviceSize value, const VkDeviceSize alignment) {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+
+        bool RangesOverlap(const VkDeviceSize offsetA, const VkDeviceSize sizeA, const VkDeviceSize offsetB, const VkDeviceSize sizeB) {
+            return offsetA < offsetB + sizeB && offsetB < offsetA + sizeA;
+        }
+    }
+
+    void RenderGraphBuilder::ColorAttachment(const RenderGraphTexture texture, const VkClearColorValue* clear) {
+        m_graph.AddUse(m_pass, texture.id, true, RenderGraphAccess::ColorAttachment, 0);
+
+        RenderGraph::Attachment attachment{};
+        attachment.texture = texture.id;
+        attachment.clear = clear != nullptr;
+        if (clear) {
+            attachment.clearValue.color = *clear;
+        }
+        m_graph.m_passes[m_pass].attachments.push_back(attachment);
+    }
+
+    void RenderGraphBuilder::DepthAttachment(const RenderGraphTexture texture, const VkClearDepthStencilValue* clear, const bool readOnly) {
+        RenderGraph::Pass& pass = m_graph.m_passes[m_pass];
+        if (readOnly && clear) {
+            throw std::runtime_error("Read-only depth attachment of pass '" + pass.name + "' cannot be cleared!");
+        }
+        for (const auto& attachment : pass.attachments) {
+            if (attachment.depth) {
+                throw std::runtime_error("Pass '" + pass.name + "' has more than one depth attachment!");
+            }
+        }
+
+        m_graph.AddUse(m_pass, texture.id, true, readOnly ? RenderGraphAccess::DepthRead : RenderGraphAccess::DepthAttachment, 0);
+
+        RenderGraph::Attachment attachment{};
+        attachment.texture = texture.id;
+        attachment.depth = true;
+        attachment.readOnly = readOnly;
+        attachment.clear = clear != nullptr;
+        if (clear) {
+            attachment.clearValue.depthStencil = *clear;
+        }
+        m_graph.m_passes[m_pass].attachments.push_back(attachment);
+    }
+
+    void RenderGraphBuilder::Read(const RenderGraphTexture texture, const RenderGraphAccess access, const VkPipelineStageFlags stages) {
+        if (IsAttachmentAccess(access) || RenderGraph::GetAccessInfo(access).write) {
+            throw std::runtime_error("Invalid read access in pass '" + m_graph.m_passes[m_pass].name + "'!");
+        }
+        m_graph.AddUse(m_pass, texture.id, true, access, stages);
+    }
+
+    void RenderGraphBuilder::Write(const RenderGraphTexture texture, const RenderGraphAccess access, const VkPipelineStageFlags stages) {
+        if (IsAttachmentAccess(access) || !RenderGraph::GetAccessInfo(access).write) {
+            throw std::runtime_error("Invalid write access in pass '" + m_graph.m_passes[m_pass].name + "'!");
+        }
+        m_graph.AddUse(m_pass, texture.id, true, access, stages);
+    }
+
+    void RenderGraphBuilder::Read(const RenderGraphBuffer buffer, const RenderGraphAccess access, const VkPipelineStageFlags stages) {
+        if (RenderGraph::GetAccessInfo(access).write) {
+            throw std::runtime_error("Invalid read access in pass '" + m_graph.m_passes[m_pass].name + "'!");
+        }
+        m_graph.AddUse(m_pass, buffer.id, false, access, stages);
+    }
+
+    void RenderGraphBuilder::Write(const RenderGraphBuffer buffer, const RenderGraphAccess access, const VkPipelineStageFlags stages) {
+        if (!RenderGraph::GetAccessInfo(access).write) {
+            throw std::runtime_error("Invalid write access in pass '" + m_graph.m_passes[m_pass].name + "'!");
+        }
+        m_graph.AddUse(m_pass, buffer.id, false, access, stages);
+    }
+
+    void RenderGraphBuilder::NeverCull() {
+        m_graph.m_passes[m_pass].neverCull = true;
+    }
+
+    VkImage RenderGraphContext::GetImage(const RenderGraphTexture texture) const {
+        return m_graph.m_textures.at(texture.id).image;
+    }
+
+    VkImageView RenderGraphContext::GetView(const RenderGraphTexture texture) const {
+        return m_graph.m_textures.at(texture.id).view;
+    }
+
+    VkBuffer RenderGraphContext::GetBuffer(const RenderGraphBuffer buffer) const {
+        return m_graph.m_buffers.at(buffer.id).buffer;
+    }
+
+    bool RenderGraph::TransientKey::operator==(const TransientKey& other) const {
+        return texture == other.texture &&
+               extent.width == other.extent.width &&
+               extent.height == other.extent.height &&
+               format == other.format &&
+               usage == other.usage &&
+               size == other.size &&
+               firstPass == other.firstPass &&
+               lastPass == other.lastPass;
+    }
+
+    bool RenderGraph::FramebufferKey::operator<(const FramebufferKey& other) const {
+        return std::tie(swapchainGeneration, renderPass, width, height, views) <
+               std::tie(other.swapchainGeneration, other.renderPass, other.width, other.height, other.views);
+    }
+
+    RenderGraph::RenderGraph(VulkanRenderer& renderer)
+        : m_renderer(renderer)
+        , m_device(renderer.GetDevice())
+        , m_allocator(renderer.GetAllocator()) {
+        m_transients.resize(VulkanRenderer::MAX_FRAMES_IN_FLIGHT);
+    }
+
+    RenderGraph::~RenderGraph() {
+        // Frames in flight may still use any of it
+        for (auto& transients : m_transients) {
+            DestroyTransients(transients);
+            for (auto& heap : transients.heaps) {
+                if (heap.allocation.IsValid()) {
+                    m_renderer.Retire([allocator = &m_allocator, allocation = heap.allocation]() mutable {
+                        allocator->Free(allocation);
+                    });
+                }
+            }
+        }
+        for (auto& [key, cached] : m_framebuffers) {
+            m_renderer.Retire([device = m_device, framebuffer = cached.framebuffer]() {
+                vkDestroyFramebuffer(device, framebuffer, nullptr);
+            });
+        }
+    }
+
+    RenderGraph::AccessInfo RenderGraph::GetAccessInfo(const RenderGraphAccess access) {
+        // Shader accesses leave the stages to the pass
+        switch (access) {
+            case RenderGraphAccess::SampledRead:
+                return {0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, false};
+            case RenderGraphAccess::StorageRead:
+                return {0, VK_ACCESS_SHADER_READ_BIT, VK_IMAGE_LAYOUT_GENERAL, false};
+            case RenderGraphAccess::StorageWrite:
+                return {0, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, true};
+            case RenderGraphAccess::UniformRead:
+                return {0, VK_ACCESS_UNIFORM_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case RenderGraphAccess::VertexRead:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case RenderGraphAccess::IndexRead:
+                return {VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_INDEX_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case RenderGraphAccess::IndirectRead:
+                return {VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED, false};
+            case RenderGraphAccess::TransferSrc:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, false};
+            case RenderGraphAccess::TransferDst:
+                return {VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, true};
+            case RenderGraphAccess::ColorAttachment:
+                return {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                        VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, true};
+            case RenderGraphAccess::DepthAttachment:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, true};
+            case RenderGraphAccess::DepthRead:
+                return {VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                        VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                        VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, false};
+            default:
+                throw std::runtime_error("Unknown render graph access!");
+        }
+    }
+
+    VkImageAspectFlags RenderGraph::GetAspect(const VkFormat format) {
+        switch (format) {
+            case VK_FORMAT_D16_UNORM:
+            case VK_FORMAT_X8_D24_UNORM_PACK32:
+            case VK_FORMAT_D32_SFLOAT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT;
+            case VK_FORMAT_D16_UNORM_S8_UINT:
+            case VK_FORMAT_D24_UNORM_S8_UINT:
+            case VK_FORMAT_D32_SFLOAT_S8_UINT:
+                return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+            case VK_FORMAT_S8_UINT:
+                return VK_IMAGE_ASPECT_STENCIL_BIT;
+            default:
+                return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+
+    RenderGraphTexture RenderGraph::CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc) {
+        const VkExtent2D extent = m_renderer.GetExtent();
+
+        TextureResource texture;
+        texture.name = name;
+        texture.desc = desc;
+        texture.extent = {desc.width ? desc.width : extent.width, desc.height ? desc.height : extent.height};
+        texture.usage = desc.usage;
+        m_textures.push_back(std::move(texture));
+        return {static_cast<uint32_t>(m_textures.size() - 1)};
+    }
+
+    RenderGraphBuffer RenderGraph::CreateBuffer(const std::string& name, const RenderGraphBufferDesc& desc) {
+        if (desc.size == 0) {
+            throw std::runtime_error("Render graph buffer '" + name + "' has no size!");
+        }
+
+        BufferResource buffer;
+        buffer.name = name;
+        buffer.desc = desc;
+        buffer.usage = desc.usage;
+        m_buffers.push_back(std::move(buffer));
+        return {static_cast<uint32_t>(m_buffers.size() - 1)};
+    }
+
+    RenderGraphTexture RenderGraph::ImportTexture(
+        const std::string& name,
+        VkImage image,
+        VkImageView view,
+        const VkFormat format,
+        const VkExtent2D extent,
+        const VkImageLayout currentLayout,
+        const VkImageLayout finalLayout
+    ) {
+        TextureResource texture;
+        texture.name = name;
+        texture.desc.width = extent.width;
+        texture.desc.height = extent.height;
+        texture.desc.format = format;
+        texture.extent = extent;
+        texture.imported = true;
+        texture.image = image;
+        texture.view = view;
+        texture.finalLayout = finalLayout;
+
+        // Whatever happened to it before is unknown, the first use waits for all of it
+        texture.state.layout = currentLayout;
+        texture.state.writeStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        texture.state.writeAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+
+        m_textures.push_back(std::move(texture));
+        return {static_cast<uint32_t>(m_textures.size() - 1)};
+    }
+
+    RenderGraphBuffer RenderGraph::ImportBuffer(const std::string& name, VkBuffer buffer, const VkDeviceSize size) {
+        BufferResource resource;
+        resource.name = name;
+        resource.desc.size = size;
+        resource.imported = true;
+        resource.buffer = buffer;
+        resource.state.writeStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+        resource.state.writeAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+
+        m_buffers.push_back(std::move(resource));
+        return {static_cast<uint32_t>(m_buffers.size() - 1)};
+    }
+
+    RenderGraphTexture RenderGraph::ImportBackbuffer() {
+        // Left as the frame's render pass expects to continue it
+        const VkImageLayout layout = m_renderer.GetBackbufferLayout();
+        return ImportTexture("Backbuffer", m_renderer.GetBackbufferImage(), m_renderer.GetBackbufferView(),
+                             m_renderer.GetBackbufferFormat(), m_renderer.GetExtent(), layout, layout);
+    }
+
+    void RenderGraph::AddPass(
+        const std::string& name,
+        const std::function<void(RenderGraphBuilder&)>& setup,
+        std::function<void(RenderGraphContext&)> execute
+    ) {
+        const auto index = static_cast<uint32_t>(m_passes.size());
+        m_passes.emplace_back();
+        m_passes.back().name = name;
+        m_passes.back().execute = std::move(execute);
+
+        RenderGraphBuilder builder(*this, index);
+        setup(builder);
+
+        Pass& pass = m_passes[index];
+        const VkPipelineStageFlags shaderStages = pass.attachments.empty()
+            ? VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            : VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        for (auto& use : pass.uses) {
+            if (use.info.stages == 0) {
+                use.info.stages = shaderStages;
+            }
+        }
+
+        for (const auto& attachment : pass.attachments) {
+            const VkExtent2D extent = m_textures[attachment.texture].extent;
+            const VkExtent2D first = m_textures[pass.attachments[0].texture].extent;
+            if (extent.width != first.width || extent.height != first.height) {
+                throw std::runtime_error("Attachments of pass '" + name + "' differ in size!");
+            }
+        }
+    }
+
+    void RenderGraph::AddUse(
+        const uint32_t pass,
+        const uint32_t resource,
+        const bool texture,
+        const RenderGraphAccess access,
+        const VkPipelineStageFlags stages
+    ) {
+        Pass& target = m_passes[pass];
+        if (resource >= (texture ? m_textures.size() : m_buffers.size())) {
+            throw std::runtime_error("Invalid render graph resource in pass '" + target.name + "'!");
+        }
+
+        AccessInfo info = GetAccessInfo(access);
+        if (stages != 0) {
+            info.stages = stages;
+        }
+
+        const uint32_t usage = texture ? GetImageUsage(access) : GetBufferUsage(access);
+        if (usage == 0) {
+            throw std::runtime_error("Access does not apply to a " + std::string(texture ? "texture" : "buffer") +
+                                     " in pass '" + target.name + "'!");
+        }
+
+        // One barrier per resource and pass, so repeated uses merge
+        for (auto& use : target.uses) {
+            if (use.texture != texture || use.resource != resource) {
+                continue;
+            }
+            if (texture && use.info.layout != info.layout) {
+                throw std::runtime_error("Pass '" + target.name + "' uses texture '" +
+                                         m_textures[resource].name + "' in two layouts!");
+            }
+            use.info.stages |= info.stages;
+            use.info.access |= info.access;
+            use.info.write = use.info.write || info.write;
+            use.usage |= usage;
+            return;
+        }
+
+        target.uses.push_back({resource, texture, info, usage});
+    }
+
+    void RenderGraph::Execute(VkCommandBuffer cmd) {
+        RPROFILE_SCOPE("RenderGraph::Execute");
+
+        m_stats = {};
+        m_stats.passCount = static_cast<uint32_t>(m_passes.size());
+
+        // The swapchain was recreated, framebuffers of the old backbuffer views
+        // must go before a new view can reuse a handle
+        const uint64_t swapchainGeneration = m_renderer.GetSwapchainGeneration();
+        if (swapchainGeneration != m_swapchainGeneration) {
+            for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+                if (it->first.swapchainGeneration != swapchainGeneration) {
+                    m_renderer.Retire([device = m_device, framebuffer = it->second.framebuffer]() {
+                        vkDestroyFramebuffer(device, framebuffer, nullptr);
+                    });
+                    it = m_framebuffers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            m_swapchainGeneration = swapchainGeneration;
+        }
+
+        Cull();
+        ComputeLifetimes();
+        AllocateTransients();
+
+        for (uint32_t i = 0; i < m_passes.size(); i++) {
+            if (!m_passes[i].culled) {
+                RecordPass(cmd, i);
+            }
+        }
+        FinishImports(cmd);
+
+        // Framebuffers nothing used for a while may point at destroyed views
+        for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+            if (it->second.lastUsed + FRAMEBUFFER_IDLE_EXECUTES < m_executeCount) {
+                m_renderer.Retire([device = m_device, framebuffer = it->second.framebuffer]() {
+                    vkDestroyFramebuffer(device, framebuffer, nullptr);
+                });
+                it = m_framebuffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        m_executeCount++;
+
+        m_passes.clear();
+        m_textures.clear();
+        m_buffers.clear();
+        m_transientResources.clear();
+    }
+
+    void RenderGraph::Cull() {
+        // Walk back from the imported resources and the passes that must run,
+        // keeping every pass that produces something a kept pass consumes
+        std::vector<bool> neededTextures(m_textures.size(), false);
+        std::vector<bool> neededBuffers(m_buffers.size(), false);
+
+        for (size_t i = m_passes.size(); i-- > 0;) {
+            Pass& pass = m_passes[i];
+
+            bool keep = pass.neverCull;
+            for (const auto& use : pass.uses) {
+                if (!use.info.write) {
+                    continue;
+                }
+                if (use.texture) {
+                    keep = keep || m_textures[use.resource].imported || neededTextures[use.resource];
+                } else {
+                    keep = keep || m_buffers[use.resource].imported || neededBuffers[use.resource];
+                }
+            }
+            if (!keep) {
+                pass.culled = true;
+                m_stats.culledPassCount++;
+                continue;
+            }
+
+            // A cleared attachment does not depend on earlier writers. Reads,
+            // loads and storage writes (which may be partial) do.
+            for (const auto& use : pass.uses) {
+                if (!use.texture) {
+                    neededBuffers[use.resource] = true;
+                    continue;
+                }
+                const bool cleared = std::any_of(pass.attachments.begin(), pass.attachments.end(),
+                    [&](const Attachment& attachment) { return attachment.texture == use.resource && attachment.clear; });
+                neededTextures[use.resource] = !cleared;
+            }
+        }
+    }
+
+    void RenderGraph::ComputeLifetimes() {
+        for (uint32_t i = 0; i < m_passes.size(); i++) {
+            if (m_passes[i].culled) {
+                continue;
+            }
+            for (const auto& use : m_passes[i].uses) {
+                if (use.texture) {
+                    TextureResource& texture = m_textures[use.resource];
+                    texture.firstPass = std::min(texture.firstPass, i);
+                    texture.lastPass = i;
+                    texture.usage |= use.usage;
+                } else {
+                    BufferResource& buffer = m_buffers[use.resource];
+                    buffer.firstPass = std::min(buffer.firstPass, i);
+                    buffer.lastPass = i;
+                    buffer.usage |= use.usage;
+                }
+            }
+        }
+    }
+
+    void RenderGraph::AllocateTransients() {
+        FrameTransients& transients = m_transients[m_renderer.GetCurrentFrameSlot()];
+
+        std::vector<TransientKey> keys;
+        for (uint32_t i = 0; i < m_textures.size(); i++) {
+            TextureResource& texture = m_textures[i];
+            if (texture.imported || texture.firstPass == UINT32_MAX) {
+                continue;
+            }
+            texture.transient = static_cast<uint32_t>(keys.size());
+            keys.push_back({true, texture.extent, texture.desc.format, texture.usage, 0, texture.firstPass, texture.lastPass});
+            m_transientResources.emplace_back(true, i);
+        }
+        for (uint32_t i = 0; i < m_buffers.size(); i++) {
+            BufferResource& buffer = m_buffers[i];
+            if (buffer.imported || buffer.firstPass == UINT32_MAX) {
+                continue;
+            }
+            buffer.transient = static_cast<uint32_t>(keys.size());
+            keys.push_back({false, {0, 0}, VK_FORMAT_UNDEFINED, buffer.usage, buffer.desc.size, buffer.firstPass, buffer.lastPass});
+            m_transientResources.emplace_back(false, i);
+        }
+
+        // The same graph as last time this slot ran keeps its objects and placement
+        if (keys != transients.keys) {
+            DestroyTransients(transients);
+            transients.keys = std::move(keys);
+            CreateTransients(transients);
+        }
+
+        // A second Execute() in one frame reuses memory the first one's passes may still access
+        const uint64_t frame = m_renderer.GetFrameNumber();
+        const bool reused = transients.lastFrame == frame;
+        transients.lastFrame = frame;
+
+        for (size_t i = 0; i < m_transientResources.size(); i++) {
+            const auto [texture, index] = m_transientResources[i];
+            const TransientObject& object = transients.objects[i];
+            if (texture) {
+                m_textures[index].image = object.image;
+                m_textures[index].view = object.view;
+            } else {
+                m_buffers[index].buffer = object.buffer;
+            }
+
+            if (reused) {
+                ResourceState& state = GetState(texture, index);
+                state.writeStages = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+                state.writeAccess = VK_ACCESS_MEMORY_WRITE_BIT;
+            }
+            m_stats.unaliasedBytes += object.requirements.size;
+        }
+        for (const auto& heap : transients.heaps) {
+            m_stats.transientBytes += heap.used;
+        }
+    }
+
+    void RenderGraph::CreateTransients(FrameTransients& transients) {
+        transients.objects.assign(transients.keys.size(), {});
+
+        for (size_t i = 0; i < transients.keys.size(); i++) {
+            const TransientKey& key = transients.keys[i];
+            TransientObject& object = transients.objects[i];
+
+            if (key.texture) {
+                VkImageCreateInfo imageInfo{};
+                imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+                imageInfo.imageType = VK_IMAGE_TYPE_2D;
+                imageInfo.extent = {key.extent.width, key.extent.height, 1};
+                imageInfo.mipLevels = 1;
+                imageInfo.arrayLayers = 1;
+                imageInfo.format = key.format;
+                imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+                imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+                imageInfo.usage = key.usage;
+                imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+                imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                if (vkCreateImage(m_device, &imageInfo, nullptr, &object.image) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to create render graph image!");
+                }
+                vkGetImageMemoryRequirements(m_device, object.image, &object.requirements);
+            } else {
+                VkBufferCreateInfo bufferInfo{};
+                bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+                bufferInfo.size = key.size;
+                bufferInfo.usage = key.usage;
+                bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+                if (vkCreateBuffer(m_device, &bufferInfo, nullptr, &object.buffer) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to create render graph buffer!");
+                }
+                vkGetBufferMemoryRequirements(m_device, object.buffer, &object.requirements);
+            }
+        }
+
+        // Group objects by a memory type they can all use. Drivers may report
+        // different types for e.g. depth and color images, those get heaps of their own.
+        std::vector<TransientHeap> groups;
+        for (size_t i = 0; i < transients.keys.size(); i++) {
+            const AllocationKind kind = transients.keys[i].texture ? AllocationKind::Optimal : AllocationKind::Linear;
+            TransientObject& object = transients.objects[i];
+
+            object.heap = static_cast<uint32_t>(groups.size());
+            for (uint32_t g = 0; g < groups.size(); g++) {
+                if (groups[g].kind == kind && (groups[g].memoryTypeBits & object.requirements.memoryTypeBits)) {
+                    object.heap = g;
+                    break;
+                }
+            }
+            if (object.heap == groups.size()) {
+                groups.push_back({kind});
+            }
+            groups[object.heap].memoryTypeBits &= object.requirements.memoryTypeBits;
+        }
+
+        // Heaps past the groups of this graph are no longer needed
+        for (size_t g = groups.size(); g < transients.heaps.size(); g++) {
+            if (transients.heaps[g].allocation.IsValid()) {
+                m_renderer.Retire([allocator = &m_allocator, old = transients.heaps[g].allocation]() mutable {
+                    allocator->Free(old);
+                });
+            }
+        }
+        transients.heaps.resize(groups.size());
+
+        for (uint32_t g = 0; g < groups.size(); g++) {
+            TransientHeap& heap = transients.heaps[g];
+            const bool textures = groups[g].kind == AllocationKind::Optimal;
+            const VkDeviceSize heapSize = PackTransients(transients, g);
+
+            VkMemoryRequirements requirements{};
+            requirements.size = heapSize;
+            requirements.alignment = 1;
+            requirements.memoryTypeBits = groups[g].memoryTypeBits;
+            for (size_t i = 0; i < transients.keys.size(); i++) {
+                if (transients.objects[i].heap == g) {
+                    requirements.alignment = std::max(requirements.alignment, transients.objects[i].requirements.alignment);
+                }
+            }
+
+            // Grown with some headroom so a slowly growing graph does not reallocate every frame
+            VulkanAllocation& allocation = heap.allocation;
+            if (!allocation.IsValid() || heap.kind != groups[g].kind || allocation.size < heapSize ||
+                !(requirements.memoryTypeBits & (1u << allocation.memoryType))) {
+                if (allocation.IsValid()) {
+                    m_renderer.Retire([allocator = &m_allocator, old = allocation]() mutable { allocator->Free(old); });
+                }
+                requirements.size = heapSize + heapSize / 4;
+                allocation = m_allocator.Allocate(requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, groups[g].kind,
+                                                  AllocationStrategy::Dedicated);
+            }
+            heap.kind = groups[g].kind;
+            heap.memoryTypeBits = groups[g].memoryTypeBits;
+            heap.used = heapSize;
+
+            for (size_t i = 0; i < transients.keys.size(); i++) {
+                const TransientObject& object = transients.objects[i];
+                if (object.heap != g) {
+                    continue;
+                }
+                const VkResult result = textures
+                    ? vkBindImageMemory(m_device, object.image, allocation.memory, allocation.offset + object.offset)
+                    : vkBindBufferMemory(m_device, object.buffer, allocation.memory, allocation.offset + object.offset);
+                if (result != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to bind render graph memory!");
+                }
+            }
+        }
+
+        for (size_t i = 0; i < transients.keys.size(); i++) {
+            const TransientKey& key = transients.keys[i];
+            if (!key.texture) {
+                continue;
+            }
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = transients.objects[i].image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = key.format;
+            viewInfo.subresourceRange.aspectMask = GetAspect(key.format);
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(m_device, &viewInfo, nullptr, &transients.objects[i].view) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create render graph image view!");
+            }
+        }
+    }
+
+    VkDeviceSize RenderGraph::PackTransients(FrameTransients& transients, const uint32_t heap) const {
+        std::vector<uint32_t> order;
+        for (uint32_t i = 0; i < transients.keys.size(); i++) {
+            if (transients.objects[i].heap == heap) {
+                order.push_back(i);
+            }
+        }
+
+        // Largest first, each at the lowest offset that no object alive at the same time covers
+        std::stable_sort(order.begin(), order.end(), [&](const uint32_t a, const uint32_t b) {
+            return transients.objects[a].requirements.size > transients.objects[b].requirements.size;
+        });
+
+        const auto livesOverlap = [&](const uint32_t a, const uint32_t b) {
+            return transients.keys[a].firstPass <= transients.keys[b].lastPass &&
+                   transients.keys[b].firstPass <= transients.keys[a].lastPass;
+        };
+
+        VkDeviceSize heapSize = 0;
+        std::vector<uint32_t> placed;
+        for (const uint32_t i : order) {
+            TransientObject& object = transients.objects[i];
+
+            std::vector<uint32_t> neighbours;
+            for (const uint32_t other : placed) {
+                if (livesOverlap(i, other)) {
+                    neighbours.push_back(other);
+                }
+            }
+            std::sort(neighbours.begin(), neighbours.end(), [&](const uint32_t a, const uint32_t b) {
+                return transients.objects[a].offset < transients.objects[b].offset;
+            });
+
+            VkDeviceSize offset = 0;
+            for (const uint32_t other : neighbours) {
+                const TransientObject& neighbour = transients.objects[other];
+                if (offset + object.requirements.size <= neighbour.offset) {
+                    break;
+                }
+                offset = std::max(offset, AlignUp(neighbour.offset + neighbour.requirements.size, object.requirements.alignment));
+            }
+
+            object.offset = offset;
+            placed.push_back(i);
+            heapSize = std::max(heapSize, offset + object.requirements.size);
+        }
+
+        // Objects that take over memory from an earlier one wait for it at their first use
+        for (const uint32_t i : order) {
+            TransientObject& object = transients.objects[i];
+            object.aliasedAfter.clear();
+            for (const uint32_t other : order) {
+                const TransientObject& previous = transients.objects[other];
+                if (transients.keys[other].lastPass < transients.keys[i].firstPass &&
+                    RangesOverlap(object.offset, object.requirements.size, previous.offset, previous.requirements.size)) {
+                    object.aliasedAfter.push_back(other);
+                }
+            }
+        }
+        return heapSize;
+    }
+
+    RenderGraph::ResourceState& RenderGraph::GetState(const bool texture, const uint32_t resource) {
+        return texture ? m_textures[resource].state : m_buffers[resource].state;
+    }
+
+    void RenderGraph::RecordPass(VkCommandBuffer cmd, const uint32_t passIndex) {
+        Pass& pass = m_passes[passIndex];
+        GpuScope scope(m_renderer.GetGpuProfiler(), cmd, pass.name);
+
+        // Every dependency of the pass goes into a single barrier call
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        bool memoryDependency = false;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+
+        const FrameTransients& transients = m_transients[m_renderer.GetCurrentFrameSlot()];
+
+        for (const auto& use : pass.uses) {
+            const AccessInfo& info = use.info;
+            ResourceState& state = GetState(use.texture, use.resource);
+
+            VkPipelineStageFlags src = 0;
+            VkAccessFlags srcAccess = 0;
+            bool barrier = false;
+
+            // The first use of aliased memory waits for the resources that used it before
+            const uint32_t transient = use.texture ? m_textures[use.resource].transient : m_buffers[use.resource].transient;
+            const uint32_t firstPass = use.texture ? m_textures[use.resource].firstPass : m_buffers[use.resource].firstPass;
+            if (transient != UINT32_MAX && firstPass == passIndex) {
+                for (const uint32_t previous : transients.objects[transient].aliasedAfter) {
+                    const auto [texture, index] = m_transientResources[previous];
+                    const ResourceState& previousState = GetState(texture, index);
+                    src |= previousState.writeStages | previousState.readStages;
+                    srcAccess |= previousState.writeAccess;
+                    barrier = true;
+                }
+            }
+
+            const VkImageLayout oldLayout = state.layout;
+            const bool layoutChange = use.texture && info.layout != state.layout;
+
+            if (info.write || layoutChange) {
+                // Waits for earlier writes and, against write-after-read hazards, reads
+                src |= state.writeStages | state.readStages;
+                srcAccess |= state.writeAccess;
+                barrier = barrier || layoutChange || src != 0;
+
+                if (info.write) {
+                    state.writeStages = info.stages;
+                    state.writeAccess = info.access;
+                    state.readStages = 0;
+                    state.visibleStages = 0;
+                    state.visibleAccess = 0;
+                } else {
+                    // The transition counts as a write, made visible to this read
+                    state.writeStages = info.stages;
+                    state.writeAccess = 0;
+                    state.readStages = info.stages;
+                    state.visibleStages = info.stages;
+                    state.visibleAccess = info.access;
+                }
+            } else {
+                // Reads only wait if the last write is not yet visible to them
+                const bool visible = (info.stages & ~state.visibleStages) == 0 && (info.access & ~state.visibleAccess) == 0;
+                if (state.writeStages != 0 && !visible) {
+                    src |= state.writeStages;
+                    srcAccess |= state.writeAccess;
+                    barrier = true;
+                    state.visibleStages |= info.stages;
+                    state.visibleAccess |= info.access;
+                }
+                state.readStages |= info.stages;
+            }
+            if (use.texture) {
+                state.layout = info.layout;
+            }
+
+            if (!barrier) {
+                continue;
+            }
+            srcStages |= src;
+            dstStages |= info.stages;
+
+            if (layoutChange) {
+                const TextureResource& texture = m_textures[use.resource];
+
+                VkImageMemoryBarrier imageBarrier{};
+                imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                imageBarrier.srcAccessMask = srcAccess;
+                imageBarrier.dstAccessMask = info.access;
+                imageBarrier.oldLayout = oldLayout;
+                imageBarrier.newLayout = info.layout;
+                imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                imageBarrier.image = texture.image;
+                imageBarrier.subresourceRange.aspectMask = GetAspect(texture.desc.format);
+                imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+                imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+                imageBarriers.push_back(imageBarrier);
+            } else {
+                memoryBarrier.srcAccessMask |= srcAccess;
+                memoryBarrier.dstAccessMask |= info.access;
+                memoryDependency = true;
+            }
+        }
+
+        if (memoryDependency || !imageBarriers.empty()) {
+            vkCmdPipelineBarrier(
+                cmd,
+                srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                dstStages,
+                0,
+                memoryDependency ? 1 : 0, &memoryBarrier,
+                0, nullptr,
+                static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+            );
+            m_stats.barrierBatchCount++;
+            m_stats.imageBarrierCount += static_cast<uint32_t>(imageBarriers.size());
+        }
+
+        RenderGraphContext context(*this);
+        context.m_cmd = cmd;
+
+        if (pass.attachments.empty()) {
+            pass.execute(context);
+            return;
+        }
+
+        const VkExtent2D extent = m_textures[pass.attachments[0].texture].extent;
+        const bool dynamicRendering = m_renderer.UsesDynamicRendering();
+
+        if (dynamicRendering) {
+            BeginRendering(cmd, passIndex, extent);
+        } else {
+            const VkRenderPass renderPass = GetRenderPass(passIndex);
+
+            std::vector<VkClearValue> clearValues;
+            clearValues.reserve(pass.attachments.size());
+            for (const auto& attachment : pass.attachments) {
+                clearValues.push_back(attachment.clearValue);
+            }
+
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = renderPass;
+            renderPassInfo.framebuffer = GetFramebuffer(renderPass, pass, extent);
+            renderPassInfo.renderArea.extent = extent;
+            renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+            renderPassInfo.pClearValues = clearValues.data();
+            vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+            context.m_renderPass = renderPass;
+        }
+
+        // For pipelines with dynamic viewport and scissor, static ones override it
+        VkViewport viewport{};
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(cmd, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.extent = extent;
+        vkCmdSetScissor(cmd, 0, 1, &scissor);
+
+        for (const auto& attachment : pass.attachments) {
+            const VkFormat format = m_textures[attachment.texture].desc.format;
+            if (attachment.depth) {
+                context.m_depthFormat = format;
+            } else {
+                context.m_colorFormats.push_back(format);
+            }
+        }
+        context.m_extent = extent;
+        pass.execute(context);
+
+        if (dynamicRendering) {
+            m_renderer.CmdEndRendering(cmd);
+        } else {
+            vkCmdEndRenderPass(cmd);
+        }
+    }
+
+    RenderGraph::AttachmentOps RenderGraph::GetAttachmentOps(const uint32_t passIndex, const Attachment& attachment) const {
+        const TextureResource& texture = m_textures[attachment.texture];
+        const bool transient = !texture.imported;
+
+        AttachmentOps ops;
+        ops.layout = !attachment.depth ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+            : attachment.readOnly ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL
+            : VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+        // Transients hold nothing before their first pass and nothing is read after their last
+        ops.loadOp = attachment.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR
+            : transient && texture.firstPass == passIndex ? VK_ATTACHMENT_LOAD_OP_DONT_CARE
+            : VK_ATTACHMENT_LOAD_OP_LOAD;
+        ops.storeOp = !attachment.readOnly && transient && texture.lastPass == passIndex
+            ? VK_ATTACHMENT_STORE_OP_DONT_CARE
+            : VK_ATTACHMENT_STORE_OP_STORE;
+        return ops;
+    }
+
+    void RenderGraph::BeginRendering(VkCommandBuffer cmd, const uint32_t passIndex, const VkExtent2D extent) {
+        const Pass& pass = m_passes[passIndex];
+
+        // Same ops and layouts the render pass would get, the barriers before the pass did the transitions
+        std::vector<VkRenderingAttachmentInfoKHR> colorAttachments;
+        VkRenderingAttachmentInfoKHR depthAttachment{};
+        VkImageAspectFlags depthAspect = 0;
+
+        for (const auto& attachment : pass.attachments) {
+            const AttachmentOps ops = GetAttachmentOps(passIndex, attachment);
+
+            VkRenderingAttachmentInfoKHR info{};
+            info.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+            info.imageView = m_textures[attachment.texture].view;
+            info.imageLayout = ops.layout;
+            info.loadOp = ops.loadOp;
+            info.storeOp = ops.storeOp;
+            info.clearValue = attachment.clearValue;
+
+            if (attachment.depth) {
+                depthAttachment = info;
+                depthAspect = GetAspect(m_textures[attachment.texture].desc.format);
+            } else {
+                colorAttachments.push_back(info);
+            }
+        }
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        renderingInfo.renderArea.extent = extent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorAttachments.size());
+        renderingInfo.pColorAttachments = colorAttachments.data();
+        renderingInfo.pDepthAttachment = (depthAspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? &depthAttachment : nullptr;
+        renderingInfo.pStencilAttachment = (depthAspect & VK_IMAGE_ASPECT_STENCIL_BIT) ? &depthAttachment : nullptr;
+        m_renderer.CmdBeginRendering(cmd, renderingInfo);
+    }
+
+    void RenderGraph::FinishImports(VkCommandBuffer cmd) {
+        // Whoever uses imported resources next knows nothing about the graph, so
+        // everything it did is made available to all later commands
+        VkPipelineStageFlags srcStages = 0;
+        VkMemoryBarrier memoryBarrier{};
+        memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        bool memoryDependency = false;
+        std::vector<VkImageMemoryBarrier> imageBarriers;
+
+        for (const auto& texture : m_textures) {
+            if (!texture.imported || texture.firstPass == UINT32_MAX) {
+                continue;
+            }
+            srcStages |= texture.state.writeStages | texture.state.readStages;
+
+            const VkImageLayout finalLayout = texture.finalLayout != VK_IMAGE_LAYOUT_UNDEFINED ? texture.finalLayout : texture.state.layout;
+            if (finalLayout == texture.state.layout) {
+                memoryBarrier.srcAccessMask |= texture.state.writeAccess;
+                memoryDependency = true;
+                continue;
+            }
+
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = texture.state.writeAccess;
+            imageBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+            imageBarrier.oldLayout = texture.state.layout;
+            imageBarrier.newLayout = finalLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = texture.image;
+            imageBarrier.subresourceRange.aspectMask = GetAspect(texture.desc.format);
+            imageBarrier.subresourceRange.levelCount = VK_REMAINING_MIP_LEVELS;
+            imageBarrier.subresourceRange.layerCount = VK_REMAINING_ARRAY_LAYERS;
+            imageBarriers.push_back(imageBarrier);
+        }
+
+        for (const auto& buffer : m_buffers) {
+            if (!buffer.imported || buffer.firstPass == UINT32_MAX) {
+                continue;
+            }
+            srcStages |= buffer.state.writeStages | buffer.state.readStages;
+            memoryBarrier.srcAccessMask |= buffer.state.writeAccess;
+            memoryDependency = true;
+        }
+
+        if (!memoryDependency && imageBarriers.empty()) {
+            return;
+        }
+        memoryBarrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            cmd,
+            srcStages != 0 ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+            0,
+            memoryDependency ? 1 : 0, &memoryBarrier,
+            0, nullptr,
+            static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data()
+        );
+        m_stats.barrierBatchCount++;
+        m_stats.imageBarrierCount += static_cast<uint32_t>(imageBarriers.size());
+    }
+
+    VkRenderPass RenderGraph::GetRenderPass(const uint32_t passIndex) {
+        const Pass& pass = m_passes[passIndex];
+
+        // Attachments keep their layout through the pass, the barriers before it do the transitions
+        RenderPassKey key;
+        std::vector<VkAttachmentDescription> descriptions;
+        std::vector<VkAttachmentReference> colorReferences;
+        VkAttachmentReference depthReference{};
+        bool hasDepth = false;
+
+        for (uint32_t i = 0; i < pass.attachments.size(); i++) {
+            const Attachment& attachment = pass.attachments[i];
+            const TextureResource& texture = m_textures[attachment.texture];
+            const AttachmentOps ops = GetAttachmentOps(passIndex, attachment);
+            const VkImageLayout layout = ops.layout;
+            const VkAttachmentLoadOp loadOp = ops.loadOp;
+            const VkAttachmentStoreOp storeOp = ops.storeOp;
+
+            key.attachments.push_back({
+                static_cast<uint32_t>(texture.desc.format),
+                static_cast<uint32_t>(loadOp),
+                static_cast<uint32_t>(storeOp),
+                static_cast<uint32_t>(layout)
+            });
+
+            VkAttachmentDescription description{};
+            description.format = texture.desc.format;
+            description.samples = VK_SAMPLE_COUNT_1_BIT;
+            description.loadOp = loadOp;
+            description.storeOp = storeOp;
+            description.stencilLoadOp = loadOp;
+            description.stencilStoreOp = storeOp;
+            description.initialLayout = layout;
+            description.finalLayout = layout;
+            descriptions.push_back(description);
+
+            if (attachment.depth) {
+                depthReference = {i, layout};
+                hasDepth = true;
+            } else {
+                colorReferences.push_back({i, layout});
+            }
+        }
+
+        const auto it = m_renderPasses.find(key);
+        if (it != m_renderPasses.end()) {
+            return it->second;
+        }
+
+        VkSubpassDescription subpass{};
+        subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+        subpass.colorAttachmentCount = static_cast<uint32_t>(colorReferences.size());
+        subpass.pColorAttachments = colorReferences.data();
+        subpass.pDepthStencilAttachment = hasDepth ? &depthReference : nullptr;
+
+        VkRenderPassCreateInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+        renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+        renderPassInfo.pAttachments = descriptions.data();
+        renderPassInfo.subpassCount = 1;
+        renderPassInfo.pSubpasses = &subpass;
+
+        // Owned by the layout cache, so graphs built every frame share them
+        VkRenderPass renderPass = m_renderer.GetLayoutCache().GetRenderPass(renderPassInfo);
+        m_renderPasses.emplace(std::move(key), renderPass);
+        return renderPass;
+    }
+
+    VkFramebuffer RenderGraph::GetFramebuffer(VkRenderPass renderPass, const Pass& pass, const VkExtent2D extent) {
+        FramebufferKey key{renderPass, {}, extent.width, extent.height, m_swapchainGeneration};
+        for (const auto& attachment : pass.attachments) {
+            key.views.push_back(m_textures[attachment.texture].view);
+        }
+
+        const auto it = m_framebuffers.find(key);
+        if (it != m_framebuffers.end()) {
+            it->second.lastUsed = m_executeCount;
+            return it->second.framebuffer;
+        }
+
+        VkFramebufferCreateInfo framebufferInfo{};
+        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        framebufferInfo.renderPass = renderPass;
+        framebufferInfo.attachmentCount = static_cast<uint32_t>(key.views.size());
+        framebufferInfo.pAttachments = key.views.data();
+        framebufferInfo.width = extent.width;
+        framebufferInfo.height = extent.height;
+        framebufferInfo.layers = 1;
+
+        VkFramebuffer framebuffer;
+        if (vkCreateFramebuffer(m_device, &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create render graph framebuffer!");
+        }
+        m_framebuffers.emplace(std::move(key), CachedFramebuffer{framebuffer, m_executeCount});
+        return framebuffer;
+    }
+
+    void RenderGraph::DestroyTransients(FrameTransients& transients) {
+        std::vector<VkImageView> views;
+        for (const auto& object : transients.objects) {
+            if (object.view != VK_NULL_HANDLE) {
+                views.push_back(object.view);
+            }
+        }
+        ReleaseFramebuffers(views);
+
+        if (!transients.objects.empty()) {
+            m_renderer.Retire([device = m_device, objects = std::move(transients.objects)]() {
+                for (const auto& object : objects) {
+                    if (object.view != VK_NULL_HANDLE) {
+                        vkDestroyImageView(device, object.view, nullptr);
+                    }
+                    if (object.image != VK_NULL_HANDLE) {
+                        vkDestroyImage(device, object.image, nullptr);
+                    }
+                    if (object.buffer != VK_NULL_HANDLE) {
+                        vkDestroyBuffer(device, object.buffer, nullptr);
+                    }
+                }
+            });
+        }
+        transients.objects.clear();
+        transients.keys.clear();
+        for (auto& heap : transients.heaps) {
+            heap.used = 0;
+        }
+    }
+
+    void RenderGraph::ReleaseFramebuffers(const std::vector<VkImageView>& views) {
+        if (views.empty()) {
+            return;
+        }
+        for (auto it = m_framebuffers.begin(); it != m_framebuffers.end();) {
+            const bool usesView = std::any_of(it->first.views.begin(), it->first.views.end(), [&](VkImageView view) {
+                return std::find(views.begin(), views.end(), view) != views.end();
+            });
+            if (usesView) {
+                m_renderer.Retire([device = m_device, framebuffer = it->second.framebuffer]() {
+                    vkDestroyFramebuffer(device, framebuffer, nullptr);
+                });
+                it = m_framebuffers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
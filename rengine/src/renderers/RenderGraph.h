@@ -0,0 +1,354 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <VulkanAllocator.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <utility>
+#include <string>
+#include <vector>
+
+namespace REngine {
+    class VulkanRenderer;
+    class RenderGraph;
+
+    struct RenderGraphTexture {
+        uint32_t id = UINT32_MAX;
+        [[nodiscard]] bool IsValid() const { return id != UINT32_MAX; }
+    };
+
+    struct RenderGraphBuffer {
+        uint32_t id = UINT32_MAX;
+        [[nodiscard]] bool IsValid() const { return id != UINT32_MAX; }
+    };
+
+    // How a pass touches a resource. Attachments are declared with
+    // RenderGraphBuilder::ColorAttachment() and DepthAttachment() instead.
+    enum class RenderGraphAccess : uint8_t {
+        SampledRead = 0,
+        StorageRead,
+        StorageWrite,
+        UniformRead,
+        VertexRead,
+        IndexRead,
+        IndirectRead,
+        TransferSrc,
+        TransferDst,
+        ColorAttachment,
+        DepthAttachment,
+        DepthRead,
+        Count
+    };
+
+    struct RenderGraphTextureDesc {
+        uint32_t width = 0;   // 0 follows the renderer's extent
+        uint32_t height = 0;
+        VkFormat format = VK_FORMAT_R8G8B8A8_UNORM;
+        VkImageUsageFlags usage = 0;  // Added to the usage implied by the passes
+    };
+
+    struct RenderGraphBufferDesc {
+        VkDeviceSize size = 0;
+        VkBufferUsageFlags usage = 0;  // Added to the usage implied by the passes
+    };
+
+    struct RenderGraphStats {
+        uint32_t passCount = 0;
+        uint32_t culledPassCount = 0;
+        uint32_t barrierBatchCount = 0;   // vkCmdPipelineBarrier calls
+        uint32_t imageBarrierCount = 0;
+        VkDeviceSize transientBytes = 0;  // Memory bound to transient resources
+        VkDeviceSize unaliasedBytes = 0;  // What they would take without aliasing
+    };
+
+    // Declares the resources a pass uses. Only valid inside the setup callback.
+    class RenderGraphBuilder {
+    public:
+        // clear is null to keep the contents
+        void ColorAttachment(RenderGraphTexture texture, const VkClearColorValue* clear = nullptr);
+        void DepthAttachment(RenderGraphTexture texture, const VkClearDepthStencilValue* clear = nullptr, bool readOnly = false);
+
+        // stages 0 picks the shader stages of the pass kind: vertex and fragment
+        // for passes with attachments, compute otherwise
+        void Read(RenderGraphTexture texture, RenderGraphAccess access = RenderGraphAccess::SampledRead, VkPipelineStageFlags stages = 0);
+        void Write(RenderGraphTexture texture, RenderGraphAccess access = RenderGraphAccess::StorageWrite, VkPipelineStageFlags stages = 0);
+        void Read(RenderGraphBuffer buffer, RenderGraphAccess access = RenderGraphAccess::StorageRead, VkPipelineStageFlags stages = 0);
+        void Write(RenderGraphBuffer buffer, RenderGraphAccess access = RenderGraphAccess::StorageWrite, VkPipelineStageFlags stages = 0);
+
+        // The pass runs even if nothing reads what it writes (readbacks, debug output)
+        void NeverCull();
+
+    private:
+        friend class RenderGraph;
+        RenderGraphBuilder(RenderGraph& graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+
+        RenderGraph& m_graph;
+        uint32_t m_pass;
+    };
+
+    // Handed to the execute callback of a pass
+    class RenderGraphContext {
+    public:
+        [[nodiscard]] VkCommandBuffer GetCommandBuffer() const { return m_cmd; }
+
+        // Null outside passes with attachments. Stable across frames while the
+        // attachment formats and load ops stay the same, pipelines can be built against it.
+        // Also null with dynamic rendering, pipelines then take the formats below
+        // through VkPipelineRenderingCreateInfoKHR.
+        [[nodiscard]] VkRenderPass GetRenderPass() const { return m_renderPass; }
+        [[nodiscard]] const std::vector<VkFormat>& GetColorFormats() const { return m_colorFormats; }
+        [[nodiscard]] VkFormat GetDepthFormat() const { return m_depthFormat; }
+        [[nodiscard]] VkExtent2D GetExtent() const { return m_extent; }
+
+        [[nodiscard]] VkImage GetImage(RenderGraphTexture texture) const;
+        [[nodiscard]] VkImageView GetView(RenderGraphTexture texture) const;
+        [[nodiscard]] VkBuffer GetBuffer(RenderGraphBuffer buffer) const;
+
+    private:
+        friend class RenderGraph;
+        explicit RenderGraphContext(const RenderGraph& graph) : m_graph(graph) {}
+
+        const RenderGraph& m_graph;
+        VkCommandBuffer m_cmd = VK_NULL_HANDLE;
+        VkRenderPass m_renderPass = VK_NULL_HANDLE;
+        std::vector<VkFormat> m_colorFormats;
+        VkFormat m_depthFormat = VK_FORMAT_UNDEFINED;
+        VkExtent2D m_extent{};
+    };
+
+    // Frame graph: passes declare what they read and write, then Execute()
+    // culls passes whose results nobody uses, records them in declaration order
+    // with the barriers between them batched into one call per pass, and places
+    // transient images and buffers whose lifetimes do not overlap in the same
+    // memory.
+    //
+    // Resources and passes are declared again every frame. Render passes,
+    // framebuffers, transient resources and their memory are kept between
+    // frames, one set of transients per frame slot. When the renderer uses
+    // dynamic rendering, passes create no render passes or framebuffers.
+    class RenderGraph {
+    public:
+        explicit RenderGraph(VulkanRenderer& renderer);
+        ~RenderGraph();
+
+        // Disable copying
+        RenderGraph(const RenderGraph&) = delete;
+        RenderGraph& operator=(const RenderGraph&) = delete;
+
+        // Contents are undefined at the first use, and the memory may be reused
+        // once the last pass using the resource has run
+        RenderGraphTexture CreateTexture(const std::string& name, const RenderGraphTextureDesc& desc);
+        RenderGraphBuffer CreateBuffer(const std::string& name, const RenderGraphBufferDesc& desc);
+
+        // Passes writing imported resources are never culled. The image is
+        // expected in currentLayout and left in finalLayout, UNDEFINED keeps the
+        // last layout the graph used.
+        RenderGraphTexture ImportTexture(
+            const std::string& name,
+            VkImage image,
+            VkImageView view,
+            VkFormat format,
+            VkExtent2D extent,
+            VkImageLayout currentLayout,
+            VkImageLayout finalLayout
+        );
+        RenderGraphBuffer ImportBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size);
+
+        // The image the current frame renders into. Use from graphs run by
+        // VulkanRenderer::ExecuteRenderGraph().
+        RenderGraphTexture ImportBackbuffer();
+
+        // setup runs immediately, execute during Execute() if the pass survives culling
+        void AddPass(
+            const std::string& name,
+            const std::function<void(RenderGraphBuilder&)>& setup,
+            std::function<void(RenderGraphContext&)> execute
+        );
+
+        // Compiles and records every pass into cmd, outside any render pass,
+        // then clears the declarations for the next frame. Render thread only.
+        void Execute(VkCommandBuffer cmd);
+
+        // Of the last Execute()
+        [[nodiscard]] const RenderGraphStats& GetStats() const { return m_stats; }
+
+    private:
+        friend class RenderGraphBuilder;
+        friend class RenderGraphContext;
+
+        static constexpr uint32_t FRAMEBUFFER_IDLE_EXECUTES = 16;  // Unused framebuffers are destroyed after this many
+
+        struct AccessInfo {
+            VkPipelineStageFlags stages;
+            VkAccessFlags access;
+            VkImageLayout layout;
+            bool write;
+        };
+
+        // Uses of one resource within a pass are merged into one
+        struct ResourceUse {
+            uint32_t resource;
+            bool texture;
+            AccessInfo info;  // Defaulted stages are filled in once the pass is declared
+            uint32_t usage;   // Image or buffer usage the access needs
+        };
+
+        struct Attachment {
+            uint32_t texture;
+            bool depth;
+            bool readOnly;
+            bool clear;
+            VkClearValue clearValue;
+        };
+
+        // How an attachment is loaded, stored and laid out during its pass
+        struct AttachmentOps {
+            VkImageLayout layout;
+            VkAttachmentLoadOp loadOp;
+            VkAttachmentStoreOp storeOp;
+        };
+
+        struct Pass {
+            std::string name;
+            std::function<void(RenderGraphContext&)> execute;
+            std::vector<ResourceUse> uses;
+            std::vector<Attachment> attachments;
+            bool neverCull = false;
+            bool culled = false;
+        };
+
+        // Image and buffer state as the passes recorded so far left it
+        struct ResourceState {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags writeStages = 0;
+            VkAccessFlags writeAccess = 0;
+            VkPipelineStageFlags readStages = 0;       // Reads since the last write
+            VkPipelineStageFlags visibleStages = 0;    // Reads the last write was made visible to
+            VkAccessFlags visibleAccess = 0;
+        };
+
+        struct TextureResource {
+            std::string name;
+            RenderGraphTextureDesc desc;
+            VkExtent2D extent{};
+            bool imported = false;
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkImageUsageFlags usage = 0;
+            uint32_t firstPass = UINT32_MAX;
+            uint32_t lastPass = 0;
+            uint32_t transient = UINT32_MAX;  // Index into the frame slot's objects
+            ResourceState state;
+        };
+
+        struct BufferResource {
+            std::string name;
+            RenderGraphBufferDesc desc;
+            bool imported = false;
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkBufferUsageFlags usage = 0;
+            uint32_t firstPass = UINT32_MAX;
+            uint32_t lastPass = 0;
+            uint32_t transient = UINT32_MAX;  // Index into the frame slot's objects
+            ResourceState state;
+        };
+
+        // What a transient was created from. A frame slot keeps its objects
+        // while the keys match the previous frame's.
+        struct TransientKey {
+            bool texture;
+            VkExtent2D extent;
+            VkFormat format;
+            uint32_t usage;      // Image or buffer usage
+            VkDeviceSize size;   // Buffers only
+            uint32_t firstPass;
+            uint32_t lastPass;
+
+            bool operator==(const TransientKey& other) const;
+        };
+
+        struct TransientObject {
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VkBuffer buffer = VK_NULL_HANDLE;
+            VkMemoryRequirements requirements{};
+            VkDeviceSize offset = 0;             // Within its heap
+            uint32_t heap = 0;
+            std::vector<uint32_t> aliasedAfter;  // Objects whose memory this one reuses within the frame
+        };
+
+        // Objects that can share one memory type. Images and buffers never share
+        // a heap, so bufferImageGranularity never matters, and aliasing only
+        // happens within a heap.
+        struct TransientHeap {
+            AllocationKind kind = AllocationKind::Optimal;
+            uint32_t memoryTypeBits = ~0u;
+            VkDeviceSize used = 0;
+            VulkanAllocation allocation;
+        };
+
+        struct FrameTransients {
+            std::vector<TransientHeap> heaps;
+            std::vector<TransientKey> keys;
+            std::vector<TransientObject> objects;     // Same order as keys
+            uint64_t lastFrame = UINT64_MAX;          // Renderer frame of the last Execute()
+        };
+
+        struct RenderPassKey {
+            std::vector<std::array<uint32_t, 4>> attachments;  // format, load op, store op, layout
+            bool operator<(const RenderPassKey& other) const { return attachments < other.attachments; }
+        };
+
+        struct FramebufferKey {
+            VkRenderPass renderPass;
+            std::vector<VkImageView> views;
+            uint32_t width;
+            uint32_t height;
+            uint64_t swapchainGeneration;  // Imported backbuffer views are not released individually
+            bool operator<(const FramebufferKey& other) const;
+        };
+
+        struct CachedFramebuffer {
+            VkFramebuffer framebuffer;
+            uint64_t lastUsed;
+        };
+
+        static AccessInfo GetAccessInfo(RenderGraphAccess access);
+        static VkImageAspectFlags GetAspect(VkFormat format);
+
+        void AddUse(uint32_t pass, uint32_t resource, bool texture, RenderGraphAccess access, VkPipelineStageFlags stages);
+        void Cull();
+        void ComputeLifetimes();
+        void AllocateTransients();
+        VkDeviceSize PackTransients(FrameTransients& transients, uint32_t heap) const;
+        void CreateTransients(FrameTransients& transients);
+        void RecordPass(VkCommandBuffer cmd, uint32_t passIndex);
+        void FinishImports(VkCommandBuffer cmd);
+        ResourceState& GetState(bool texture, uint32_t resource);
+        AttachmentOps GetAttachmentOps(uint32_t passIndex, const Attachment& attachment) const;
+        void BeginRendering(VkCommandBuffer cmd, uint32_t passIndex, VkExtent2D extent);
+        VkRenderPass GetRenderPass(uint32_t passIndex);
+        VkFramebuffer GetFramebuffer(VkRenderPass renderPass, const Pass& pass, VkExtent2D extent);
+        void DestroyTransients(FrameTransients& transients);
+        void ReleaseFramebuffers(const std::vector<VkImageView>& views);
+
+        VulkanRenderer& m_renderer;
+        VkDevice m_device;
+        VulkanAllocator& m_allocator;
+
+        std::vector<Pass> m_passes;
+        std::vector<TextureResource> m_textures;
+        std::vector<BufferResource> m_buffers;
+        std::vector<std::pair<bool, uint32_t>> m_transientResources;  // Per object: texture?, resource index
+
+        std::vector<FrameTransients> m_transients;  // Per frame slot
+        std::map<RenderPassKey, VkRenderPass> m_renderPasses;  // Owned by the renderer's layout cache
+        std::map<FramebufferKey, CachedFramebuffer> m_framebuffers;
+        uint64_t m_executeCount = 0;
+        uint64_t m_swapchainGeneration = 0;  // Of the cached framebuffers
+
+        RenderGraphStats m_stats;
+    };
+}
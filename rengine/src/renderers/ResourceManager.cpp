@@ -0,0 +1,251 @@
+﻿#include "ResourceManager.h"
+#include <RFileWatcher.h>
+#include <RHash.h>
+#include <RProfiler.h>
+#include <renderers/VulkanRenderer.h>
+#include <algorithm>
+#include <chrono>
+#include <exception>
+
+namespace REngine {
+    namespace {
+        std::string TextureKey(const std::string& source, const VkFormat format, const bool generateMipmaps) {
+            return "texture:" + source + "|" + std::to_string(format) + (generateMipmaps ? "|mips" : "");
+        }
+    }
+
+    ResourceManager::ResourceManager(VulkanRenderer& renderer, const uint32_t threadCount)
+        : m_renderer(renderer)
+        , m_loader(renderer, threadCount) {
+    }
+
+    ResourceManager::~ResourceManager() {
+        // Textures still decoding are created and dropped with everything else
+        m_loader.WaitAll();
+        for (const auto& entry : m_loading) {
+            try {
+                entry->resource = entry->future.get();
+            } catch (const std::exception&) {
+            }
+            entry->future = {};
+        }
+        for (const auto& entry : m_resources) {
+            Evict(entry);
+        }
+        m_resources.clear();
+        m_keys.clear();
+        m_loading.clear();
+    }
+
+    TextureHandle ResourceManager::LoadTexture(const std::string& path, const VkFormat format, const bool generateMipmaps) {
+        const std::string key = TextureKey(RFileWatcher::NormalizePath(path), format, generateMipmaps);
+        if (std::shared_ptr<ResourceEntry> entry = Find(key)) {
+            return TextureHandle(std::move(entry));
+        }
+
+        std::shared_ptr<ResourceEntry> entry = Insert(key);
+        entry->future = m_loader.Load(path, format, generateMipmaps);
+        m_loading.push_back(entry);
+        return TextureHandle(std::move(entry));
+    }
+
+    TextureHandle ResourceManager::LoadTexture(const RAssetPack& pack, const std::string& name, const VkFormat format,
+                                               const bool generateMipmaps) {
+        const std::string key = TextureKey(RFileWatcher::NormalizePath(pack.GetPath()) + "#" + name, format, generateMipmaps);
+        if (std::shared_ptr<ResourceEntry> entry = Find(key)) {
+            return TextureHandle(std::move(entry));
+        }
+
+        std::shared_ptr<ResourceEntry> entry = Insert(key);
+        try {
+            auto texture = std::make_shared<Texture>();
+            texture->CreateFromPack(m_renderer, pack, name, format, generateMipmaps);
+            entry->memorySize = texture->GetMemorySize();
+            entry->resource = std::move(texture);
+            entry->state = ResourceState::Loaded;
+        } catch (const std::exception& e) {
+            entry->error = e.what();
+            entry->state = ResourceState::Failed;
+        }
+        return TextureHandle(std::move(entry));
+    }
+
+    ShaderHandle ResourceManager::LoadShader(const std::vector<std::pair<Shader::Stage, std::string>>& stages) {
+        std::string key = "shader:";
+        for (const auto& [stage, path] : stages) {
+            key += std::to_string(stage) + "=" + RFileWatcher::NormalizePath(path) + ";";
+        }
+        if (std::shared_ptr<ResourceEntry> entry = Find(key)) {
+            return ShaderHandle(std::move(entry));
+        }
+
+        // The same SPIR-V under other paths is the same shader
+        std::string contentKey;
+        try {
+            size_t hash = 0;
+            for (const auto& [stage, path] : stages) {
+                HashCombine(hash, static_cast<uint64_t>(stage));
+                HashCombine(hash, m_renderer.GetShaderCache().Load(path)->hash);
+            }
+            contentKey = "shader#" + std::to_string(hash);
+        } catch (const std::exception& e) {
+            std::shared_ptr<ResourceEntry> entry = Insert(key);
+            entry->error = e.what();
+            entry->state = ResourceState::Failed;
+            return ShaderHandle(std::move(entry));
+        }
+
+        if (std::shared_ptr<ResourceEntry> entry = Find(contentKey)) {
+            entry->keys.push_back(key);
+            m_keys[key] = entry;
+            return ShaderHandle(std::move(entry));
+        }
+
+        std::shared_ptr<ResourceEntry> entry = Insert(key);
+        entry->keys.push_back(contentKey);
+        m_keys[contentKey] = entry;
+        try {
+            auto shader = std::make_shared<Shader>(m_renderer);
+            for (const auto& [stage, path] : stages) {
+                shader->LoadFromFile(path, stage);
+            }
+            shader->BuildPipelineLayout();
+            entry->resource = std::move(shader);
+            entry->state = ResourceState::Loaded;
+        } catch (const std::exception& e) {
+            entry->error = e.what();
+            entry->state = ResourceState::Failed;
+        }
+        return ShaderHandle(std::move(entry));
+    }
+
+    void ResourceManager::Update() {
+        RPROFILE_SCOPE("ResourceManager::Update");
+        m_frame++;
+
+        m_loader.Update();
+        for (auto it = m_loading.begin(); it != m_loading.end();) {
+            ResourceEntry& entry = **it;
+            if (entry.future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+
+            try {
+                std::shared_ptr<Texture> texture = entry.future.get();
+                entry.memorySize = texture->GetMemorySize();
+                entry.resource = std::move(texture);
+                entry.state = ResourceState::Loaded;
+            } catch (const std::exception& e) {
+                entry.error = e.what();
+                entry.state = ResourceState::Failed;
+            }
+            entry.future = {};
+            it = m_loading.erase(it);
+        }
+
+        // Failed loads are forgotten once nothing refers to them, so they can be retried
+        VkDeviceSize residentBytes = 0;
+        std::vector<std::shared_ptr<ResourceEntry>> unreferenced;
+        for (auto it = m_resources.begin(); it != m_resources.end();) {
+            const std::shared_ptr<ResourceEntry>& entry = *it;
+            if (entry->refCount > 0) {
+                entry->lastUsedFrame = m_frame;
+            } else if (entry->state == ResourceState::Failed) {
+                Evict(entry);
+                it = m_resources.erase(it);
+                continue;
+            } else if (entry->state == ResourceState::Loaded) {
+                unreferenced.push_back(entry);
+            }
+            residentBytes += entry->memorySize;
+            ++it;
+        }
+
+        if (m_budget == 0 || residentBytes <= m_budget) {
+            return;
+        }
+
+        std::sort(unreferenced.begin(), unreferenced.end(), [](const auto& a, const auto& b) {
+            return a->lastUsedFrame < b->lastUsedFrame;
+        });
+        for (const std::shared_ptr<ResourceEntry>& entry : unreferenced) {
+            if (residentBytes <= m_budget) {
+                break;
+            }
+            residentBytes -= entry->memorySize;
+            Evict(entry);
+            m_resources.erase(std::find(m_resources.begin(), m_resources.end(), entry));
+            m_evictions++;
+        }
+    }
+
+    void ResourceManager::Clear() {
+        for (auto it = m_resources.begin(); it != m_resources.end();) {
+            const std::shared_ptr<ResourceEntry>& entry = *it;
+            if (entry->refCount > 0 || entry->state == ResourceState::Loading) {
+                ++it;
+                continue;
+            }
+            if (entry->state == ResourceState::Loaded) {
+                m_evictions++;
+            }
+            Evict(entry);
+            it = m_resources.erase(it);
+        }
+    }
+
+    ResourceManagerStats ResourceManager::GetStats() const {
+        ResourceManagerStats stats;
+        stats.resourceCount = static_cast<uint32_t>(m_resources.size());
+        stats.loadingCount = static_cast<uint32_t>(m_loading.size());
+        for (const auto& entry : m_resources) {
+            if (entry->refCount > 0) {
+                stats.referencedCount++;
+            }
+            stats.residentBytes += entry->memorySize;
+        }
+        stats.budgetBytes = m_budget;
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        stats.evictions = m_evictions;
+        return stats;
+    }
+
+    std::shared_ptr<ResourceEntry> ResourceManager::Find(const std::string& key) {
+        const auto it = m_keys.find(key);
+        if (it == m_keys.end()) {
+            return nullptr;
+        }
+        m_hits++;
+        it->second->lastUsedFrame = m_frame;
+        return it->second;
+    }
+
+    std::shared_ptr<ResourceEntry> ResourceManager::Insert(const std::string& key) {
+        m_misses++;
+        auto entry = std::make_shared<ResourceEntry>();
+        entry->keys.push_back(key);
+        entry->lastUsedFrame = m_frame;
+        m_keys[key] = entry;
+        m_resources.push_back(entry);
+        return entry;
+    }
+
+    void ResourceManager::Evict(const std::shared_ptr<ResourceEntry>& entry) {
+        for (const std::string& key : entry->keys) {
+            m_keys.erase(key);
+        }
+        entry->keys.clear();
+
+        // Frames in flight may still sample the texture or use pipelines built from the shader
+        if (entry->resource) {
+            m_renderer.Retire([resource = std::move(entry->resource)]() mutable {
+                resource.reset();
+            });
+        }
+        entry->memorySize = 0;
+        entry->state = ResourceState::Failed;
+        entry->error = "Evicted";
+    }
+}
@@ -0,0 +1,164 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <RAssetPack.h>
+#include <renderers/Shader.h>
+#include <renderers/Texture.h>
+#include <renderers/TextureLoader.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace REngine {
+    class VulkanRenderer;
+
+    enum class ResourceState {
+        Loading,
+        Loaded,
+        Failed
+    };
+
+    // One resource, shared by every handle to it. Owned by ResourceManager.
+    struct ResourceEntry {
+        std::vector<std::string> keys;     // Every key the manager finds it under
+        ResourceState state = ResourceState::Loading;
+        std::shared_ptr<void> resource;    // Texture or Shader once loaded
+        std::string error;
+        VkDeviceSize memorySize = 0;
+        uint64_t lastUsedFrame = 0;
+        std::atomic<uint32_t> refCount{0};
+        TextureFuture future;              // Textures still decoding
+    };
+
+    // Counted reference to a managed resource. Resources stay resident while a
+    // handle refers to them; without one they may be evicted. State is updated
+    // by ResourceManager::Update(), so read it on the render thread. Handles
+    // themselves can be copied and dropped anywhere.
+    template <typename T>
+    class ResourceHandle {
+    public:
+        ResourceHandle() = default;
+        ~ResourceHandle() { Release(); }
+
+        ResourceHandle(const ResourceHandle& other) : m_entry(other.m_entry) { Acquire(); }
+        ResourceHandle(ResourceHandle&& other) noexcept : m_entry(std::move(other.m_entry)) {}
+        ResourceHandle& operator=(ResourceHandle other) noexcept {
+            std::swap(m_entry, other.m_entry);
+            return *this;
+        }
+
+        // Null until loaded
+        [[nodiscard]] T* Get() const {
+            return IsLoaded() ? static_cast<T*>(m_entry->resource.get()) : nullptr;
+        }
+        T* operator->() const { return Get(); }
+        explicit operator bool() const { return Get() != nullptr; }
+
+        [[nodiscard]] bool IsValid() const { return m_entry != nullptr; }
+        [[nodiscard]] bool IsLoaded() const { return m_entry && m_entry->state == ResourceState::Loaded; }
+        [[nodiscard]] bool HasFailed() const { return m_entry && m_entry->state == ResourceState::Failed; }
+        [[nodiscard]] const std::string& GetError() const {
+            static const std::string none;
+            return m_entry ? m_entry->error : none;
+        }
+
+        void Reset() {
+            Release();
+            m_entry.reset();
+        }
+
+    private:
+        friend class ResourceManager;
+
+        explicit ResourceHandle(std::shared_ptr<ResourceEntry> entry) : m_entry(std::move(entry)) { Acquire(); }
+
+        void Acquire() { if (m_entry) m_entry->refCount++; }
+        void Release() { if (m_entry) m_entry->refCount--; }
+
+        std::shared_ptr<ResourceEntry> m_entry;
+    };
+
+    using TextureHandle = ResourceHandle<Texture>;
+    using ShaderHandle = ResourceHandle<Shader>;
+
+    struct ResourceManagerStats {
+        uint32_t resourceCount = 0;
+        uint32_t referencedCount = 0;
+        uint32_t loadingCount = 0;
+        VkDeviceSize residentBytes = 0;     // Texture memory of loaded resources
+        VkDeviceSize budgetBytes = 0;
+        uint64_t hits = 0;                  // Loads answered by a resident or loading resource
+        uint64_t misses = 0;
+        uint64_t evictions = 0;
+    };
+
+    // Hands out handles to textures and shaders, loading each one once. Textures
+    // are found by normalized path, shaders by their stage paths and by the
+    // content hashes of their SPIR-V, so copies of the same shader under other
+    // names share one Shader. Loads of resident or loading resources return at
+    // once. Over the budget, unreferenced resources are evicted least recently
+    // used first. Render thread only, apart from the handles. Destroy it before
+    // the renderer shuts down.
+    class ResourceManager {
+    public:
+        static constexpr VkDeviceSize DEFAULT_BUDGET = 512ull * 1024 * 1024;
+
+        explicit ResourceManager(VulkanRenderer& renderer, uint32_t threadCount = 0);
+        ~ResourceManager();
+
+        // Disable copying
+        ResourceManager(const ResourceManager&) = delete;
+        ResourceManager& operator=(const ResourceManager&) = delete;
+
+        // Decoded on TextureLoader's workers, see Update()
+        TextureHandle LoadTexture(
+            const std::string& path,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            bool generateMipmaps = true
+        );
+
+        // Created right away from the pack's mapping
+        TextureHandle LoadTexture(
+            const RAssetPack& pack,
+            const std::string& name,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            bool generateMipmaps = true
+        );
+
+        // SPIR-V files per stage. Loaded right away (ShaderCache keeps this cheap)
+        // with the pipeline layout built.
+        ShaderHandle LoadShader(const std::vector<std::pair<Shader::Stage, std::string>>& stages);
+
+        // Texture memory the manager keeps resident, 0 for no cap. Shaders are
+        // small and not counted.
+        void SetBudget(VkDeviceSize bytes) { m_budget = bytes; }
+
+        // Finishes texture loads and evicts over budget. Call once per frame.
+        void Update();
+
+        // Evicts every unreferenced resource
+        void Clear();
+
+        [[nodiscard]] ResourceManagerStats GetStats() const;
+
+    private:
+        std::shared_ptr<ResourceEntry> Find(const std::string& key);
+        std::shared_ptr<ResourceEntry> Insert(const std::string& key);
+        void Evict(const std::shared_ptr<ResourceEntry>& entry);
+
+        VulkanRenderer& m_renderer;
+        TextureLoader m_loader;
+        VkDeviceSize m_budget = DEFAULT_BUDGET;
+        uint64_t m_frame = 0;
+
+        std::vector<std::shared_ptr<ResourceEntry>> m_resources;
+        std::unordered_map<std::string, std::shared_ptr<ResourceEntry>> m_keys;
+        std::vector<std::shared_ptr<ResourceEntry>> m_loading;
+        uint64_t m_hits = 0;
+        uint64_t m_misses = 0;
+        uint64_t m_evictions = 0;
+    };
+}
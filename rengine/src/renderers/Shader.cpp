@@ -1,17 +1,24 @@
 ﻿#include "Shader.h"
-#include <fstream>
+#include <renderers/VulkanRenderer.h>
+#include <cstring>
+#include <map>
 #include <stdexcept>
 #include <algorithm>
 namespace REngine {
-    Shader::Shader(VkDevice device) : m_device(device) {}
+    Shader::Shader(VulkanRenderer& renderer)
+        : m_renderer(renderer)
+        , m_device(renderer.GetDevice())
+        , m_shaderCache(renderer.GetShaderCache())
+        , m_layoutCache(renderer.GetLayoutCache()) {
+        m_reloadId = renderer.GetShaderHotReloader().Register(*this);
+    }
 
     Shader::~Shader() {
+        m_renderer.GetShaderHotReloader().Unregister(*this);
+
         for (auto& [stage, module] : m_modules) {
             vkDestroyShaderModule(m_device, module, nullptr);
         }
-        if (m_layout != VK_NULL_HANDLE) {
-            vkDestroyPipelineLayout(m_device, m_layout, nullptr);
-        }
     }
 
     void Shader::CreateShaderModule(const std::vector<uint32_t>& code, Stage stage) {
@@ -24,92 +31,162 @@ namespace REngine {
         if (vkCreateShaderModule(m_device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create shader module!");
         }
+
+        const auto it = m_modules.find(stage);
+        if (it != m_modules.end()) {
+            vkDestroyShaderModule(m_device, it->second, nullptr);
+        }
         m_modules[stage] = shaderModule;
     }
 
-    void Shader::ReflectDescriptors(const std::vector<uint32_t>& code) {
-        SpvReflectShaderModule module;
-        if (spvReflectCreateShaderModule(code.size() * sizeof(uint32_t), code.data(), &module) != SPV_REFLECT_RESULT_SUCCESS) {
-            throw std::runtime_error("Failed to reflect SPIR-V!");
+    void Shader::BuildPipelineLayout() {
+        // Merge the bindings of every stage, keyed by set then binding
+        std::map<uint32_t, std::map<uint32_t, VkDescriptorSetLayoutBinding>> setBindings;
+        std::vector<VkPushConstantRange> pushConstants;
+
+        for (const auto& [stage, blob] : m_blobs) {
+            for (const auto& binding : blob->bindings) {
+                auto& bindings = setBindings[binding.set];
+                const auto it = bindings.find(binding.binding);
+                if (it == bindings.end()) {
+                    bindings[binding.binding] = {
+                        binding.binding,
+                        binding.type,
+                        binding.count,
+                        binding.stageFlags,
+                        nullptr  // pImmutableSamplers
+                    };
+                } else if (it->second.descriptorType != binding.type || it->second.descriptorCount != binding.count) {
+                    throw std::runtime_error("Shader stages disagree on set " + std::to_string(binding.set) +
+                                             " binding " + std::to_string(binding.binding) + "!");
+                } else {
+                    it->second.stageFlags |= binding.stageFlags;
+                }
+            }
+
+            // Stages sharing one push constant block get a single range
+            for (const auto& range : blob->pushConstants) {
+                const auto it = std::find_if(pushConstants.begin(), pushConstants.end(),
+                    [&](const VkPushConstantRange& other) {
+                        return other.offset == range.offset && other.size == range.size;
+                    });
+                if (it != pushConstants.end()) {
+                    it->stageFlags |= range.stageFlags;
+                } else {
+                    pushConstants.push_back(range);
+                }
+            }
         }
 
-        uint32_t count = 0;
-        spvReflectEnumerateDescriptorSets(&module, &count, nullptr);
-        std::vector<SpvReflectDescriptorSet*> sets(count);
-        spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
-
-        for (const auto& set : sets) {
-            for (uint32_t i = 0; i < set->binding_count; ++i) {
-                const auto& binding = *set->bindings[i];
-                m_bindings.push_back({
-                    set->set,  // Set index
-                    binding.binding,
-                    static_cast<VkDescriptorType>(binding.descriptor_type),
-                    static_cast<VkShaderStageFlags>(module.shader_stage)
-                });
+        std::sort(pushConstants.begin(), pushConstants.end(),
+            [](const VkPushConstantRange& a, const VkPushConstantRange& b) {
+                return a.offset != b.offset ? a.offset < b.offset : a.stageFlags < b.stageFlags;
+            });
+
+        // Set indices may have gaps, those get an empty layout
+        m_setLayouts.clear();
+        const uint32_t setCount = setBindings.empty() ? 0 : setBindings.rbegin()->first + 1;
+        m_setLayouts.reserve(setCount);
+        for (uint32_t set = 0; set < setCount; set++) {
+            std::vector<VkDescriptorSetLayoutBinding> bindings;
+            const auto it = setBindings.find(set);
+            if (it != setBindings.end()) {
+                for (const auto& [index, binding] : it->second) {
+                    bindings.push_back(binding);
+                }
+            }
+
+            // A sampler array alone in its set is the renderer's bindless table
+            VulkanBindlessTable& bindless = m_renderer.GetBindlessTable();
+            if (bindings.size() == 1 && bindings[0].binding == 0 &&
+                bindings[0].descriptorType == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER &&
+                (bindings[0].descriptorCount == 0 || bindings[0].descriptorCount == bindless.GetCapacity())) {
+                m_setLayouts.push_back(bindless.GetSetLayout());
+                continue;
             }
+            m_setLayouts.push_back(m_layoutCache.GetSetLayout(std::move(bindings)));
         }
 
-        spvReflectDestroyShaderModule(&module);
+        m_layout = m_layoutCache.GetPipelineLayout(m_setLayouts, pushConstants);
     }
 
-    void Shader::BuildPipelineLayout() {
-        std::unordered_map<uint32_t, std::vector<VkDescriptorSetLayoutBinding>> setBindings;
-
-        for (const auto& binding : m_bindings) {
-            setBindings[binding.set].push_back({
-                binding.binding,
-                binding.type,
-                1,  // descriptorCount
-                binding.stageFlags,
-                nullptr  // pImmutableSamplers
-            });
+    void Shader::LoadFromFile(const std::string& path, Stage stage) {
+        std::shared_ptr<const ShaderBlob> blob = m_shaderCache.Load(path);
+
+        CreateShaderModule(blob->code, stage);
+        m_blobs[stage] = std::move(blob);
+
+        ShaderHotReloader& reloader = m_renderer.GetShaderHotReloader();
+        const auto it = m_paths.find(stage);
+        if (it != m_paths.end()) {
+            reloader.Unwatch(*this, it->second);
         }
+        m_paths[stage] = path;
+        reloader.Watch(*this, path);
+    }
 
-        // Create descriptor set layouts
-        m_setLayouts.reserve(setBindings.size());
-        for (const auto& [set, bindings] : setBindings) {
-            VkDescriptorSetLayoutCreateInfo layoutInfo{};
-            layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-            layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
-            layoutInfo.pBindings = bindings.data();
-
-            VkDescriptorSetLayout layout;
-            if (vkCreateDescriptorSetLayout(m_device, &layoutInfo, nullptr, &layout) != VK_SUCCESS) {
-                throw std::runtime_error("Failed to create descriptor set layout!");
-            }
-            m_setLayouts.push_back(layout);
+    void Shader::LoadFromMemory(const void* code, const size_t size, Stage stage) {
+        if (size == 0 || size % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("SPIR-V size must be a non-zero multiple of 4!");
         }
 
-        // Create pipeline layout
-        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(m_setLayouts.size());
-        pipelineLayoutInfo.pSetLayouts = m_setLayouts.data();
+        const size_t wordCount = size / sizeof(uint32_t);
+        std::shared_ptr<const ShaderBlob> blob;
+        if (reinterpret_cast<uintptr_t>(code) % alignof(uint32_t) == 0) {
+            blob = m_shaderCache.Load(static_cast<const uint32_t*>(code), wordCount);
+        } else {
+            std::vector<uint32_t> words(wordCount);
+            std::memcpy(words.data(), code, size);
+            blob = m_shaderCache.Load(std::move(words));
+        }
 
-        if (vkCreatePipelineLayout(m_device, &pipelineLayoutInfo, nullptr, &m_layout) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create pipeline layout!");
+        CreateShaderModule(blob->code, stage);
+        m_blobs[stage] = std::move(blob);
+
+        // A file this stage was loaded from before no longer applies
+        const auto it = m_paths.find(stage);
+        if (it != m_paths.end()) {
+            m_renderer.GetShaderHotReloader().Unwatch(*this, it->second);
+            m_paths.erase(it);
         }
     }
 
-    void Shader::LoadFromFile(const std::string& path, Stage stage) {
-        std::ifstream file(path, std::ios::ate | std::ios::binary);
-        if (!file.is_open()) {
-            throw std::runtime_error("Failed to open shader file: " + path);
+    void Shader::LoadFromPack(const RAssetPack& pack, const std::string& name, Stage stage) {
+        const PackEntry& entry = pack.Get(name);
+        if (entry.codec == PackCodec::None) {
+            LoadFromMemory(pack.GetView(entry), entry.size, stage);
+            return;
         }
+        const std::vector<uint8_t> code = pack.Read(name);
+        LoadFromMemory(code.data(), code.size(), stage);
+    }
 
-        const size_t fileSize = file.tellg();
-        std::vector<uint32_t> buffer(fileSize / sizeof(uint32_t));
-        file.seekg(0);
-        file.read(reinterpret_cast<char*>(buffer.data()), fileSize);
-        file.close();
+    void Shader::Reload() {
+        m_renderer.GetShaderHotReloader().Request(*this);
+    }
 
-        CreateShaderModule(buffer, stage);
-        ReflectDescriptors(buffer);
+    void Shader::SwapModule(const Stage stage, std::shared_ptr<const ShaderBlob> blob, VkShaderModule module) {
+        const auto it = m_modules.find(stage);
+        if (it != m_modules.end()) {
+            // Frames still in flight may have been recorded with the old module
+            m_renderer.Retire([device = m_device, old = it->second]() {
+                vkDestroyShaderModule(device, old, nullptr);
+            });
+        }
+        m_modules[stage] = module;
+        m_blobs[stage] = std::move(blob);
     }
 
-    void Shader::Reload() {
-        // Implementation for hot-reloading would go here
-        // Would need to track file paths per stage
+    void Shader::FinishReload() {
+        // Edits may have changed the bindings, layouts come from the cache so
+        // unchanged ones resolve to the same handles
+        if (m_layout != VK_NULL_HANDLE) {
+            BuildPipelineLayout();
+        }
+
+        m_version++;
+        if (m_reloadCallback) {
+            m_reloadCallback(*this);
+        }
     }
-}
\ No newline at end of file
+}
@@ -2,10 +2,17 @@
 #include <vulkan/vulkan.h>
 #include <string>
 #include <vector>
+#include <functional>
+#include <memory>
 #include <unordered_map>
-#include <spirv_reflect.h>
+#include <renderers/ShaderCache.h>
+#include <RAssetPack.h>
+#include <VulkanLayoutCache.h>
 
 namespace REngine {
+    class VulkanRenderer;
+    class ShaderHotReloader;
+
     class Shader {
     public:
         enum Stage {
@@ -20,14 +27,40 @@ namespace REngine {
             STAGE_COUNT
         };
 
-        Shader(VkDevice device);
+        explicit Shader(VulkanRenderer& renderer);
         ~Shader();
 
+        // Disable copying
+        Shader(const Shader&) = delete;
+        Shader& operator=(const Shader&) = delete;
+
         void LoadFromFile(const std::string& path, Stage stage);
+
+        // SPIR-V in memory, size in bytes. Stages loaded this way are not hot
+        // reloaded.
+        void LoadFromMemory(const void* code, size_t size, Stage stage);
+
+        // Uncompressed entries are hashed and reflected in place in the mapping
+        void LoadFromPack(const RAssetPack& pack, const std::string& name, Stage stage);
         void BuildPipelineLayout();
+
+        // Re-reads every stage from disk in the background. The new modules are
+        // swapped in by the renderer between frames; files loaded through
+        // LoadFromFile() are also reloaded automatically when they change.
         void Reload();
 
+        // Called on the render thread after new modules were swapped in, so
+        // pipelines built from this shader can be recreated
+        void SetReloadCallback(std::function<void(Shader&)> callback) { m_reloadCallback = std::move(callback); }
+
+        // Incremented on every completed reload
+        uint32_t GetVersion() const { return m_version; }
+
+        // Owned by the renderer's layout cache and shared with every shader that
+        // has the same bindings
         VkPipelineLayout GetLayout() const { return m_layout; }
+        const std::vector<VkDescriptorSetLayout>& GetSetLayouts() const { return m_setLayouts; }
+
         VkShaderModule GetModule(Stage stage) const {
             const auto it = m_modules.find(stage);
             return (it != m_modules.end()) ? it->second : VK_NULL_HANDLE;
@@ -40,20 +73,27 @@ namespace REngine {
         }
 
     private:
+        friend class ShaderHotReloader;
+
         void CreateShaderModule(const std::vector<uint32_t>& code, Stage stage);
-        void ReflectDescriptors(const std::vector<uint32_t>& code);
 
+        // Used by ShaderHotReloader at the frame boundary
+        void SwapModule(Stage stage, std::shared_ptr<const ShaderBlob> blob, VkShaderModule module);
+        void FinishReload();
+
+        VulkanRenderer& m_renderer;
         VkDevice m_device;
+        ShaderCache& m_shaderCache;
+        VulkanLayoutCache& m_layoutCache;
+
         std::unordered_map<Stage, VkShaderModule> m_modules;
+        std::unordered_map<Stage, std::shared_ptr<const ShaderBlob>> m_blobs;
+        std::unordered_map<Stage, std::string> m_paths;
         VkPipelineLayout m_layout = VK_NULL_HANDLE;
-
-        struct DescriptorBinding {
-            uint32_t set;  // This was missing in original
-            uint32_t binding;
-            VkDescriptorType type;
-            VkShaderStageFlags stageFlags;
-        };
         std::vector<VkDescriptorSetLayout> m_setLayouts;
-        std::vector<DescriptorBinding> m_bindings;
+
+        uint64_t m_reloadId = 0;
+        uint32_t m_version = 0;
+        std::function<void(Shader&)> m_reloadCallback;
     };
-}
\ No newline at end of file
+}
@@ -0,0 +1,124 @@
+﻿#include "ShaderCache.h"
+#include <RHash.h>
+#include <spirv_reflect.h>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace REngine {
+    std::shared_ptr<const ShaderBlob> ShaderCache::Load(const std::string& path) {
+        std::ifstream file(path, std::ios::ate | std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open shader file: " + path);
+        }
+
+        const size_t fileSize = file.tellg();
+        if (fileSize == 0 || fileSize % sizeof(uint32_t) != 0) {
+            throw std::runtime_error("Invalid SPIR-V file: " + path);
+        }
+        std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(fileSize));
+        file.close();
+
+        // Unchanged code is found by its hash
+        return Load(std::move(code));
+    }
+
+    std::shared_ptr<const ShaderBlob> ShaderCache::Load(std::vector<uint32_t> code) {
+        const uint64_t hash = HashBytes(code.data(), code.size() * sizeof(uint32_t));
+        if (std::shared_ptr<const ShaderBlob> blob = Find(hash, code.data(), code.size())) {
+            return blob;
+        }
+
+        // Reflect outside the lock so loads on other threads are not serialized
+        return Insert(Reflect(std::move(code), hash));
+    }
+
+    std::shared_ptr<const ShaderBlob> ShaderCache::Load(const uint32_t* code, const size_t wordCount) {
+        const uint64_t hash = HashBytes(code, wordCount * sizeof(uint32_t));
+        if (std::shared_ptr<const ShaderBlob> blob = Find(hash, code, wordCount)) {
+            return blob;
+        }
+        return Insert(Reflect(std::vector<uint32_t>(code, code + wordCount), hash));
+    }
+
+    std::shared_ptr<const ShaderBlob> ShaderCache::Find(const uint64_t hash, const uint32_t* code, const size_t wordCount) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const auto it = m_blobs.find(hash);
+        if (it != m_blobs.end() && std::equal(code, code + wordCount, it->second->code.begin(), it->second->code.end())) {
+            m_hits++;
+            return it->second;
+        }
+        return nullptr;
+    }
+
+    std::shared_ptr<const ShaderBlob> ShaderCache::Insert(std::shared_ptr<const ShaderBlob> blob) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_misses++;
+        // Another thread may have reflected the same code in the meantime
+        const auto [it, inserted] = m_blobs.emplace(blob->hash, blob);
+        if (!inserted && it->second->code == blob->code) {
+            return it->second;
+        }
+        it->second = blob;
+        return blob;
+    }
+
+    void ShaderCache::Clear() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_blobs.clear();
+    }
+
+    uint32_t ShaderCache::GetBlobCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return static_cast<uint32_t>(m_blobs.size());
+    }
+
+    std::shared_ptr<ShaderBlob> ShaderCache::Reflect(std::vector<uint32_t> code, const uint64_t hash) {
+        auto blob = std::make_shared<ShaderBlob>();
+        blob->hash = hash;
+        blob->code = std::move(code);
+
+        SpvReflectShaderModule module;
+        if (spvReflectCreateShaderModule(blob->code.size() * sizeof(uint32_t), blob->code.data(), &module) != SPV_REFLECT_RESULT_SUCCESS) {
+            throw std::runtime_error("Failed to reflect SPIR-V!");
+        }
+
+        blob->stage = static_cast<VkShaderStageFlagBits>(module.shader_stage);
+
+        uint32_t count = 0;
+        spvReflectEnumerateDescriptorSets(&module, &count, nullptr);
+        std::vector<SpvReflectDescriptorSet*> sets(count);
+        spvReflectEnumerateDescriptorSets(&module, &count, sets.data());
+
+        for (const auto& set : sets) {
+            for (uint32_t i = 0; i < set->binding_count; ++i) {
+                const auto& binding = *set->bindings[i];
+                blob->bindings.push_back({
+                    set->set,
+                    binding.binding,
+                    static_cast<VkDescriptorType>(binding.descriptor_type),
+                    binding.count,
+                    static_cast<VkShaderStageFlags>(module.shader_stage)
+                });
+            }
+        }
+
+        count = 0;
+        spvReflectEnumeratePushConstantBlocks(&module, &count, nullptr);
+        std::vector<SpvReflectBlockVariable*> blocks(count);
+        spvReflectEnumeratePushConstantBlocks(&module, &count, blocks.data());
+
+        for (const auto& block : blocks) {
+            blob->pushConstants.push_back({
+                static_cast<VkShaderStageFlags>(module.shader_stage),
+                block->offset,
+                block->size
+            });
+        }
+
+        spvReflectDestroyShaderModule(&module);
+        return blob;
+    }
+}
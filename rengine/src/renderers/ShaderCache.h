@@ -0,0 +1,66 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace REngine {
+    struct ShaderDescriptorBinding {
+        uint32_t set;
+        uint32_t binding;
+        VkDescriptorType type;
+        uint32_t count;
+        VkShaderStageFlags stageFlags;
+    };
+
+    // SPIR-V code together with its reflection results
+    struct ShaderBlob {
+        uint64_t hash = 0;
+        std::vector<uint32_t> code;
+        VkShaderStageFlagBits stage = VK_SHADER_STAGE_VERTEX_BIT;
+        std::vector<ShaderDescriptorBinding> bindings;
+        std::vector<VkPushConstantRange> pushConstants;
+    };
+
+    // Content-hashed cache of SPIR-V blobs. Identical code is reflected once no
+    // matter how many paths or shaders refer to it. Files are read and hashed on
+    // every load, so one rewritten within the timestamp resolution is never
+    // served stale; only reflection is skipped. Thread-safe.
+    class ShaderCache {
+    public:
+        ShaderCache() = default;
+
+        // Disable copying
+        ShaderCache(const ShaderCache&) = delete;
+        ShaderCache& operator=(const ShaderCache&) = delete;
+
+        std::shared_ptr<const ShaderBlob> Load(const std::string& path);
+        std::shared_ptr<const ShaderBlob> Load(std::vector<uint32_t> code);
+
+        // Code in memory owned elsewhere, e.g. a mapped asset pack. Hits copy
+        // nothing, misses copy the code once into the new blob.
+        std::shared_ptr<const ShaderBlob> Load(const uint32_t* code, size_t wordCount);
+
+        void Clear();
+
+        [[nodiscard]] uint32_t GetBlobCount() const;
+        [[nodiscard]] uint32_t GetHitCount() const { return m_hits; }
+        [[nodiscard]] uint32_t GetMissCount() const { return m_misses; }
+
+    private:
+        static std::shared_ptr<ShaderBlob> Reflect(std::vector<uint32_t> code, uint64_t hash);
+
+        // Counts a hit when found
+        std::shared_ptr<const ShaderBlob> Find(uint64_t hash, const uint32_t* code, size_t wordCount);
+        std::shared_ptr<const ShaderBlob> Insert(std::shared_ptr<const ShaderBlob> blob);
+
+        std::unordered_map<uint64_t, std::shared_ptr<const ShaderBlob>> m_blobs;
+        std::atomic<uint32_t> m_hits{0};
+        std::atomic<uint32_t> m_misses{0};
+        mutable std::mutex m_mutex;
+    };
+}
@@ -0,0 +1,194 @@
+﻿#include "ShaderHotReloader.h"
+#include <renderers/VulkanRenderer.h>
+#include <iostream>
+
+namespace REngine {
+    ShaderHotReloader::~ShaderHotReloader() {
+        Shutdown();
+    }
+
+    void ShaderHotReloader::Initialize(VulkanRenderer& renderer) {
+        m_renderer = &renderer;
+        m_device = renderer.GetDevice();
+        m_shaderCache = &renderer.GetShaderCache();
+        m_worker = std::make_unique<RThreadPool>(1);
+        SetEnabled(m_enabled);
+    }
+
+    void ShaderHotReloader::Shutdown() {
+        if (m_device == VK_NULL_HANDLE) {
+            return;
+        }
+
+        // Stop producing results before throwing the pending ones away
+        m_watcher.reset();
+        m_worker.reset();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (const auto& result : m_results) {
+            DestroyModules(result);
+        }
+        m_results.clear();
+        m_changedPaths.clear();
+
+        m_device = VK_NULL_HANDLE;
+    }
+
+    void ShaderHotReloader::SetEnabled(const bool enabled) {
+        m_enabled = enabled;
+
+        if (!enabled || m_device == VK_NULL_HANDLE) {
+            m_watcher.reset();
+            return;
+        }
+        if (m_watcher) {
+            return;
+        }
+
+        try {
+            m_watcher = std::make_unique<RFileWatcher>([this](const std::string& path) { OnFileChanged(path); });
+            for (const auto& [path, shaders] : m_watchedPaths) {
+                m_watcher->Watch(path);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Shader hot reload disabled: " << e.what() << std::endl;
+            m_watcher.reset();
+        }
+    }
+
+    uint64_t ShaderHotReloader::Register(Shader& shader) {
+        const uint64_t id = m_nextShaderId++;
+        m_shaders[id] = &shader;
+        return id;
+    }
+
+    void ShaderHotReloader::Unregister(const Shader& shader) {
+        for (const auto& [stage, path] : shader.m_paths) {
+            Unwatch(shader, path);
+        }
+        m_shaders.erase(shader.m_reloadId);
+    }
+
+    void ShaderHotReloader::Watch(const Shader& shader, const std::string& path) {
+        const std::string file = RFileWatcher::NormalizePath(path);
+
+        auto& shaders = m_watchedPaths[file];
+        if (shaders.empty() && m_watcher) {
+            try {
+                m_watcher->Watch(file);
+            } catch (const std::exception& e) {
+                std::cerr << "Shader hot reload: " << e.what() << std::endl;
+            }
+        }
+        shaders.insert(shader.m_reloadId);
+    }
+
+    void ShaderHotReloader::Unwatch(const Shader& shader, const std::string& path) {
+        const std::string file = RFileWatcher::NormalizePath(path);
+
+        const auto it = m_watchedPaths.find(file);
+        if (it == m_watchedPaths.end()) {
+            return;
+        }
+        it->second.erase(shader.m_reloadId);
+        if (it->second.empty()) {
+            m_watchedPaths.erase(it);
+            if (m_watcher) {
+                m_watcher->Unwatch(file);
+            }
+        }
+    }
+
+    void ShaderHotReloader::Request(const Shader& shader) {
+        if (!m_worker || shader.m_paths.empty()) {
+            return;
+        }
+
+        m_worker->Submit([this, shaderId = shader.m_reloadId, paths = shader.m_paths]() {
+            // Published only once every stage built, so Update() never pairs a new
+            // stage with an old one whose interface may no longer match
+            Result result{shaderId, {}};
+            for (const auto& [stage, path] : paths) {
+                try {
+                    std::shared_ptr<const ShaderBlob> blob = m_shaderCache->Load(path);
+
+                    VkShaderModuleCreateInfo createInfo{};
+                    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+                    createInfo.codeSize = blob->code.size() * sizeof(uint32_t);
+                    createInfo.pCode = blob->code.data();
+
+                    VkShaderModule module;
+                    if (vkCreateShaderModule(m_device, &createInfo, nullptr, &module) != VK_SUCCESS) {
+                        throw std::runtime_error("Failed to create shader module!");
+                    }
+                    result.stages.push_back({stage, std::move(blob), module});
+                } catch (const std::exception& e) {
+                    // Keep running with the previous modules
+                    std::cerr << "Shader reload failed (" << path << "): " << e.what() << std::endl;
+                    DestroyModules(result);
+                    return;
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.push_back(std::move(result));
+        });
+    }
+
+    void ShaderHotReloader::DestroyModules(const Result& result) const {
+        for (const auto& stage : result.stages) {
+            vkDestroyShaderModule(m_device, stage.module, nullptr);
+        }
+    }
+
+    void ShaderHotReloader::OnFileChanged(const std::string& path) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_changedPaths.insert(path);
+    }
+
+    void ShaderHotReloader::Update() {
+        std::unordered_set<std::string> changedPaths;
+        std::vector<Result> results;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            changedPaths.swap(m_changedPaths);
+            results.swap(m_results);
+        }
+
+        std::unordered_set<uint64_t> requested;
+        for (const auto& path : changedPaths) {
+            const auto it = m_watchedPaths.find(path);
+            if (it == m_watchedPaths.end()) {
+                continue;
+            }
+            for (const uint64_t id : it->second) {
+                if (requested.insert(id).second) {
+                    Request(*m_shaders[id]);
+                }
+            }
+        }
+
+        std::unordered_set<Shader*> reloaded;
+        for (auto& result : results) {
+            const auto it = m_shaders.find(result.shaderId);
+            if (it == m_shaders.end()) {
+                // The shader was destroyed while its reload was in flight
+                DestroyModules(result);
+                continue;
+            }
+            for (auto& stage : result.stages) {
+                it->second->SwapModule(stage.stage, std::move(stage.blob), stage.module);
+            }
+            reloaded.insert(it->second);
+        }
+
+        for (Shader* shader : reloaded) {
+            try {
+                shader->FinishReload();
+            } catch (const std::exception& e) {
+                std::cerr << "Shader reload failed: " << e.what() << std::endl;
+            }
+            m_reloadCount++;
+        }
+    }
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <RFileWatcher.h>
+#include <RThreadPool.h>
+#include <renderers/Shader.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace REngine {
+    class VulkanRenderer;
+
+    // Reloads shaders whose SPIR-V files change on disk. Reading, reflection and
+    // module creation run on a worker thread; Update() swaps the new modules in
+    // at the frame boundary and hands the old ones to VulkanRenderer::Retire()
+    // so frames still in flight keep using them. Nothing here waits on the GPU.
+    class ShaderHotReloader {
+    public:
+        ShaderHotReloader() = default;
+        ~ShaderHotReloader();
+
+        // Disable copying
+        ShaderHotReloader(const ShaderHotReloader&) = delete;
+        ShaderHotReloader& operator=(const ShaderHotReloader&) = delete;
+
+        void Initialize(VulkanRenderer& renderer);
+        void Shutdown();
+
+        // Starts or stops watching files. Reload() still works while disabled.
+        void SetEnabled(bool enabled);
+        [[nodiscard]] bool IsEnabled() const { return m_enabled; }
+
+        uint64_t Register(Shader& shader);
+        void Unregister(const Shader& shader);
+        void Watch(const Shader& shader, const std::string& path);
+        void Unwatch(const Shader& shader, const std::string& path);
+
+        // Queues a background reload of every stage of the shader. The stages are
+        // swapped in together, and not at all if any of them fails.
+        void Request(const Shader& shader);
+
+        // Applies finished reloads and queues reloads for changed files.
+        // Call on the render thread between frames.
+        void Update();
+
+        [[nodiscard]] uint32_t GetReloadCount() const { return m_reloadCount; }
+
+    private:
+        struct StageModule {
+            Shader::Stage stage;
+            std::shared_ptr<const ShaderBlob> blob;
+            VkShaderModule module;
+        };
+
+        // Every stage of one shader
+        struct Result {
+            uint64_t shaderId;
+            std::vector<StageModule> stages;
+        };
+
+        void DestroyModules(const Result& result) const;
+
+        void OnFileChanged(const std::string& path);
+
+        VulkanRenderer* m_renderer = nullptr;
+        VkDevice m_device = VK_NULL_HANDLE;
+        ShaderCache* m_shaderCache = nullptr;
+
+        std::unique_ptr<RThreadPool> m_worker;
+        std::unique_ptr<RFileWatcher> m_watcher;
+        bool m_enabled = true;
+
+        // Render thread only
+        uint64_t m_nextShaderId = 1;
+        std::unordered_map<uint64_t, Shader*> m_shaders;
+        std::unordered_map<std::string, std::unordered_set<uint64_t>> m_watchedPaths;
+        uint32_t m_reloadCount = 0;
+
+        // Shared with the worker and watcher threads
+        std::mutex m_mutex;
+        std::vector<Result> m_results;
+        std::unordered_set<std::string> m_changedPaths;
+    };
+}
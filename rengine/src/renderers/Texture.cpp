@@ -4,7 +4,12 @@
 #include <stb_image.h>
 #include <stdexcept>
 #include <algorithm>
+#include <functional>
 #include <VulkanBuffer.h>
+#include <VulkanMipGenerator.h>
+#include <VulkanUploadManager.h>
+#include <RProfiler.h>
+#include <renderers/VulkanRenderer.h>
 
 using REngine::VulkanBuffer;
 
@@ -13,14 +18,32 @@ namespace REngine {
 
     Texture::~Texture() {
         if (m_device) {
-            vkDestroySampler(m_device, m_sampler, nullptr);
-            vkDestroyImageView(m_device, m_imageView, nullptr);
-            vkDestroyImage(m_device, m_image, nullptr);
-            vkFreeMemory(m_device, m_memory, nullptr);
+            // The upload may still be reading from or writing to the image
+            WaitUntilReady();
+            if (m_uploadManager) {
+                m_uploadManager->Wait(m_streamUpload);
+            }
+
+            // Frames in flight may still sample it
+            m_renderer->Retire([device = m_device, allocator = m_allocator, table = m_bindlessTable,
+                                index = m_bindlessIndex, image = m_image, view = m_imageView,
+                                allocation = m_allocation]() mutable {
+                if (table) {
+                    table->Unregister(index);
+                }
+                vkDestroyImageView(device, view, nullptr);
+                vkDestroyImage(device, image, nullptr);
+                allocator->Free(allocation);
+            });
         }
     }
 
-    void Texture::CreateFromFile(VkDevice device, VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const std::string& path, VkFormat format, bool generateMipmaps){
+    void Texture::CreateFromFile(VulkanRenderer& renderer, const std::string& path, VkFormat format, bool generateMipmaps){
+        if (TextureFile::IsContainer(path)) {
+            CreateFromFileData(renderer, TextureFile::Load(path), generateMipmaps);
+            return;
+        }
+
         // Load image data
         int texWidth, texHeight, texChannels;
         stbi_uc* pixels = stbi_load(path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
@@ -29,36 +52,105 @@ namespace REngine {
             throw std::runtime_error("Failed to load texture image: " + path);
         }
 
-        CreateFromData(device, physicalDevice, commandPool, queue,
+        CreateFromData(renderer,
                      pixels, texWidth, texHeight, format, generateMipmaps);
 
         stbi_image_free(pixels);
     }
 
-    void Texture::CreateFromData(VkDevice device,VkPhysicalDevice physicalDevice, VkCommandPool commandPool, VkQueue queue, const void* pixels,uint32_t width, uint32_t height,VkFormat format, bool generateMipmaps){
+    void Texture::CreateFromData(VulkanRenderer& renderer, const void* pixels,uint32_t width, uint32_t height,VkFormat format, bool generateMipmaps){
+        RPROFILE_SCOPE("Texture::CreateFromData");
+
+        TextureLevel level;
+        level.size = static_cast<VkDeviceSize>(width) * height * 4;
+        level.width = width;
+        level.height = height;
+        CreateImage(renderer, static_cast<const uint8_t*>(pixels), {level}, format, generateMipmaps);
+    }
+
+    void Texture::CreateFromFileData(VulkanRenderer& renderer, const TextureFileData& data, bool generateMipmaps) {
+        CreateFromFileData(renderer, data, data.bytes.data(), generateMipmaps);
+    }
+
+    void Texture::CreateFromFileData(VulkanRenderer& renderer, const TextureFileData& header, const uint8_t* texels,
+                                     bool generateMipmaps) {
+        RPROFILE_SCOPE("Texture::CreateFromFileData");
+
+        if (header.levels.empty()) {
+            throw std::runtime_error("Texture file data has no levels!");
+        }
+        if (!SupportsFormat(renderer, header.format)) {
+            throw std::runtime_error("Texture format " + std::to_string(header.format) + " is not supported by the device!");
+        }
+
+        // Block-compressed images can be neither blitted into nor written by the downsampler
+        generateMipmaps = generateMipmaps && header.levels.size() == 1 && !TextureFile::IsCompressed(header.format);
+        CreateImage(renderer, texels, header.levels, header.format, generateMipmaps);
+    }
+
+    void Texture::CreateFromPack(VulkanRenderer& renderer, const RAssetPack& pack, const std::string& name,
+                                 VkFormat format, bool generateMipmaps) {
+        RPROFILE_SCOPE("Texture::CreateFromPack");
+
+        // Compressed entries need a copy to decompress into, the rest is used in place
+        const PackEntry& entry = pack.Get(name);
+        std::vector<uint8_t> decompressed;
+        const uint8_t* bytes = nullptr;
+        if (entry.codec == PackCodec::None) {
+            bytes = pack.GetView(entry);
+        } else {
+            decompressed.resize(entry.size);
+            pack.ReadInto(entry, decompressed.data());
+            bytes = decompressed.data();
+        }
+
+        if (TextureFile::IsContainer(name)) {
+            const TextureFileData header = TextureFile::ParseHeader(bytes, entry.size, name);
+            CreateFromFileData(renderer, header, bytes, generateMipmaps);
+            return;
+        }
+
+        int texWidth, texHeight, texChannels;
+        stbi_uc* pixels = stbi_load_from_memory(bytes, static_cast<int>(entry.size), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        if (!pixels) {
+            throw std::runtime_error("Failed to load texture image: " + name);
+        }
+        CreateFromData(renderer, pixels, texWidth, texHeight, format, generateMipmaps);
+        stbi_image_free(pixels);
+    }
+
+    bool Texture::SupportsFormat(VulkanRenderer& renderer, VkFormat format) {
+        VkFormatProperties properties{};
+        vkGetPhysicalDeviceFormatProperties(renderer.GetPhysicalDevice(), format, &properties);
+        return (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) != 0;
+    }
+
+    void Texture::CreateImage(VulkanRenderer& renderer, const uint8_t* source, const std::vector<TextureLevel>& levels,
+                              VkFormat format, bool generateMipmaps) {
+        VulkanAllocator& allocator = renderer.GetAllocator();
+        VulkanUploadManager& uploadManager = renderer.GetUploadManager();
+        VulkanMipGenerator& mipGenerator = renderer.GetMipGenerator();
+        VkDevice device = allocator.GetDevice();
+        const uint32_t width = levels[0].width;
+        const uint32_t height = levels[0].height;
+        m_renderer = &renderer;
+        m_allocator = &allocator;
         m_device = device;
         m_width = width;
         m_height = height;
         m_format = format;
         m_mipLevels = generateMipmaps ?
-            static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1 : 1;
-
-        // Create staging buffer
-        VkDeviceSize imageSize = width * height * 4;
-        VulkanBuffer stagingBuffer;
-        stagingBuffer.Create(
-            device,
-            physicalDevice,
-            imageSize,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
-        );
-
-        // Copy pixel data
-        void* data;
-        vkMapMemory(device, stagingBuffer.GetMemory(), 0, imageSize, 0, &data);
-        memcpy(data, pixels, static_cast<size_t>(imageSize));
-        vkUnmapMemory(device, stagingBuffer.GetMemory());
+            static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1 :
+            static_cast<uint32_t>(levels.size());
+
+        // Levels share one staging region, each at a 16 byte offset, which
+        // satisfies the copy alignment of every supported block size
+        std::vector<TextureLevel> staged = levels;
+        VkDeviceSize imageSize = 0;
+        for (TextureLevel& level : staged) {
+            level.offset = imageSize;
+            imageSize += (level.size + 15) & ~VkDeviceSize(15);
+        }
 
         // Create Vulkan image
         VkImageCreateInfo imageInfo{};
@@ -75,6 +167,9 @@ namespace REngine {
         imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
                          VK_IMAGE_USAGE_TRANSFER_DST_BIT |
                          VK_IMAGE_USAGE_SAMPLED_BIT;
+        if (generateMipmaps) {
+            mipGenerator.GetImageRequirements(format, imageInfo.usage, imageInfo.flags);
+        }
         imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
         imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 
@@ -82,43 +177,61 @@ namespace REngine {
             throw std::runtime_error("Failed to create image!");
         }
 
-        // Allocate memory
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(device, m_image, &memRequirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(
-            physicalDevice,
-            memRequirements.memoryTypeBits,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-        );
-
-        if (vkAllocateMemory(device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate image memory!");
+        // Allocate and bind memory
+        m_allocation = allocator.AllocateForImage(m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        // Record the copy into the open upload batch. Mip generation needs the
+        // graphics queue, so with a dedicated transfer queue the image changes
+        // queue family ownership between the two halves.
+        const uint32_t transferFamily = uploadManager.GetTransferQueueFamily();
+        const uint32_t graphicsFamily = uploadManager.GetGraphicsQueueFamily();
+
+        // sRGB formats hold colors, their mips are weighted by alpha. UNORM data
+        // may keep something unrelated in alpha and is averaged channel by channel.
+        MipChainDesc mipChain;
+        mipChain.image = m_image;
+        mipChain.format = format;
+        mipChain.extent = {width, height};
+        mipChain.mipLevels = m_mipLevels;
+        mipChain.alphaWeighted = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_B8G8R8A8_SRGB;
+        std::function<void()> releaseMips;
+
+        m_uploadManager = &uploadManager;
+        m_uploadHandle = uploadManager.Upload(imageSize,
+            [&](const StagingRegion& staging, VkCommandBuffer transfer, VkCommandBuffer graphics) {
+                for (size_t i = 0; i < staged.size(); i++) {
+                    memcpy(static_cast<uint8_t*>(staging.mapped) + staged[i].offset,
+                           source + levels[i].offset, static_cast<size_t>(levels[i].size));
+                }
+
+                TransitionImageLayout(transfer, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+                CopyBufferToImage(transfer, staging.buffer, staging.offset, staged);
+
+                if (transferFamily != graphicsFamily) {
+                    TransferQueueOwnership(transfer, transferFamily, graphicsFamily, true);
+                    TransferQueueOwnership(graphics, transferFamily, graphicsFamily, false);
+                }
+
+                if (generateMipmaps) {
+                    releaseMips = mipGenerator.Generate(graphics, mipChain);
+                } else {
+                    TransitionImageLayout(graphics, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+                }
+            });
+        if (releaseMips) {
+            uploadManager.ReleaseAfter(m_uploadHandle, std::move(releaseMips));
         }
 
-        vkBindImageMemory(device, m_image, m_memory, 0);
-
-        // Transfer layout and copy data
-        VkCommandBuffer cmd = BeginSingleTimeCommands(device, commandPool);
-        {
-            TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-            CopyBufferToImage(cmd, stagingBuffer.GetBuffer());
-
-            if (generateMipmaps) {
-                GenerateMipmaps(cmd, physicalDevice);
-            } else {
-                TransitionImageLayout(cmd, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                                   VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-            }
-        }
-        EndSingleTimeCommands(device, commandPool, queue, cmd);
+        // Create image view. Images the mip generator writes through another
+        // format carry a storage usage this format may not support.
+        VkImageViewUsageCreateInfo viewUsage{};
+        viewUsage.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO;
+        viewUsage.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
 
-        // Create image view
         VkImageViewCreateInfo viewInfo{};
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.pNext = (imageInfo.flags & VK_IMAGE_CREATE_EXTENDED_USAGE_BIT) ? &viewUsage : nullptr;
         viewInfo.image = m_image;
         viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
         viewInfo.format = format;
@@ -132,11 +245,15 @@ namespace REngine {
             throw std::runtime_error("Failed to create texture image view!");
         }
 
-        // Create sampler
-        CreateSampler();
+        // Every texture uses the same sampler, the layout cache hands out one for all
+        CreateSampler(renderer.GetLayoutCache());
+
+        // Shaders can sample it by index once IsReady()
+        m_bindlessTable = &renderer.GetBindlessTable();
+        m_bindlessIndex = m_bindlessTable->Register(m_imageView, m_sampler);
     }
 
-    void Texture::CreateSampler() {
+    void Texture::CreateSampler(VulkanLayoutCache& layoutCache) {
         VkSamplerCreateInfo samplerInfo{};
         samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
         samplerInfo.magFilter = VK_FILTER_LINEAR;
@@ -152,97 +269,10 @@ namespace REngine {
         samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
         samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
         samplerInfo.minLod = 0.0f;
-        samplerInfo.maxLod = static_cast<float>(m_mipLevels);
+        samplerInfo.maxLod = VK_LOD_CLAMP_NONE;  // The view limits the levels, streaming changes their count
         samplerInfo.mipLodBias = 0.0f;
 
-        if (vkCreateSampler(m_device, &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to create texture sampler!");
-        }
-    }
-
-    void Texture::GenerateMipmaps(VkCommandBuffer cmd, VkPhysicalDevice physicalDevice) {
-        // Check if image format supports linear blitting
-        VkFormatProperties formatProperties;
-        vkGetPhysicalDeviceFormatProperties(physicalDevice, m_format, &formatProperties);
-
-        if (!(formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT)) {
-            throw std::runtime_error("Texture image format does not support linear blitting!");
-        }
-
-        VkImageMemoryBarrier barrier{};
-        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-        barrier.image = m_image;
-        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        barrier.subresourceRange.baseArrayLayer = 0;
-        barrier.subresourceRange.layerCount = 1;
-        barrier.subresourceRange.levelCount = 1;
-
-        int32_t mipWidth = m_width;
-        int32_t mipHeight = m_height;
-
-        for (uint32_t i = 1; i < m_mipLevels; i++) {
-            barrier.subresourceRange.baseMipLevel = i - 1;
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-
-            vkCmdPipelineBarrier(cmd,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier);
-
-            VkImageBlit blit{};
-            blit.srcOffsets[0] = {0, 0, 0};
-            blit.srcOffsets[1] = {mipWidth, mipHeight, 1};
-            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.srcSubresource.mipLevel = i - 1;
-            blit.srcSubresource.baseArrayLayer = 0;
-            blit.srcSubresource.layerCount = 1;
-            blit.dstOffsets[0] = {0, 0, 0};
-            blit.dstOffsets[1] = {mipWidth > 1 ? mipWidth / 2 : 1,
-                                 mipHeight > 1 ? mipHeight / 2 : 1, 1};
-            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-            blit.dstSubresource.mipLevel = i;
-            blit.dstSubresource.baseArrayLayer = 0;
-            blit.dstSubresource.layerCount = 1;
-
-            vkCmdBlitImage(cmd,
-                m_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
-                m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-                1, &blit,
-                VK_FILTER_LINEAR);
-
-            barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-            barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-            vkCmdPipelineBarrier(cmd,
-                VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-                0, nullptr,
-                0, nullptr,
-                1, &barrier);
-
-            if (mipWidth > 1) mipWidth /= 2;
-            if (mipHeight > 1) mipHeight /= 2;
-        }
-
-        // Transition last mip level
-        barrier.subresourceRange.baseMipLevel = m_mipLevels - 1;
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-
-        vkCmdPipelineBarrier(cmd,
-            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
-            0, nullptr,
-            0, nullptr,
-            1, &barrier);
+        m_sampler = layoutCache.GetSampler(samplerInfo);
     }
 
     void Texture::TransitionImageLayout(VkCommandBuffer cmd, VkImageLayout oldLayout, VkImageLayout newLayout) {
@@ -288,25 +318,58 @@ namespace REngine {
         );
     }
 
-    void Texture::CopyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer) {
-        VkBufferImageCopy region{};
-        region.bufferOffset = 0;
-        region.bufferRowLength = 0;
-        region.bufferImageHeight = 0;
-        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-        region.imageSubresource.mipLevel = 0;
-        region.imageSubresource.baseArrayLayer = 0;
-        region.imageSubresource.layerCount = 1;
-        region.imageOffset = {0, 0, 0};
-        region.imageExtent = {m_width, m_height, 1};
+    void Texture::TransferQueueOwnership(VkCommandBuffer cmd, uint32_t srcFamily, uint32_t dstFamily, bool release) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+        barrier.image = m_image;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = m_mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+
+        // Release and acquire halves must describe the same transfer
+        barrier.srcAccessMask = release ? VK_ACCESS_TRANSFER_WRITE_BIT : 0;
+        barrier.dstAccessMask = release ? 0 : VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(
+            cmd,
+            release ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            release ? VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT : VK_PIPELINE_STAGE_TRANSFER_BIT,
+            0,
+            0, nullptr,
+            0, nullptr,
+            1, &barrier
+        );
+    }
+
+    void Texture::CopyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize bufferOffset,
+                                    const std::vector<TextureLevel>& levels) {
+        std::vector<VkBufferImageCopy> regions(levels.size());
+        for (size_t i = 0; i < levels.size(); i++) {
+            VkBufferImageCopy& region = regions[i];
+            region.bufferOffset = bufferOffset + levels[i].offset;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = static_cast<uint32_t>(i);
+            region.imageSubresource.baseArrayLayer = 0;
+            region.imageSubresource.layerCount = 1;
+            region.imageOffset = {0, 0, 0};
+            region.imageExtent = {levels[i].width, levels[i].height, 1};
+        }
 
         vkCmdCopyBufferToImage(
             cmd,
             buffer,
             m_image,
             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-            1,
-            &region
+            static_cast<uint32_t>(regions.size()),
+            regions.data()
         );
     }
 }
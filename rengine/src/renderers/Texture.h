@@ -1,35 +1,42 @@
 ﻿#pragma once
 #include <vulkan/vulkan.h>
+#include <VulkanAllocator.h>
+#include <VulkanBindlessTable.h>
+#include <VulkanLayoutCache.h>
+#include <VulkanUploadManager.h>
+#include <RAssetPack.h>
+#include <renderers/TextureFile.h>
 #include <glm.hpp>
 #include <string>
 #include <memory>
+#include <vector>
 
 namespace REngine {
+    class VulkanRenderer;
+    class TextureStreamer;
+
     class Texture {
     public:
         Texture();
+
+        // Hands the image to VulkanRenderer::Retire(), so destroy on the render thread
         ~Texture();
 
         // Disable copying
         Texture(const Texture&) = delete;
         Texture& operator=(const Texture&) = delete;
 
-        // Creation methods
+        // Creation methods. KTX2 and DDS files keep their own format and mips,
+        // format only applies to images decoded to RGBA8.
         void CreateFromFile(
-            VkDevice device,
-            VkPhysicalDevice physicalDevice,
-            VkCommandPool commandPool,
-            VkQueue queue,
+            VulkanRenderer& renderer,
             const std::string& path,
             VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
             bool generateMipmaps = true
         );
 
         void CreateFromData(
-            VkDevice device,
-            VkPhysicalDevice physicalDevice,
-            VkCommandPool commandPool,
-            VkQueue queue,
+            VulkanRenderer& renderer,
             const void* pixels,
             uint32_t width,
             uint32_t height,
@@ -37,8 +44,43 @@ namespace REngine {
             bool generateMipmaps = true
         );
 
-        // Bindless support
-        void SetBindlessIndex(uint32_t index) { m_bindlessIndex = index; }
+        // Uploads every level in data. Mips are generated only for single-level
+        // uncompressed data; block-compressed formats keep the levels they came with.
+        void CreateFromFileData(
+            VulkanRenderer& renderer,
+            const TextureFileData& data,
+            bool generateMipmaps = true
+        );
+
+        // Same, with the level offsets of header relative to texels, e.g. a mapped file
+        void CreateFromFileData(
+            VulkanRenderer& renderer,
+            const TextureFileData& header,
+            const uint8_t* texels,
+            bool generateMipmaps = true
+        );
+
+        // Uncompressed KTX2 and DDS entries are copied from the pack's mapping
+        // straight into staging memory. format as for CreateFromFile.
+        void CreateFromPack(
+            VulkanRenderer& renderer,
+            const RAssetPack& pack,
+            const std::string& name,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            bool generateMipmaps = true
+        );
+
+        // Whether the device can sample images of this format with optimal tiling
+        static bool SupportsFormat(VulkanRenderer& renderer, VkFormat format);
+
+        // Upload state. Creation only records the upload; it reaches the GPU at the
+        // next upload flush (at the latest in VulkanRenderer::EndFrame).
+        [[nodiscard]] bool IsReady() const { return !m_uploadManager || m_uploadManager->IsComplete(m_uploadHandle); }
+        void WaitUntilReady() const { if (m_uploadManager) m_uploadManager->Wait(m_uploadHandle); }
+        [[nodiscard]] UploadHandle GetUploadHandle() const { return m_uploadHandle; }
+
+        // Element of the renderer's bindless table, assigned on creation and
+        // released on destruction. VulkanBindlessTable::INVALID_INDEX if the table was full.
         uint32_t GetBindlessIndex() const { return m_bindlessIndex; }
 
         // Vulkan resources
@@ -51,26 +93,49 @@ namespace REngine {
         uint32_t GetHeight() const { return m_height; }
         VkFormat GetFormat() const { return m_format; }
 
+        // Device memory of the image
+        VkDeviceSize GetMemorySize() const { return m_allocation.size; }
+
+        // The image holds levels [GetFirstLevel(), GetFirstLevel() + GetMipLevels())
+        // of a chain whose level 0 is GetWidth() x GetHeight(). Only streamed
+        // textures start past level 0, see TextureStreamer.
+        uint32_t GetFirstLevel() const { return m_firstLevel; }
+        uint32_t GetMipLevels() const { return m_mipLevels; }
+
     private:
-        void CreateSampler();
-        void GenerateMipmaps(VkCommandBuffer cmd, VkPhysicalDevice physicalDevice);
+        // Swaps the image, view and bindless index as levels stream in and out
+        friend class TextureStreamer;
+
+        // levels hold offsets into source, largest first
+        void CreateImage(VulkanRenderer& renderer, const uint8_t* source, const std::vector<TextureLevel>& levels,
+                         VkFormat format, bool generateMipmaps);
+        void CreateSampler(VulkanLayoutCache& layoutCache);
         void TransitionImageLayout(VkCommandBuffer cmd, VkImageLayout oldLayout, VkImageLayout newLayout);
-        void CopyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer);
+        void TransferQueueOwnership(VkCommandBuffer cmd, uint32_t srcFamily, uint32_t dstFamily, bool release);
+        void CopyBufferToImage(VkCommandBuffer cmd, VkBuffer buffer, VkDeviceSize bufferOffset,
+                               const std::vector<TextureLevel>& levels);
 
-        // Vulkan resources
+        // Vulkan resources, destroyed through VulkanRenderer::Retire()
+        VulkanRenderer* m_renderer = nullptr;
+        VulkanAllocator* m_allocator = nullptr;
         VkDevice m_device = VK_NULL_HANDLE;
         VkImage m_image = VK_NULL_HANDLE;
         VkImageView m_imageView = VK_NULL_HANDLE;
-        VkDeviceMemory m_memory = VK_NULL_HANDLE;
-        VkSampler m_sampler = VK_NULL_HANDLE;
+        VulkanAllocation m_allocation;
+        VulkanUploadManager* m_uploadManager = nullptr;
+        UploadHandle m_uploadHandle;
+        UploadHandle m_streamUpload;  // Level change reading from the image
+        VkSampler m_sampler = VK_NULL_HANDLE;  // Shared, owned by the layout cache
 
         // Texture properties
         uint32_t m_width = 0;
         uint32_t m_height = 0;
         uint32_t m_mipLevels = 1;
+        uint32_t m_firstLevel = 0;
         VkFormat m_format = VK_FORMAT_UNDEFINED;
 
         // Bindless support
-        uint32_t m_bindlessIndex = UINT32_MAX;
+        VulkanBindlessTable* m_bindlessTable = nullptr;
+        uint32_t m_bindlessIndex = VulkanBindlessTable::INVALID_INDEX;
     };
 }
\ No newline at end of file
@@ -0,0 +1,536 @@
+﻿#include "TextureFile.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace REngine {
+    namespace {
+        constexpr uint8_t KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+        constexpr size_t KTX2_HEADER_SIZE = 80;
+        constexpr size_t KTX2_LEVEL_ENTRY_SIZE = 24;
+        constexpr size_t MAX_HEADER_SIZE = 4096;  // Any header and level table
+
+        constexpr uint32_t DDS_MAGIC = 0x20534444;  // "DDS "
+        constexpr size_t DDS_HEADER_SIZE = 128;     // Magic and DDS_HEADER
+        constexpr size_t DDS_DX10_HEADER_SIZE = 20;
+        constexpr uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+        constexpr uint32_t DDPF_FOURCC = 0x4;
+        constexpr uint32_t DDPF_RGB = 0x40;
+        constexpr uint32_t DDSCAPS2_CUBEMAP = 0x200;
+        constexpr uint32_t DDSCAPS2_VOLUME = 0x200000;
+        constexpr uint32_t DDS_DIMENSION_TEXTURE2D = 3;
+        constexpr uint32_t DDS_MISC_TEXTURECUBE = 0x4;
+
+        // Data format descriptor color models and channels (Khronos Data Format 1.3)
+        constexpr uint8_t DF_MODEL_RGBSDA = 1;
+        constexpr uint8_t DF_MODEL_BC1A = 128;
+        constexpr uint8_t DF_MODEL_BC3 = 130;
+        constexpr uint8_t DF_MODEL_BC4 = 131;
+        constexpr uint8_t DF_MODEL_BC5 = 132;
+        constexpr uint8_t DF_MODEL_BC7 = 134;
+        constexpr uint8_t DF_CHANNEL_ALPHA = 15;
+        constexpr uint8_t DF_QUALIFIER_LINEAR = 0x10;
+        constexpr uint8_t DF_PRIMARIES_BT709 = 1;
+        constexpr uint8_t DF_TRANSFER_LINEAR = 1;
+        constexpr uint8_t DF_TRANSFER_SRGB = 2;
+
+        constexpr uint32_t FourCC(const char a, const char b, const char c, const char d) {
+            return static_cast<uint32_t>(a) | static_cast<uint32_t>(b) << 8 |
+                   static_cast<uint32_t>(c) << 16 | static_cast<uint32_t>(d) << 24;
+        }
+
+        template<typename T>
+        T Read(const uint8_t* data, const size_t offset) {
+            T value;
+            std::memcpy(&value, data + offset, sizeof(T));
+            return value;
+        }
+
+        template<typename T>
+        void Append(std::vector<uint8_t>& out, const T value) {
+            const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+            out.insert(out.end(), bytes, bytes + sizeof(T));
+        }
+
+        std::string LowerExtension(const std::string& path) {
+            std::string extension = std::filesystem::path(path).extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            return extension;
+        }
+
+        std::vector<uint8_t> ReadFile(const std::string& path, const size_t maxBytes = SIZE_MAX) {
+            std::ifstream file(path, std::ios::binary | std::ios::ate);
+            if (!file.is_open()) {
+                throw std::runtime_error("Failed to open texture file: " + path);
+            }
+
+            const size_t size = std::min(static_cast<size_t>(file.tellg()), maxBytes);
+            std::vector<uint8_t> bytes(size);
+            file.seekg(0);
+            file.read(reinterpret_cast<char*>(bytes.data()), static_cast<std::streamsize>(size));
+            if (!file) {
+                throw std::runtime_error("Failed to read texture file: " + path);
+            }
+            return bytes;
+        }
+
+        VkFormat FormatFromDxgi(const uint32_t dxgiFormat) {
+            switch (dxgiFormat) {
+                case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+                case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+                case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+                case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+                case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+                case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+                case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+                case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+                case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+                case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+                case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+                case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+                case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+                case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+                case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+                case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+                default: return VK_FORMAT_UNDEFINED;
+            }
+        }
+
+        // Levels of a full mip chain, down to 1x1
+        uint32_t GetMaxLevelCount(uint32_t width, uint32_t height) {
+            uint32_t count = 1;
+            for (uint32_t size = std::max(width, height); size > 1; size >>= 1) {
+                count++;
+            }
+            return count;
+        }
+
+        // Fills levels with tightly packed sizes starting at offset, as DDS stores them
+        void PackLevels(TextureFileData& data, uint32_t levelCount, uint64_t offset) {
+            for (uint32_t level = 0; level < levelCount; level++) {
+                TextureLevel entry;
+                entry.width = std::max(data.width >> level, 1u);
+                entry.height = std::max(data.height >> level, 1u);
+                entry.offset = offset;
+                entry.size = TextureFile::GetLevelSize(data.format, entry.width, entry.height);
+                offset += entry.size;
+                data.levels.push_back(entry);
+            }
+        }
+    }
+
+    bool TextureFile::IsContainer(const std::string& path) {
+        const std::string extension = LowerExtension(path);
+        return extension == ".ktx2" || extension == ".dds";
+    }
+
+    TextureFileData TextureFile::Load(const std::string& path) {
+        return Parse(ReadFile(path), path);
+    }
+
+    TextureFileData TextureFile::Parse(std::vector<uint8_t> bytes, const std::string& name) {
+        TextureFileData data = ParseHeader(bytes.data(), bytes.size(), name);
+        data.bytes = std::move(bytes);
+        return data;
+    }
+
+    TextureFileData TextureFile::ParseHeader(const uint8_t* bytes, const size_t size, const std::string& name) {
+        return ParseHeader(bytes, size, size, name);
+    }
+
+    TextureFileData TextureFile::ParseHeader(const uint8_t* bytes, const size_t size, const uint64_t fileSize, const std::string& name) {
+        if (size >= sizeof(KTX2_IDENTIFIER) && std::memcmp(bytes, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+            return ParseKtx2(bytes, size, fileSize, name);
+        }
+        if (size >= 4 && Read<uint32_t>(bytes, 0) == DDS_MAGIC) {
+            return ParseDds(bytes, size, fileSize, name);
+        }
+        throw std::runtime_error("Unknown texture container: " + name);
+    }
+
+    TextureFileData TextureFile::LoadHeader(const std::string& path) {
+        std::error_code error;
+        const uint64_t fileSize = std::filesystem::file_size(path, error);
+        if (error) {
+            throw std::runtime_error("Failed to open texture file: " + path);
+        }
+
+        const std::vector<uint8_t> header = ReadFile(path, MAX_HEADER_SIZE);
+        return ParseHeader(header.data(), header.size(), fileSize, path);
+    }
+
+    TextureFileData TextureFile::ReadLevels(const std::string& path, const TextureFileData& header,
+                                            const uint32_t first, const uint32_t count) {
+        if (count == 0 || first + count > header.levels.size()) {
+            throw std::runtime_error("Texture levels out of range: " + path);
+        }
+
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open texture file: " + path);
+        }
+
+        TextureFileData data;
+        data.format = header.format;
+        data.width = header.levels[first].width;
+        data.height = header.levels[first].height;
+        for (uint32_t level = first; level < first + count; level++) {
+            TextureLevel entry = header.levels[level];
+            file.seekg(static_cast<std::streamoff>(entry.offset));
+            entry.offset = data.bytes.size();
+            data.bytes.resize(static_cast<size_t>(entry.offset + entry.size));
+            file.read(reinterpret_cast<char*>(data.bytes.data() + entry.offset), static_cast<std::streamsize>(entry.size));
+            if (!file) {
+                throw std::runtime_error("Failed to read texture level " + std::to_string(level) + ": " + path);
+            }
+            data.levels.push_back(entry);
+        }
+        return data;
+    }
+
+    VkFormat TextureFile::ReadFormat(const std::string& path) {
+        const std::vector<uint8_t> header = ReadFile(path, DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE);
+        if (header.size() >= sizeof(KTX2_IDENTIFIER) && std::memcmp(header.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0) {
+            return ReadKtx2Format(header.data(), header.size(), path);
+        }
+        if (header.size() >= 4 && Read<uint32_t>(header.data(), 0) == DDS_MAGIC) {
+            return ReadDdsFormat(header.data(), header.size(), path);
+        }
+        throw std::runtime_error("Unknown texture container: " + path);
+    }
+
+    VkFormat TextureFile::ReadKtx2Format(const uint8_t* header, const size_t size, const std::string& name) {
+        if (size < KTX2_HEADER_SIZE) {
+            throw std::runtime_error("Truncated KTX2 header: " + name);
+        }
+
+        const auto format = static_cast<VkFormat>(Read<uint32_t>(header, 12));
+        const uint32_t supercompression = Read<uint32_t>(header, 44);
+        if (format == VK_FORMAT_UNDEFINED || supercompression != 0) {
+            throw std::runtime_error("Supercompressed KTX2 files are not supported: " + name);
+        }
+
+        FormatBlockInfo block;
+        if (!GetBlockInfo(format, block)) {
+            throw std::runtime_error("Unsupported KTX2 format " + std::to_string(format) + ": " + name);
+        }
+        return format;
+    }
+
+    VkFormat TextureFile::ReadDdsFormat(const uint8_t* header, const size_t size, const std::string& name) {
+        if (size < DDS_HEADER_SIZE) {
+            throw std::runtime_error("Truncated DDS header: " + name);
+        }
+
+        const uint32_t pixelFlags = Read<uint32_t>(header, 80);
+        const uint32_t fourCC = Read<uint32_t>(header, 84);
+
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        if (pixelFlags & DDPF_FOURCC) {
+            if (fourCC == FourCC('D', 'X', '1', '0')) {
+                if (size < DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE) {
+                    throw std::runtime_error("Truncated DDS header: " + name);
+                }
+                format = FormatFromDxgi(Read<uint32_t>(header, DDS_HEADER_SIZE));
+            } else if (fourCC == FourCC('D', 'X', 'T', '1')) {
+                format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+            } else if (fourCC == FourCC('D', 'X', 'T', '3')) {
+                format = VK_FORMAT_BC2_UNORM_BLOCK;
+            } else if (fourCC == FourCC('D', 'X', 'T', '5')) {
+                format = VK_FORMAT_BC3_UNORM_BLOCK;
+            } else if (fourCC == FourCC('A', 'T', 'I', '1') || fourCC == FourCC('B', 'C', '4', 'U')) {
+                format = VK_FORMAT_BC4_UNORM_BLOCK;
+            } else if (fourCC == FourCC('A', 'T', 'I', '2') || fourCC == FourCC('B', 'C', '5', 'U')) {
+                format = VK_FORMAT_BC5_UNORM_BLOCK;
+            }
+        } else if ((pixelFlags & DDPF_RGB) && Read<uint32_t>(header, 88) == 32) {
+            // Byte order from the red mask
+            const uint32_t redMask = Read<uint32_t>(header, 92);
+            if (redMask == 0x000000FF) {
+                format = VK_FORMAT_R8G8B8A8_UNORM;
+            } else if (redMask == 0x00FF0000) {
+                format = VK_FORMAT_B8G8R8A8_UNORM;
+            }
+        }
+
+        if (format == VK_FORMAT_UNDEFINED) {
+            throw std::runtime_error("Unsupported DDS pixel format: " + name);
+        }
+        return format;
+    }
+
+    TextureFileData TextureFile::ParseKtx2(const uint8_t* bytes, const size_t size, const uint64_t fileSize, const std::string& name) {
+        TextureFileData data;
+        data.format = ReadKtx2Format(bytes, size, name);
+        data.width = Read<uint32_t>(bytes, 20);
+        data.height = Read<uint32_t>(bytes, 24);
+
+        const uint32_t depth = Read<uint32_t>(bytes, 28);
+        const uint32_t layers = Read<uint32_t>(bytes, 32);
+        const uint32_t faces = Read<uint32_t>(bytes, 36);
+        if (data.width == 0 || data.height == 0 || depth > 1 || layers > 1 || faces != 1) {
+            throw std::runtime_error("Only 2D KTX2 textures are supported: " + name);
+        }
+
+        // 0 asks for mips to be generated at load, the file holds the base level only
+        const uint32_t levelCount = std::max(Read<uint32_t>(bytes, 40), 1u);
+        if (levelCount > GetMaxLevelCount(data.width, data.height)) {
+            throw std::runtime_error("Corrupt KTX2 level count: " + name);
+        }
+        if (size < KTX2_HEADER_SIZE + static_cast<uint64_t>(levelCount) * KTX2_LEVEL_ENTRY_SIZE) {
+            throw std::runtime_error("Truncated KTX2 level index: " + name);
+        }
+
+        for (uint32_t level = 0; level < levelCount; level++) {
+            const size_t entry = KTX2_HEADER_SIZE + level * KTX2_LEVEL_ENTRY_SIZE;
+
+            TextureLevel info;
+            info.width = std::max(data.width >> level, 1u);
+            info.height = std::max(data.height >> level, 1u);
+            info.offset = Read<uint64_t>(bytes, entry);
+            info.size = GetLevelSize(data.format, info.width, info.height);
+
+            const uint64_t length = Read<uint64_t>(bytes, entry + 8);
+            if (length < info.size || info.offset > fileSize || length > fileSize - info.offset) {
+                throw std::runtime_error("Corrupt KTX2 level " + std::to_string(level) + ": " + name);
+            }
+            data.levels.push_back(info);
+        }
+
+        return data;
+    }
+
+    TextureFileData TextureFile::ParseDds(const uint8_t* bytes, const size_t size, const uint64_t fileSize, const std::string& name) {
+        TextureFileData data;
+        data.format = ReadDdsFormat(bytes, size, name);
+        data.height = Read<uint32_t>(bytes, 12);
+        data.width = Read<uint32_t>(bytes, 16);
+
+        const uint32_t flags = Read<uint32_t>(bytes, 8);
+        const uint32_t caps2 = Read<uint32_t>(bytes, 112);
+        const bool dx10 = Read<uint32_t>(bytes, 84) == FourCC('D', 'X', '1', '0');
+        if (data.width == 0 || data.height == 0 || (caps2 & (DDSCAPS2_CUBEMAP | DDSCAPS2_VOLUME))) {
+            throw std::runtime_error("Only 2D DDS textures are supported: " + name);
+        }
+        if (dx10 && (Read<uint32_t>(bytes, DDS_HEADER_SIZE + 4) != DDS_DIMENSION_TEXTURE2D ||
+                     (Read<uint32_t>(bytes, DDS_HEADER_SIZE + 8) & DDS_MISC_TEXTURECUBE) ||
+                     Read<uint32_t>(bytes, DDS_HEADER_SIZE + 12) > 1)) {
+            throw std::runtime_error("Only 2D DDS textures are supported: " + name);
+        }
+
+        const uint32_t levelCount = (flags & DDSD_MIPMAPCOUNT) ? std::max(Read<uint32_t>(bytes, 28), 1u) : 1;
+        if (levelCount > GetMaxLevelCount(data.width, data.height)) {
+            throw std::runtime_error("Corrupt DDS mip count: " + name);
+        }
+        PackLevels(data, levelCount, dx10 ? DDS_HEADER_SIZE + DDS_DX10_HEADER_SIZE : DDS_HEADER_SIZE);
+
+        const TextureLevel& last = data.levels.back();
+        if (last.offset + last.size > fileSize) {
+            throw std::runtime_error("Truncated DDS texture data: " + name);
+        }
+
+        return data;
+    }
+
+    void TextureFile::WriteKtx2(const std::string& path, const TextureFileData& data) {
+        FormatBlockInfo block;
+        if (!GetBlockInfo(data.format, block) || data.levels.empty()) {
+            throw std::runtime_error("Cannot write KTX2 texture: " + path);
+        }
+
+        // Data format descriptor, the color model and the channels each sample holds
+        struct Sample {
+            uint16_t bitOffset;
+            uint8_t bitLength;
+            uint8_t channel;
+        };
+        bool srgb = false;
+        uint8_t model = DF_MODEL_RGBSDA;
+        std::vector<Sample> samples;
+        switch (data.format) {
+            case VK_FORMAT_R8G8B8A8_SRGB: srgb = true; [[fallthrough]];
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                samples = {{0, 8, 0}, {8, 8, 1}, {16, 8, 2}, {24, 8, DF_CHANNEL_ALPHA}};
+                break;
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK: srgb = true; [[fallthrough]];
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                model = DF_MODEL_BC1A;
+                samples = {{0, 64, 0}};
+                break;
+            case VK_FORMAT_BC3_SRGB_BLOCK: srgb = true; [[fallthrough]];
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+                model = DF_MODEL_BC3;
+                samples = {{0, 64, DF_CHANNEL_ALPHA}, {64, 64, 0}};
+                break;
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+                model = DF_MODEL_BC4;
+                samples = {{0, 64, 0}};
+                break;
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+                model = DF_MODEL_BC5;
+                samples = {{0, 64, 0}, {64, 64, 1}};
+                break;
+            case VK_FORMAT_BC7_SRGB_BLOCK: srgb = true; [[fallthrough]];
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+                model = DF_MODEL_BC7;
+                samples = {{0, 128, 0}};
+                break;
+            default:
+                throw std::runtime_error("No KTX2 writer for format " + std::to_string(data.format) + ": " + path);
+        }
+
+        std::vector<uint8_t> dfd;
+        const uint32_t blockSize = 24 + 16 * static_cast<uint32_t>(samples.size());
+        Append<uint32_t>(dfd, 4 + blockSize);
+        Append<uint32_t>(dfd, 0);                    // Khronos vendor, basic descriptor type
+        Append<uint32_t>(dfd, 2 | blockSize << 16);  // Version 1.3
+        Append<uint8_t>(dfd, model);
+        Append<uint8_t>(dfd, DF_PRIMARIES_BT709);
+        Append<uint8_t>(dfd, srgb ? DF_TRANSFER_SRGB : DF_TRANSFER_LINEAR);
+        Append<uint8_t>(dfd, 0);                     // Straight alpha
+        Append<uint8_t>(dfd, static_cast<uint8_t>(block.width - 1));
+        Append<uint8_t>(dfd, static_cast<uint8_t>(block.height - 1));
+        Append<uint16_t>(dfd, 0);
+        Append<uint8_t>(dfd, static_cast<uint8_t>(block.bytes));
+        dfd.insert(dfd.end(), 7, 0);
+        for (const Sample& sample : samples) {
+            // sRGB never applies to alpha
+            const bool linear = srgb && sample.channel == DF_CHANNEL_ALPHA;
+            Append<uint16_t>(dfd, sample.bitOffset);
+            Append<uint8_t>(dfd, static_cast<uint8_t>(sample.bitLength - 1));
+            Append<uint8_t>(dfd, static_cast<uint8_t>(sample.channel | (linear ? DF_QUALIFIER_LINEAR : 0)));
+            Append<uint32_t>(dfd, 0);                // Sample position
+            Append<uint32_t>(dfd, 0);                // Lower
+            Append<uint32_t>(dfd, sample.bitLength >= 32 ? UINT32_MAX : (1u << sample.bitLength) - 1);
+        }
+
+        const auto levelCount = static_cast<uint32_t>(data.levels.size());
+        const uint64_t dfdOffset = KTX2_HEADER_SIZE + levelCount * KTX2_LEVEL_ENTRY_SIZE;
+
+        // Levels start on a multiple of the block size, smallest first
+        const uint64_t alignment = std::max<uint64_t>(block.bytes, 4);
+        std::vector<uint64_t> offsets(levelCount);
+        uint64_t offset = dfdOffset + dfd.size();
+        for (uint32_t level = levelCount; level-- > 0;) {
+            offset = (offset + alignment - 1) / alignment * alignment;
+            offsets[level] = offset;
+            offset += data.levels[level].size;
+        }
+
+        std::vector<uint8_t> out;
+        out.reserve(static_cast<size_t>(offset));
+        out.insert(out.end(), std::begin(KTX2_IDENTIFIER), std::end(KTX2_IDENTIFIER));
+        Append<uint32_t>(out, static_cast<uint32_t>(data.format));
+        Append<uint32_t>(out, 1);                    // typeSize, 1 for 8-bit and block formats
+        Append<uint32_t>(out, data.width);
+        Append<uint32_t>(out, data.height);
+        Append<uint32_t>(out, 0);                    // pixelDepth
+        Append<uint32_t>(out, 0);                    // layerCount
+        Append<uint32_t>(out, 1);                    // faceCount
+        Append<uint32_t>(out, levelCount);
+        Append<uint32_t>(out, 0);                    // No supercompression
+        Append<uint32_t>(out, static_cast<uint32_t>(dfdOffset));
+        Append<uint32_t>(out, static_cast<uint32_t>(dfd.size()));
+        Append<uint32_t>(out, 0);                    // No key/value data
+        Append<uint32_t>(out, 0);
+        Append<uint64_t>(out, 0);                    // No supercompression global data
+        Append<uint64_t>(out, 0);
+        for (uint32_t level = 0; level < levelCount; level++) {
+            Append<uint64_t>(out, offsets[level]);
+            Append<uint64_t>(out, data.levels[level].size);
+            Append<uint64_t>(out, data.levels[level].size);
+        }
+        out.insert(out.end(), dfd.begin(), dfd.end());
+
+        for (uint32_t level = levelCount; level-- > 0;) {
+            const TextureLevel& entry = data.levels[level];
+            if (entry.offset + entry.size > data.bytes.size()) {
+                throw std::runtime_error("Texture level outside its data: " + path);
+            }
+            out.resize(static_cast<size_t>(offsets[level]), 0);
+            out.insert(out.end(), data.bytes.begin() + static_cast<std::ptrdiff_t>(entry.offset),
+                       data.bytes.begin() + static_cast<std::ptrdiff_t>(entry.offset + entry.size));
+        }
+
+        std::ofstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to create texture file: " + path);
+        }
+        file.write(reinterpret_cast<const char*>(out.data()), static_cast<std::streamsize>(out.size()));
+        if (!file) {
+            throw std::runtime_error("Failed to write texture file: " + path);
+        }
+    }
+
+    bool TextureFile::GetBlockInfo(const VkFormat format, FormatBlockInfo& info) {
+        switch (format) {
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_B8G8R8A8_UNORM:
+            case VK_FORMAT_B8G8R8A8_SRGB:
+                info = {1, 1, 4};
+                return true;
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC4_UNORM_BLOCK:
+            case VK_FORMAT_BC4_SNORM_BLOCK:
+                info = {4, 4, 8};
+                return true;
+            case VK_FORMAT_BC2_UNORM_BLOCK:
+            case VK_FORMAT_BC2_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC5_UNORM_BLOCK:
+            case VK_FORMAT_BC5_SNORM_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+            case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
+                info = {4, 4, 16};
+                return true;
+            case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
+                info = {5, 5, 16};
+                return true;
+            case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
+                info = {6, 6, 16};
+                return true;
+            case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
+                info = {8, 8, 16};
+                return true;
+            case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
+                info = {10, 10, 16};
+                return true;
+            case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
+            case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
+                info = {12, 12, 16};
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    uint64_t TextureFile::GetLevelSize(const VkFormat format, const uint32_t width, const uint32_t height) {
+        FormatBlockInfo block;
+        if (!GetBlockInfo(format, block)) {
+            throw std::runtime_error("Unsupported texture format " + std::to_string(format) + "!");
+        }
+        const uint64_t blocksX = (width + block.width - 1) / block.width;
+        const uint64_t blocksY = (height + block.height - 1) / block.height;
+        return blocksX * blocksY * block.bytes;
+    }
+
+    bool TextureFile::IsCompressed(const VkFormat format) {
+        FormatBlockInfo block;
+        return GetBlockInfo(format, block) && block.width > 1;
+    }
+}
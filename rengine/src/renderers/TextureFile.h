@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace REngine {
+    // One mip level inside TextureFileData::bytes
+    struct TextureLevel {
+        uint64_t offset = 0;
+        uint64_t size = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+
+    // Texel data as stored in the container, levels ordered largest first.
+    // Level offsets point into bytes, which may hold the whole file.
+    struct TextureFileData {
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<TextureLevel> levels;
+        std::vector<uint8_t> bytes;
+    };
+
+    // Texels per block side and bytes per block, 1x1 blocks for uncompressed formats
+    struct FormatBlockInfo {
+        uint32_t width = 1;
+        uint32_t height = 1;
+        uint32_t bytes = 0;
+    };
+
+    // KTX2 and DDS containers holding a single 2D image with its mips in
+    // RGBA8/BGRA8, BC1-BC5, BC7 or ASTC. Arrays, cubemaps, volumes and
+    // supercompressed KTX2 (Basis, zstd) are rejected.
+    class TextureFile {
+    public:
+        // By extension, .ktx2 or .dds
+        static bool IsContainer(const std::string& path);
+
+        static TextureFileData Load(const std::string& path);
+        static TextureFileData Parse(std::vector<uint8_t> bytes, const std::string& name);
+
+        // Level table of a whole file already in memory, offsets relative to bytes.
+        // Leaves the result's bytes empty so texels can be uploaded from where they are.
+        static TextureFileData ParseHeader(const uint8_t* bytes, size_t size, const std::string& name);
+
+        // Only reads the header
+        static VkFormat ReadFormat(const std::string& path);
+
+        // Header and level table, bytes stays empty. Levels can then be read
+        // separately with ReadLevels().
+        static TextureFileData LoadHeader(const std::string& path);
+
+        // Levels [first, first + count) of a LoadHeader() result, packed in
+        // bytes. The result starts at level first's size.
+        static TextureFileData ReadLevels(const std::string& path, const TextureFileData& header, uint32_t first, uint32_t count);
+
+        // Level data is written smallest first, as KTX2 requires
+        static void WriteKtx2(const std::string& path, const TextureFileData& data);
+
+        // False for formats the containers are not read in
+        static bool GetBlockInfo(VkFormat format, FormatBlockInfo& info);
+        static uint64_t GetLevelSize(VkFormat format, uint32_t width, uint32_t height);
+        static bool IsCompressed(VkFormat format);
+
+    private:
+        // bytes holds at least the header and level table of a fileSize byte file
+        static TextureFileData ParseHeader(const uint8_t* bytes, size_t size, uint64_t fileSize, const std::string& name);
+        static TextureFileData ParseKtx2(const uint8_t* bytes, size_t size, uint64_t fileSize, const std::string& name);
+        static TextureFileData ParseDds(const uint8_t* bytes, size_t size, uint64_t fileSize, const std::string& name);
+        static VkFormat ReadKtx2Format(const uint8_t* header, size_t size, const std::string& name);
+        static VkFormat ReadDdsFormat(const uint8_t* header, size_t size, const std::string& name);
+    };
+}
@@ -0,0 +1,229 @@
+﻿#include "TextureLoader.h"
+#include <renderers/VulkanRenderer.h>
+#include <stb_image.h>
+#include <RProfiler.h>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace REngine {
+    namespace {
+        bool IsSupportedImage(const std::filesystem::path& path) {
+            std::string extension = path.extension().string();
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                [](const unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+            return extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+                   extension == ".tga" || extension == ".bmp" || extension == ".psd" ||
+                   extension == ".gif" || extension == ".ktx2" || extension == ".dds";
+        }
+    }
+
+    TextureLoader::TextureLoader(VulkanRenderer& renderer, const uint32_t threadCount)
+        : m_renderer(renderer)
+        , m_threadPool(std::make_unique<RThreadPool>(threadCount)) {}
+
+    TextureLoader::~TextureLoader() {
+        // Let in-flight decodes finish before dropping their results
+        m_threadPool.reset();
+
+        for (auto& image : m_decoded) {
+            if (image->pixels) {
+                stbi_image_free(image->pixels);
+            }
+            image->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error("Texture loader destroyed before " + image->path + " was created")));
+        }
+        m_decoded.clear();
+    }
+
+    TextureFuture TextureLoader::Load(const std::string& path, const VkFormat format, const bool generateMipmaps) {
+        auto image = std::make_shared<DecodedImage>();
+        image->path = path;
+        image->format = format;
+        image->generateMipmaps = generateMipmaps;
+        TextureFuture future = image->promise.get_future().share();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending++;
+        }
+
+        m_threadPool->Submit([this, image]() {
+            RPROFILE_SCOPE("TextureLoader::Decode");
+
+            if (TextureFile::IsContainer(image->path)) {
+                try {
+                    image->file = TextureFile::Load(image->path);
+                } catch (const std::exception& e) {
+                    image->error = e.what();
+                }
+            } else {
+                int channels = 0;
+                image->pixels = stbi_load(image->path.c_str(), &image->width, &image->height, &channels, STBI_rgb_alpha);
+                if (!image->pixels) {
+                    image->error = "Failed to load texture image: " + image->path;
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_decoded.push_back(image);
+            }
+            m_decodedCondition.notify_one();
+        });
+
+        return future;
+    }
+
+    TextureFuture TextureLoader::LoadFirstSupported(
+        const std::vector<std::string>& candidates,
+        const VkFormat format,
+        const bool generateMipmaps
+    ) {
+        for (const std::string& path : candidates) {
+            if (!TextureFile::IsContainer(path)) {
+                return Load(path, format, generateMipmaps);
+            }
+
+            VkFormat fileFormat = VK_FORMAT_UNDEFINED;
+            try {
+                fileFormat = TextureFile::ReadFormat(path);
+            } catch (const std::exception&) {
+                continue;  // Missing or unreadable, try the next one
+            }
+            if (Texture::SupportsFormat(m_renderer, fileFormat)) {
+                return Load(path, format, generateMipmaps);
+            }
+        }
+
+        throw std::runtime_error("No supported texture among " + std::to_string(candidates.size()) + " candidates" +
+                                 (candidates.empty() ? std::string("!") : ": " + candidates.front()));
+    }
+
+    std::map<std::string, TextureFuture> TextureLoader::LoadDirectory(
+        const std::string& directory,
+        const bool recursive,
+        const VkFormat format,
+        const bool generateMipmaps
+    ) {
+        std::map<std::string, TextureFuture> results;
+
+        auto enqueue = [&](const std::filesystem::directory_entry& entry) {
+            if (entry.is_regular_file() && IsSupportedImage(entry.path())) {
+                const std::string path = entry.path().string();
+                results.emplace(path, Load(path, format, generateMipmaps));
+            }
+        };
+
+        if (recursive) {
+            for (const auto& entry : std::filesystem::recursive_directory_iterator(directory)) {
+                enqueue(entry);
+            }
+        } else {
+            for (const auto& entry : std::filesystem::directory_iterator(directory)) {
+                enqueue(entry);
+            }
+        }
+
+        return results;
+    }
+
+    std::map<std::string, TextureFuture> TextureLoader::LoadManifest(
+        const std::string& manifestPath,
+        const VkFormat format,
+        const bool generateMipmaps
+    ) {
+        std::ifstream file(manifestPath);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open texture manifest: " + manifestPath);
+        }
+
+        const std::filesystem::path baseDirectory = std::filesystem::path(manifestPath).parent_path();
+        std::map<std::string, TextureFuture> results;
+
+        std::string line;
+        while (std::getline(file, line)) {
+            // Trim whitespace (and a trailing '\r' from Windows line endings)
+            const auto first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') {
+                continue;
+            }
+            const auto last = line.find_last_not_of(" \t\r");
+            const std::string entry = line.substr(first, last - first + 1);
+
+            const std::string path = (baseDirectory / entry).string();
+            results.emplace(path, Load(path, format, generateMipmaps));
+        }
+
+        return results;
+    }
+
+    uint32_t TextureLoader::Update(const uint32_t maxTextures) {
+        std::vector<std::shared_ptr<DecodedImage>> ready;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const size_t count = std::min<size_t>(m_decoded.size(), maxTextures);
+            ready.assign(
+                std::make_move_iterator(m_decoded.begin()),
+                std::make_move_iterator(m_decoded.begin() + static_cast<std::ptrdiff_t>(count)));
+            m_decoded.erase(m_decoded.begin(), m_decoded.begin() + static_cast<std::ptrdiff_t>(count));
+        }
+
+        RPROFILE_SCOPE("TextureLoader::Update");
+
+        for (auto& image : ready) {
+            if (!image->error.empty()) {
+                image->promise.set_exception(std::make_exception_ptr(std::runtime_error(image->error)));
+                continue;
+            }
+
+            try {
+                auto texture = std::make_shared<Texture>();
+                if (image->pixels) {
+                    texture->CreateFromData(m_renderer, image->pixels,
+                        static_cast<uint32_t>(image->width), static_cast<uint32_t>(image->height),
+                        image->format, image->generateMipmaps);
+                } else {
+                    texture->CreateFromFileData(m_renderer, image->file, image->generateMipmaps);
+                }
+                image->promise.set_value(std::move(texture));
+            } catch (...) {
+                image->promise.set_exception(std::current_exception());
+            }
+
+            if (image->pixels) {
+                stbi_image_free(image->pixels);
+                image->pixels = nullptr;
+            }
+            image->file = {};
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pending -= static_cast<uint32_t>(ready.size());
+        }
+
+        return static_cast<uint32_t>(ready.size());
+    }
+
+    void TextureLoader::WaitAll() {
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_decodedCondition.wait(lock, [this]() { return m_pending == 0 || !m_decoded.empty(); });
+                if (m_pending == 0) {
+                    return;
+                }
+            }
+            Update();
+        }
+    }
+
+    uint32_t TextureLoader::GetPendingCount() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_pending;
+    }
+}
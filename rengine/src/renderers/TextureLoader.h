@@ -0,0 +1,95 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <RThreadPool.h>
+#include <renderers/Texture.h>
+#include <renderers/TextureFile.h>
+#include <condition_variable>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace REngine {
+    class VulkanRenderer;
+
+    using TextureFuture = std::shared_future<std::shared_ptr<Texture>>;
+
+    // Decodes image files on worker threads and creates the textures on the
+    // render thread in Update(). Futures become ready once the texture has been
+    // created and its upload recorded; use Texture::IsReady() for GPU completion.
+    // Never block on a future from the render thread without pumping Update()
+    // (WaitAll() does that).
+    class TextureLoader {
+    public:
+        explicit TextureLoader(VulkanRenderer& renderer, uint32_t threadCount = 0);
+        ~TextureLoader();
+
+        // Disable copying
+        TextureLoader(const TextureLoader&) = delete;
+        TextureLoader& operator=(const TextureLoader&) = delete;
+
+        TextureFuture Load(
+            const std::string& path,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            bool generateMipmaps = true
+        );
+
+        // First candidate the device can sample, e.g. {"albedo.astc.ktx2", "albedo.bc7.ktx2", "albedo.png"}.
+        // Reads the KTX2/DDS headers on the calling thread; images decoded to
+        // RGBA8 always qualify. Throws if no candidate does.
+        TextureFuture LoadFirstSupported(
+            const std::vector<std::string>& candidates,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            bool generateMipmaps = true
+        );
+
+        // Every supported image (png, jpg, jpeg, tga, bmp, psd, gif, ktx2, dds) in the directory
+        std::map<std::string, TextureFuture> LoadDirectory(
+            const std::string& directory,
+            bool recursive = false,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            bool generateMipmaps = true
+        );
+
+        // Text file with one image path per line, relative to the manifest.
+        // Empty lines and lines starting with '#' are skipped.
+        std::map<std::string, TextureFuture> LoadManifest(
+            const std::string& manifestPath,
+            VkFormat format = VK_FORMAT_R8G8B8A8_SRGB,
+            bool generateMipmaps = true
+        );
+
+        // Creates textures for decoded images. Call once per frame on the render thread.
+        // Returns the number of textures created.
+        uint32_t Update(uint32_t maxTextures = UINT32_MAX);
+
+        // Pumps Update() until every requested texture has been created
+        void WaitAll();
+
+        [[nodiscard]] uint32_t GetPendingCount() const;
+        [[nodiscard]] uint32_t GetThreadCount() const { return m_threadPool->GetThreadCount(); }
+
+    private:
+        struct DecodedImage {
+            std::string path;
+            VkFormat format = VK_FORMAT_UNDEFINED;
+            bool generateMipmaps = true;
+            unsigned char* pixels = nullptr;
+            int width = 0;
+            int height = 0;
+            TextureFileData file;  // KTX2 and DDS, pixels stays null
+            std::string error;
+            std::promise<std::shared_ptr<Texture>> promise;
+        };
+
+        VulkanRenderer& m_renderer;
+        std::unique_ptr<RThreadPool> m_threadPool;
+
+        std::vector<std::shared_ptr<DecodedImage>> m_decoded;
+        uint32_t m_pending = 0;  // Requested but not yet created
+        mutable std::mutex m_mutex;
+        std::condition_variable m_decodedCondition;
+    };
+}
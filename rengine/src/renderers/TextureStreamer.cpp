@@ -0,0 +1,530 @@
+﻿#include "TextureStreamer.h"
+#include <renderers/VulkanRenderer.h>
+#include <RProfiler.h>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace REngine {
+    namespace {
+        void ImageBarrier(VkCommandBuffer cmd, VkImage image, uint32_t baseLevel, uint32_t levelCount,
+                          VkImageLayout oldLayout, VkImageLayout newLayout,
+                          VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                          VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage,
+                          uint32_t srcFamily = VK_QUEUE_FAMILY_IGNORED, uint32_t dstFamily = VK_QUEUE_FAMILY_IGNORED) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.oldLayout = oldLayout;
+            barrier.newLayout = newLayout;
+            barrier.srcQueueFamilyIndex = srcFamily;
+            barrier.dstQueueFamilyIndex = dstFamily;
+            barrier.image = image;
+            barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            barrier.subresourceRange.baseMipLevel = baseLevel;
+            barrier.subresourceRange.levelCount = levelCount;
+            barrier.subresourceRange.baseArrayLayer = 0;
+            barrier.subresourceRange.layerCount = 1;
+            barrier.srcAccessMask = srcAccess;
+            barrier.dstAccessMask = dstAccess;
+
+            vkCmdPipelineBarrier(cmd, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+    }
+
+    TextureStreamer::TextureStreamer(VulkanRenderer& renderer, const uint32_t threadCount)
+        : m_renderer(renderer)
+        , m_threadPool(std::make_unique<RThreadPool>(threadCount)) {}
+
+    TextureStreamer::~TextureStreamer() {
+        // Let in-flight reads finish before dropping their results
+        m_threadPool.reset();
+
+        for (auto& entry : m_loaded) {
+            entry->promise.set_exception(std::make_exception_ptr(
+                std::runtime_error("Texture streamer destroyed before " + entry->path + " was created")));
+        }
+        m_loaded.clear();
+        m_read.clear();
+
+        // Textures keep whatever levels they have
+        for (auto& [texture, entry] : m_entries) {
+            if (entry->image != VK_NULL_HANDLE) {
+                m_renderer.GetUploadManager().Wait(entry->upload);
+                DestroyPending(*entry);
+            }
+        }
+        m_entries.clear();
+    }
+
+    TextureFuture TextureStreamer::Load(const std::string& path, const float priority) {
+        auto entry = std::make_shared<Entry>();
+        entry->path = path;
+        entry->priority = priority;
+        TextureFuture future = entry->promise.get_future().share();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pendingLoads++;
+        }
+
+        const uint32_t tailSize = m_tailSize;
+        m_threadPool->Submit([this, entry, tailSize]() {
+            RPROFILE_SCOPE("TextureStreamer::LoadTail");
+
+            try {
+                if (!TextureFile::IsContainer(entry->path)) {
+                    throw std::runtime_error("Only KTX2 and DDS textures can be streamed: " + entry->path);
+                }
+                entry->header = TextureFile::LoadHeader(entry->path);
+
+                const auto levelCount = static_cast<uint32_t>(entry->header.levels.size());
+                uint32_t tail = 0;
+                while (tail + 1 < levelCount &&
+                       std::max(entry->header.levels[tail].width, entry->header.levels[tail].height) > tailSize) {
+                    tail++;
+                }
+                entry->tailLevel = tail;
+                entry->levels = TextureFile::ReadLevels(entry->path, entry->header, tail, levelCount - tail);
+            } catch (const std::exception& e) {
+                entry->error = e.what();
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_loaded.push_back(entry);
+        });
+
+        return future;
+    }
+
+    void TextureStreamer::RequestScreenSize(const Texture& texture, const float pixels) {
+        Entry* entry = FindEntry(texture);
+        if (!entry) {
+            return;
+        }
+
+        // One level per halving of the on-screen size
+        const auto extent = static_cast<float>(std::max(entry->header.width, entry->header.height));
+        const uint32_t level = pixels >= extent ? 0 :
+            static_cast<uint32_t>(std::floor(std::log2(extent / std::max(pixels, 1.0f))));
+        RequestLevel(texture, level);
+    }
+
+    void TextureStreamer::RequestLevel(const Texture& texture, uint32_t level) {
+        Entry* entry = FindEntry(texture);
+        if (!entry) {
+            return;
+        }
+
+        level = std::min(level, entry->tailLevel);
+        entry->requestedLevel = entry->requested && entry->requestFrame == m_frame ?
+            std::min(entry->requestedLevel, level) : level;
+        entry->requestFrame = m_frame;
+        entry->requested = true;
+    }
+
+    void TextureStreamer::SetPriority(const Texture& texture, const float priority) {
+        if (Entry* entry = FindEntry(texture)) {
+            entry->priority = priority;
+        }
+    }
+
+    void TextureStreamer::Update(const uint32_t maxChanges) {
+        RPROFILE_SCOPE("TextureStreamer::Update");
+
+        VulkanUploadManager& uploadManager = m_renderer.GetUploadManager();
+
+        // Swap in finished images and forget destroyed textures. A destroyed
+        // texture waited for its level change, so the new image is unused.
+        for (auto it = m_entries.begin(); it != m_entries.end();) {
+            Entry& entry = *it->second;
+            const std::shared_ptr<Texture> texture = entry.texture.lock();
+            if (entry.image != VK_NULL_HANDLE && (!texture || uploadManager.IsComplete(entry.upload))) {
+                FinishRebuild(entry, texture.get());
+            }
+            it = texture ? std::next(it) : m_entries.erase(it);
+        }
+
+        std::vector<std::shared_ptr<Entry>> loaded;
+        std::vector<std::shared_ptr<Entry>> read;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            loaded.swap(m_loaded);
+            read.swap(m_read);
+            m_pendingLoads -= static_cast<uint32_t>(loaded.size());
+            m_pendingReads -= static_cast<uint32_t>(read.size());
+        }
+
+        for (auto& entry : loaded) {
+            CreateLoaded(entry);
+        }
+
+        for (auto& entry : read) {
+            entry->busy = false;
+            const std::shared_ptr<Texture> texture = entry->texture.lock();
+            if (!texture) {
+                continue;
+            }
+            if (!entry->error.empty()) {
+                std::cerr << "Texture streaming failed: " << entry->error << std::endl;
+                entry->error.clear();
+                entry->levels = {};
+                continue;
+            }
+            Rebuild(*entry, *texture, entry->firstLevel);
+        }
+
+        // Every texture keeps its tail; the budget left goes to the levels
+        // requested recently, highest priority first
+        struct Candidate {
+            std::shared_ptr<Entry> entry;
+            std::shared_ptr<Texture> texture;
+            uint32_t wanted;
+            uint32_t target;
+            bool recent;
+        };
+        std::vector<Candidate> candidates;
+        candidates.reserve(m_entries.size());
+
+        VkDeviceSize resident = 0;
+        VkDeviceSize planned = 0;
+        for (auto& [key, entry] : m_entries) {
+            std::shared_ptr<Texture> texture = entry->texture.lock();
+            if (!texture) {
+                continue;
+            }
+            resident += texture->m_allocation.size + entry->allocation.size;
+            planned += GetResidentSize(*entry, entry->tailLevel);
+
+            const bool recent = entry->requested && m_frame - entry->requestFrame <= REQUEST_TIMEOUT_FRAMES;
+            const uint32_t wanted = recent ? entry->requestedLevel : entry->tailLevel;
+            candidates.push_back({entry, std::move(texture), wanted, entry->tailLevel, recent});
+        }
+
+        const VkDeviceSize budget = ComputeBudget(resident);
+        m_stats.residentBytes = resident;
+        m_stats.budgetBytes = budget;
+
+        std::stable_sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b) {
+            return a.recent != b.recent ? a.recent : a.entry->priority > b.entry->priority;
+        });
+
+        for (Candidate& candidate : candidates) {
+            const VkDeviceSize tailSize = GetResidentSize(*candidate.entry, candidate.entry->tailLevel);
+            for (uint32_t level = candidate.wanted; level < candidate.entry->tailLevel; level++) {
+                const VkDeviceSize extra = GetResidentSize(*candidate.entry, level) - tailSize;
+                if (planned + extra <= budget) {
+                    candidate.target = level;
+                    planned += extra;
+                    break;
+                }
+            }
+        }
+
+        uint32_t changes = 0;
+        auto canChange = [&](const Candidate& candidate) {
+            return changes < maxChanges && !candidate.entry->busy && candidate.texture->IsReady();
+        };
+
+        // Over budget, lowest priority first, until the estimate fits
+        VkDeviceSize estimate = 0;
+        for (const Candidate& candidate : candidates) {
+            estimate += GetResidentSize(*candidate.entry, candidate.texture->m_firstLevel);
+        }
+        for (auto it = candidates.rbegin(); it != candidates.rend() && estimate > budget; ++it) {
+            const uint32_t current = it->texture->m_firstLevel;
+            if (it->target > current && canChange(*it)) {
+                estimate -= GetResidentSize(*it->entry, current) - GetResidentSize(*it->entry, it->target);
+                Rebuild(*it->entry, *it->texture, it->target);
+                changes++;
+            }
+        }
+
+        // Finer levels, highest priority first, read on the workers
+        for (const Candidate& candidate : candidates) {
+            const uint32_t current = candidate.texture->m_firstLevel;
+            if (candidate.target >= current || !canChange(candidate)) {
+                continue;
+            }
+
+            std::shared_ptr<Entry> entry = candidate.entry;
+            entry->busy = true;
+            entry->firstLevel = candidate.target;
+            changes++;
+
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pendingReads++;
+            }
+
+            const uint32_t count = current - candidate.target;
+            m_threadPool->Submit([this, entry, count]() {
+                RPROFILE_SCOPE("TextureStreamer::ReadLevels");
+
+                try {
+                    entry->levels = TextureFile::ReadLevels(entry->path, entry->header, entry->firstLevel, count);
+                } catch (const std::exception& e) {
+                    entry->error = e.what();
+                }
+
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_read.push_back(entry);
+            });
+        }
+
+        m_frame++;
+    }
+
+    TextureStreamerStats TextureStreamer::GetStats() const {
+        TextureStreamerStats stats = m_stats;
+        stats.textureCount = static_cast<uint32_t>(m_entries.size());
+        stats.pendingUploads = static_cast<uint32_t>(std::count_if(m_entries.begin(), m_entries.end(),
+            [](const auto& entry) { return entry.second->image != VK_NULL_HANDLE; }));
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        stats.pendingReads = m_pendingReads;
+        return stats;
+    }
+
+    void TextureStreamer::CreateLoaded(const std::shared_ptr<Entry>& entry) {
+        if (!entry->error.empty()) {
+            entry->promise.set_exception(std::make_exception_ptr(std::runtime_error(entry->error)));
+            return;
+        }
+
+        try {
+            auto texture = std::make_shared<Texture>();
+            texture->CreateFromFileData(m_renderer, entry->levels, false);
+
+            // The image starts at the tail, the texture keeps the full size
+            texture->m_width = entry->header.width;
+            texture->m_height = entry->header.height;
+            texture->m_firstLevel = entry->tailLevel;
+
+            entry->levels = {};
+            entry->texture = texture;
+            entry->requestedLevel = entry->tailLevel;
+            m_entries[texture.get()] = entry;
+            entry->promise.set_value(std::move(texture));
+        } catch (...) {
+            entry->promise.set_exception(std::current_exception());
+        }
+    }
+
+    void TextureStreamer::Rebuild(Entry& entry, Texture& texture, const uint32_t firstLevel) {
+        RPROFILE_SCOPE("TextureStreamer::Rebuild");
+
+        VulkanAllocator& allocator = m_renderer.GetAllocator();
+        VulkanUploadManager& uploadManager = m_renderer.GetUploadManager();
+        VkDevice device = allocator.GetDevice();
+
+        const auto totalLevels = static_cast<uint32_t>(entry.header.levels.size());
+        const uint32_t oldFirst = texture.m_firstLevel;
+        const uint32_t levelCount = totalLevels - firstLevel;
+        const TextureLevel& base = entry.header.levels[firstLevel];
+
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {base.width, base.height, 1};
+        imageInfo.mipLevels = levelCount;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = texture.m_format;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &entry.image) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create streamed texture image!");
+        }
+        entry.allocation = allocator.AllocateForImage(entry.image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        entry.firstLevel = firstLevel;
+        entry.busy = true;
+
+        // Levels read from the file come first, each at a 16 byte staging offset
+        const TextureFileData& data = entry.levels;
+        std::vector<VkBufferImageCopy> regions(data.levels.size());
+        VkDeviceSize stagingSize = 0;
+        for (size_t i = 0; i < data.levels.size(); i++) {
+            VkBufferImageCopy& region = regions[i];
+            region.bufferOffset = stagingSize;
+            region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            region.imageSubresource.mipLevel = static_cast<uint32_t>(i);
+            region.imageSubresource.layerCount = 1;
+            region.imageExtent = {data.levels[i].width, data.levels[i].height, 1};
+            stagingSize += (data.levels[i].size + 15) & ~VkDeviceSize(15);
+        }
+
+        // The rest are copied from the current image
+        const uint32_t sharedFirst = std::max(firstLevel, oldFirst);
+        std::vector<VkImageCopy> copies;
+        for (uint32_t level = sharedFirst; level < totalLevels; level++) {
+            VkImageCopy copy{};
+            copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - oldFirst, 0, 1};
+            copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - firstLevel, 0, 1};
+            copy.extent = {entry.header.levels[level].width, entry.header.levels[level].height, 1};
+            copies.push_back(copy);
+        }
+
+        const uint32_t transferFamily = uploadManager.GetTransferQueueFamily();
+        const uint32_t graphicsFamily = uploadManager.GetGraphicsQueueFamily();
+        VkImage oldImage = texture.m_image;
+        VkImage newImage = entry.image;
+
+        entry.upload = uploadManager.Upload(stagingSize,
+            [&](const StagingRegion& staging, VkCommandBuffer transfer, VkCommandBuffer graphics) {
+                if (!regions.empty()) {
+                    for (size_t i = 0; i < regions.size(); i++) {
+                        memcpy(static_cast<uint8_t*>(staging.mapped) + regions[i].bufferOffset,
+                               data.bytes.data() + data.levels[i].offset, static_cast<size_t>(data.levels[i].size));
+                        regions[i].bufferOffset += staging.offset;
+                    }
+
+                    ImageBarrier(transfer, newImage, 0, levelCount,
+                                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+                    vkCmdCopyBufferToImage(transfer, staging.buffer, newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                           static_cast<uint32_t>(regions.size()), regions.data());
+
+                    if (transferFamily != graphicsFamily) {
+                        ImageBarrier(transfer, newImage, 0, levelCount,
+                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                     VK_ACCESS_TRANSFER_WRITE_BIT, 0,
+                                     VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                                     transferFamily, graphicsFamily);
+                        ImageBarrier(graphics, newImage, 0, levelCount,
+                                     VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                     0, VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT,
+                                     VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                     transferFamily, graphicsFamily);
+                    }
+                } else {
+                    ImageBarrier(graphics, newImage, 0, levelCount,
+                                 VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                                 VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+                }
+
+                // Frames submitted earlier may still sample the old image
+                const auto sharedCount = static_cast<uint32_t>(copies.size());
+                ImageBarrier(graphics, oldImage, sharedFirst - oldFirst, sharedCount,
+                             VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                             0, VK_ACCESS_TRANSFER_READ_BIT,
+                             VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+                vkCmdCopyImage(graphics, oldImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               newImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, sharedCount, copies.data());
+                ImageBarrier(graphics, oldImage, sharedFirst - oldFirst, sharedCount,
+                             VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                             0, VK_ACCESS_SHADER_READ_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+                ImageBarrier(graphics, newImage, 0, levelCount,
+                             VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                             VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                             VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+            });
+
+        // A texture destroyed meanwhile waits for the copy out of its image
+        texture.m_streamUpload = entry.upload;
+        entry.levels = {};
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = entry.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = texture.m_format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = levelCount;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &entry.view) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create streamed texture image view!");
+        }
+    }
+
+    void TextureStreamer::FinishRebuild(Entry& entry, Texture* texture) {
+        if (!texture) {
+            DestroyPending(entry);
+            return;
+        }
+
+        // A new index, as frames in flight still sample the old one. With a full
+        // table the texture keeps its current levels.
+        VulkanBindlessTable* table = texture->m_bindlessTable;
+        const uint32_t index = table->Register(entry.view, texture->m_sampler);
+        if (index == VulkanBindlessTable::INVALID_INDEX) {
+            DestroyPending(entry);
+            return;
+        }
+
+        if (entry.firstLevel < texture->m_firstLevel) {
+            m_stats.levelsStreamedIn += texture->m_firstLevel - entry.firstLevel;
+        } else {
+            m_stats.levelsEvicted += entry.firstLevel - texture->m_firstLevel;
+        }
+
+        VulkanAllocator* allocator = texture->m_allocator;
+        VkDevice device = texture->m_device;
+        m_renderer.Retire([device, allocator, table, index = texture->m_bindlessIndex, image = texture->m_image,
+                           view = texture->m_imageView, allocation = texture->m_allocation]() mutable {
+            table->Unregister(index);
+            vkDestroyImageView(device, view, nullptr);
+            vkDestroyImage(device, image, nullptr);
+            allocator->Free(allocation);
+        });
+
+        texture->m_image = entry.image;
+        texture->m_imageView = entry.view;
+        texture->m_allocation = entry.allocation;
+        texture->m_bindlessIndex = index;
+        texture->m_mipLevels = static_cast<uint32_t>(entry.header.levels.size()) - entry.firstLevel;
+        texture->m_firstLevel = entry.firstLevel;
+
+        entry.image = VK_NULL_HANDLE;
+        entry.view = VK_NULL_HANDLE;
+        entry.allocation = {};
+        entry.upload = {};
+        entry.busy = false;
+    }
+
+    void TextureStreamer::DestroyPending(Entry& entry) {
+        VkDevice device = m_renderer.GetDevice();
+        vkDestroyImageView(device, entry.view, nullptr);
+        vkDestroyImage(device, entry.image, nullptr);
+        m_renderer.GetAllocator().Free(entry.allocation);
+
+        entry.image = VK_NULL_HANDLE;
+        entry.view = VK_NULL_HANDLE;
+        entry.allocation = {};
+        entry.upload = {};
+        entry.busy = false;
+    }
+
+    TextureStreamer::Entry* TextureStreamer::FindEntry(const Texture& texture) {
+        const auto it = m_entries.find(&texture);
+        return it != m_entries.end() ? it->second.get() : nullptr;
+    }
+
+    VkDeviceSize TextureStreamer::GetResidentSize(const Entry& entry, const uint32_t firstLevel) const {
+        VkDeviceSize size = 0;
+        for (size_t level = firstLevel; level < entry.header.levels.size(); level++) {
+            size += entry.header.levels[level].size;
+        }
+        return size;
+    }
+
+    VkDeviceSize TextureStreamer::ComputeBudget(const VkDeviceSize residentBytes) const {
+        // The heap's budget less what is not ours
+        VulkanAllocator& allocator = m_renderer.GetAllocator();
+        const VulkanHeapBudget heap = allocator.GetHeapBudget(allocator.GetDeviceLocalHeap());
+        const VkDeviceSize others = heap.usage > residentBytes ? heap.usage - residentBytes : 0;
+        const VkDeviceSize available = heap.budget > others ? heap.budget - others : 0;
+        return m_budget ? std::min(m_budget, available) : available;
+    }
+}
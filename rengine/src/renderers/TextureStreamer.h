@@ -0,0 +1,129 @@
+﻿#pragma once
+#include <vulkan/vulkan.h>
+#include <RThreadPool.h>
+#include <VulkanAllocator.h>
+#include <VulkanUploadManager.h>
+#include <renderers/Texture.h>
+#include <renderers/TextureFile.h>
+#include <renderers/TextureLoader.h>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace REngine {
+    class VulkanRenderer;
+
+    struct TextureStreamerStats {
+        uint32_t textureCount = 0;
+        uint32_t pendingReads = 0;
+        uint32_t pendingUploads = 0;
+        VkDeviceSize residentBytes = 0;  // Images of streamed textures, including ones being built
+        VkDeviceSize budgetBytes = 0;    // What they may use, from the last Update()
+        uint64_t levelsStreamedIn = 0;
+        uint64_t levelsEvicted = 0;
+    };
+
+    // Streams the mips of KTX2 and DDS textures in and out of VRAM. Load() makes
+    // only the mip tail resident; finer levels follow as RequestScreenSize() and
+    // RequestLevel() ask for them, in priority order while they fit the budget.
+    // Over budget, textures lose their finest levels, unrequested ones first.
+    //
+    // Changing the resident levels builds a new image, copies the levels both
+    // images share on the GPU and swaps it in once the copy completes. A
+    // texture's view and bindless index change with it, so read them every frame.
+    class TextureStreamer {
+    public:
+        // Levels no larger than this are resident from the start
+        static constexpr uint32_t DEFAULT_TAIL_SIZE = 128;
+
+        // Textures not requested for this many frames fall back to their tail
+        static constexpr uint64_t REQUEST_TIMEOUT_FRAMES = 120;
+
+        explicit TextureStreamer(VulkanRenderer& renderer, uint32_t threadCount = 2);
+        ~TextureStreamer();
+
+        // Disable copying
+        TextureStreamer(const TextureStreamer&) = delete;
+        TextureStreamer& operator=(const TextureStreamer&) = delete;
+
+        // KTX2 or DDS files with their mips, see rengine_texconv. The future
+        // becomes ready in Update() once the tail's upload has been recorded.
+        TextureFuture Load(const std::string& path, float priority = 1.0f);
+
+        // Feedback, render thread. The finest level asked for during a frame wins.
+        // pixels: the largest extent the texture covers on screen
+        void RequestScreenSize(const Texture& texture, float pixels);
+        void RequestLevel(const Texture& texture, uint32_t level);
+
+        // Higher priorities get their levels first and lose them last
+        void SetPriority(const Texture& texture, float priority);
+
+        // Cap for the streamed textures in bytes. 0 leaves only the device-local
+        // heap's budget, less what everything else in the heap uses.
+        void SetBudget(VkDeviceSize bytes) { m_budget = bytes; }
+        void SetTailSize(uint32_t size) { m_tailSize = size; }
+
+        // Creates loaded textures, swaps in finished level changes and starts up
+        // to maxChanges new ones. Call once per frame on the render thread.
+        void Update(uint32_t maxChanges = 4);
+
+        [[nodiscard]] TextureStreamerStats GetStats() const;
+
+    private:
+        struct Entry {
+            std::string path;
+            TextureFileData header;        // Level table, no texels
+            uint32_t tailLevel = 0;        // Always resident from here on
+            float priority = 1.0f;
+            std::weak_ptr<Texture> texture;
+            std::promise<std::shared_ptr<Texture>> promise;
+
+            // Feedback
+            uint32_t requestedLevel = 0;
+            uint64_t requestFrame = 0;
+            bool requested = false;
+
+            // Read or rebuild in flight
+            bool busy = false;
+            TextureFileData levels;        // Read result, levels [firstLevel, current first)
+            std::string error;
+
+            // Image being built, swapped in once upload completes
+            UploadHandle upload;
+            VkImage image = VK_NULL_HANDLE;
+            VkImageView view = VK_NULL_HANDLE;
+            VulkanAllocation allocation;
+            uint32_t firstLevel = 0;
+        };
+
+        void CreateLoaded(const std::shared_ptr<Entry>& entry);
+        void Rebuild(Entry& entry, Texture& texture, uint32_t firstLevel);
+        void FinishRebuild(Entry& entry, Texture* texture);
+        void DestroyPending(Entry& entry);
+        Entry* FindEntry(const Texture& texture);
+        VkDeviceSize GetResidentSize(const Entry& entry, uint32_t firstLevel) const;
+        VkDeviceSize ComputeBudget(VkDeviceSize residentBytes) const;
+
+        VulkanRenderer& m_renderer;
+        std::unique_ptr<RThreadPool> m_threadPool;
+
+        VkDeviceSize m_budget = 0;
+        uint32_t m_tailSize = DEFAULT_TAIL_SIZE;
+        uint64_t m_frame = 0;
+
+        // Render thread only
+        std::unordered_map<const Texture*, std::shared_ptr<Entry>> m_entries;
+        TextureStreamerStats m_stats;
+
+        // Filled by workers, drained by Update()
+        std::vector<std::shared_ptr<Entry>> m_loaded;
+        std::vector<std::shared_ptr<Entry>> m_read;
+        uint32_t m_pendingLoads = 0;
+        uint32_t m_pendingReads = 0;
+        mutable std::mutex m_mutex;
+    };
+}
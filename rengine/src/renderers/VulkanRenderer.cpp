@@ -1,12 +1,45 @@
 ﻿#include "VulkanRenderer.h"
+#include "RenderGraph.h"
+#include "Texture.h"
+#include <RProfiler.h>
+#include <RTime.h>
+#include <VulkanBuffer.h>
+#include <VulkanHelpers.h>
 #include <stdexcept>
 #include <iostream>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <future>
 #include <imgui.h>
 #include <backends/imgui_impl_vulkan.h>
 #include <backends/imgui_impl_sdl2.h>
 
 
 namespace REngine {
+    namespace {
+        // Left to the sampler bindings of other sets next to the bindless table
+        constexpr uint32_t RESERVED_SAMPLER_DESCRIPTORS = 64;
+
+        const char* PresentModeName(const VkPresentModeKHR mode) {
+            switch (mode) {
+                case VK_PRESENT_MODE_IMMEDIATE_KHR: return "IMMEDIATE";
+                case VK_PRESENT_MODE_MAILBOX_KHR: return "MAILBOX";
+                case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+                case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO_RELAXED";
+                default: return "UNKNOWN";
+            }
+        }
+
+        // ImGui's pipeline needs a render pass unless its backend was built with dynamic rendering
+#ifdef IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING
+        constexpr bool IMGUI_DYNAMIC_RENDERING = true;
+#else
+        constexpr bool IMGUI_DYNAMIC_RENDERING = false;
+#endif
+    }
+
     VulkanRenderer::VulkanRenderer()
         : m_instance(VK_NULL_HANDLE)
         , m_physicalDevice(VK_NULL_HANDLE)
@@ -14,6 +47,7 @@ namespace REngine {
         , m_surface(VK_NULL_HANDLE)
         , m_swapchain(VK_NULL_HANDLE)
         , m_renderPass(VK_NULL_HANDLE)
+        , m_loadRenderPass(VK_NULL_HANDLE)
         , m_commandPool(VK_NULL_HANDLE)
         , m_currentFrame(0)
         , m_imageIndex(0)
@@ -24,10 +58,26 @@ namespace REngine {
     }
 
     bool VulkanRenderer::Initialize(SDL_Window* window) {
-
         m_window = window;
+        m_headless = false;
+        return InitializeVulkan();
+    }
 
+    bool VulkanRenderer::InitializeHeadless(const uint32_t width, const uint32_t height) {
+        if (width == 0 || height == 0) {
+            return false;
+        }
+        m_window = nullptr;
+        m_headless = true;
+        m_headlessExtent = {width, height};
+        return InitializeVulkan();
+    }
+
+    bool VulkanRenderer::InitializeVulkan() {
         m_initialized = false;
+        m_swapchainDirty = false;
+
+        const auto startTime = std::chrono::steady_clock::now();
 
         try {
             if (!CreateInstance()) {
@@ -46,6 +96,14 @@ namespace REngine {
                 Shutdown();
                 return false;
             }
+            if (!CreateAllocator()) {
+                Shutdown();
+                return false;
+            }
+            if (!CreateCaches()) {
+                Shutdown();
+                return false;
+            }
             if (!CreateSwapchain()) {
                 Shutdown();
                 return false;
@@ -74,7 +132,25 @@ namespace REngine {
                 Shutdown();
                 return false;
             }
+            if (!CreateGpuProfiler()) {
+                Shutdown();
+                return false;
+            }
+            if (!CreateRecordingPools()) {
+                Shutdown();
+                return false;
+            }
+            if (!CreateBindlessTable()) {
+                Shutdown();
+                return false;
+            }
             m_initialized = true;
+
+            m_startupTimeMS = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+            std::cout << "Vulkan initialized" << (m_headless ? " (headless, " : " (")
+                      << m_allocator.GetDeviceProperties().deviceName << ") in " << m_startupTimeMS << " ms ("
+                      << (m_pipelineCache.IsWarm() ? "warm" : "cold") << " pipeline cache, "
+                      << m_pipelineCache.GetLoadedSize() / 1024 << " KB)" << std::endl;
             return true;
         } catch (const std::exception& e) {
             m_initialized = false;
@@ -95,7 +171,7 @@ namespace REngine {
 
         // 3. Destroy synchronization objects
         if (m_device != VK_NULL_HANDLE) {
-            for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            for (size_t i = 0; i < m_inFlightFences.size(); i++) {
                 if (m_imageAvailableSemaphores[i] != VK_NULL_HANDLE) {
                     vkDestroySemaphore(m_device, m_imageAvailableSemaphores[i], nullptr);
                     m_imageAvailableSemaphores[i] = VK_NULL_HANDLE;
@@ -111,19 +187,34 @@ namespace REngine {
             }
         }
 
-        // 4. Destroy command pool
+        // 4. Stop the recording workers, destroy their pools and the command pool
+        m_recordThreads.reset();
+        m_recordPools.Shutdown();
         if (m_commandPool != VK_NULL_HANDLE && m_device != VK_NULL_HANDLE) {
             vkDestroyCommandPool(m_device, m_commandPool, nullptr);
             m_commandPool = VK_NULL_HANDLE;
         }
 
-        // 5. Destroy render pass
-        if (m_renderPass != VK_NULL_HANDLE && m_device != VK_NULL_HANDLE) {
-            vkDestroyRenderPass(m_device, m_renderPass, nullptr);
-            m_renderPass = VK_NULL_HANDLE;
-        }
+        // 5. Render passes are owned by the layout cache, destroyed below
+        m_renderPass = VK_NULL_HANDLE;
+        m_loadRenderPass = VK_NULL_HANDLE;
+
+        // 6. Stop shader reloads, destroy retired objects and the profiler queries, save the pipeline cache,
+        // destroy descriptor pools and cached layouts, release upload batches and the mip generator
+        // objects they hold, the staging ring and device memory blocks, then destroy device
+        m_shaderHotReloader.Shutdown();
+        m_defaultTexture.reset();
+        ReleaseRetired(true);
+        m_bindlessTable.Shutdown();
+        m_gpuProfiler.Shutdown();
+        m_pipelineCache.Shutdown();
+        m_descriptorAllocator.Shutdown();
+        m_layoutCache.Shutdown();
+        m_uploadManager.Shutdown();
+        m_mipGenerator.Shutdown();
+        m_stagingRing.Shutdown();
+        m_allocator.Shutdown();
 
-        // 6. Destroy device
         if (m_device != VK_NULL_HANDLE) {
             vkDestroyDevice(m_device, nullptr);
             m_device = VK_NULL_HANDLE;
@@ -143,22 +234,49 @@ namespace REngine {
     }
 
     bool VulkanRenderer::BeginFrame() {
+        RPROFILE_SCOPE("VulkanRenderer::BeginFrame");
+
+        if (m_requestedFramesInFlight != m_framesInFlight) {
+            ApplyFramesInFlight();
+        }
+
         vkWaitForFences(m_device, 1, &m_inFlightFences[m_currentFrame], VK_TRUE, UINT64_MAX);
 
-        VkResult result = vkAcquireNextImageKHR(
-            m_device, m_swapchain, UINT64_MAX,
-            m_imageAvailableSemaphores[m_currentFrame],
-            VK_NULL_HANDLE, &m_imageIndex
-        );
+        ReleaseRetired();
 
-        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-            RecreateSwapchain();
-            return false;
-        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-            throw std::runtime_error("Failed to acquire swapchain image!");
+        if (m_headless) {
+            // Each frame slot owns an image, the fence above guards its reuse
+            m_imageIndex = m_currentFrame;
+        } else {
+            if (m_swapchainDirty) {
+                RecreateSwapchain();
+                if (m_swapchainDirty) {
+                    return false;
+                }
+            }
+
+            const VkResult result = vkAcquireNextImageKHR(
+                m_device, m_swapchain, UINT64_MAX,
+                m_imageAvailableSemaphores[m_currentFrame],
+                VK_NULL_HANDLE, &m_imageIndex
+            );
+
+            if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+                RecreateSwapchain();
+                return false;
+            } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+                throw std::runtime_error("Failed to acquire swapchain image!");
+            }
         }
 
         vkResetFences(m_device, 1, &m_inFlightFences[m_currentFrame]);
+        m_recordPools.BeginFrame(m_currentFrame);
+        m_bindlessTable.BeginFrame(m_currentFrame);
+        m_descriptorAllocator.BeginFrame(m_currentFrame);
+
+        m_uploadManager.Update();
+        m_stagingRing.Reclaim();
+        m_shaderHotReloader.Update();
         vkResetCommandBuffer(m_commandBuffers[m_currentFrame], 0);
 
         VkCommandBufferBeginInfo beginInfo{};
@@ -167,22 +285,214 @@ namespace REngine {
             throw std::runtime_error("Failed to begin command buffer!");
         }
 
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = m_renderPass;
-        renderPassInfo.framebuffer = m_framebuffers[m_imageIndex];
-        renderPassInfo.renderArea.extent = m_swapchainExtent;
+        // Query resets must happen outside the render pass
+        m_gpuProfiler.BeginFrame(m_commandBuffers[m_currentFrame], m_currentFrame);
+        m_gpuProfiler.BeginScope(m_commandBuffers[m_currentFrame], "Main pass");
 
+        m_backbufferAttached = false;
+        BeginMainPass(false, VK_SUBPASS_CONTENTS_INLINE);
+        return true;
+    }
+
+    void VulkanRenderer::BeginMainPass(const bool load, const VkSubpassContents contents) {
+        const VkCommandBuffer cmd = m_commandBuffers[m_currentFrame];
+
+        // Ignored when loading
         constexpr VkClearValue clearColor = {{{0.2f, 0.3f, 0.4f, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
 
-        vkCmdBeginRenderPass(m_commandBuffers[m_currentFrame], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        return true;
+        if (!m_dynamicRendering) {
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = load ? m_loadRenderPass : m_renderPass;
+            renderPassInfo.framebuffer = m_framebuffers[m_imageIndex];
+            renderPassInfo.renderArea.extent = m_swapchainExtent;
+            renderPassInfo.clearValueCount = 1;
+            renderPassInfo.pClearValues = &clearColor;
+
+            vkCmdBeginRenderPass(cmd, &renderPassInfo, contents);
+            return;
+        }
+
+        // What the render pass's layouts and external dependency did: the first
+        // instance waits for the acquire semaphore, later ones for the previous
+        // instance's writes or for whatever left the image in the backbuffer layout
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = m_backbufferAttached ? VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT : 0;
+        barrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.oldLayout = m_backbufferAttached ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+                          : load ? GetBackbufferLayout() : VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_swapchainImages[m_imageIndex];
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        m_backbufferAttached = true;
+
+        VkRenderingAttachmentInfoKHR colorAttachment{};
+        colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR;
+        colorAttachment.imageView = m_swapchainImageViews[m_imageIndex];
+        colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        colorAttachment.loadOp = load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        colorAttachment.clearValue = clearColor;
+
+        VkRenderingInfoKHR renderingInfo{};
+        renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR;
+        if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+            renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+        }
+        renderingInfo.renderArea.extent = m_swapchainExtent;
+        renderingInfo.layerCount = 1;
+        renderingInfo.colorAttachmentCount = 1;
+        renderingInfo.pColorAttachments = &colorAttachment;
+
+        m_cmdBeginRendering(cmd, &renderingInfo);
+    }
+
+    void VulkanRenderer::EndMainPass(const bool toBackbufferLayout) {
+        const VkCommandBuffer cmd = m_commandBuffers[m_currentFrame];
+        if (!m_dynamicRendering) {
+            // The render pass's final layout is always the backbuffer layout
+            vkCmdEndRenderPass(cmd);
+            return;
+        }
+
+        m_cmdEndRendering(cmd);
+        if (!toBackbufferLayout) {
+            return;
+        }
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        barrier.newLayout = GetBackbufferLayout();
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_swapchainImages[m_imageIndex];
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+        m_backbufferAttached = false;
+    }
+
+    void VulkanRenderer::RecordParallel(const std::vector<std::function<void(VkCommandBuffer)>>& tasks) {
+        RPROFILE_SCOPE("VulkanRenderer::RecordParallel");
+
+        if (tasks.empty()) {
+            return;
+        }
+
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+        // Dynamic rendering inherits the attachment formats instead of a render pass
+        VkCommandBufferInheritanceRenderingInfoKHR renderingInheritance{};
+        if (m_dynamicRendering) {
+            renderingInheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO_KHR;
+            renderingInheritance.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT_KHR;
+            renderingInheritance.colorAttachmentCount = 1;
+            renderingInheritance.pColorAttachmentFormats = &m_swapchainImageFormat;
+            renderingInheritance.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+            inheritance.pNext = &renderingInheritance;
+        } else {
+            inheritance.renderPass = m_loadRenderPass;
+            inheritance.subpass = 0;
+            inheritance.framebuffer = m_framebuffers[m_imageIndex];
+        }
+
+        // Contiguous chunks, one per pool, so a pool is never used by two threads at once
+        const uint32_t chunkCount = std::min(m_recordPools.GetWorkerCount(), static_cast<uint32_t>(tasks.size()));
+        std::vector<VkCommandBuffer> secondaries(tasks.size());
+
+        const auto recordChunk = [&](const uint32_t chunk) {
+            RPROFILE_SCOPE("VulkanRenderer::RecordParallel chunk");
+
+            const size_t first = tasks.size() * chunk / chunkCount;
+            const size_t last = tasks.size() * (chunk + 1) / chunkCount;
+            for (size_t i = first; i < last; i++) {
+                const VkCommandBuffer secondary = m_recordPools.AcquireSecondary(chunk);
+
+                VkCommandBufferBeginInfo beginInfo{};
+                beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+                beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+                beginInfo.pInheritanceInfo = &inheritance;
+                if (vkBeginCommandBuffer(secondary, &beginInfo) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to begin secondary command buffer!");
+                }
+
+                tasks[i](secondary);
+
+                if (vkEndCommandBuffer(secondary) != VK_SUCCESS) {
+                    throw std::runtime_error("Failed to record secondary command buffer!");
+                }
+                secondaries[i] = secondary;
+            }
+        };
+
+        // The calling thread takes the last chunk instead of waiting idle
+        std::vector<std::future<void>> futures;
+        for (uint32_t chunk = 0; chunk + 1 < chunkCount; chunk++) {
+            futures.push_back(m_recordThreads->Submit([&recordChunk, chunk]() { recordChunk(chunk); }));
+        }
+
+        // Every worker must be done with the locals before an error propagates
+        std::exception_ptr error;
+        try {
+            recordChunk(chunkCount - 1);
+        } catch (...) {
+            error = std::current_exception();
+        }
+        for (auto& future : futures) {
+            try {
+                future.get();
+            } catch (...) {
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if (error) {
+            std::rethrow_exception(error);
+        }
+
+        // Secondaries need a render pass instance begun for them, so the inline
+        // instance is split around them. Loading keeps what was drawn.
+        const VkCommandBuffer cmd = m_commandBuffers[m_currentFrame];
+        EndMainPass(false);
+        {
+            GpuScope scope(m_gpuProfiler, cmd, "Parallel recording");
+            BeginMainPass(true, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+            vkCmdExecuteCommands(cmd, static_cast<uint32_t>(secondaries.size()), secondaries.data());
+            EndMainPass(false);
+        }
+        BeginMainPass(true, VK_SUBPASS_CONTENTS_INLINE);
+    }
+
+    void VulkanRenderer::ExecuteRenderGraph(RenderGraph& graph) {
+        RPROFILE_SCOPE("VulkanRenderer::ExecuteRenderGraph");
+
+        // Graph passes bring their own render passes and barriers
+        const VkCommandBuffer cmd = m_commandBuffers[m_currentFrame];
+        EndMainPass(true);
+        graph.Execute(cmd);
+        BeginMainPass(true, VK_SUBPASS_CONTENTS_INLINE);
     }
 
     void VulkanRenderer::EndFrame() {
-        vkCmdEndRenderPass(m_commandBuffers[m_currentFrame]);
+        RPROFILE_SCOPE("VulkanRenderer::EndFrame");
+
+        // Uploads recorded this frame are submitted ahead of the frame that uses them
+        m_uploadManager.Flush();
+
+        EndMainPass(true);
+
+        m_gpuProfiler.EndScope(m_commandBuffers[m_currentFrame]);
+        m_gpuProfiler.EndFrame(m_commandBuffers[m_currentFrame]);
 
         if (vkEndCommandBuffer(m_commandBuffers[m_currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("Failed to record command buffer!");
@@ -191,6 +501,21 @@ namespace REngine {
         VkSubmitInfo submitInfo{};
         submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
+        if (m_headless) {
+            // Nothing to acquire or present, the fence is the only signal
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &m_commandBuffers[m_currentFrame];
+
+            if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrame]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to submit command buffer!");
+            }
+            m_frameNumber++;
+            m_lastSubmittedFrame = m_currentFrame;
+            m_lastSubmittedImage = m_imageIndex;
+            m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+            return;
+        }
+
         VkSemaphore waitSemaphores[] = {m_imageAvailableSemaphores[m_currentFrame]};
         VkPipelineStageFlags waitStages[] = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
         submitInfo.waitSemaphoreCount = 1;
@@ -206,6 +531,7 @@ namespace REngine {
         if (vkQueueSubmit(m_graphicsQueue, 1, &submitInfo, m_inFlightFences[m_currentFrame]) != VK_SUCCESS) {
             throw std::runtime_error("Failed to submit command buffer!");
         }
+        m_frameNumber++;
 
         VkPresentInfoKHR presentInfo{};
         presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -227,7 +553,7 @@ namespace REngine {
             throw std::runtime_error("Failed to present swapchain image!");
         }
 
-        m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
     }
 
     // Helper method to check for device loss from Vulkan results
@@ -241,7 +567,7 @@ namespace REngine {
                 break;
             case VK_ERROR_OUT_OF_DATE_KHR:
             case VK_SUBOPTIMAL_KHR:
-                m_deviceLost = true;
+                // Handled by recreating the swapchain, not the device
                 break;
             default:
                 // For other errors, you might want to assert or log
@@ -250,10 +576,157 @@ namespace REngine {
     }
 
     void VulkanRenderer::SetVsync(const bool enabled) {
-        m_Vsync = enabled;
+        PresentConfig config = m_presentConfig;
+        config.presentMode = enabled ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR;
+        SetPresentConfig(config);
+    }
+
+    void VulkanRenderer::SetPresentConfig(const PresentConfig& config) {
+        const bool swapchainChanged = config.presentMode != m_presentConfig.presentMode ||
+                                      config.imageCount != m_presentConfig.imageCount;
+        m_presentConfig = config;
+        m_requestedFramesInFlight = std::clamp(config.framesInFlight, 1u, MAX_FRAMES_IN_FLIGHT);
+
+        if (!m_initialized) {
+            m_framesInFlight = m_requestedFramesInFlight;
+            return;
+        }
+
+        // A frame may be recording, both changes wait for the next BeginFrame()
+        if (swapchainChanged) {
+            m_swapchainDirty = true;
+        }
+    }
+
+    void VulkanRenderer::ApplyFramesInFlight() {
+        // Frame slots are about to be renumbered, let the ones in flight finish.
+        // Between frames every fence is either signaled or submitted, so this
+        // only waits for real work.
+        vkWaitForFences(m_device, static_cast<uint32_t>(m_inFlightFences.size()), m_inFlightFences.data(), VK_TRUE, UINT64_MAX);
+
+        m_framesInFlight = m_requestedFramesInFlight;
+        m_currentFrame = 0;
+        m_bindlessTable.SetActiveSlots(m_framesInFlight);
+    }
+
+    VkPresentModeKHR VulkanRenderer::ChoosePresentMode(const VkPresentModeKHR requested) const {
+        uint32_t modeCount = 0;
+        vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &modeCount, nullptr);
+        std::vector<VkPresentModeKHR> supportedModes(modeCount);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(m_physicalDevice, m_surface, &modeCount, supportedModes.data());
+
+        std::vector<VkPresentModeKHR> candidates;
+        switch (requested) {
+            case VK_PRESENT_MODE_MAILBOX_KHR:
+                // Never tears, FIFO is what MAILBOX degrades to
+                candidates = {VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_FIFO_KHR};
+                break;
+            case VK_PRESENT_MODE_IMMEDIATE_KHR:
+                candidates = {VK_PRESENT_MODE_IMMEDIATE_KHR, VK_PRESENT_MODE_MAILBOX_KHR};
+                break;
+            case VK_PRESENT_MODE_FIFO_RELAXED_KHR:
+                candidates = {VK_PRESENT_MODE_FIFO_RELAXED_KHR};
+                break;
+            default:
+                break;
+        }
+
+        for (const auto mode : candidates) {
+            if (std::find(supportedModes.begin(), supportedModes.end(), mode) != supportedModes.end()) {
+                return mode;
+            }
+        }
+
+        // FIFO support is required by the spec
+        return VK_PRESENT_MODE_FIFO_KHR;
+    }
+
+    bool VulkanRenderer::ReadPixels(std::vector<uint8_t>& pixels) {
+        if (!m_headless || m_frameNumber == 0) {
+            return false;
+        }
+
+        vkWaitForFences(m_device, 1, &m_inFlightFences[m_lastSubmittedFrame], VK_TRUE, UINT64_MAX);
+
+        const uint32_t width = m_swapchainExtent.width;
+        const uint32_t height = m_swapchainExtent.height;
+        const VkDeviceSize size = static_cast<VkDeviceSize>(width) * height * 4;
+
+        VulkanBuffer readback;
+        readback.Create(
+            m_allocator,
+            size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+        );
 
-        // Recreate swapchain with new present mode
-        RecreateSwapchain();
+        const VkCommandBuffer cmd = BeginSingleTimeCommands(m_device, m_commandPool);
+
+        // The render pass left the image in TRANSFER_SRC, make its writes visible to the copy
+        VkImageMemoryBarrier imageBarrier{};
+        imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        imageBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        imageBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        imageBarrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        imageBarrier.image = m_swapchainImages[m_lastSubmittedImage];
+        imageBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &imageBarrier);
+
+        VkBufferImageCopy region{};
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+        region.imageExtent = {width, height, 1};
+        vkCmdCopyImageToBuffer(cmd, m_swapchainImages[m_lastSubmittedImage], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                               readback.GetBuffer(), 1, &region);
+
+        VkBufferMemoryBarrier bufferBarrier{};
+        bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        bufferBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        bufferBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        bufferBarrier.buffer = readback.GetBuffer();
+        bufferBarrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+                             0, 0, nullptr, 1, &bufferBarrier, 0, nullptr);
+
+        EndSingleTimeCommands(m_device, m_commandPool, m_graphicsQueue, cmd);
+
+        // The offscreen images use the swapchain's BGRA format
+        const auto* source = static_cast<const uint8_t*>(readback.GetMappedData());
+        pixels.resize(static_cast<size_t>(size));
+        for (size_t i = 0; i < pixels.size(); i += 4) {
+            pixels[i + 0] = source[i + 2];
+            pixels[i + 1] = source[i + 1];
+            pixels[i + 2] = source[i + 0];
+            pixels[i + 3] = source[i + 3];
+        }
+
+        readback.Destroy();
+        return true;
+    }
+
+    void VulkanRenderer::Retire(std::function<void()> destroy) {
+        // The frame being recorded (number m_frameNumber) may still use it
+        m_retired.push_back({m_frameNumber, std::move(destroy)});
+    }
+
+    void VulkanRenderer::FlushRetired() {
+        vkDeviceWaitIdle(m_device);
+        ReleaseRetired(true);
+    }
+
+    void VulkanRenderer::ReleaseRetired(const bool all) {
+        // Called after waiting on the current slot's fence, so every frame up to
+        // m_frameNumber - m_framesInFlight has completed
+        while (!m_retired.empty() &&
+               (all || m_retired.front().frame + m_framesInFlight <= m_frameNumber)) {
+            m_retired.front().destroy();
+            m_retired.pop_front();
+        }
     }
 
     void VulkanRenderer::CleanupSwapchain() {
@@ -279,12 +752,23 @@ namespace REngine {
                 vkDestroySwapchainKHR(m_device, m_swapchain, nullptr);
                 m_swapchain = VK_NULL_HANDLE;
             }
+
+            // Headless images are ours, not the swapchain's
+            if (!m_offscreenAllocations.empty()) {
+                for (size_t i = 0; i < m_swapchainImages.size(); i++) {
+                    vkDestroyImage(m_device, m_swapchainImages[i], nullptr);
+                    m_allocator.Free(m_offscreenAllocations[i]);
+                }
+                m_swapchainImages.clear();
+                m_offscreenAllocations.clear();
+            }
         }
     }
 
     void VulkanRenderer::RecreateSwapchain() {
 
-        if (!m_initialized) {
+        // The headless extent is fixed and there is no present mode to apply
+        if (!m_initialized || m_headless) {
             return;
         }
 
@@ -292,24 +776,50 @@ namespace REngine {
 
         SDL_GetWindowSize(m_window, &width, &height);
 
-        while (width == 0 || height == 0) {
-            SDL_GetWindowSize(m_window, &width, &height);
-
-            SDL_WaitEvent(nullptr);
+        // Minimized, BeginFrame() retries once the window has a size again
+        if (width == 0 || height == 0) {
+            m_swapchainDirty = true;
+            return;
         }
 
-        vkDeviceWaitIdle(m_device);
+        // Frames in flight may still render to or present the old images, so they
+        // are handed to the new swapchain and destroyed once those frames finish
+        VkSwapchainKHR oldSwapchain = m_swapchain;
+        std::vector<VkImageView> oldImageViews = std::move(m_swapchainImageViews);
+        std::vector<VkFramebuffer> oldFramebuffers = std::move(m_framebuffers);
+        m_swapchain = VK_NULL_HANDLE;
+        m_swapchainImageViews.clear();
+        m_framebuffers.clear();
 
-        CleanupSwapchain();
+        const bool created = CreateSwapchain(oldSwapchain) && CreateImageViews() && CreateFramebuffers();
 
-        CreateSwapchain();
+        Retire([device = m_device, oldSwapchain, oldImageViews, oldFramebuffers]() {
+            for (const auto framebuffer : oldFramebuffers) {
+                vkDestroyFramebuffer(device, framebuffer, nullptr);
+            }
+            for (const auto imageView : oldImageViews) {
+                vkDestroyImageView(device, imageView, nullptr);
+            }
+            if (oldSwapchain != VK_NULL_HANDLE) {
+                vkDestroySwapchainKHR(device, oldSwapchain, nullptr);
+            }
+        });
 
-        CreateImageViews();
+        m_swapchainDirty = !created;
 
-        CreateFramebuffers();
+        // ImGui sizes its per-image buffers by this
+        const auto imageCount = static_cast<uint32_t>(m_swapchainImages.size());
+        if (created && m_imguiMinImageCount != 0 && imageCount != m_imguiMinImageCount) {
+            ImGui_ImplVulkan_SetMinImageCount(imageCount);
+            m_imguiMinImageCount = imageCount;
+        }
     }
 
-    bool VulkanRenderer::CreateSwapchain() {
+    bool VulkanRenderer::CreateSwapchain(VkSwapchainKHR oldSwapchain) {
+        if (m_headless) {
+            return CreateOffscreenImages();
+        }
+
         VkSurfaceCapabilitiesKHR capabilities;
 
         vkGetPhysicalDeviceSurfaceCapabilitiesKHR(m_physicalDevice, m_surface, &capabilities);
@@ -322,10 +832,23 @@ namespace REngine {
             m_swapchainExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height)};
         }
 
+        // The surface can report a zero extent while the window is minimized
+        if (m_swapchainExtent.width == 0 || m_swapchainExtent.height == 0) {
+            return false;
+        }
+
+        uint32_t imageCount = m_presentConfig.imageCount > 0 ? m_presentConfig.imageCount : capabilities.minImageCount + 1;
+        imageCount = std::max(imageCount, capabilities.minImageCount);
+        if (capabilities.maxImageCount > 0) {
+            imageCount = std::min(imageCount, capabilities.maxImageCount);
+        }
+
+        m_currentPresentMode = ChoosePresentMode(m_presentConfig.presentMode);
+
         VkSwapchainCreateInfoKHR createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
         createInfo.surface = m_surface;
-        createInfo.minImageCount = capabilities.minImageCount + 1;
+        createInfo.minImageCount = imageCount;
         createInfo.imageFormat = VK_FORMAT_B8G8R8A8_SRGB;
         createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
         createInfo.imageExtent = m_swapchainExtent;
@@ -333,15 +856,14 @@ namespace REngine {
         createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
         createInfo.preTransform = capabilities.currentTransform;
         createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-        createInfo.presentMode = m_Vsync ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_IMMEDIATE_KHR;
+        createInfo.presentMode = m_currentPresentMode;
         createInfo.clipped = VK_TRUE;
+        createInfo.oldSwapchain = oldSwapchain;
 
         if (vkCreateSwapchainKHR(m_device, &createInfo, nullptr, &m_swapchain) != VK_SUCCESS) {
             return false;
         }
 
-        uint32_t imageCount;
-
         vkGetSwapchainImagesKHR(m_device, m_swapchain, &imageCount, nullptr);
 
         m_swapchainImages.resize(imageCount);
@@ -353,7 +875,38 @@ namespace REngine {
         return true;
     }
 
+    bool VulkanRenderer::CreateOffscreenImages() {
+        m_swapchainExtent = m_headlessExtent;
+        m_swapchainImageFormat = VK_FORMAT_B8G8R8A8_SRGB;
+
+        // One image per frame slot, frames in flight can change at runtime
+        m_swapchainImages.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+        m_offscreenAllocations.resize(MAX_FRAMES_IN_FLIGHT);
+
+        for (size_t i = 0; i < m_swapchainImages.size(); i++) {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = m_swapchainImageFormat;
+            imageInfo.extent = {m_swapchainExtent.width, m_swapchainExtent.height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            if (vkCreateImage(m_device, &imageInfo, nullptr, &m_swapchainImages[i]) != VK_SUCCESS) {
+                return false;
+            }
+            m_offscreenAllocations[i] = m_allocator.AllocateForImage(m_swapchainImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+        return true;
+    }
+
     bool VulkanRenderer::CreateImageViews() {
+        m_swapchainGeneration++;
         m_swapchainImageViews.resize(m_swapchainImages.size());
         for (size_t i = 0; i < m_swapchainImages.size(); i++) {
             VkImageViewCreateInfo createInfo{};
@@ -377,6 +930,11 @@ namespace REngine {
     }
 
     bool VulkanRenderer::CreateRenderPass() {
+        // BeginMainPass() does the layout transitions instead
+        if (m_dynamicRendering) {
+            return true;
+        }
+
         VkAttachmentDescription colorAttachment{};
         colorAttachment.format = m_swapchainImageFormat;
         colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -385,7 +943,8 @@ namespace REngine {
         colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        // Headless frames stay ready for ReadPixels()
+        colorAttachment.finalLayout = m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference colorAttachmentRef{};
         colorAttachmentRef.attachment = 0;
@@ -396,20 +955,40 @@ namespace REngine {
         subpass.colorAttachmentCount = 1;
         subpass.pColorAttachments = &colorAttachmentRef;
 
+        // Orders this pass's attachment writes after the previous instance's
+        // (RecordParallel() splits the frame) and after the acquire semaphore wait
+        VkSubpassDependency dependency{};
+        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
+        dependency.dstSubpass = 0;
+        dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.attachmentCount = 1;
         renderPassInfo.pAttachments = &colorAttachment;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
+        renderPassInfo.dependencyCount = 1;
+        renderPassInfo.pDependencies = &dependency;
 
-        if (vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_renderPass) != VK_SUCCESS) {
-            return false;
-        }
+        m_renderPass = m_layoutCache.GetRenderPass(renderPassInfo);
+
+        // Same pass but keeping the contents, only load op and layouts differ so
+        // it stays compatible with framebuffers and pipelines made for m_renderPass
+        colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+        colorAttachment.initialLayout = colorAttachment.finalLayout;
+        m_loadRenderPass = m_layoutCache.GetRenderPass(renderPassInfo);
         return true;
     }
 
     bool VulkanRenderer::CreateFramebuffers() {
+        if (m_dynamicRendering) {
+            return true;
+        }
+
         m_framebuffers.resize(m_swapchainImageViews.size());
         for (size_t i = 0; i < m_swapchainImageViews.size(); i++) {
             VkImageView attachments[] = {m_swapchainImageViews[i]};
@@ -443,6 +1022,7 @@ namespace REngine {
     }
 
     bool VulkanRenderer::CreateCommandBuffers() {
+        // Allocated for the maximum so frames in flight can change at runtime
         m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
         VkCommandBufferAllocateInfo allocInfo{};
@@ -480,14 +1060,162 @@ namespace REngine {
         return true;
     }
 
+    bool VulkanRenderer::CreateGpuProfiler() {
+        // One query range per frame slot, frames in flight can change at runtime
+        m_gpuProfiler.Initialize(m_device, m_physicalDevice, m_graphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT);
+        return true;
+    }
+
+    bool VulkanRenderer::CreateRecordingPools() {
+        m_recordThreads = std::make_unique<RThreadPool>(m_recordThreadCount);
+
+        // One pool per worker plus one for the calling thread, per frame slot
+        m_recordPools.Initialize(m_device, m_graphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT, m_recordThreads->GetThreadCount() + 1);
+        return true;
+    }
+
+    bool VulkanRenderer::CreateBindlessTable() {
+        const VkPhysicalDeviceLimits& limits = m_allocator.GetDeviceProperties().limits;
+        uint32_t limit = std::min({
+            limits.maxPerStageDescriptorSamplers,
+            limits.maxPerStageDescriptorSampledImages,
+            limits.maxDescriptorSetSamplers,
+            limits.maxDescriptorSetSampledImages
+        });
+
+        if (m_descriptorIndexing) {
+            VkPhysicalDeviceDescriptorIndexingPropertiesEXT indexingProperties{};
+            indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES_EXT;
+
+            VkPhysicalDeviceProperties2 properties{};
+            properties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+            properties.pNext = &indexingProperties;
+            vkGetPhysicalDeviceProperties2(m_physicalDevice, &properties);
+
+            limit = std::min({
+                indexingProperties.maxPerStageDescriptorUpdateAfterBindSamplers,
+                indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+                indexingProperties.maxDescriptorSetUpdateAfterBindSamplers,
+                indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages
+            });
+        }
+
+        const uint32_t available = limit > 2 * RESERVED_SAMPLER_DESCRIPTORS ? limit - RESERVED_SAMPLER_DESCRIPTORS : limit / 2;
+        m_bindlessTable.Initialize(m_device, m_descriptorIndexing, MAX_FRAMES_IN_FLIGHT, std::min(m_bindlessCapacity, available));
+        m_bindlessTable.SetActiveSlots(m_framesInFlight);
+
+        // Registers first, so it always gets element 0
+        constexpr uint32_t white = 0xFFFFFFFF;
+        m_defaultTexture = std::make_unique<Texture>();
+        m_defaultTexture->CreateFromData(*this, &white, 1, 1, VK_FORMAT_R8G8B8A8_UNORM, false);
+        m_bindlessTable.SetDefault(m_defaultTexture->GetView(), m_defaultTexture->GetSampler());
+        return true;
+    }
+
+    bool VulkanRenderer::QueryDescriptorIndexing() const {
+        // Feature queries need vkGetPhysicalDeviceFeatures2 (Vulkan 1.1)
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        if (m_instanceApiVersion < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, extensions.data());
+
+        const bool hasExtension = std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension) {
+            return std::strcmp(extension.extensionName, VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME) == 0;
+        });
+        if (!hasExtension) {
+            return false;
+        }
+
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &indexingFeatures;
+        vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features);
+
+        return indexingFeatures.shaderSampledImageArrayNonUniformIndexing &&
+               indexingFeatures.runtimeDescriptorArray &&
+               indexingFeatures.descriptorBindingSampledImageUpdateAfterBind &&
+               indexingFeatures.descriptorBindingUpdateUnusedWhilePending &&
+               indexingFeatures.descriptorBindingPartiallyBound;
+    }
+
+    bool VulkanRenderer::QueryDynamicRendering() const {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        if (m_instanceApiVersion < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, extensions.data());
+
+        // The instance targets 1.1 at most, so the extension is used even where
+        // it is core, along with the two it depends on that became core in 1.2
+        for (const char* name : {VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME, VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
+                                 VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME}) {
+            const bool hasExtension = std::any_of(extensions.begin(), extensions.end(), [name](const VkExtensionProperties& extension) {
+                return std::strcmp(extension.extensionName, name) == 0;
+            });
+            if (!hasExtension) {
+                return false;
+            }
+        }
+
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+
+        VkPhysicalDeviceFeatures2 features{};
+        features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features.pNext = &dynamicRenderingFeatures;
+        vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features);
+
+        return dynamicRenderingFeatures.dynamicRendering;
+    }
+
+    bool VulkanRenderer::QueryMemoryBudget() const {
+        // The budget is read through vkGetPhysicalDeviceMemoryProperties2 (Vulkan 1.1)
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        if (m_instanceApiVersion < VK_API_VERSION_1_1 || properties.apiVersion < VK_API_VERSION_1_1) {
+            return false;
+        }
+
+        uint32_t extensionCount = 0;
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, nullptr);
+        std::vector<VkExtensionProperties> extensions(extensionCount);
+        vkEnumerateDeviceExtensionProperties(m_physicalDevice, nullptr, &extensionCount, extensions.data());
+
+        return std::any_of(extensions.begin(), extensions.end(), [](const VkExtensionProperties& extension) {
+            return std::strcmp(extension.extensionName, VK_EXT_MEMORY_BUDGET_EXTENSION_NAME) == 0;
+        });
+    }
+
     bool VulkanRenderer::CreateLogicalDevice() {
         // Queue creation
         float queuePriority = 1.0f;
+        std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
+
         VkDeviceQueueCreateInfo queueCreateInfo{};
         queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueCreateInfo.queueFamilyIndex = m_graphicsQueueFamilyIndex;
         queueCreateInfo.queueCount = 1;
         queueCreateInfo.pQueuePriorities = &queuePriority;
+        queueCreateInfos.push_back(queueCreateInfo);
+
+        if (m_transferQueueFamilyIndex != m_graphicsQueueFamilyIndex) {
+            queueCreateInfo.queueFamilyIndex = m_transferQueueFamilyIndex;
+            queueCreateInfos.push_back(queueCreateInfo);
+        }
 
         // Device features
         VkPhysicalDeviceFeatures deviceFeatures{};
@@ -495,16 +1223,49 @@ namespace REngine {
         // Device creation
         VkDeviceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-        createInfo.pQueueCreateInfos = &queueCreateInfo;
-        createInfo.queueCreateInfoCount = 1;
+        createInfo.pQueueCreateInfos = queueCreateInfos.data();
+        createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
         createInfo.pEnabledFeatures = &deviceFeatures;
 
         // Extensions
-        const std::vector<const char*> deviceExtensions = {
-            VK_KHR_SWAPCHAIN_EXTENSION_NAME
-        };
+        std::vector<const char*> deviceExtensions;
+        if (!m_headless) {
+            deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+
+        // Only what the bindless table uses
+        VkPhysicalDeviceDescriptorIndexingFeaturesEXT indexingFeatures{};
+        indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES_EXT;
+        m_descriptorIndexing = QueryDescriptorIndexing();
+        if (m_descriptorIndexing) {
+            indexingFeatures.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+            indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+            indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            indexingFeatures.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+            deviceExtensions.push_back(VK_EXT_DESCRIPTOR_INDEXING_EXTENSION_NAME);
+            indexingFeatures.pNext = createInfo.pNext;
+            createInfo.pNext = &indexingFeatures;
+        }
+
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        m_dynamicRendering = m_preferDynamicRendering && (m_headless || IMGUI_DYNAMIC_RENDERING) && QueryDynamicRendering();
+        if (m_dynamicRendering) {
+            dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+            deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+            deviceExtensions.push_back(VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME);
+            deviceExtensions.push_back(VK_KHR_CREATE_RENDERPASS_2_EXTENSION_NAME);
+            dynamicRenderingFeatures.pNext = createInfo.pNext;
+            createInfo.pNext = &dynamicRenderingFeatures;
+        }
+
+        m_memoryBudget = QueryMemoryBudget();
+        if (m_memoryBudget) {
+            deviceExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+        }
         createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-        createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+        createInfo.ppEnabledExtensionNames = deviceExtensions.empty() ? nullptr : deviceExtensions.data();
 
         if (vkCreateDevice(m_physicalDevice, &createInfo, nullptr, &m_device) != VK_SUCCESS) {
             return false;
@@ -513,10 +1274,47 @@ namespace REngine {
         // Get queues
         vkGetDeviceQueue(m_device, m_graphicsQueueFamilyIndex, 0, &m_graphicsQueue);
         vkGetDeviceQueue(m_device, m_presentQueueFamilyIndex, 0, &m_presentQueue);
+        vkGetDeviceQueue(m_device, m_transferQueueFamilyIndex, 0, &m_transferQueue);
+
+        if (m_dynamicRendering) {
+            m_cmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(vkGetDeviceProcAddr(m_device, "vkCmdBeginRenderingKHR"));
+            m_cmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(vkGetDeviceProcAddr(m_device, "vkCmdEndRenderingKHR"));
+            if (!m_cmdBeginRendering || !m_cmdEndRendering) {
+                throw std::runtime_error("Failed to load dynamic rendering commands!");
+            }
+        }
 
         return true;
     }
 
+    bool VulkanRenderer::CreateAllocator() {
+        m_allocator.Initialize(m_device, m_physicalDevice, m_memoryBudget);
+        m_stagingRing.Initialize(m_allocator);
+        m_uploadManager.Initialize(
+            m_allocator,
+            m_stagingRing,
+            m_transferQueue,
+            m_transferQueueFamilyIndex,
+            m_graphicsQueue,
+            m_graphicsQueueFamilyIndex
+        );
+        return true;
+    }
+
+    bool VulkanRenderer::CreateCaches() {
+        m_pipelineCache.Initialize(m_device, m_physicalDevice, m_pipelineCachePath);
+        m_layoutCache.Initialize(m_device);
+        m_descriptorAllocator.Initialize(m_device, m_layoutCache, MAX_FRAMES_IN_FLIGHT);
+        m_shaderHotReloader.Initialize(*this);
+
+        // Writing sRGB mips through a UNORM view needs VK_IMAGE_CREATE_EXTENDED_USAGE_BIT (Vulkan 1.1)
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        const bool vulkan11 = m_instanceApiVersion >= VK_API_VERSION_1_1 && properties.apiVersion >= VK_API_VERSION_1_1;
+        m_mipGenerator.Initialize(m_device, m_physicalDevice, m_layoutCache, m_pipelineCache.GetCache(), vulkan11);
+        return true;
+    }
+
     bool VulkanRenderer::SelectPhysicalDevice() {
         uint32_t deviceCount = 0;
         vkEnumeratePhysicalDevices(m_instance, &deviceCount, nullptr);
@@ -537,13 +1335,26 @@ namespace REngine {
 
             // Find graphics and present queue families
             for (uint32_t i = 0; i < queueFamilyCount; i++) {
-                VkBool32 presentSupport = false;
-                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+                // Headless frames are never presented
+                VkBool32 presentSupport = m_headless;
+                if (!m_headless) {
+                    vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &presentSupport);
+                }
 
                 if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT && presentSupport) {
                     m_physicalDevice = device;
                     m_graphicsQueueFamilyIndex = i;
                     m_presentQueueFamilyIndex = i;
+
+                    // Prefer a transfer-only family (DMA engine) for uploads
+                    m_transferQueueFamilyIndex = i;
+                    for (uint32_t j = 0; j < queueFamilyCount; j++) {
+                        const VkQueueFlags flags = queueFamilies[j].queueFlags;
+                        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+                            m_transferQueueFamilyIndex = j;
+                            break;
+                        }
+                    }
                     return true;
                 }
             }
@@ -553,6 +1364,9 @@ namespace REngine {
     }
 
     bool VulkanRenderer::CreateSurface() {
+        if (m_headless) {
+            return true;
+        }
         if (!SDL_Vulkan_CreateSurface(m_window, m_instance, &m_surface)) {
             return false;
         }
@@ -568,18 +1382,31 @@ namespace REngine {
         appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
         appInfo.apiVersion = VK_API_VERSION_1_0;
 
+        // 1.1 where the loader has it, descriptor indexing needs the 1.1 feature queries
+        const auto enumerateInstanceVersion = reinterpret_cast<PFN_vkEnumerateInstanceVersion>(
+            vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion"));
+        uint32_t loaderVersion = VK_API_VERSION_1_0;
+        if (enumerateInstanceVersion && enumerateInstanceVersion(&loaderVersion) == VK_SUCCESS &&
+            loaderVersion >= VK_API_VERSION_1_1) {
+            appInfo.apiVersion = VK_API_VERSION_1_1;
+        }
+        m_instanceApiVersion = appInfo.apiVersion;
+
         VkInstanceCreateInfo createInfo{};
         createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
         createInfo.pApplicationInfo = &appInfo;
 
-        // Get required extensions from SDL
-        uint32_t extensionCount = 0;
-        SDL_Vulkan_GetInstanceExtensions(m_window, &extensionCount, nullptr);
-        std::vector<const char*> extensions(extensionCount);
-        SDL_Vulkan_GetInstanceExtensions(m_window, &extensionCount, extensions.data());
+        // Get required extensions from SDL, headless needs no surface extensions
+        std::vector<const char*> extensions;
+        if (!m_headless) {
+            uint32_t extensionCount = 0;
+            SDL_Vulkan_GetInstanceExtensions(m_window, &extensionCount, nullptr);
+            extensions.resize(extensionCount);
+            SDL_Vulkan_GetInstanceExtensions(m_window, &extensionCount, extensions.data());
+        }
 
         createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
-        createInfo.ppEnabledExtensionNames = extensions.data();
+        createInfo.ppEnabledExtensionNames = extensions.empty() ? nullptr : extensions.data();
 
         if (vkCreateInstance(&createInfo, nullptr, &m_instance) != VK_SUCCESS) {
             return false;
@@ -603,10 +1430,19 @@ namespace REngine {
 
     bool VulkanRenderer::RecreateVulkanDevice() {
         Shutdown();
+        if (m_headless) {
+            return InitializeHeadless(m_headlessExtent.width, m_headlessExtent.height);
+        }
         return Initialize(m_window); // Reinitialize with existing window
     }
 
     void VulkanRenderer::InitImGui(SDL_Window* window) {
+        if (m_headless) {
+            throw std::runtime_error("ImGui requires a window!");
+        }
+
+        const auto startTime = std::chrono::steady_clock::now();
+
         VkDescriptorPoolSize pool_sizes[] = {{ VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },};
         vkCreateDescriptorPool(m_device, &m_poolInfo, nullptr, &m_imguiDescriptorPool);
 
@@ -623,20 +1459,35 @@ namespace REngine {
         init_info.Device = m_device;
         init_info.QueueFamily = m_graphicsQueueFamilyIndex;
         init_info.Queue = m_graphicsQueue;
-        init_info.PipelineCache = VK_NULL_HANDLE;
+        init_info.PipelineCache = m_pipelineCache.GetCache();
         init_info.DescriptorPool = m_imguiDescriptorPool; // Create this earlier!
-        init_info.MinImageCount = m_swapchainImages.size();
-        init_info.ImageCount = m_swapchainImages.size();
+        m_imguiMinImageCount = static_cast<uint32_t>(m_swapchainImages.size());
+        init_info.MinImageCount = m_imguiMinImageCount;
+        // ImGui keeps one vertex/index buffer set per image, it must cover every frame in flight
+        init_info.ImageCount = std::max<uint32_t>(static_cast<uint32_t>(m_swapchainImages.size()), MAX_FRAMES_IN_FLIGHT);
         init_info.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+#ifdef IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING
+        if (m_dynamicRendering) {
+            init_info.UseDynamicRendering = true;
+            init_info.PipelineRenderingCreateInfo = {};
+            init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO_KHR;
+            init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+            init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &m_swapchainImageFormat;
+        }
+#endif
         init_info.RenderPass = m_renderPass;
         ImGui_ImplVulkan_Init(&init_info); // Use your main render pass
 
         // 3. Create default fonts texture.
         ImGui_ImplVulkan_CreateFontsTexture();
 
+        // ImGui builds its pipeline here, so it counts towards startup
+        m_startupTimeMS += std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - startTime).count();
     }
 
-    void VulkanRenderer::RenderImGui() const {
+    void VulkanRenderer::RenderImGui() {
+        RPROFILE_SCOPE("VulkanRenderer::RenderImGui");
+
         ImGui_ImplVulkan_NewFrame();
         ImGui_ImplSDL2_NewFrame(); // Pass SDL_Window*
         ImGui::NewFrame();
@@ -644,11 +1495,58 @@ namespace REngine {
         // Draw your debug text
         ImGui::Begin("STATS",0,ImGuiWindowFlags_NoMove);
         ImGui::Text("FPS: %.1f", ImGui::GetIO().Framerate);
+
+        const FrameStatsSnapshot& frameStats = RTime::GetFrameStats();
+        ImGui::Text("Frame ms: p50 %.2f  p95 %.2f  p99 %.2f  p99.9 %.2f  max %.2f",
+            frameStats.p50MS, frameStats.p95MS, frameStats.p99MS, frameStats.p999MS, frameStats.maxMS);
+        ImGui::Text("Hitches (>%.1f ms): %u in last %u frames, %llu total", RTime::GetHitchThresholdMS(),
+            frameStats.hitchCount, frameStats.frameCount, static_cast<unsigned long long>(frameStats.totalHitchCount));
+        ImGui::Text("Present: %s, %u images, %u frames in flight", PresentModeName(m_currentPresentMode), GetSwapchainImageCount(), m_framesInFlight);
+
+        const VulkanAllocatorStats memoryStats = m_allocator.GetStats();
+        ImGui::Text("GPU memory: %.1f / %.1f MB", memoryStats.usedBytes / (1024.0 * 1024.0), memoryStats.blockBytes / (1024.0 * 1024.0));
+        const VulkanHeapBudget heapBudget = m_allocator.GetHeapBudget(m_allocator.GetDeviceLocalHeap());
+        ImGui::Text("VRAM: %.1f / %.1f MB (%s)", heapBudget.usage / (1024.0 * 1024.0), heapBudget.budget / (1024.0 * 1024.0),
+            m_allocator.UsesMemoryBudget() ? "memory budget" : "estimated");
+        ImGui::Text("Allocations: %u (%u blocks, %u dedicated)", memoryStats.allocationCount, memoryStats.blockCount, memoryStats.dedicatedAllocationCount);
+        ImGui::Text("Bindless: %u / %u textures (%s)", m_bindlessTable.GetLiveCount(), m_bindlessTable.GetCapacity(),
+            m_bindlessTable.UsesDescriptorIndexing() ? "update after bind" : "per-frame sets");
+        const LayoutCacheStats layoutStats = m_layoutCache.GetStats();
+        const auto hitRate = [](const LayoutCacheCounts& counts) {
+            const uint64_t lookups = counts.hits + counts.misses;
+            return lookups ? 100.0 * counts.hits / lookups : 0.0;
+        };
+        ImGui::Text("Layouts: %u set (%.1f%% hits), %u pipeline (%.1f%% hits)",
+            layoutStats.setLayouts.objects, hitRate(layoutStats.setLayouts),
+            layoutStats.pipelineLayouts.objects, hitRate(layoutStats.pipelineLayouts));
+        ImGui::Text("Samplers: %u (%.1f%% hits), render passes: %u (%.1f%% hits)",
+            layoutStats.samplers.objects, hitRate(layoutStats.samplers),
+            layoutStats.renderPasses.objects, hitRate(layoutStats.renderPasses));
+        const DescriptorAllocatorStats descriptorStats = m_descriptorAllocator.GetStats();
+        const uint64_t descriptorLookups = descriptorStats.cacheHits + descriptorStats.cacheMisses;
+        ImGui::Text("Descriptor sets: %u this frame, %u cached (%.1f%% hits), %u pools", descriptorStats.setsThisFrame,
+            descriptorStats.cachedSets, descriptorLookups ? 100.0 * descriptorStats.cacheHits / descriptorLookups : 0.0,
+            descriptorStats.poolCount);
+        const MipGeneratorStats mipStats = m_mipGenerator.GetStats();
+        ImGui::Text("Mip chains: %llu compute (%llu dispatches), %llu blit, %llu barriers",
+            static_cast<unsigned long long>(mipStats.computeChains), static_cast<unsigned long long>(mipStats.dispatches),
+            static_cast<unsigned long long>(mipStats.blitChains), static_cast<unsigned long long>(mipStats.barriers));
+        ImGui::Text("Startup: %.1f ms (%s pipeline cache)", m_startupTimeMS, m_pipelineCache.IsWarm() ? "warm" : "cold");
+
+        if (m_gpuProfiler.IsSupported()) {
+            ImGui::Separator();
+            for (const auto& scope : m_gpuProfiler.GetResults()) {
+                ImGui::Text("%*sGPU %s: %.3f ms", static_cast<int>(scope.depth * 2), "", scope.name.c_str(), scope.timeMS);
+            }
+        } else {
+            ImGui::Text("GPU timestamps not supported");
+        }
         ImGui::End();
 
         // Render
         ImGui::Render();
         ImDrawData* draw_data = ImGui::GetDrawData();
+        GpuScope scope(m_gpuProfiler, m_commandBuffers[m_currentFrame], "ImGui");
         ImGui_ImplVulkan_RenderDrawData(draw_data, m_commandBuffers[m_currentFrame]);
     }
 
@@ -4,9 +4,42 @@
 #include <SDL_vulkan.h>
 #include <vulkan/vulkan.h>
 #include <vector>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <stdexcept>
+#include <string>
+#include <RThreadPool.h>
+#include <VulkanAllocator.h>
+#include <VulkanBindlessTable.h>
+#include <VulkanCommandPools.h>
+#include <VulkanDescriptorAllocator.h>
+#include <VulkanGpuProfiler.h>
+#include <VulkanLayoutCache.h>
+#include <VulkanMipGenerator.h>
+#include <VulkanPipelineCache.h>
+#include <VulkanStagingRing.h>
+#include <VulkanUploadManager.h>
+#include "ShaderCache.h"
+#include "ShaderHotReloader.h"
 
 namespace REngine {
+    class Texture;
+    class RenderGraph;
+
+    struct PresentConfig {
+        // Falls back to the closest supported mode, FIFO is always available:
+        // MAILBOX -> IMMEDIATE -> FIFO, IMMEDIATE -> MAILBOX -> FIFO, FIFO_RELAXED -> FIFO
+        VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+
+        // 0 uses minImageCount + 1, clamped to the surface limits
+        uint32_t imageCount = 0;
+
+        // 1 gives the lowest latency, more frames trade latency for throughput.
+        // Clamped to [1, MAX_FRAMES_IN_FLIGHT].
+        uint32_t framesInFlight = 2;
+    };
 
     class VulkanRenderer {
     public:
@@ -16,6 +49,17 @@ namespace REngine {
 
         bool Initialize(SDL_Window* window);
 
+        // No window, surface or present queue. Frames render into a ring of
+        // offscreen color images, one per frame slot, so this runs on software
+        // devices (lavapipe, SwiftShader) without a display. ImGui is unavailable.
+        bool InitializeHeadless(uint32_t width, uint32_t height);
+
+        [[nodiscard]] bool IsHeadless() const { return m_headless; }
+
+        // Headless only: waits for the last submitted frame and copies its color
+        // image out as tightly packed RGBA8 rows. Returns false if nothing was rendered.
+        bool ReadPixels(std::vector<uint8_t>& pixels);
+
         void Shutdown();
 
         bool BeginFrame();
@@ -24,8 +68,55 @@ namespace REngine {
 
         void CheckVkResult(VkResult result);
 
+        // Records the tasks on worker threads into secondary command buffers and
+        // executes them in task order, between BeginFrame() and EndFrame(). Each
+        // secondary continues the frame's render pass and inherits no dynamic
+        // state, so every task sets its own viewport and scissor.
+        void RecordParallel(const std::vector<std::function<void(VkCommandBuffer)>>& tasks);
+
+        // Records the graph's passes between BeginFrame() and EndFrame(). The
+        // frame's render pass is split around them and continues afterwards
+        // with what was drawn before, plus whatever the graph wrote to the backbuffer.
+        void ExecuteRenderGraph(RenderGraph& graph);
+
+        // Worker threads for RecordParallel(), 0 uses hardware threads - 1.
+        // Must be set before Initialize().
+        void SetRecordThreadCount(uint32_t count) { m_recordThreadCount = count; }
+
         void SetVsync(bool enabled);
 
+        // Takes effect at the next BeginFrame(), which recreates the swapchain if
+        // the present mode or image count changed. Safe to call mid-frame.
+        void SetPresentConfig(const PresentConfig& config);
+        [[nodiscard]] const PresentConfig& GetPresentConfig() const { return m_presentConfig; }
+
+        // The mode actually in use after fallback
+        [[nodiscard]] VkPresentModeKHR GetPresentMode() const { return m_currentPresentMode; }
+        [[nodiscard]] uint32_t GetSwapchainImageCount() const { return static_cast<uint32_t>(m_swapchainImages.size()); }
+        [[nodiscard]] uint32_t GetFramesInFlight() const { return m_framesInFlight; }
+        [[nodiscard]] VkExtent2D GetExtent() const { return m_swapchainExtent; }
+
+        // Changes whenever the backbuffer views are recreated, so caches keyed by
+        // view handles can tell a reused handle from the old view
+        [[nodiscard]] uint64_t GetSwapchainGeneration() const { return m_swapchainGeneration; }
+
+        // The image the current frame renders into, valid between BeginFrame()
+        // and EndFrame(). Outside the frame's render pass it is in GetBackbufferLayout().
+        [[nodiscard]] VkImage GetBackbufferImage() const { return m_swapchainImages[m_imageIndex]; }
+        [[nodiscard]] VkImageView GetBackbufferView() const { return m_swapchainImageViews[m_imageIndex]; }
+        [[nodiscard]] VkFormat GetBackbufferFormat() const { return m_swapchainImageFormat; }
+        [[nodiscard]] VkImageLayout GetBackbufferLayout() const {
+            return m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        }
+
+        // Slot of the frame being recorded, in [0, MAX_FRAMES_IN_FLIGHT)
+        [[nodiscard]] uint32_t GetCurrentFrameSlot() const { return m_currentFrame; }
+        [[nodiscard]] uint64_t GetFrameNumber() const { return m_frameNumber; }
+
+        static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+
+        // Never waits on the device: the old swapchain is passed as oldSwapchain
+        // and its views and framebuffers are retired with the frames using them
         void RecreateSwapchain();
 
         void HandleDeviceLost();
@@ -34,7 +125,7 @@ namespace REngine {
 
         void InitImGui(SDL_Window *window);
 
-        void RenderImGui() const;
+        void RenderImGui();
 
         void ProcessImGuiEvents(const SDL_Event *event) const;
 
@@ -44,31 +135,118 @@ namespace REngine {
         [[nodiscard]] VkPhysicalDevice GetPhysicalDevice() const { return m_physicalDevice; }
         [[nodiscard]] VkCommandPool GetCommandPool() const { return m_commandPool; }
         [[nodiscard]] VkQueue GetQueue() const { return m_graphicsQueue; }
+        [[nodiscard]] VkCommandBuffer GetCurrentCommandBuffer() const { return m_commandBuffers[m_currentFrame]; }
+        [[nodiscard]] VulkanAllocator& GetAllocator() { return m_allocator; }
+        [[nodiscard]] VulkanStagingRing& GetStagingRing() { return m_stagingRing; }
+        [[nodiscard]] VulkanUploadManager& GetUploadManager() { return m_uploadManager; }
+        [[nodiscard]] VulkanMipGenerator& GetMipGenerator() { return m_mipGenerator; }
+
+        // Pass to every vkCreate*Pipelines call
+        [[nodiscard]] VkPipelineCache GetPipelineCache() const { return m_pipelineCache.GetCache(); }
+
+        [[nodiscard]] VulkanLayoutCache& GetLayoutCache() { return m_layoutCache; }
+
+        // Sets for the layouts in Shader::GetSetLayouts(), reset with their frame slot
+        [[nodiscard]] VulkanDescriptorAllocator& GetDescriptorAllocator() { return m_descriptorAllocator; }
+        [[nodiscard]] ShaderCache& GetShaderCache() { return m_shaderCache; }
+        [[nodiscard]] ShaderHotReloader& GetShaderHotReloader() { return m_shaderHotReloader; }
+        [[nodiscard]] VulkanGpuProfiler& GetGpuProfiler() { return m_gpuProfiler; }
+
+        // Every texture registers itself here. Shaders declare the table alone in
+        // its set as `layout(set = N, binding = 0) uniform sampler2D textures[];`
+        // and bind GetBindlessSet() once per frame. Element 0 is a white texture
+        // and unused elements fall back to it.
+        [[nodiscard]] VulkanBindlessTable& GetBindlessTable() { return m_bindlessTable; }
+        [[nodiscard]] VkDescriptorSet GetBindlessSet() const { return m_bindlessTable.GetSet(m_currentFrame); }
+
+        // Requested table size, clamped to the device limits. Must be set before Initialize().
+        void SetBindlessCapacity(uint32_t capacity) { m_bindlessCapacity = capacity; }
+
+        // VK_EXT_descriptor_indexing with the features the bindless table needs
+        [[nodiscard]] bool SupportsDescriptorIndexing() const { return m_descriptorIndexing; }
+
+        // Renders the frame with VK_KHR_dynamic_rendering instead of VkRenderPass
+        // and VkFramebuffer objects, so swapchain recreation creates no framebuffers.
+        // Falls back to render passes on devices without it. Must be set before Initialize().
+        void SetDynamicRendering(bool enabled) { m_preferDynamicRendering = enabled; }
+        [[nodiscard]] bool UsesDynamicRendering() const { return m_dynamicRendering; }
+
+        // Pipelines drawn in the main pass are created for this render pass, or
+        // with VkPipelineRenderingCreateInfoKHR and GetBackbufferFormat() when it is VK_NULL_HANDLE
+        [[nodiscard]] VkRenderPass GetMainRenderPass() const { return m_renderPass; }
+
+        // Only valid when UsesDynamicRendering()
+        void CmdBeginRendering(VkCommandBuffer cmd, const VkRenderingInfoKHR& info) const { m_cmdBeginRendering(cmd, &info); }
+        void CmdEndRendering(VkCommandBuffer cmd) const { m_cmdEndRendering(cmd); }
+
+        // Runs destroy once every frame that may still reference the object has
+        // finished on the GPU. Render thread only.
+        void Retire(std::function<void()> destroy);
+
+        // Waits for the device to go idle and runs everything retired so far,
+        // for code that creates and drops resources without rendering frames.
+        // Between frames, render thread only.
+        void FlushRetired();
+
+        // Must be set before Initialize()
+        void SetPipelineCachePath(const std::string& path) { m_pipelineCachePath = path; }
+
+        // Time spent in Initialize() and InitImGui(), for comparing cold and warm pipeline caches
+        [[nodiscard]] float GetStartupTimeMS() const { return m_startupTimeMS; }
 
 
     private:
 
-        // Vsync
-        bool m_Vsync = true;
-        VkPresentModeKHR m_currentPresentMode;
+        // Presentation
+        PresentConfig m_presentConfig;
+        VkPresentModeKHR m_currentPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+        uint32_t m_framesInFlight = 2;
+        uint32_t m_requestedFramesInFlight = 2;  // Applied by the next BeginFrame()
+        uint64_t m_swapchainGeneration = 0;
+        uint32_t m_imguiMinImageCount = 0;       // 0 until InitImGui()
 
         VkDescriptorPool m_imguiDescriptorPool;
         VkDescriptorPoolCreateInfo m_poolInfo;
 
-        // Constants
-        static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
-
         // Core Vulkan objects
         VkInstance m_instance;
         VkPhysicalDevice m_physicalDevice;
         VkDevice m_device;
         VkSurfaceKHR m_surface;
 
+        // Device memory
+        VulkanAllocator m_allocator;
+        VulkanStagingRing m_stagingRing;
+        VulkanUploadManager m_uploadManager;
+        VulkanMipGenerator m_mipGenerator;
+        bool m_memoryBudget = false;  // VK_EXT_memory_budget, see VulkanAllocator::GetHeapBudget()
+
+        // Pipeline, layout and shader caches, descriptor sets
+        VulkanPipelineCache m_pipelineCache;
+        VulkanLayoutCache m_layoutCache;
+        VulkanDescriptorAllocator m_descriptorAllocator;
+        ShaderCache m_shaderCache;
+        ShaderHotReloader m_shaderHotReloader;
+
+        // Bindless textures
+        VulkanBindlessTable m_bindlessTable;
+        std::unique_ptr<Texture> m_defaultTexture;
+        uint32_t m_bindlessCapacity = VulkanBindlessTable::DEFAULT_CAPACITY;
+        bool m_descriptorIndexing = false;
+        uint32_t m_instanceApiVersion = VK_API_VERSION_1_0;
+
+        // GPU timestamps
+        VulkanGpuProfiler m_gpuProfiler;
+        std::string m_pipelineCachePath = "pipeline_cache.bin";
+        float m_startupTimeMS = 0.0f;
+
         // Queues
         VkQueue m_graphicsQueue;
         VkQueue m_presentQueue;
+        VkQueue m_transferQueue;
         uint32_t m_graphicsQueueFamilyIndex;
         uint32_t m_presentQueueFamilyIndex;
+        uint32_t m_transferQueueFamilyIndex;
 
         // Swapchain
         VkSwapchainKHR m_swapchain;
@@ -76,11 +254,32 @@ namespace REngine {
         std::vector<VkImageView> m_swapchainImageViews;
         VkFormat m_swapchainImageFormat;
         VkExtent2D m_swapchainExtent;
+        bool m_swapchainDirty = false;  // Recreation pending (e.g. window minimized)
+
+        // Headless targets stand in for the swapchain images
+        bool m_headless = false;
+        VkExtent2D m_headlessExtent{};
+        std::vector<VulkanAllocation> m_offscreenAllocations;
+        uint32_t m_lastSubmittedFrame = 0;  // Frame slot and image of the last EndFrame()
+        uint32_t m_lastSubmittedImage = 0;
 
-        // Rendering
+        // Rendering, the render passes and framebuffers stay null with dynamic rendering
         VkRenderPass m_renderPass;
+        VkRenderPass m_loadRenderPass;  // Compatible with m_renderPass, keeps the contents
         std::vector<VkFramebuffer> m_framebuffers;
 
+        // Dynamic rendering
+        bool m_preferDynamicRendering = true;
+        bool m_dynamicRendering = false;
+        bool m_backbufferAttached = false;  // In COLOR_ATTACHMENT_OPTIMAL between main pass instances
+        PFN_vkCmdBeginRenderingKHR m_cmdBeginRendering = nullptr;
+        PFN_vkCmdEndRenderingKHR m_cmdEndRendering = nullptr;
+
+        // Parallel recording, the calling thread records too and uses the last pool
+        VulkanCommandPools m_recordPools;
+        std::unique_ptr<RThreadPool> m_recordThreads;
+        uint32_t m_recordThreadCount = 0;
+
         // Command buffers
         VkCommandPool m_commandPool;
         std::vector<VkCommandBuffer> m_commandBuffers;
@@ -90,27 +289,50 @@ namespace REngine {
         std::vector<VkSemaphore> m_renderFinishedSemaphores;
         std::vector<VkFence> m_inFlightFences;
 
+        // Deferred destruction, keyed by the frame number at retirement
+        struct RetiredObject {
+            uint64_t frame;
+            std::function<void()> destroy;
+        };
+        std::deque<RetiredObject> m_retired;
+
         // State
+        uint64_t m_frameNumber = 0;  // Frames submitted so far
         uint32_t m_currentFrame;
         uint32_t m_imageIndex;
         SDL_Window* m_window;
         bool m_initialized = false;
 
         // Initialization methods
+        bool InitializeVulkan();
         bool CreateInstance();
         bool CreateSurface();
         bool SelectPhysicalDevice();
         bool CreateLogicalDevice();
-        bool CreateSwapchain();
+        bool CreateAllocator();
+        bool CreateCaches();
+        bool CreateSwapchain(VkSwapchainKHR oldSwapchain = VK_NULL_HANDLE);
+        bool CreateOffscreenImages();
         bool CreateImageViews();
         bool CreateRenderPass();
         bool CreateFramebuffers();
         bool CreateCommandPool();
         bool CreateCommandBuffers();
         bool CreateSyncObjects();
+        bool CreateGpuProfiler();
+        bool CreateRecordingPools();
+        bool CreateBindlessTable();
+        bool QueryDescriptorIndexing() const;
+        bool QueryDynamicRendering() const;
+        bool QueryMemoryBudget() const;
 
         // Helper methods
         void CleanupSwapchain();
+        void BeginMainPass(bool load, VkSubpassContents contents);
+        void EndMainPass(bool toBackbufferLayout);
+        void ReleaseRetired(bool all = false);
+        VkPresentModeKHR ChoosePresentMode(VkPresentModeKHR requested) const;
+        void ApplyFramesInFlight();
 
         // Handle Device Lost
         bool m_deviceLost = false;
@@ -0,0 +1,369 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <core/REngineCore.h>
+#include <core/VulkanBuffer.h>
+#include <renderers/Shader.h>
+
+using REngine::PresentConfig;
+using REngine::Shader;
+using REngine::VulkanBuffer;
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    struct Options {
+        std::string outputPath = "rengine_bench.json";
+        std::string shaderPath;     // Shader benchmarks are skipped without one
+        std::string filter;         // Substring of the benchmark names to run
+        uint32_t iterations = 0;    // 0 keeps each benchmark's default
+        uint32_t width = 1280;
+        uint32_t height = 720;
+    };
+
+    struct Result {
+        std::string name;
+        uint32_t iterations = 0;
+        double minMS = 0.0;
+        double meanMS = 0.0;
+        double p50MS = 0.0;
+        double p95MS = 0.0;
+        double p99MS = 0.0;
+        double maxMS = 0.0;
+        double throughputMBps = 0.0;  // 0 when the benchmark moves no data
+    };
+
+    void PrintUsage() {
+        std::cout << "Usage: rengine_bench [options]\n"
+                  << "  --out <file>         JSON results (default rengine_bench.json)\n"
+                  << "  --filter <text>      Only run benchmarks whose name contains text\n"
+                  << "  --iterations <n>     Override every benchmark's iteration count\n"
+                  << "  --shader <file.spv>  Enables the shader load benchmarks\n"
+                  << "  --size <w> <h>       Headless frame size (default 1280 720)\n";
+    }
+
+    bool ParseOptions(const int argc, char* argv[], Options& options) {
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+            const bool hasValue = i + 1 < argc;
+
+            if (arg == "--out" && hasValue) {
+                options.outputPath = argv[++i];
+            } else if (arg == "--filter" && hasValue) {
+                options.filter = argv[++i];
+            } else if (arg == "--iterations" && hasValue) {
+                options.iterations = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else if (arg == "--shader" && hasValue) {
+                options.shaderPath = argv[++i];
+            } else if (arg == "--size" && i + 2 < argc) {
+                options.width = static_cast<uint32_t>(std::stoul(argv[++i]));
+                options.height = static_cast<uint32_t>(std::stoul(argv[++i]));
+            } else {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    double Percentile(const std::vector<double>& sorted, const double percentile) {
+        const size_t rank = static_cast<size_t>(std::ceil(percentile / 100.0 * sorted.size()));
+        return sorted[std::clamp<size_t>(rank, 1, sorted.size()) - 1];
+    }
+
+    std::string Escape(const std::string& text) {
+        std::string escaped;
+        for (const char c : text) {
+            if (c == '"' || c == '\\') {
+                escaped += '\\';
+            }
+            escaped += c;
+        }
+        return escaped;
+    }
+
+    Shader::Stage StageFromPath(const std::string& path) {
+        if (path.find("frag") != std::string::npos) return Shader::FRAGMENT;
+        if (path.find("comp") != std::string::npos) return Shader::COMPUTE;
+        return Shader::VERTEX;
+    }
+
+    class Bench {
+    public:
+        Bench(VulkanRenderer& renderer, const Options& options)
+            : m_renderer(renderer), m_options(options) {}
+
+        // Times body once per iteration after a few untimed warmup runs.
+        // teardown runs after each iteration outside the measurement.
+        void Run(
+            const std::string& name,
+            uint32_t iterations,
+            const std::function<void()>& body,
+            const std::function<void()>& teardown = {},
+            const double bytesPerIteration = 0.0
+        ) {
+            if (!m_options.filter.empty() && name.find(m_options.filter) == std::string::npos) {
+                return;
+            }
+            if (m_options.iterations > 0) {
+                iterations = m_options.iterations;
+            }
+
+            const uint32_t warmup = std::max(1u, iterations / 10);
+            for (uint32_t i = 0; i < warmup; i++) {
+                body();
+                if (teardown) teardown();
+            }
+
+            std::vector<double> samples;
+            samples.reserve(iterations);
+            for (uint32_t i = 0; i < iterations; i++) {
+                const auto start = Clock::now();
+                body();
+                samples.push_back(std::chrono::duration<double, std::milli>(Clock::now() - start).count());
+                if (teardown) teardown();
+            }
+
+            std::sort(samples.begin(), samples.end());
+
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.minMS = samples.front();
+            result.maxMS = samples.back();
+            for (const double sample : samples) {
+                result.meanMS += sample;
+            }
+            result.meanMS /= samples.size();
+            result.p50MS = Percentile(samples, 50.0);
+            result.p95MS = Percentile(samples, 95.0);
+            result.p99MS = Percentile(samples, 99.0);
+            if (bytesPerIteration > 0.0 && result.meanMS > 0.0) {
+                result.throughputMBps = bytesPerIteration / (1024.0 * 1024.0) / (result.meanMS * 0.001);
+            }
+
+            std::printf("%-44s %7u it  mean %9.4f ms  p50 %9.4f  p99 %9.4f", name.c_str(), iterations,
+                        result.meanMS, result.p50MS, result.p99MS);
+            if (result.throughputMBps > 0.0) {
+                std::printf("  %9.1f MB/s", result.throughputMBps);
+            }
+            std::printf("\n");
+
+            m_results.push_back(result);
+        }
+
+        void BufferChurn() {
+            struct Case {
+                const char* name;
+                VkDeviceSize size;
+                VkBufferUsageFlags usage;
+                VkMemoryPropertyFlags properties;
+                uint32_t iterations;
+            };
+            const Case cases[] = {
+                {"device_local/256B", 256, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 10000},
+                {"device_local/64KB", 64 * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 10000},
+                {"device_local/4MB", 4 * 1024 * 1024, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 2000},
+                {"device_local/128MB", 128ull * 1024 * 1024, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, 100},
+                {"host_visible/64KB", 64 * 1024, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, 10000},
+            };
+
+            for (const auto& c : cases) {
+                VulkanBuffer buffer;
+                Run(std::string("buffer_churn/") + c.name, c.iterations, [&] {
+                    buffer.Create(m_renderer.GetAllocator(), c.size, c.usage, c.properties);
+                    buffer.Destroy();
+                });
+            }
+        }
+
+        void TextureUpload() {
+            const uint32_t sizes[] = {256, 1024, 2048};
+            for (const uint32_t size : sizes) {
+                // Fixed pattern so every run uploads the same bytes
+                std::vector<uint8_t> pixels(static_cast<size_t>(size) * size * 4);
+                for (size_t i = 0; i < pixels.size(); i++) {
+                    pixels[i] = static_cast<uint8_t>(i * 2654435761u >> 24);
+                }
+
+                for (const bool mips : {false, true}) {
+                    std::unique_ptr<Texture> texture;
+                    const std::string name = "texture_upload/" + std::to_string(size) + (mips ? "/mips" : "/no_mips");
+                    Run(name, size >= 2048 ? 50 : 200,
+                        [&] {
+                            texture = std::make_unique<Texture>();
+                            texture->CreateFromData(m_renderer, pixels.data(), size, size, VK_FORMAT_R8G8B8A8_UNORM, mips);
+                            texture->WaitUntilReady();
+                        },
+                        [&] {
+                            // No frames run here, so retired images are only freed by the flush
+                            texture.reset();
+                            m_renderer.FlushRetired();
+                            m_renderer.GetUploadManager().Update();
+                            m_renderer.GetStagingRing().Reclaim();
+                        },
+                        static_cast<double>(pixels.size()));
+                }
+            }
+        }
+
+        void ShaderLoad() {
+            if (m_options.shaderPath.empty()) {
+                std::cout << "shader_load skipped, pass --shader <file.spv>" << std::endl;
+                return;
+            }
+
+            const Shader::Stage stage = StageFromPath(m_options.shaderPath);
+            std::unique_ptr<Shader> shader;
+            const auto destroy = [&] { shader.reset(); };
+
+            // Read, hash and reflect every time
+            Run("shader_load/reflect", 500, [&] {
+                m_renderer.GetShaderCache().Clear();
+                shader = std::make_unique<Shader>(m_renderer);
+                shader->LoadFromFile(m_options.shaderPath, stage);
+            }, destroy);
+
+            // Served from the shader cache, only the module is created
+            Run("shader_load/cached", 500, [&] {
+                shader = std::make_unique<Shader>(m_renderer);
+                shader->LoadFromFile(m_options.shaderPath, stage);
+            }, destroy);
+
+            Run("shader_load/reflect_and_layout", 500, [&] {
+                m_renderer.GetShaderCache().Clear();
+                shader = std::make_unique<Shader>(m_renderer);
+                shader->LoadFromFile(m_options.shaderPath, stage);
+                shader->BuildPipelineLayout();
+            }, destroy);
+        }
+
+        void FrameLoop() {
+            const PresentConfig original = m_renderer.GetPresentConfig();
+
+            for (const uint32_t framesInFlight : {1u, 2u, 3u}) {
+                PresentConfig config = original;
+                config.framesInFlight = framesInFlight;
+                m_renderer.SetPresentConfig(config);
+
+                Run("frame_loop/" + std::to_string(framesInFlight) + "_in_flight", 2000, [&] {
+                    if (m_renderer.BeginFrame()) {
+                        m_renderer.EndFrame();
+                    }
+                });
+            }
+
+            // Fan-out, secondary command buffer and render pass split cost of parallel recording
+            const std::vector<std::function<void(VkCommandBuffer)>> tasks(64, [](VkCommandBuffer) {});
+            Run("frame_loop/parallel_64_tasks", 2000, [&] {
+                if (m_renderer.BeginFrame()) {
+                    m_renderer.RecordParallel(tasks);
+                    m_renderer.EndFrame();
+                }
+            });
+
+            m_renderer.SetPresentConfig(original);
+            vkDeviceWaitIdle(m_renderer.GetDevice());
+        }
+
+        bool WriteJson(const std::string& path) const {
+            std::ofstream file(path, std::ios::trunc);
+            if (!file.is_open()) {
+                return false;
+            }
+
+            const VkPhysicalDeviceProperties& properties = m_renderer.GetAllocator().GetDeviceProperties();
+
+            char timestamp[32] = {};
+            const std::time_t now = std::time(nullptr);
+            std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+            file.precision(6);
+            file << std::fixed;
+            file << "{\n"
+                 << "  \"timestamp\": \"" << timestamp << "\",\n"
+                 << "  \"device\": \"" << Escape(properties.deviceName) << "\",\n"
+                 << "  \"driverVersion\": " << properties.driverVersion << ",\n"
+                 << "  \"vendorID\": " << properties.vendorID << ",\n"
+                 << "  \"width\": " << m_options.width << ",\n"
+                 << "  \"height\": " << m_options.height << ",\n"
+                 << "  \"benchmarks\": [";
+
+            for (size_t i = 0; i < m_results.size(); i++) {
+                const Result& result = m_results[i];
+                file << (i == 0 ? "\n" : ",\n")
+                     << "    {\"name\": \"" << Escape(result.name) << "\""
+                     << ", \"iterations\": " << result.iterations
+                     << ", \"minMS\": " << result.minMS
+                     << ", \"meanMS\": " << result.meanMS
+                     << ", \"p50MS\": " << result.p50MS
+                     << ", \"p95MS\": " << result.p95MS
+                     << ", \"p99MS\": " << result.p99MS
+                     << ", \"maxMS\": " << result.maxMS;
+                if (result.throughputMBps > 0.0) {
+                    file << ", \"throughputMBps\": " << result.throughputMBps;
+                }
+                file << "}";
+            }
+
+            file << "\n  ]\n}\n";
+            return file.good();
+        }
+
+    private:
+        VulkanRenderer& m_renderer;
+        const Options& m_options;
+        std::vector<Result> m_results;
+    };
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options)) {
+        PrintUsage();
+        return 1;
+    }
+
+    REngine::REngineCore::Init();
+
+    // Headless, so it runs on build machines without a GPU or display (lavapipe, SwiftShader)
+    VulkanRenderer renderer;
+    if (!renderer.InitializeHeadless(options.width, options.height)) {
+        std::cerr << "Renderer initialization failed!" << std::endl;
+        return 1;
+    }
+
+    // Reloads would make the shader timings depend on the file system
+    renderer.GetShaderHotReloader().SetEnabled(false);
+
+    int exitCode = 0;
+    {
+        Bench bench(renderer, options);
+        try {
+            bench.BufferChurn();
+            bench.TextureUpload();
+            bench.ShaderLoad();
+            bench.FrameLoop();
+        } catch (const std::exception& e) {
+            std::cerr << "Benchmark failed: " << e.what() << std::endl;
+            exitCode = 1;
+        }
+
+        if (!bench.WriteJson(options.outputPath)) {
+            std::cerr << "Failed to write " << options.outputPath << std::endl;
+            exitCode = 1;
+        } else {
+            std::cout << "Results written to " << options.outputPath << std::endl;
+        }
+    }
+
+    renderer.Shutdown();
+    return exitCode;
+}
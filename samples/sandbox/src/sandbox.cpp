@@ -1,4 +1,5 @@
 ﻿#include <iostream>
+#include <memory>
 #include <core/REngineCore.h>
 
 int main() {
@@ -23,19 +24,33 @@ int main() {
 
     renderer.InitImGui(window.GetNativeWindow());
 
-    const auto texture = new Texture();
-    texture->CreateFromFile(
-        renderer.GetDevice(),
-        renderer.GetPhysicalDevice(),
-        renderer.GetCommandPool(),
-        renderer.GetQueue(),
-        "d:/test/001.png");
+    auto resources = std::make_unique<ResourceManager>(renderer);
+    auto texture = resources->LoadTexture("d:/test/001.png");
+
+    RProfiler::SetThreadName("Main");
+    bool traceKeyDown = false;
 
     while (window.IsRunning()) {
+        RProfiler::NewFrame();
         window.Run();
         RTime::Update();
+
+        // F12 dumps the last frames as a Chrome trace (chrome://tracing or ui.perfetto.dev)
+        const bool traceKey = SDL_GetKeyboardState(nullptr)[SDL_SCANCODE_F12] != 0;
+        if (traceKey && !traceKeyDown) {
+            RProfiler::WriteChromeTrace("rengine_trace.json");
+        }
+        traceKeyDown = traceKey;
+
+        resources->Update();
         renderer.ProcessImGuiEvents(window.SDL_GetEvent());
-        renderer.BeginFrame();
+        if (!renderer.BeginFrame()) {
+            // No swapchain while minimized, don't spin
+            if (SDL_GetWindowFlags(window.GetNativeWindow()) & SDL_WINDOW_MINIMIZED) {
+                SDL_Delay(10);
+            }
+            continue;
+        }
         renderer.RenderImGui();
         renderer.EndFrame();
 
@@ -46,6 +61,10 @@ int main() {
         }
     }
 
+    // Resources must go before the device does
+    texture = {};
+    resources.reset();
+
     renderer.ShutdownImGui();
     renderer.Shutdown();
     SDL_DestroyWindow(window.GetNativeWindow());
@@ -0,0 +1,193 @@
+﻿#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include <RAssetPack.h>
+#include <RCompression.h>
+#include <RHash.h>
+
+using REngine::PackCodec;
+using REngine::PackEntry;
+using REngine::PackEntryType;
+using REngine::PackHeader;
+using REngine::RAssetPack;
+
+namespace {
+    struct Options {
+        std::string outputPath;
+        std::string inputDirectory;
+        uint32_t alignment = RAssetPack::DEFAULT_ALIGNMENT;
+        bool lz4 = false;
+    };
+
+    void PrintUsage() {
+        std::cout << "Usage: rengine_pack [options] <output.rpak> <input directory>\n"
+                  << "  --lz4            Compress entries that shrink by at least 1/8\n"
+                  << "  --align <bytes>  Payload alignment, a power of two (default 64)\n";
+    }
+
+    bool ParseOptions(const int argc, char* argv[], Options& options) {
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+
+            if (arg == "--lz4") {
+                options.lz4 = true;
+            } else if (arg == "--align" && i + 1 < argc) {
+                try {
+                    options.alignment = static_cast<uint32_t>(std::stoul(argv[++i]));
+                } catch (const std::exception&) {
+                    return false;
+                }
+            } else if (arg.rfind("--", 0) == 0) {
+                return false;
+            } else {
+                positional.push_back(arg);
+            }
+        }
+
+        // Payloads hold SPIR-V words at least
+        const uint32_t alignment = options.alignment;
+        if (positional.size() != 2 || alignment < 4 || (alignment & (alignment - 1)) != 0) {
+            return false;
+        }
+        options.outputPath = positional[0];
+        options.inputDirectory = positional[1];
+        return true;
+    }
+
+    PackEntryType GetEntryType(std::string extension) {
+        std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+        if (extension == ".spv") {
+            return PackEntryType::Shader;
+        }
+        if (extension == ".ktx2" || extension == ".dds" || extension == ".png" || extension == ".jpg" ||
+            extension == ".jpeg" || extension == ".tga" || extension == ".bmp") {
+            return PackEntryType::Texture;
+        }
+        return PackEntryType::Raw;
+    }
+
+    void WritePadding(std::ofstream& file, const uint32_t alignment) {
+        static const char zeros[4096] = {};
+        const uint64_t position = static_cast<uint64_t>(file.tellp());
+        uint64_t padding = (alignment - position % alignment) % alignment;
+        while (padding > 0) {
+            const uint64_t chunk = std::min<uint64_t>(padding, sizeof(zeros));
+            file.write(zeros, static_cast<std::streamsize>(chunk));
+            padding -= chunk;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    if (!ParseOptions(argc, argv, options) || !std::filesystem::is_directory(options.inputDirectory)) {
+        PrintUsage();
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Sorted, so the same directory always gives the same pack
+    std::vector<std::filesystem::path> files;
+    for (const auto& item : std::filesystem::recursive_directory_iterator(options.inputDirectory)) {
+        if (item.is_regular_file()) {
+            files.push_back(item.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    std::ofstream file(options.outputPath, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        std::cerr << "Failed to open " << options.outputPath << std::endl;
+        return 1;
+    }
+
+    PackHeader header{};
+    header.magic = RAssetPack::MAGIC;
+    header.version = RAssetPack::VERSION;
+    header.alignment = options.alignment;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    std::vector<PackEntry> entries;
+    std::string names;
+    uint64_t totalSize = 0;
+    uint64_t storedSize = 0;
+    for (const std::filesystem::path& path : files) {
+        // The pack may be written into the directory it packs
+        if (std::filesystem::equivalent(path, options.outputPath)) {
+            continue;
+        }
+
+        std::ifstream input(path, std::ios::binary);
+        const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(input)), std::istreambuf_iterator<char>());
+        if (!input.good() && !input.eof()) {
+            std::cerr << "Failed to read " << path.string() << std::endl;
+            return 1;
+        }
+
+        const std::string name = std::filesystem::relative(path, options.inputDirectory).generic_string();
+
+        PackEntry entry{};
+        entry.nameHash = REngine::HashBytes(name.data(), name.size());
+        entry.size = bytes.size();
+        entry.storedSize = bytes.size();
+        entry.nameOffset = static_cast<uint32_t>(names.size());
+        entry.nameLength = static_cast<uint32_t>(name.size());
+        entry.codec = PackCodec::None;
+        entry.type = GetEntryType(path.extension().string());
+        names += name;
+
+        // Only worth a decompression at load if it saves a fair amount
+        std::vector<uint8_t> compressed;
+        if (options.lz4 && !bytes.empty()) {
+            compressed = REngine::Lz4Compress(bytes.data(), bytes.size());
+            if (compressed.size() <= bytes.size() - bytes.size() / 8) {
+                entry.codec = PackCodec::LZ4;
+                entry.storedSize = compressed.size();
+            }
+        }
+
+        WritePadding(file, options.alignment);
+        entry.offset = static_cast<uint64_t>(file.tellp());
+        const std::vector<uint8_t>& payload = entry.codec == PackCodec::LZ4 ? compressed : bytes;
+        file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+        entries.push_back(entry);
+
+        totalSize += entry.size;
+        storedSize += entry.storedSize;
+    }
+
+    // Lookups binary search by hash, colliding names sit next to each other
+    std::stable_sort(entries.begin(), entries.end(), [](const PackEntry& a, const PackEntry& b) {
+        return a.nameHash < b.nameHash;
+    });
+
+    WritePadding(file, alignof(PackEntry));
+    header.entryCount = static_cast<uint32_t>(entries.size());
+    header.tocOffset = static_cast<uint64_t>(file.tellp());
+    file.write(reinterpret_cast<const char*>(entries.data()), static_cast<std::streamsize>(entries.size() * sizeof(PackEntry)));
+    header.namesOffset = static_cast<uint64_t>(file.tellp());
+    file.write(names.data(), static_cast<std::streamsize>(names.size()));
+
+    file.seekp(0);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.close();
+    if (!file) {
+        std::cerr << "Failed to write " << options.outputPath << std::endl;
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << options.outputPath << ": " << entries.size() << " entries, " << totalSize / 1024 << " KB, "
+              << storedSize / 1024 << " KB stored (" << seconds << " s)" << std::endl;
+    return 0;
+}
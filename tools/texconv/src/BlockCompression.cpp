@@ -0,0 +1,303 @@
+﻿#include "BlockCompression.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace TexConv {
+    namespace {
+        // Principal axis of the texels over the first channelCount channels, by power iteration
+        void PrincipalAxis(const uint8_t* texels, const uint32_t channelCount, float* mean, float* axis) {
+            float covariance[4][4] = {};
+            for (uint32_t c = 0; c < channelCount; c++) {
+                mean[c] = 0.0f;
+                for (uint32_t i = 0; i < 16; i++) {
+                    mean[c] += texels[i * 4 + c];
+                }
+                mean[c] /= 16.0f;
+            }
+            for (uint32_t i = 0; i < 16; i++) {
+                for (uint32_t a = 0; a < channelCount; a++) {
+                    for (uint32_t b = 0; b < channelCount; b++) {
+                        covariance[a][b] += (texels[i * 4 + a] - mean[a]) * (texels[i * 4 + b] - mean[b]);
+                    }
+                }
+            }
+
+            for (uint32_t c = 0; c < channelCount; c++) {
+                axis[c] = 1.0f;
+            }
+            for (int iteration = 0; iteration < 8; iteration++) {
+                float next[4] = {};
+                float length = 0.0f;
+                for (uint32_t a = 0; a < channelCount; a++) {
+                    for (uint32_t b = 0; b < channelCount; b++) {
+                        next[a] += covariance[a][b] * axis[b];
+                    }
+                    length = std::max(length, std::fabs(next[a]));
+                }
+                if (length == 0.0f) {
+                    return;  // Flat block, any axis works
+                }
+                for (uint32_t c = 0; c < channelCount; c++) {
+                    axis[c] = next[c] / length;
+                }
+            }
+        }
+
+        // Texels with the lowest and highest projection on the principal axis
+        void AxisEndpoints(const uint8_t* texels, const uint32_t channelCount, float* low, float* high) {
+            float mean[4];
+            float axis[4];
+            PrincipalAxis(texels, channelCount, mean, axis);
+
+            float minProjection = 0.0f;
+            float maxProjection = 0.0f;
+            for (uint32_t i = 0; i < 16; i++) {
+                float projection = 0.0f;
+                for (uint32_t c = 0; c < channelCount; c++) {
+                    projection += (texels[i * 4 + c] - mean[c]) * axis[c];
+                }
+                minProjection = std::min(minProjection, projection);
+                maxProjection = std::max(maxProjection, projection);
+            }
+
+            float axisLength = 0.0f;
+            for (uint32_t c = 0; c < channelCount; c++) {
+                axisLength += axis[c] * axis[c];
+            }
+            axisLength = std::max(axisLength, 1e-6f);
+            for (uint32_t c = 0; c < channelCount; c++) {
+                low[c] = std::clamp(mean[c] + axis[c] * minProjection / axisLength, 0.0f, 255.0f);
+                high[c] = std::clamp(mean[c] + axis[c] * maxProjection / axisLength, 0.0f, 255.0f);
+            }
+        }
+
+        uint16_t PackRGB565(const float* color) {
+            const auto r = static_cast<uint16_t>(std::lround(color[0] * 31.0f / 255.0f));
+            const auto g = static_cast<uint16_t>(std::lround(color[1] * 63.0f / 255.0f));
+            const auto b = static_cast<uint16_t>(std::lround(color[2] * 31.0f / 255.0f));
+            return static_cast<uint16_t>(r << 11 | g << 5 | b);
+        }
+
+        void UnpackRGB565(const uint16_t packed, int* color) {
+            const int r = packed >> 11 & 31;
+            const int g = packed >> 5 & 63;
+            const int b = packed & 31;
+            color[0] = r << 3 | r >> 2;
+            color[1] = g << 2 | g >> 4;
+            color[2] = b << 3 | b >> 2;
+        }
+
+        int Distance(const uint8_t* texel, const int* color, const uint32_t channelCount) {
+            int distance = 0;
+            for (uint32_t c = 0; c < channelCount; c++) {
+                const int delta = texel[c] - color[c];
+                distance += delta * delta;
+            }
+            return distance;
+        }
+
+        // Appends count bits of value at bit position
+        void WriteBits(uint8_t* block, uint32_t& position, const uint32_t value, const uint32_t count) {
+            for (uint32_t bit = 0; bit < count; bit++, position++) {
+                if (value >> bit & 1) {
+                    block[position / 8] |= static_cast<uint8_t>(1u << (position % 8));
+                }
+            }
+        }
+    }
+
+    uint32_t GetBlockBytes(const BlockFormat format) {
+        return format == BlockFormat::BC1 || format == BlockFormat::BC4 ? 8 : 16;
+    }
+
+    void EncodeBC1(const uint8_t* texels, uint8_t* block) {
+        float low[3];
+        float high[3];
+        AxisEndpoints(texels, 3, low, high);
+
+        // Four color mode needs color0 > color1
+        uint16_t color0 = PackRGB565(high);
+        uint16_t color1 = PackRGB565(low);
+        if (color0 < color1) {
+            std::swap(color0, color1);
+        }
+
+        int palette[4][3];
+        UnpackRGB565(color0, palette[0]);
+        UnpackRGB565(color1, palette[1]);
+        for (int c = 0; c < 3; c++) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+
+        uint32_t indices = 0;
+        if (color0 != color1) {
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t best = 0;
+                int bestDistance = Distance(texels + i * 4, palette[0], 3);
+                for (uint32_t p = 1; p < 4; p++) {
+                    const int distance = Distance(texels + i * 4, palette[p], 3);
+                    if (distance < bestDistance) {
+                        best = p;
+                        bestDistance = distance;
+                    }
+                }
+                indices |= best << (i * 2);
+            }
+        }
+
+        std::memcpy(block, &color0, 2);
+        std::memcpy(block + 2, &color1, 2);
+        std::memcpy(block + 4, &indices, 4);
+    }
+
+    void EncodeBC4(const uint8_t* texels, uint8_t* block, const uint32_t channel) {
+        int low = 255;
+        int high = 0;
+        for (uint32_t i = 0; i < 16; i++) {
+            low = std::min<int>(low, texels[i * 4 + channel]);
+            high = std::max<int>(high, texels[i * 4 + channel]);
+        }
+
+        // Eight value mode: red0 > red1, the six values between interpolated
+        int palette[8] = {high, low};
+        for (int p = 1; p < 7; p++) {
+            palette[p + 1] = ((7 - p) * high + p * low) / 7;
+        }
+
+        std::memset(block, 0, 8);
+        block[0] = static_cast<uint8_t>(high);
+        block[1] = static_cast<uint8_t>(low);
+        uint32_t position = 16;
+        for (uint32_t i = 0; i < 16; i++) {
+            uint32_t best = 0;
+            int bestDistance = 256;
+            for (uint32_t p = 0; p < 8; p++) {
+                const int distance = std::abs(texels[i * 4 + channel] - palette[p]);
+                if (distance < bestDistance) {
+                    best = p;
+                    bestDistance = distance;
+                }
+            }
+            WriteBits(block, position, best, 3);
+        }
+    }
+
+    void EncodeBC3(const uint8_t* texels, uint8_t* block) {
+        EncodeBC4(texels, block, 3);
+        EncodeBC1(texels, block + 8);
+    }
+
+    void EncodeBC5(const uint8_t* texels, uint8_t* block) {
+        EncodeBC4(texels, block, 0);
+        EncodeBC4(texels, block + 8, 1);
+    }
+
+    void EncodeBC7(const uint8_t* texels, uint8_t* block) {
+        // Mode 6: one subset, 7 bit RGBA endpoints with a shared low bit each, 4 bit indices
+        static constexpr int WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+        float endpoints[2][4];
+        AxisEndpoints(texels, 4, endpoints[0], endpoints[1]);
+
+        // Per endpoint, the low bit that loses the least precision
+        uint32_t quantized[2][4];
+        uint32_t pBits[2];
+        int colors[2][4];
+        for (int e = 0; e < 2; e++) {
+            float bestError = 0.0f;
+            for (uint32_t p = 0; p < 2; p++) {
+                uint32_t candidate[4];
+                float error = 0.0f;
+                for (int c = 0; c < 4; c++) {
+                    const float value = (endpoints[e][c] - static_cast<float>(p)) / 2.0f;
+                    candidate[c] = static_cast<uint32_t>(std::clamp(std::lround(value), 0l, 127l));
+                    const float delta = static_cast<float>(candidate[c] * 2 + p) - endpoints[e][c];
+                    error += delta * delta;
+                }
+                if (p == 0 || error < bestError) {
+                    bestError = error;
+                    pBits[e] = p;
+                    std::memcpy(quantized[e], candidate, sizeof(candidate));
+                }
+            }
+            for (int c = 0; c < 4; c++) {
+                colors[e][c] = static_cast<int>(quantized[e][c] * 2 + pBits[e]);
+            }
+        }
+
+        int palette[16][4];
+        for (int p = 0; p < 16; p++) {
+            for (int c = 0; c < 4; c++) {
+                palette[p][c] = ((64 - WEIGHTS[p]) * colors[0][c] + WEIGHTS[p] * colors[1][c] + 32) >> 6;
+            }
+        }
+
+        uint32_t indices[16];
+        for (uint32_t i = 0; i < 16; i++) {
+            indices[i] = 0;
+            int bestDistance = Distance(texels + i * 4, palette[0], 4);
+            for (uint32_t p = 1; p < 16; p++) {
+                const int distance = Distance(texels + i * 4, palette[p], 4);
+                if (distance < bestDistance) {
+                    indices[i] = p;
+                    bestDistance = distance;
+                }
+            }
+        }
+
+        // The first index is stored without its top bit, which must be clear
+        if (indices[0] >= 8) {
+            std::swap(quantized[0], quantized[1]);
+            std::swap(pBits[0], pBits[1]);
+            for (uint32_t& index : indices) {
+                index = 15 - index;
+            }
+        }
+
+        std::memset(block, 0, 16);
+        uint32_t position = 0;
+        WriteBits(block, position, 1u << 6, 7);
+        for (int c = 0; c < 4; c++) {
+            WriteBits(block, position, quantized[0][c], 7);
+            WriteBits(block, position, quantized[1][c], 7);
+        }
+        WriteBits(block, position, pBits[0], 1);
+        WriteBits(block, position, pBits[1], 1);
+        WriteBits(block, position, indices[0], 3);
+        for (uint32_t i = 1; i < 16; i++) {
+            WriteBits(block, position, indices[i], 4);
+        }
+    }
+
+    std::vector<uint8_t> CompressImage(const uint8_t* rgba, const uint32_t width, const uint32_t height, const BlockFormat format) {
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        const uint32_t blockBytes = GetBlockBytes(format);
+        std::vector<uint8_t> blocks(static_cast<size_t>(blocksX) * blocksY * blockBytes);
+
+        uint8_t texels[64];
+        for (uint32_t by = 0; by < blocksY; by++) {
+            for (uint32_t bx = 0; bx < blocksX; bx++) {
+                for (uint32_t y = 0; y < 4; y++) {
+                    for (uint32_t x = 0; x < 4; x++) {
+                        const uint32_t sx = std::min(bx * 4 + x, width - 1);
+                        const uint32_t sy = std::min(by * 4 + y, height - 1);
+                        std::memcpy(texels + (y * 4 + x) * 4, rgba + (static_cast<size_t>(sy) * width + sx) * 4, 4);
+                    }
+                }
+
+                uint8_t* block = blocks.data() + (static_cast<size_t>(by) * blocksX + bx) * blockBytes;
+                switch (format) {
+                    case BlockFormat::BC1: EncodeBC1(texels, block); break;
+                    case BlockFormat::BC3: EncodeBC3(texels, block); break;
+                    case BlockFormat::BC4: EncodeBC4(texels, block); break;
+                    case BlockFormat::BC5: EncodeBC5(texels, block); break;
+                    case BlockFormat::BC7: EncodeBC7(texels, block); break;
+                }
+            }
+        }
+        return blocks;
+    }
+}
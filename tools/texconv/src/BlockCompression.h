@@ -0,0 +1,25 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace TexConv {
+    enum class BlockFormat {
+        BC1,    // RGB, alpha is dropped
+        BC3,    // RGBA
+        BC4,    // R
+        BC5,    // RG, for normal maps
+        BC7     // RGBA, mode 6 only
+    };
+
+    uint32_t GetBlockBytes(BlockFormat format);
+
+    // Each encoder takes 16 RGBA8 texels in row order
+    void EncodeBC1(const uint8_t* texels, uint8_t* block);
+    void EncodeBC3(const uint8_t* texels, uint8_t* block);
+    void EncodeBC4(const uint8_t* texels, uint8_t* block, uint32_t channel = 0);
+    void EncodeBC5(const uint8_t* texels, uint8_t* block);
+    void EncodeBC7(const uint8_t* texels, uint8_t* block);
+
+    // Blocks in row order; edge blocks repeat the last row and column
+    std::vector<uint8_t> CompressImage(const uint8_t* rgba, uint32_t width, uint32_t height, BlockFormat format);
+}
@@ -0,0 +1,209 @@
+﻿#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <stb_image.h>
+#include <renderers/TextureFile.h>
+#include "BlockCompression.h"
+
+using REngine::TextureFile;
+using REngine::TextureFileData;
+using REngine::TextureLevel;
+using TexConv::BlockFormat;
+
+namespace {
+    struct Options {
+        std::string inputPath;
+        std::string outputPath;
+        std::string format = "bc7";
+        bool srgb = true;           // Ignored by bc4 and bc5, which hold data
+        bool generateMipmaps = true;
+    };
+
+    struct Image {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        std::vector<uint8_t> rgba;
+    };
+
+    void PrintUsage() {
+        std::cout << "Usage: rengine_texconv [options] <input image> <output.ktx2>\n"
+                  << "  --format <name>  rgba8, bc1, bc3, bc4, bc5 or bc7 (default bc7)\n"
+                  << "  --linear         Store color formats as UNORM instead of sRGB\n"
+                  << "  --no-mips        Only write the base level\n";
+    }
+
+    bool ParseOptions(const int argc, char* argv[], Options& options) {
+        std::vector<std::string> positional;
+        for (int i = 1; i < argc; i++) {
+            const std::string arg = argv[i];
+
+            if (arg == "--format" && i + 1 < argc) {
+                options.format = argv[++i];
+            } else if (arg == "--linear") {
+                options.srgb = false;
+            } else if (arg == "--no-mips") {
+                options.generateMipmaps = false;
+            } else if (arg.rfind("--", 0) == 0) {
+                return false;
+            } else {
+                positional.push_back(arg);
+            }
+        }
+
+        if (positional.size() != 2) {
+            return false;
+        }
+        options.inputPath = positional[0];
+        options.outputPath = positional[1];
+        return true;
+    }
+
+    bool GetFormat(const Options& options, VkFormat& format, bool& compressed, BlockFormat& blockFormat) {
+        compressed = true;
+        if (options.format == "rgba8") {
+            compressed = false;
+            format = options.srgb ? VK_FORMAT_R8G8B8A8_SRGB : VK_FORMAT_R8G8B8A8_UNORM;
+        } else if (options.format == "bc1") {
+            blockFormat = BlockFormat::BC1;
+            format = options.srgb ? VK_FORMAT_BC1_RGBA_SRGB_BLOCK : VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        } else if (options.format == "bc3") {
+            blockFormat = BlockFormat::BC3;
+            format = options.srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+        } else if (options.format == "bc4") {
+            blockFormat = BlockFormat::BC4;
+            format = VK_FORMAT_BC4_UNORM_BLOCK;
+        } else if (options.format == "bc5") {
+            blockFormat = BlockFormat::BC5;
+            format = VK_FORMAT_BC5_UNORM_BLOCK;
+        } else if (options.format == "bc7") {
+            blockFormat = BlockFormat::BC7;
+            format = options.srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    float ToLinear(const uint8_t value) {
+        const float c = value / 255.0f;
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    uint8_t FromLinear(const float value) {
+        const float c = value <= 0.0031308f ? value * 12.92f : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f));
+    }
+
+    // 2x2 box filter, averaging sRGB colors in linear space like the runtime mip generator.
+    // Odd edges reuse their last row or column.
+    Image Downsample(const Image& source, const bool srgb) {
+        static float linear[256];
+        static const bool linearReady = [] {
+            for (int i = 0; i < 256; i++) {
+                linear[i] = ToLinear(static_cast<uint8_t>(i));
+            }
+            return true;
+        }();
+        (void)linearReady;
+
+        Image level;
+        level.width = std::max(source.width / 2, 1u);
+        level.height = std::max(source.height / 2, 1u);
+        level.rgba.resize(static_cast<size_t>(level.width) * level.height * 4);
+
+        for (uint32_t y = 0; y < level.height; y++) {
+            for (uint32_t x = 0; x < level.width; x++) {
+                const uint32_t x0 = std::min(x * 2, source.width - 1);
+                const uint32_t x1 = std::min(x * 2 + 1, source.width - 1);
+                const uint32_t y0 = std::min(y * 2, source.height - 1);
+                const uint32_t y1 = std::min(y * 2 + 1, source.height - 1);
+                const uint8_t* texels[4] = {
+                    &source.rgba[(static_cast<size_t>(y0) * source.width + x0) * 4],
+                    &source.rgba[(static_cast<size_t>(y0) * source.width + x1) * 4],
+                    &source.rgba[(static_cast<size_t>(y1) * source.width + x0) * 4],
+                    &source.rgba[(static_cast<size_t>(y1) * source.width + x1) * 4],
+                };
+
+                uint8_t* out = &level.rgba[(static_cast<size_t>(y) * level.width + x) * 4];
+                for (int c = 0; c < 4; c++) {
+                    // sRGB never applies to alpha
+                    const bool toLinear = srgb && c < 3;
+                    float sum = 0.0f;
+                    for (const uint8_t* texel : texels) {
+                        sum += toLinear ? linear[texel[c]] : static_cast<float>(texel[c]);
+                    }
+                    out[c] = toLinear ? FromLinear(sum / 4.0f) : static_cast<uint8_t>(std::lround(sum / 4.0f));
+                }
+            }
+        }
+        return level;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    bool compressed = false;
+    BlockFormat blockFormat = BlockFormat::BC7;
+    if (!ParseOptions(argc, argv, options) || !GetFormat(options, format, compressed, blockFormat)) {
+        PrintUsage();
+        return 1;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load(options.inputPath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+    if (!pixels) {
+        std::cerr << "Failed to load " << options.inputPath << ": " << stbi_failure_reason() << std::endl;
+        return 1;
+    }
+
+    std::vector<Image> levels(1);
+    levels[0].width = static_cast<uint32_t>(width);
+    levels[0].height = static_cast<uint32_t>(height);
+    levels[0].rgba.assign(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    const bool srgb = options.srgb && format != VK_FORMAT_BC4_UNORM_BLOCK && format != VK_FORMAT_BC5_UNORM_BLOCK;
+    while (options.generateMipmaps && (levels.back().width > 1 || levels.back().height > 1)) {
+        levels.push_back(Downsample(levels.back(), srgb));
+    }
+
+    TextureFileData data;
+    data.format = format;
+    data.width = levels[0].width;
+    data.height = levels[0].height;
+    for (const Image& image : levels) {
+        std::vector<uint8_t> encoded = compressed ?
+            TexConv::CompressImage(image.rgba.data(), image.width, image.height, blockFormat) : image.rgba;
+
+        TextureLevel level;
+        level.offset = data.bytes.size();
+        level.size = encoded.size();
+        level.width = image.width;
+        level.height = image.height;
+        data.levels.push_back(level);
+        data.bytes.insert(data.bytes.end(), encoded.begin(), encoded.end());
+    }
+
+    try {
+        TextureFile::WriteKtx2(options.outputPath, data);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << options.outputPath << ": " << options.format << (srgb ? " srgb" : "") << ", "
+              << data.width << "x" << data.height << ", " << data.levels.size() << " levels, "
+              << data.bytes.size() / 1024 << " KB (" << seconds << " s)" << std::endl;
+    return 0;
+}